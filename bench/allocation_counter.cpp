@@ -0,0 +1,48 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include <sys/resource.h>
+
+#include "allocation_counter.hpp"
+
+namespace {
+    std::atomic<std::size_t> allocations{0};
+}
+
+void *operator new(std::size_t const size)
+{
+    ++allocations;
+    if (auto const p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void *const p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *const p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace templa {
+namespace bench {
+
+std::size_t allocation_count()
+{
+    return allocations.load();
+}
+
+std::size_t peak_rss_kb()
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<std::size_t>(usage.ru_maxrss);
+}
+
+} // namespace bench
+} // namespace templa
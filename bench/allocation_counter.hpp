@@ -0,0 +1,18 @@
+#if !defined TEMPLA_BENCH_ALLOCATION_COUNTER_HPP_INCLUDED
+#define      TEMPLA_BENCH_ALLOCATION_COUNTER_HPP_INCLUDED
+
+#include <cstddef>
+
+namespace templa {
+namespace bench {
+
+// Number of calls to the global operator new since the program started.
+std::size_t allocation_count();
+
+// Peak resident set size of the process in kilobytes.
+std::size_t peak_rss_kb();
+
+} // namespace bench
+} // namespace templa
+
+#endif    // TEMPLA_BENCH_ALLOCATION_COUNTER_HPP_INCLUDED
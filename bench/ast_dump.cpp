@@ -0,0 +1,46 @@
+#include <string>
+#include <ostream>
+
+#include "parser.hpp"
+#include "ast_dumper.hpp"
+#include "bench.hpp"
+#include "generator.hpp"
+
+namespace templa {
+namespace bench {
+
+namespace {
+
+std::string nested_program(std::size_t const depth)
+{
+    return "f = " + std::string(depth, '(') + "1" + std::string(depth, ')') + "\n";
+}
+
+void ast_dump()
+{
+    syntax::parser p{syntax::parser::backend::recursive_descent};
+
+    auto const tree = p.parse(generate_program(2 * 1024 * 1024));
+    null_buffer buffer;
+    std::ostream out(&buffer);
+    auto const stream_ns = measure_ns([&]{ ast::dump_ast(out, tree); }, 1, 3);
+    auto const string_ns = measure_ns([&]{ ast::dump_ast(tree); }, 1, 3);
+    report("ast_dump/stream (2MB)", stream_ns / 1e6, "ms");
+    report("ast_dump/string (2MB)", string_ns / 1e6, "ms");
+
+    // Text of a nesting grows quadratically with its depth because of the
+    // indentation, so time per byte should stay flat as depth grows.
+    for (std::size_t const depth : {500, 1000, 2000}) {
+        auto const nested = p.parse(nested_program(depth));
+        buffer.written = 0;
+        auto const ns = measure_ns([&]{ ast::dump_ast(out, nested); }, 1, 3);
+        report("ast_dump/nested depth " + std::to_string(depth), ns / (buffer.written / 3.0), "ns/byte");
+    }
+}
+
+registration const _{"ast_dump", ast_dump};
+
+} // namespace
+
+} // namespace bench
+} // namespace templa
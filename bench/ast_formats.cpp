@@ -0,0 +1,53 @@
+#include <string>
+#include <sstream>
+
+#include "parser.hpp"
+#include "ast_json.hpp"
+#include "ast_binary.hpp"
+#include "helper/source_buffer.hpp"
+#include "bench.hpp"
+#include "generator.hpp"
+
+namespace templa {
+namespace bench {
+
+namespace {
+
+// That the formats round trip is checked by the test of the same name
+void ast_formats()
+{
+    auto const code = generate_program(2 * 1024 * 1024);
+    syntax::parser p{syntax::parser::backend::recursive_descent};
+    auto const tree = p.parse(code);
+
+    std::string json;
+    auto const json_ns = measure_ns([&]{
+        std::ostringstream out;
+        ast::dump_ast_json(out, tree);
+        json = out.str();
+    }, 1, 3);
+    std::string binary;
+    auto const binary_ns = measure_ns([&]{
+        std::ostringstream out;
+        ast::save_ast_binary(out, tree);
+        binary = out.str();
+    }, 1, 3);
+    report("ast_formats/emit_json (2MB)", json_ns / 1e6, "ms");
+    report("ast_formats/emit_bin (2MB)", binary_ns / 1e6, "ms");
+    report("ast_formats/json_size (2MB)", json.size() / 1024.0 / 1024.0, "MB");
+    report("ast_formats/bin_size (2MB)", binary.size() / 1024.0 / 1024.0, "MB");
+
+    auto const buffer = helper::source_buffer::copy_of(binary);
+    ast::ast loaded;
+    auto const load_ns = measure_ns([&]{ loaded = ast::load_ast_binary(buffer); }, 1, 3);
+    auto const parse_ns = measure_ns([&]{ p.parse(code); }, 1, 3);
+    report("ast_formats/load_bin (2MB)", load_ns / 1e6, "ms");
+    report("ast_formats/parse (2MB)", parse_ns / 1e6, "ms");
+}
+
+registration const _{"ast_formats", ast_formats};
+
+} // namespace
+
+} // namespace bench
+} // namespace templa
@@ -0,0 +1,42 @@
+#include <string>
+
+#include <boost/variant/get.hpp>
+
+#include "parser.hpp"
+#include "bench.hpp"
+#include "generator.hpp"
+#include "allocation_counter.hpp"
+
+namespace templa {
+namespace bench {
+
+namespace {
+
+void ast_memory()
+{
+    auto const code = generate_program(2 * 1024 * 1024);
+    syntax::parser p;
+
+    auto const before_parse = allocation_count();
+    auto const a = p.parse(code);
+    auto const after_parse = allocation_count();
+    report("ast_memory/allocations_per_parse (2MB)", after_parse - before_parse, "allocs");
+    report("ast_memory/arena_nodes (2MB)", a.node_arena->object_count(), "nodes");
+    report("ast_memory/arena_bytes (2MB)", a.node_arena->used_bytes() / 1024.0 / 1024.0, "MB");
+
+    auto const& decls = boost::get<ast::program const*>(a.root.value)->function_declarations;
+    auto const before_copy = allocation_count();
+    auto const copied = decls;
+    auto const after_copy = allocation_count();
+    report("ast_memory/allocations_per_tree_copy (2MB)", after_copy - before_copy, "allocs");
+    report("ast_memory/top_level_declarations", ast::count_declarations(copied), "decls");
+
+    report("ast_memory/peak_rss", peak_rss_kb() / 1024.0, "MB");
+}
+
+registration const _{"ast_memory", ast_memory};
+
+} // namespace
+
+} // namespace bench
+} // namespace templa
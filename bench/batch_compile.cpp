@@ -0,0 +1,56 @@
+#include <string>
+#include <vector>
+#include <memory>
+#include <sstream>
+
+#include "compiler.hpp"
+#include "helper/source_buffer.hpp"
+#include "helper/thread_pool.hpp"
+#include "bench.hpp"
+#include "generator.hpp"
+
+namespace templa {
+namespace bench {
+
+namespace {
+
+void batch_compile()
+{
+    std::size_t const num_files = 1000;
+    std::vector<std::shared_ptr<helper::source_buffer const>> sources;
+    for (std::size_t i = 0; i < num_files; ++i) {
+        // Sizes vary, so that the workers get uneven work
+        sources.push_back(helper::source_buffer::copy_of(generate_program(512 + i % 17 * 256)));
+    }
+
+    // A compiler per file, as with a process per file
+    auto const fresh_ns = measure_ns([&]{
+        for (auto const& s : sources) {
+            std::ostringstream out;
+            compiler{}.compile(s, out);
+        }
+    }, 1, 3);
+    report("batch_compile/compiler_per_file (1000 files)", fresh_ns / 1e6, "ms");
+
+    for (std::size_t const threads : {1, 2, 4}) {
+        helper::thread_pool pool{threads};
+        std::vector<std::unique_ptr<compiler>> compilers;
+        for (std::size_t w = 0; w < pool.size(); ++w) {
+            compilers.push_back(std::make_unique<compiler>());
+        }
+        auto const ns = measure_ns([&]{
+            pool.parallel_for(sources.size(), [&](std::size_t const i, std::size_t const worker){
+                std::ostringstream out;
+                compilers[worker]->compile(sources[i], out);
+            });
+        }, 1, 3);
+        report("batch_compile/compiler_per_worker (1000 files, " + std::to_string(threads) + " threads)", ns / 1e6, "ms");
+    }
+}
+
+registration const _{"batch_compile", batch_compile};
+
+} // namespace
+
+} // namespace bench
+} // namespace templa
@@ -0,0 +1,83 @@
+#if !defined TEMPLA_BENCH_BENCH_HPP_INCLUDED
+#define      TEMPLA_BENCH_BENCH_HPP_INCLUDED
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <streambuf>
+
+namespace templa {
+namespace bench {
+
+// Calls f() `iterations` times per sample and returns the median duration of
+// one call in nanoseconds.
+template<class F>
+double measure_ns(F && f, std::size_t const iterations, std::size_t const samples = 5)
+{
+    std::vector<double> results;
+    results.reserve(samples);
+    for (std::size_t s = 0; s < samples; ++s) {
+        auto const start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < iterations; ++i) {
+            f();
+        }
+        auto const elapsed = std::chrono::steady_clock::now() - start;
+        results.push_back(
+            std::chrono::duration<double, std::nano>(elapsed).count() / iterations
+        );
+    }
+    std::sort(std::begin(results), std::end(results));
+    return results[results.size() / 2];
+}
+
+// Counts and discards everything written to it
+class null_buffer : public std::streambuf {
+protected:
+    std::streamsize xsputn(char const*, std::streamsize const n) override
+    {
+        written += n;
+        return n;
+    }
+
+    int_type overflow(int_type const c) override
+    {
+        ++written;
+        return traits_type::not_eof(c);
+    }
+
+public:
+    std::size_t written = 0;
+};
+
+// Runs command with the shell and measures it, including the processes it
+// waits for
+struct command_usage {
+    bool succeeded;
+    double wall_ms;
+    double peak_rss_mb;
+};
+
+command_usage run_command(std::string const& command);
+
+void report(std::string const& name, double const value, std::string const& unit);
+
+struct benchmark {
+    char const* name;
+    void (*run)();
+};
+
+std::vector<benchmark> &registry();
+
+struct registration {
+    registration(char const* name, void (*run)())
+    {
+        registry().push_back({name, run});
+    }
+};
+
+} // namespace bench
+} // namespace templa
+
+#endif    // TEMPLA_BENCH_BENCH_HPP_INCLUDED
@@ -0,0 +1,73 @@
+#include <string>
+
+#include "parser.hpp"
+#include "evaluator.hpp"
+#include "bytecode.hpp"
+#include "vm.hpp"
+#include "bench.hpp"
+#include "generator.hpp"
+
+namespace templa {
+namespace bench {
+
+namespace {
+
+// The tree walker and the VM on recursive numeric programs.  The VM is timed
+// without compiling the bytecode, which is timed on its own.  The test of
+// the same name checks that both print the same.
+void bytecode_vm()
+{
+    struct program {
+        std::string name;
+        std::string code;
+    };
+
+    program const programs[] = {
+        {"fib_22", "fib(0) = 0\nfib(1) = 1\nfib(n) = fib(n - 1) + fib(n - 2)\nmain = fib(22)\n"},
+        {
+            "collatz_3000",
+            "steps(1) = 0\n"
+            "steps(n) = if n % 2 == 0 then 1 + steps(n / 2) else 1 + steps(3 * n + 1)\n"
+            "longest(0, best) = best\n"
+            "longest(n, best) = let s = steps(n)\n"
+            "                   in longest(n - 1, max(s, best))\n"
+            "max(a, b) = if a > b then a else b\n"
+            "main = longest(3000, 0)\n"
+        },
+        {"sum_10000", generate_sum_program(10000)},
+        {"list_sum_10000", generate_list_sum_program(10000)},
+    };
+
+    syntax::parser p;
+    eval::limits l;
+    l.depth = 100000;
+    l.steps = 100000000;
+    for (auto const& prog : programs) {
+        auto const a = p.parse(prog.code);
+
+        // The tree walker needs the large stack of eval::run()
+        auto const tree_ns = measure_ns([&]{
+            null_buffer buf;
+            std::ostream discarded{&buf};
+            eval::run(discarded, a, l);
+        }, 3);
+        auto const code = eval::compile_bytecode(a);
+        auto const vm_ns = measure_ns([&]{
+            eval::vm machine{code, l};
+            machine.call("main", {});
+        }, 3);
+        auto const compile_ns = measure_ns([&]{ eval::compile_bytecode(a); }, 10);
+
+        report("bytecode_vm/tree (" + prog.name + ")", tree_ns / 1e6, "ms");
+        report("bytecode_vm/vm (" + prog.name + ")", vm_ns / 1e6, "ms");
+        report("bytecode_vm/compile (" + prog.name + ")", compile_ns / 1e3, "us");
+        report("bytecode_vm/speedup (" + prog.name + ")", tree_ns / (vm_ns + compile_ns), "x");
+    }
+}
+
+registration const _{"bytecode_vm", bytecode_vm};
+
+} // namespace
+
+} // namespace bench
+} // namespace templa
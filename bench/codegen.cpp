@@ -0,0 +1,93 @@
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+#include <unistd.h>
+
+#include "parser.hpp"
+#include "mpl_generator.hpp"
+#include "constexpr_generator.hpp"
+#include "helper/source_buffer.hpp"
+#include "bench.hpp"
+#include "generator.hpp"
+
+namespace templa {
+namespace bench {
+
+namespace {
+
+std::string const list_sample =
+    "hoge = [1, 'a', \"hoge\"]\n"
+    "hoge2 = [1 .. 10]\n"
+    "foo(x:y:xs) = [x, y]\n"
+    "main = [foo(hoge), hoge2]\n";
+
+std::string generate(syntax::parser &p, std::string const& code)
+{
+    std::ostringstream out;
+    codegen::generate_mpl(out, p.parse(code));
+    return out.str();
+}
+
+// Time of the C++ compiler to check the output, which instantiates every
+// template main() needs
+void report_compile_time(std::string const& compiler, std::string const& directory, std::string const& name, std::string const& code)
+{
+    auto file = directory + "/" + name + ".cpp";
+    std::replace(std::begin(file), std::end(file), ' ', '_');
+    std::ofstream{file} << code;
+    auto const command = compiler + " -std=c++14 -fsyntax-only " + file + " >/dev/null 2>&1";
+    bool failed = false;
+    auto const ns = measure_ns([&]{ failed |= !run_command(command).succeeded; }, 1, 3);
+    if (failed) {
+        std::cerr << "codegen: " << compiler << " rejects the output for " << name << std::endl;
+        return;
+    }
+    report("codegen/cxx_compile (" + name + ")", ns / 1e6, "ms");
+}
+
+void codegen()
+{
+    syntax::parser p;
+
+    // Valid programs of many functions with local functions and cases
+    auto const code = generate_nested_program(2 * 1024 * 1024, 8);
+    auto const tree = p.parse(code);
+    null_buffer buffer;
+    std::ostream out(&buffer);
+    auto const ns = measure_ns([&]{ codegen::generate_mpl(out, tree); }, 1, 3);
+    report("codegen/generate_mpl (2MB)", code.size() / (1024.0 * 1024.0) / (ns / 1e9), "MB/s");
+    auto const constexpr_ns = measure_ns([&]{ codegen::generate_constexpr(out, tree); }, 1, 3);
+    report("codegen/generate_constexpr (2MB)", code.size() / (1024.0 * 1024.0) / (constexpr_ns / 1e9), "MB/s");
+
+    auto const cxx = std::getenv("CXX");
+    std::string const compiler = cxx ? cxx : "c++";
+    if (std::system((compiler + " --version >/dev/null 2>&1").c_str()) != 0) {
+        std::cerr << "codegen: no C++ compiler, set CXX to measure compile times" << std::endl;
+        return;
+    }
+
+    char directory[] = "/tmp/templa_codegen_XXXXXX";
+    if (::mkdtemp(directory) == nullptr) {
+        std::perror("mkdtemp");
+        return;
+    }
+    report_compile_time(compiler, directory, "list_sample", generate(p, list_sample));
+    for (std::size_t const n : {10, 100, 200}) {
+        report_compile_time(compiler, directory, "fizzbuzz " + std::to_string(n), generate(p, generate_fizzbuzz_program(n)));
+    }
+    report_compile_time(compiler, directory, "nested 16KB", generate(p, generate_nested_program(16 * 1024, 8)));
+
+    std::system((std::string{"rm -rf "} + directory).c_str());
+}
+
+registration const _{"codegen", codegen};
+
+} // namespace
+
+} // namespace bench
+} // namespace templa
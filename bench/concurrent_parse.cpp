@@ -0,0 +1,101 @@
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+
+#include "parser.hpp"
+#include "bench.hpp"
+#include "generator.hpp"
+
+namespace templa {
+namespace bench {
+
+namespace {
+
+using backend = syntax::parser::backend;
+
+std::vector<std::string> corpus()
+{
+    std::vector<std::string> programs = {
+        "a = 1 + 2\n",
+        "a = \n",
+        "a = [1, 2\n",
+        "f(x = 1\n",
+        "a = 1\n\nb = 2\n",
+        "f(x) = if x then 1\n",
+        generate_program(16 * 1024),
+    };
+    programs.push_back(programs.back() + "oops(x) = [x,\n");
+    return programs;
+}
+
+// what() and the diagnostics of parsing code, or "ok"
+std::string outcome(syntax::parser &p, std::string const& code)
+{
+    syntax::diagnostics diags;
+    try {
+        p.parse(code, &diags);
+        return "ok";
+    } catch (syntax::parse_error const& e) {
+        std::string result = e.what();
+        for (auto const& d : diags.entries()) {
+            result += '\n' + syntax::format_diagnostic(d.line, d.col, d.message);
+        }
+        return result;
+    }
+}
+
+// Parses the corpus in several threads at once, each with its own parser,
+// and checks that every result is the one of a parse in a single thread.
+// Build with -fsanitize=thread to check that parsers share no state.
+void concurrent_parse()
+{
+    auto const programs = corpus();
+    std::size_t const num_threads = 4;
+    std::size_t const rounds = 20;
+
+    std::vector<std::string> expected[2];
+    for (auto const b : {backend::spirit, backend::recursive_descent}) {
+        syntax::parser p{b};
+        for (auto const& code : programs) {
+            expected[b == backend::recursive_descent].push_back(outcome(p, code));
+        }
+    }
+
+    std::atomic<std::size_t> mismatches{0};
+    auto const start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t]{
+            auto const b = t % 2 == 0 ? backend::spirit : backend::recursive_descent;
+            syntax::parser p{b};
+            for (std::size_t r = 0; r < rounds; ++r) {
+                for (std::size_t i = 0; i < programs.size(); ++i) {
+                    if (outcome(p, programs[i]) != expected[b == backend::recursive_descent][i]) {
+                        ++mismatches;
+                    }
+                }
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    auto const elapsed = std::chrono::steady_clock::now() - start;
+
+    report("concurrent_parse/mismatches", mismatches, "parses");
+    report(
+        "concurrent_parse/parses_per_second (4 threads)",
+        num_threads * rounds * programs.size() / std::chrono::duration<double>(elapsed).count(),
+        "parses/s"
+    );
+}
+
+registration const _{"concurrent_parse", concurrent_parse};
+
+} // namespace
+
+} // namespace bench
+} // namespace templa
@@ -0,0 +1,91 @@
+#include <string>
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#include <unistd.h>
+
+#include "parser.hpp"
+#include "mpl_generator.hpp"
+#include "constant_folding.hpp"
+#include "bench.hpp"
+#include "generator.hpp"
+
+namespace templa {
+namespace bench {
+
+namespace {
+
+// Folding the closed main of generated programs into a literal, and what it
+// saves the C++ compiler.  The evaluator recurses as deeply as the programs,
+// so they stay within the default depth limit.
+void constant_folding()
+{
+    struct program {
+        std::string name;
+        std::string code;
+    };
+
+    program const programs[] = {
+        {"sum_500", generate_sum_program(500)},
+        {"list_sum_500", generate_list_sum_program(500)},
+        {"fizzbuzz_500", generate_fizzbuzz_program(500)},
+    };
+
+    auto const cxx = std::getenv("CXX");
+    std::string const compiler = cxx ? cxx : "c++";
+    bool const has_compiler = run_command(compiler + " --version >/dev/null 2>&1").succeeded;
+    if (!has_compiler) {
+        std::cerr << "constant_folding: no C++ compiler, set CXX" << std::endl;
+    }
+
+    char directory[] = "/tmp/templa_folding_XXXXXX";
+    if (::mkdtemp(directory) == nullptr) {
+        std::perror("mkdtemp");
+        return;
+    }
+
+    syntax::parser p;
+    eval::limits const l;
+    for (auto const& prog : programs) {
+        auto const a = p.parse(prog.code);
+
+        eval::folding_statistics stats;
+        auto const folded = eval::fold_constants(a, l, &stats);
+        auto const ns = measure_ns([&]{ eval::fold_constants(a, l); }, 1);
+        report("constant_folding/fold (" + prog.name + ")", ns / 1e6, "ms");
+        report("constant_folding/instantiations saved (" + prog.name + ")", stats.instantiations, "templates");
+        if (stats.failures != 0) {
+            std::cerr << "constant_folding: " << stats.failures << " evaluations of " << prog.name << " failed" << std::endl;
+        }
+
+        if (!has_compiler) {
+            continue;
+        }
+        ast::ast const* const inputs[] = {&a, &folded};
+        char const* const labels[] = {"unfolded", "folded"};
+        for (std::size_t i = 0; i < 2; ++i) {
+            auto const base = std::string{directory} + "/" + prog.name + "_" + labels[i];
+            {
+                std::ofstream out{base + ".cpp"};
+                codegen::generate_mpl(out, *inputs[i]);
+            }
+            auto const usage = run_command(compiler + " -std=c++14 -fsyntax-only " + base + ".cpp >/dev/null 2>&1");
+            if (!usage.succeeded) {
+                std::cerr << "constant_folding: " << compiler << " rejects the " << labels[i] << " output for " << prog.name << std::endl;
+                continue;
+            }
+            report("constant_folding/cxx_compile " + std::string{labels[i]} + " (" + prog.name + ")", usage.wall_ms, "ms");
+        }
+    }
+
+    std::system((std::string{"rm -rf "} + directory).c_str());
+}
+
+registration const _{"constant_folding", constant_folding};
+
+} // namespace
+
+} // namespace bench
+} // namespace templa
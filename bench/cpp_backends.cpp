@@ -0,0 +1,112 @@
+#include <string>
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+#include <unistd.h>
+
+#include "parser.hpp"
+#include "mpl_generator.hpp"
+#include "constexpr_generator.hpp"
+#include "bench.hpp"
+#include "generator.hpp"
+
+namespace templa {
+namespace bench {
+
+namespace {
+
+struct program {
+    std::string name;
+    std::string code;
+};
+
+struct backend {
+    char const* name;
+    void (*generate)(std::ostream &, ast::ast const&);
+};
+
+// clang++ unless CXX names another compiler
+std::string cxx()
+{
+    if (auto const c = std::getenv("CXX")) {
+        return c;
+    }
+    if (run_command("clang++ --version >/dev/null 2>&1").succeeded) {
+        return "clang++";
+    }
+    std::cerr << "cpp_backends: clang++ is not found, measuring c++ instead" << std::endl;
+    return "c++";
+}
+
+// Time and peak memory of the C++ compiler for the output of each backend on
+// the same programs.  The limits are raised so that both backends can
+// recurse as deep as the programs do.
+void cpp_backends()
+{
+    auto const compiler = cxx();
+    if (!run_command(compiler + " --version >/dev/null 2>&1").succeeded) {
+        std::cerr << "cpp_backends: no C++ compiler, set CXX" << std::endl;
+        return;
+    }
+    auto const flags =
+        " -std=c++14 -fsyntax-only -ftemplate-depth=8192 -fconstexpr-depth=8192 -DTEMPLA_STRING_CAPACITY=4096";
+
+    char directory[] = "/tmp/templa_backends_XXXXXX";
+    if (::mkdtemp(directory) == nullptr) {
+        std::perror("mkdtemp");
+        return;
+    }
+
+    program const programs[] = {
+        {"fizzbuzz_50", generate_fizzbuzz_program(50)},
+        {"fizzbuzz_200", generate_fizzbuzz_program(200)},
+        {"fizzbuzz_400", generate_fizzbuzz_program(400)},
+        {"sum_100", generate_sum_program(100)},
+        {"sum_500", generate_sum_program(500)},
+        {"sum_2000", generate_sum_program(2000)},
+    };
+    backend const backends[] = {
+        {"mpl", codegen::generate_mpl},
+        {"constexpr", codegen::generate_constexpr},
+    };
+
+    syntax::parser p;
+    for (auto const& prog : programs) {
+        auto const tree = p.parse(prog.code);
+        for (auto const& b : backends) {
+            auto const file = std::string{directory} + "/" + prog.name + "_" + b.name + ".cpp";
+            {
+                std::ofstream out{file};
+                b.generate(out, tree);
+            }
+
+            auto const command = compiler + flags + " " + file + " >/dev/null 2>&1";
+            // The time is the median, the memory the highest peak
+            command_usage usage{true, 0, 0};
+            auto const ns = measure_ns([&]{
+                auto const u = run_command(command);
+                usage.succeeded &= u.succeeded;
+                usage.peak_rss_mb = std::max(usage.peak_rss_mb, u.peak_rss_mb);
+            }, 1, 3);
+            if (!usage.succeeded) {
+                std::cerr << "cpp_backends: " << compiler << " rejects the " << b.name << " output for " << prog.name << std::endl;
+                continue;
+            }
+            auto const label = "cpp_backends/" + std::string{b.name} + " (" + prog.name + ")";
+            report(label, ns / 1e6, "ms");
+            report(label, usage.peak_rss_mb, "MB peak");
+        }
+    }
+
+    std::system((std::string{"rm -rf "} + directory).c_str());
+}
+
+registration const _{"cpp_backends", cpp_backends};
+
+} // namespace
+
+} // namespace bench
+} // namespace templa
@@ -0,0 +1,73 @@
+#include <string>
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#include <unistd.h>
+
+#include "parser.hpp"
+#include "mpl_generator.hpp"
+#include "bench.hpp"
+#include "generator.hpp"
+
+namespace templa {
+namespace bench {
+
+namespace {
+
+struct program {
+    std::string name;
+    std::string code;
+};
+
+// The C++ compiler on programs which recurse 10000 calls deep in templa.  The
+// MPL output folds them in halves, so it compiles with the default
+// -ftemplate-depth.  The test of the same name checks what they print.
+void deep_recursion()
+{
+    auto const cxx = std::getenv("CXX");
+    std::string const compiler = cxx ? cxx : "c++";
+    if (!run_command(compiler + " --version >/dev/null 2>&1").succeeded) {
+        std::cerr << "deep_recursion: no C++ compiler, set CXX" << std::endl;
+        return;
+    }
+
+    char directory[] = "/tmp/templa_deep_XXXXXX";
+    if (::mkdtemp(directory) == nullptr) {
+        std::perror("mkdtemp");
+        return;
+    }
+
+    program const programs[] = {
+        {"sum_10000", generate_sum_program(10000)},
+        {"list_sum_10000", generate_list_sum_program(10000)},
+        {"fizzbuzz_10000", generate_fizzbuzz_program(10000)},
+    };
+
+    syntax::parser p;
+    for (auto const& prog : programs) {
+        auto const base = std::string{directory} + "/" + prog.name;
+        {
+            std::ofstream out{base + ".cpp"};
+            codegen::generate_mpl(out, p.parse(prog.code));
+        }
+
+        auto const usage = run_command(compiler + " -std=c++14 -o " + base + " " + base + ".cpp >/dev/null 2>&1");
+        if (!usage.succeeded) {
+            std::cerr << "deep_recursion: " << compiler << " rejects the output for " << prog.name << std::endl;
+            continue;
+        }
+        report("deep_recursion/cxx_compile (" + prog.name + ")", usage.wall_ms, "ms");
+        report("deep_recursion/cxx_compile (" + prog.name + ")", usage.peak_rss_mb, "MB peak");
+    }
+
+    std::system((std::string{"rm -rf "} + directory).c_str());
+}
+
+registration const _{"deep_recursion", deep_recursion};
+
+} // namespace
+
+} // namespace bench
+} // namespace templa
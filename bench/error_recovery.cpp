@@ -0,0 +1,60 @@
+#include <string>
+
+#include "parser.hpp"
+#include "helper/source_buffer.hpp"
+#include "bench.hpp"
+#include "generator.hpp"
+
+namespace templa {
+namespace bench {
+
+namespace {
+
+using backend = syntax::parser::backend;
+
+// Breaks every `interval`th top-level declaration of code by inserting a ']'
+// after its '='.  Returns the number of broken declarations.
+std::size_t break_declarations(std::string &code, std::size_t const interval)
+{
+    std::size_t broken = 0;
+    std::size_t n = 0;
+    for (std::size_t line = 0; line < code.size(); line = code.find('\n', line) + 1) {
+        if (code[line] != 'f' || n++ % interval != 0) {
+            continue;
+        }
+        code.insert(code.find('=', line) + 1, " ]");
+        ++broken;
+        if (code.find('\n', line) == std::string::npos) {
+            break;
+        }
+    }
+    return broken;
+}
+
+// The cost of recovering from errors.  That the result is the one of
+// parse() and that every error is reported is checked by the test of the
+// same name.
+void error_recovery()
+{
+    auto const valid = helper::source_buffer::copy_of(generate_program(2 * 1024 * 1024));
+    auto code = generate_program(2 * 1024 * 1024);
+    auto const num_broken = break_declarations(code, 200);
+    auto const invalid = helper::source_buffer::copy_of(code);
+
+    for (auto const b : {backend::spirit, backend::recursive_descent}) {
+        syntax::parser p{b};
+        std::string const label = b == backend::spirit ? " (spirit, 2MB)" : " (recursive_descent, 2MB)";
+
+        auto const valid_ns = measure_ns([&]{ syntax::diagnostics d; p.parse_recovering(valid, d); }, 1, 3);
+        auto const invalid_ns = measure_ns([&]{ syntax::diagnostics d; p.parse_recovering(invalid, d); }, 1, 3);
+        report("error_recovery/no_errors" + label, valid_ns / 1e6, "ms");
+        report("error_recovery/" + std::to_string(num_broken) + "_errors" + label, invalid_ns / 1e6, "ms");
+    }
+}
+
+registration const _{"error_recovery", error_recovery};
+
+} // namespace
+
+} // namespace bench
+} // namespace templa
@@ -0,0 +1,47 @@
+#include <string>
+
+#include "parser.hpp"
+#include "flat_ast.hpp"
+#include "ast_dumper.hpp"
+#include "bench.hpp"
+#include "generator.hpp"
+
+namespace templa {
+namespace bench {
+
+namespace {
+
+// That the flat representation dumps and compares as the tree does is
+// checked by the test of the same name
+void flat_ast()
+{
+    auto const code = generate_program(2 * 1024 * 1024);
+    syntax::parser p;
+    auto const tree = p.parse(code);
+    auto const other_tree = p.parse(code);
+
+    ast::flat_ast flat;
+    auto const flatten_ns = measure_ns([&]{ flat = ast::flatten(tree); }, 1, 3);
+    auto const other_flat = ast::flatten(other_tree);
+    report("flat_ast/flatten (2MB)", flatten_ns / 1e6, "ms");
+    report("flat_ast/nodes", flat.size(), "nodes");
+
+    volatile bool equal = true;
+    auto const tree_eq_ns = measure_ns([&]{ equal = tree == other_tree; }, 1, 3);
+    auto const flat_eq_ns = measure_ns([&]{ equal = flat == other_flat; }, 1, 3);
+    (void)equal;
+    report("flat_ast/equality_tree (2MB)", tree_eq_ns / 1e6, "ms");
+    report("flat_ast/equality_flat (2MB)", flat_eq_ns / 1e6, "ms");
+
+    auto const tree_dump_ns = measure_ns([&]{ ast::dump_ast(tree); }, 1, 3);
+    auto const flat_dump_ns = measure_ns([&]{ ast::dump_ast(flat); }, 1, 3);
+    report("flat_ast/dump_tree (2MB)", tree_dump_ns / 1e6, "ms");
+    report("flat_ast/dump_flat (2MB)", flat_dump_ns / 1e6, "ms");
+}
+
+registration const _{"flat_ast", flat_ast};
+
+} // namespace
+
+} // namespace bench
+} // namespace templa
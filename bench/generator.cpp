@@ -0,0 +1,163 @@
+#include "generator.hpp"
+
+namespace templa {
+namespace bench {
+
+namespace {
+
+void append_declaration(std::string &out, std::size_t const n)
+{
+    auto const name = "f" + std::to_string(n);
+    auto const prev = "f" + std::to_string(n == 0 ? 0 : n - 1);
+
+    switch (n % 6) {
+    case 0:
+        out += name + "(x) = if (x < " + std::to_string(n % 97) + ") then (x) else " + prev + "(x - 1)";
+        break;
+    case 1:
+        out += name + "(x) = case\n"
+               " | x % 3 == 0 then x * 2 + " + std::to_string(n) + "\n"
+               " | otherwise " + prev + "(x - 1)";
+        break;
+    case 2:
+        out += name + " = [" + std::to_string(n) + ", 2, 3, " + prev + "(4)]";
+        break;
+    case 3:
+        out += name + "(a, b) = \"str" + std::to_string(n) + "\" + " + prev + "(a * b - (a + 1) / 2)";
+        break;
+    case 4:
+        out += name + "(x:y:rest, n::Int, 0, 'c', true) = let\n"
+               " g(a) = a * -2 + y % " + std::to_string(n % 13 + 1) + "\n"
+               " h = [1 .. " + std::to_string(n) + "]\n"
+               "in g(x) <= h || !(n >= 3) && [a..z] != rest";
+        break;
+    default:
+        out += name + "(n) = if n > " + std::to_string(n % 31) + " && n != 7 then\n"
+               " -" + prev + "(n / 2)\n"
+               " else [n, 'x', \"s\", false, " + prev + "(n - 1) & 1]";
+        break;
+    }
+}
+
+// Alternates let and case levels: a let whose only declaration holds the next
+// level, and a case whose otherwise branch holds it
+void append_nested(std::string &out, std::size_t const n, std::size_t const depth)
+{
+    if (depth == 0) {
+        out += "x + " + std::to_string(n);
+        return;
+    }
+    auto const level = std::to_string(depth);
+    if (depth % 2 == 0) {
+        out += "let\n g" + level + "(x) = ";
+        append_nested(out, n, depth - 1);
+        out += "\nin g" + level + "(x * 2)";
+    } else {
+        out += "case\n | x == " + level + " then " + level + "\n | otherwise ";
+        append_nested(out, n, depth - 1);
+    }
+}
+
+template<class AppendDeclaration>
+std::string generate_declarations(std::size_t const bytes, AppendDeclaration const& append)
+{
+    std::string out;
+    out.reserve(bytes + 128);
+    for (std::size_t n = 0; out.size() < bytes; ++n) {
+        if (n != 0) {
+            out += '\n';
+        }
+        append(out, n);
+    }
+    out += '\n';
+    return out;
+}
+
+} // namespace
+
+std::string generate_program(std::size_t const bytes)
+{
+    return generate_declarations(bytes, append_declaration);
+}
+
+std::string generate_nested_program(std::size_t const bytes, std::size_t const depth)
+{
+    return generate_declarations(bytes, [depth](std::string &out, std::size_t const n){
+        out += "f" + std::to_string(n) + "(x) = ";
+        append_nested(out, n, depth);
+    });
+}
+
+std::string generate_chain_program(std::size_t const bytes, std::size_t const length)
+{
+    static char const* const operators[] = {" + ", " * ", " - ", " < ", " / ", " || ", " % ", " == "};
+    return generate_declarations(bytes, [length](std::string &out, std::size_t const n){
+        out += "f" + std::to_string(n) + "(a, b) = a";
+        for (std::size_t i = 1; i < length; ++i) {
+            out += operators[(n + i) % 8];
+            out += i % 3 == 0 ? "g(b)" : i % 3 == 1 ? "b" : std::to_string(i);
+        }
+    });
+}
+
+std::string generate_enum_list_program(std::size_t const bytes, std::size_t const length)
+{
+    return generate_declarations(bytes, [length](std::string &out, std::size_t const n){
+        out += "f" + std::to_string(n) + " = [";
+        for (std::size_t i = 0; i < length; ++i) {
+            if (i != 0) {
+                out += ", ";
+            }
+            switch ((n + i) % 4) {
+            case 0:  out += std::to_string(i); break;
+            case 1:  out += "'c'"; break;
+            case 2:  out += "\"s\""; break;
+            default: out += "x"; break;
+            }
+        }
+        out += ']';
+    });
+}
+
+std::string generate_declaration_program(std::size_t const bytes)
+{
+    return generate_declarations(bytes, [](std::string &out, std::size_t const n){
+        out += "f" + std::to_string(n) + " = " + std::to_string(n);
+    });
+}
+
+std::string generate_fizzbuzz_program(std::size_t const n)
+{
+    return
+        "fizz = \"fizz\"\n"
+        "buzz = \"buzz\"\n"
+        "fizzbuzz = fizz + buzz\n"
+        "to_string(x) = if x < 10 then String(to_char(48 + x)) else to_string(x / 10) + to_char(48 + x % 10)\n"
+        "to_fizzbuzz(n) = case\n"
+        "                 | n % 15 == 0 then fizzbuzz\n"
+        "                 | n %  3 == 0 then fizz\n"
+        "                 | n %  5 == 0 then buzz\n"
+        "                 | otherwise        to_string(n)\n"
+        "fizzbuzz_string(n) = fizzbuzz_string(n-1) + to_fizzbuzz(n) + to_char(10)\n"
+        "fizzbuzz_string(0) = \"\"\n"
+        "main = print(fizzbuzz_string(" + std::to_string(n) + "))\n";
+}
+
+std::string generate_sum_program(std::size_t const n)
+{
+    return
+        "sum(0) = 0\n"
+        "sum(n) = n + sum(n - 1)\n"
+        "main = print(sum(" + std::to_string(n) + "))\n";
+}
+
+std::string generate_list_sum_program(std::size_t const n)
+{
+    return
+        "sum(xs) = 0\n"
+        "sum(x:xs) = x + sum(xs)\n"
+        "main = print(sum([1 .. " + std::to_string(n) + "]))\n";
+}
+
+} // namespace bench
+} // namespace templa
@@ -0,0 +1,43 @@
+#if !defined TEMPLA_BENCH_GENERATOR_HPP_INCLUDED
+#define      TEMPLA_BENCH_GENERATOR_HPP_INCLUDED
+
+#include <string>
+#include <cstddef>
+
+namespace templa {
+namespace bench {
+
+// Generates a syntactically valid templa program of about `bytes` bytes.
+// The output is deterministic so that results are comparable across runs.
+std::string generate_program(std::size_t const bytes);
+
+// Programs of about `bytes` bytes in which one construct dominates, so that
+// its cost shows in the throughput.  All of them are deterministic too.
+
+// Declarations whose bodies nest let and case expressions `depth` levels deep
+std::string generate_nested_program(std::size_t const bytes, std::size_t const depth);
+
+// Declarations whose bodies are chains of `length` operands mixing
+// relational, additive and multiplicative operators
+std::string generate_chain_program(std::size_t const bytes, std::size_t const length);
+
+// Declarations of enum_list literals with `length` elements each
+std::string generate_enum_list_program(std::size_t const bytes, std::size_t const length);
+
+// Many one-line declarations, the smallest being "fN = N"
+std::string generate_declaration_program(std::size_t const bytes);
+
+// Programs whose main the C++ output computes at compile time.  main of
+// the fizzbuzz program is the fizzbuzz lines of 1 to n, as in
+// misc/fizzbuzz.templa, and main of the sum program is 1 + ... + n, which
+// recurses n calls deep.
+std::string generate_fizzbuzz_program(std::size_t const n);
+std::string generate_sum_program(std::size_t const n);
+
+// main is the sum of the elements of [1 .. n], recursing over the list
+std::string generate_list_sum_program(std::size_t const n);
+
+} // namespace bench
+} // namespace templa
+
+#endif    // TEMPLA_BENCH_GENERATOR_HPP_INCLUDED
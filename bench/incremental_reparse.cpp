@@ -0,0 +1,68 @@
+#include <string>
+
+#include "parser.hpp"
+#include "helper/source_buffer.hpp"
+#include "bench.hpp"
+#include "generator.hpp"
+
+namespace templa {
+namespace bench {
+
+namespace {
+
+using text_edit = syntax::parser::text_edit;
+
+struct edited {
+    std::string text;
+    text_edit edit;
+};
+
+edited apply(std::string const& text, std::size_t const offset, std::size_t const old_length, std::string const& replacement)
+{
+    return {
+        text.substr(0, offset) + replacement + text.substr(offset + old_length),
+        {offset, old_length, replacement.size()}
+    };
+}
+
+void measure(syntax::parser &p, std::size_t const size, std::string const& label)
+{
+    auto const text = generate_program(size);
+    auto const previous = p.parse(text);
+
+    // An edit in the middle of the program which keeps the number of lines
+    auto const digit = text.find_first_of("0123456789", text.size() / 2);
+    auto const same_lines = apply(text, digit, 1, "7");
+    auto const same_lines_source = helper::source_buffer::copy_of(same_lines.text);
+
+    // A new declaration in the middle of the program, which moves the lines
+    // of all declarations after it
+    auto const inserted = apply(text, text.find("\nf", text.size() / 2), 0, "\nzz(a) = a + 1");
+    auto const inserted_source = helper::source_buffer::copy_of(inserted.text);
+
+    auto const full_ns = measure_ns([&]{ p.parse(same_lines_source); }, 1, 3);
+    auto const same_lines_ns = measure_ns([&]{ p.reparse(previous, same_lines_source, same_lines.edit); }, 10);
+    auto const inserted_ns = measure_ns([&]{ p.reparse(previous, inserted_source, inserted.edit); }, 3);
+
+    report("incremental_reparse/full_parse (" + label + ")", full_ns / 1e3, "us");
+    report("incremental_reparse/edit_in_line (" + label + ")", same_lines_ns / 1e3, "us");
+    report("incremental_reparse/line_inserted (" + label + ")", inserted_ns / 1e3, "us");
+}
+
+// That reparses agree with full parses is checked by the test of the same
+// name
+void incremental_reparse()
+{
+    syntax::parser descent{syntax::parser::backend::recursive_descent};
+
+    measure(descent, 256 * 1024, "256KB");
+    measure(descent, 1024 * 1024, "1MB");
+    measure(descent, 4 * 1024 * 1024, "4MB");
+}
+
+registration const _{"incremental_reparse", incremental_reparse};
+
+} // namespace
+
+} // namespace bench
+} // namespace templa
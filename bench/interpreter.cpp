@@ -0,0 +1,50 @@
+#include <string>
+#include <ostream>
+
+#include "parser.hpp"
+#include "evaluator.hpp"
+#include "bench.hpp"
+#include "generator.hpp"
+
+namespace templa {
+namespace bench {
+
+namespace {
+
+// Time of --run from a parsed AST to the output.  That the output is the
+// one of the C++ program is checked by the test of the same name.
+void interpreter()
+{
+    struct program {
+        std::string name;
+        std::string code;
+    };
+
+    program const programs[] = {
+        {"fizzbuzz_100", generate_fizzbuzz_program(100)},
+        {"fizzbuzz_10000", generate_fizzbuzz_program(10000)},
+        {"sum_10000", generate_sum_program(10000)},
+        {"list_sum_10000", generate_list_sum_program(10000)},
+    };
+
+    syntax::parser p;
+    eval::limits l;
+    l.depth = 100000;
+    for (auto const& prog : programs) {
+        auto const a = p.parse(prog.code);
+
+        auto const ns = measure_ns([&]{
+            null_buffer buf;
+            std::ostream discarded{&buf};
+            eval::run(discarded, a, l);
+        }, 5);
+        report("interpreter/run (" + prog.name + ")", ns / 1e3, "us");
+    }
+}
+
+registration const _{"interpreter", interpreter};
+
+} // namespace
+
+} // namespace bench
+} // namespace templa
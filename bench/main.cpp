@@ -0,0 +1,79 @@
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <chrono>
+
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#include "bench.hpp"
+
+namespace templa {
+namespace bench {
+
+std::vector<benchmark> &registry()
+{
+    static std::vector<benchmark> benchmarks;
+    return benchmarks;
+}
+
+command_usage run_command(std::string const& command)
+{
+    auto const start = std::chrono::steady_clock::now();
+    auto const pid = ::fork();
+    if (pid == 0) {
+        ::execl("/bin/sh", "sh", "-c", command.c_str(), static_cast<char*>(nullptr));
+        ::_exit(127);
+    }
+    int status = 0;
+    ::rusage usage{};
+    if (pid < 0 || ::wait4(pid, &status, 0, &usage) != pid) {
+        return {false, 0, 0};
+    }
+    auto const elapsed = std::chrono::steady_clock::now() - start;
+    return {
+        WIFEXITED(status) && WEXITSTATUS(status) == 0,
+        std::chrono::duration<double, std::milli>(elapsed).count(),
+        // ru_maxrss is in KB on Linux
+        usage.ru_maxrss / 1024.0,
+    };
+}
+
+void report(std::string const& name, double const value, std::string const& unit)
+{
+    std::cout << std::left << std::setw(48) << name
+              << std::right << std::setw(14) << std::fixed << std::setprecision(2) << value
+              << ' ' << unit << std::endl;
+}
+
+} // namespace bench
+} // namespace templa
+
+int main(int const argc, char const* const argv[])
+{
+    auto const& benchmarks = templa::bench::registry();
+
+    if (argc == 1) {
+        for (auto const& b : benchmarks) {
+            b.run();
+        }
+        return 0;
+    }
+
+    for (int i = 1; i < argc; ++i) {
+        auto const found = std::find_if(std::begin(benchmarks), std::end(benchmarks),
+                                        [&](auto const& b){ return std::strcmp(b.name, argv[i]) == 0; });
+        if (found == std::end(benchmarks)) {
+            std::cerr << "Unknown benchmark: " << argv[i] << "\nAvailable:";
+            for (auto const& b : benchmarks) {
+                std::cerr << ' ' << b.name;
+            }
+            std::cerr << std::endl;
+            return 1;
+        }
+        found->run();
+    }
+
+    return 0;
+}
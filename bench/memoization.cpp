@@ -0,0 +1,73 @@
+#include <string>
+
+#include "parser.hpp"
+#include "evaluator.hpp"
+#include "bytecode.hpp"
+#include "vm.hpp"
+#include "memo.hpp"
+#include "constant_folding.hpp"
+#include "bench.hpp"
+
+namespace templa {
+namespace bench {
+
+namespace {
+
+// Run mode and folding of programs which call the same functions with the
+// same arguments again, with memo tables of several capacities.  Too small
+// a table evicts results before they are reused.  That the results are
+// the ones without memo is checked by the test of the same name.
+void memoization()
+{
+    struct program {
+        std::string name;
+        std::string code;
+    };
+
+    program const programs[] = {
+        {"fib_24", "fib(0) = 0\nfib(1) = 1\nfib(n) = fib(n - 1) + fib(n - 2)\nmain = fib(24)\n"},
+        {
+            "binomial_20",
+            "choose(n, 0) = 1\n"
+            "choose(n, k) = if n == k then 1 else choose(n - 1, k - 1) + choose(n - 1, k)\n"
+            "main = choose(20, 10)\n"
+        },
+    };
+    std::size_t const capacities[] = {0, 8, 4096};
+
+    syntax::parser p;
+    for (auto const& prog : programs) {
+        auto const a = p.parse(prog.code);
+        auto const code = eval::compile_bytecode(a);
+        for (auto const capacity : capacities) {
+            eval::limits l;
+            l.steps = 100000000;
+            l.memo = capacity;
+            auto const suffix = " (" + prog.name + ", memo " + std::to_string(capacity) + ")";
+
+            eval::vm machine{code, l};
+            auto const vm_ns = measure_ns([&]{
+                eval::vm fresh{code, l};
+                fresh.call("main", {});
+            }, 1, 3);
+            machine.call("main", {});
+            report("memoization/vm" + suffix, vm_ns / 1e6, "ms");
+            if (auto const m = machine.memoized()) {
+                report("memoization/hit rate" + suffix, m->stats().hit_rate() * 100, "%");
+            }
+
+            eval::folding_statistics stats;
+            auto const fold_ns = measure_ns([&]{ eval::fold_constants(a, l); }, 1, 3);
+            eval::fold_constants(a, l, &stats);
+            report("memoization/fold" + suffix, fold_ns / 1e6, "ms");
+            report("memoization/fold steps" + suffix, static_cast<double>(stats.steps), "steps");
+        }
+    }
+}
+
+registration const _{"memoization", memoization};
+
+} // namespace
+
+} // namespace bench
+} // namespace templa
@@ -0,0 +1,45 @@
+#include <string>
+#include <thread>
+#include <algorithm>
+
+#include "parser.hpp"
+#include "helper/source_buffer.hpp"
+#include "helper/thread_pool.hpp"
+#include "bench.hpp"
+#include "generator.hpp"
+
+namespace templa {
+namespace bench {
+
+namespace {
+
+// The speedup of the parallel parse.  That it agrees with the sequential
+// one is checked by the test of the same name.
+void parallel_parse()
+{
+    auto const max_threads = std::max(4u, std::thread::hardware_concurrency());
+
+    std::size_t const size = 100 * 1024 * 1024;
+    auto const source = helper::source_buffer::copy_of(generate_program(size));
+    syntax::parser p{syntax::parser::backend::recursive_descent};
+
+    double sequential_ns = 0;
+    for (std::size_t threads = 1; threads <= max_threads; threads *= 2) {
+        helper::thread_pool pool{threads};
+        auto const ns = measure_ns([&]{ p.parse(source, pool); }, 1, 3);
+        if (threads == 1) {
+            sequential_ns = ns;
+        }
+        auto const label = " (100MB, " + std::to_string(threads) + " threads)";
+        report("parallel_parse/throughput" + label, size / (ns / 1e9) / (1024 * 1024), "MB/s");
+        report("parallel_parse/speedup" + label, sequential_ns / ns, "x");
+    }
+    report("parallel_parse/hardware_threads", std::thread::hardware_concurrency(), "threads");
+}
+
+registration const _{"parallel_parse", parallel_parse};
+
+} // namespace
+
+} // namespace bench
+} // namespace templa
@@ -0,0 +1,32 @@
+#include <string>
+
+#include "parser.hpp"
+#include "bench.hpp"
+#include "generator.hpp"
+
+namespace templa {
+namespace bench {
+
+namespace {
+
+// The throughput of both backends.  That they agree is checked by the test
+// of the same name.
+void parse_backends()
+{
+    syntax::parser spirit{syntax::parser::backend::spirit};
+    syntax::parser descent{syntax::parser::backend::recursive_descent};
+
+    auto const code = generate_program(2 * 1024 * 1024);
+    double const megabytes = code.size() / (1024.0 * 1024.0);
+    auto const spirit_ns = measure_ns([&]{ spirit.parse(code); }, 1, 3);
+    auto const descent_ns = measure_ns([&]{ descent.parse(code); }, 1, 3);
+    report("parse_backends/spirit (2MB)", megabytes / (spirit_ns / 1e9), "MB/s");
+    report("parse_backends/recursive_descent (2MB)", megabytes / (descent_ns / 1e9), "MB/s");
+}
+
+registration const _{"parse_backends", parse_backends};
+
+} // namespace
+
+} // namespace bench
+} // namespace templa
@@ -0,0 +1,50 @@
+#include <string>
+#include <cstdlib>
+#include <cstdio>
+#include <iostream>
+
+#include <unistd.h>
+
+#include "parser.hpp"
+#include "parse_cache.hpp"
+#include "helper/source_buffer.hpp"
+#include "bench.hpp"
+#include "generator.hpp"
+
+namespace templa {
+namespace bench {
+
+namespace {
+
+void parse_cache()
+{
+    char directory[] = "/tmp/templa_cache_XXXXXX";
+    if (::mkdtemp(directory) == nullptr) {
+        std::perror("mkdtemp");
+        return;
+    }
+
+    auto const source = helper::source_buffer::copy_of(generate_program(2 * 1024 * 1024));
+    templa::parse_cache cache{directory, 1024 * 1024 * 1024};
+    syntax::parser p;
+
+    auto const parse_ns = measure_ns([&]{ p.parse(source); }, 1, 3);
+    auto const store_ns = measure_ns([&]{ cache.store(*source, p.parse(source)); }, 1, 3);
+    auto const hit_ns = measure_ns([&]{
+        if (!cache.load(source)) {
+            std::cerr << "parse_cache: stored AST was not found" << std::endl;
+        }
+    }, 1, 3);
+    report("parse_cache/parse (2MB)", parse_ns / 1e6, "ms");
+    report("parse_cache/miss_and_store (2MB)", store_ns / 1e6, "ms");
+    report("parse_cache/hit (2MB)", hit_ns / 1e6, "ms");
+
+    std::system((std::string{"rm -rf "} + directory).c_str());
+}
+
+registration const _{"parse_cache", parse_cache};
+
+} // namespace
+
+} // namespace bench
+} // namespace templa
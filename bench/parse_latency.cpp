@@ -0,0 +1,39 @@
+#include <string>
+
+#include "parser.hpp"
+#include "bench.hpp"
+
+namespace templa {
+namespace bench {
+
+namespace {
+
+char const* const small_inputs[] = {
+    "a = 1 + 2\n",
+    "fizz = \"fizz\"\nbuzz = \"buzz\"\n",
+    "f(x) = case\n | x % 15 == 0 then 15\n | x % 3 == 0 then 3\n | otherwise x\n",
+};
+
+void parse_latency()
+{
+    for (auto const input : small_inputs) {
+        std::string const code = input;
+
+        // What every parse() call paid before the grammar was owned by the parser
+        auto const cold = measure_ns([&]{ syntax::parser{}.parse(code); }, 200);
+
+        syntax::parser p;
+        auto const warm = measure_ns([&]{ p.parse(code); }, 2000);
+
+        auto const label = std::to_string(code.size()) + " bytes";
+        report("parse_latency/fresh_grammar (" + label + ")", cold / 1000.0, "us/call");
+        report("parse_latency/reused_grammar (" + label + ")", warm / 1000.0, "us/call");
+    }
+}
+
+registration const _{"parse_latency", parse_latency};
+
+} // namespace
+
+} // namespace bench
+} // namespace templa
@@ -0,0 +1,72 @@
+#include <string>
+#include <fstream>
+#include <iterator>
+#include <cstdio>
+#include <cstdlib>
+
+#include <unistd.h>
+
+#include "parser.hpp"
+#include "helper/source_buffer.hpp"
+#include "bench.hpp"
+#include "generator.hpp"
+#include "allocation_counter.hpp"
+
+namespace templa {
+namespace bench {
+
+namespace {
+
+// How templa used to load a source file
+std::string read_by_stream(std::string const& file_name)
+{
+    std::ifstream input(file_name, std::ios::in);
+    return {std::istreambuf_iterator<char>{input}, std::istreambuf_iterator<char>{}};
+}
+
+void source_loading()
+{
+    std::size_t const size = 64 * 1024 * 1024;
+    char file_name[] = "/tmp/templa_bench_XXXXXX";
+    int const fd = ::mkstemp(file_name);
+    if (fd < 0) {
+        std::perror("mkstemp");
+        return;
+    }
+    ::close(fd);
+    {
+        std::ofstream output(file_name, std::ios::out | std::ios::binary);
+        output << generate_program(size);
+    }
+
+    double const mb = size / 1024.0 / 1024.0;
+    auto const stream_ns = measure_ns([&]{ read_by_stream(file_name); }, 1, 3);
+    auto const mapping_ns = measure_ns([&]{
+        // Touch every page so that the mapping pays for reading the file as well
+        auto const source = helper::source_buffer::map_file(file_name);
+        volatile char sink = 0;
+        for (auto p = source->begin(); p < source->end(); p += 4096) {
+            sink = *p;
+        }
+        (void)sink;
+    }, 1, 3);
+    report("source_loading/istreambuf_iterator (64MB)", mb / (stream_ns / 1e9), "MB/s");
+    report("source_loading/mmap (64MB)", mb / (mapping_ns / 1e9), "MB/s");
+
+    // Names refer into the mapped file instead of being copied per identifier
+    syntax::parser p{syntax::parser::backend::recursive_descent};
+    auto const source = helper::source_buffer::map_file(file_name);
+    auto const before = allocation_count();
+    auto const a = p.parse(source);
+    report("source_loading/allocations_per_parse (64MB)", allocation_count() - before, "allocs");
+    report("source_loading/arena_bytes_per_source_byte", a.node_arena->used_bytes() / static_cast<double>(size), "bytes");
+
+    std::remove(file_name);
+}
+
+registration const _{"source_loading", source_loading};
+
+} // namespace
+
+} // namespace bench
+} // namespace templa
@@ -0,0 +1,61 @@
+#include <string>
+#include <cstddef>
+
+#include "parser.hpp"
+#include "bench.hpp"
+#include "generator.hpp"
+
+namespace templa {
+namespace bench {
+
+namespace {
+
+// How the parser computed an error position before positions were tracked
+// while parsing.
+std::pair<std::size_t, std::size_t> rescan_position(std::string const& code, std::size_t const offset)
+{
+    std::size_t line = 1, col = 1;
+    for (std::size_t i = 0; i < offset; ++i) {
+        if (code[i] == '\n') {
+            ++line;
+            col = 1;
+        } else {
+            ++col;
+        }
+    }
+    return {line, col};
+}
+
+void source_positions()
+{
+    auto const code = generate_program(2 * 1024 * 1024);
+    double const megabytes = code.size() / (1024.0 * 1024.0);
+    syntax::parser p;
+
+    auto const parse_ns = measure_ns([&]{ p.parse(code); }, 1, 1);
+    report("source_positions/parse (2MB)", megabytes / (parse_ns / 1e9), "MB/s");
+
+    auto broken = code;
+    broken.back() = '=';
+    auto const error_ns = measure_ns([&]{
+        try {
+            p.parse(broken);
+        } catch (syntax::parse_error const&) {
+        }
+    }, 1, 1);
+    report("source_positions/parse_error_at_end (2MB)", error_ns / 1e6, "ms");
+
+    std::size_t line = 0;
+    auto const rescan_ns = measure_ns([&]{ line += rescan_position(broken, broken.size() - 1).first; }, 10);
+    report("source_positions/rescan_for_error_position (2MB)", rescan_ns / 1e6, "ms");
+    if (line == 0) {
+        report("source_positions/unexpected_zero_line", 0, "");
+    }
+}
+
+registration const _{"source_positions", source_positions};
+
+} // namespace
+
+} // namespace bench
+} // namespace templa
@@ -0,0 +1,80 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include <unordered_map>
+
+#include <boost/variant/get.hpp>
+
+#include "parser.hpp"
+#include "semantic.hpp"
+#include "ast_adapted.hpp"
+#include "bench.hpp"
+#include "generator.hpp"
+
+namespace templa {
+namespace bench {
+
+namespace {
+
+// Names are interned while parsing, so resolving a call compares ids.  The
+// lookups of every call in a large program are timed against a table keyed
+// by the text of the names, as function_table was before.
+void symbol_interning()
+{
+    auto const code = generate_program(2 * 1024 * 1024);
+    syntax::parser p;
+
+    auto const before = ast::identifier::interned();
+    auto const a = p.parse(code);
+    report("symbol_interning/identifiers (2MB)", static_cast<double>(ast::identifier::interned() - before), "names");
+
+    auto const& decls = boost::get<ast::program const*>(a.root.value)->function_declarations;
+    std::vector<ast::identifier> calls;
+    ast::for_each_node(a.root, [&](ast::ast_node const& n){
+        if (auto const c = boost::get<ast::func_call const*>(&n.value)) {
+            calls.push_back((*c)->function_name);
+        }
+    });
+    report("symbol_interning/calls (2MB)", static_cast<double>(calls.size()), "calls");
+
+    semantic::function_table const table{decls};
+    std::unordered_map<std::string, std::size_t> by_text;
+    for (std::size_t i = 0; i < table.functions().size(); ++i) {
+        by_text.emplace(table.functions()[i].name.to_string(), i);
+    }
+
+    std::size_t by_id = 0, by_name = 0;
+    auto const id_ns = measure_ns([&]{
+        by_id = 0;
+        for (auto const c : calls) {
+            by_id += table.find(c) != nullptr;
+        }
+    }, 1, 5);
+    auto const text_ns = measure_ns([&]{
+        by_name = 0;
+        for (auto const c : calls) {
+            by_name += by_text.count(c.to_string());
+        }
+    }, 1, 5);
+    if (by_id != by_name) {
+        std::cerr << "symbol_interning: " << by_id << " calls resolved by id, but " << by_name << " by text" << std::endl;
+    }
+    report("symbol_interning/resolved calls (2MB)", static_cast<double>(by_id), "calls");
+    report("symbol_interning/resolve by id (2MB)", id_ns / calls.size(), "ns/call");
+    report("symbol_interning/resolve by text (2MB)", text_ns / calls.size(), "ns/call");
+    report("symbol_interning/table build (2MB)", measure_ns([&]{ semantic::function_table{decls}; }, 1, 5) / 1e6, "ms");
+
+    // Nodes with names, which held a boost::string_ref of 16 bytes per name
+    report("symbol_interning/sizeof decl_func", sizeof(ast::decl_func), "bytes");
+    report("symbol_interning/sizeof func_call", sizeof(ast::func_call), "bytes");
+    report("symbol_interning/sizeof type_match", sizeof(ast::type_match), "bytes");
+    report("symbol_interning/sizeof decl_param", sizeof(ast::decl_param), "bytes");
+    report("symbol_interning/arena_bytes (2MB)", a.node_arena->used_bytes() / 1024.0 / 1024.0, "MB");
+}
+
+registration const _{"symbol_interning", symbol_interning};
+
+} // namespace
+
+} // namespace bench
+} // namespace templa
@@ -0,0 +1,88 @@
+#include <string>
+#include <ostream>
+#include <iostream>
+#include <numeric>
+
+#include "parser.hpp"
+#include "compiler.hpp"
+#include "compile_stats.hpp"
+#include "ast_dumper.hpp"
+#include "helper/source_buffer.hpp"
+#include "bench.hpp"
+#include "generator.hpp"
+
+namespace templa {
+namespace bench {
+
+namespace {
+
+using backend = syntax::parser::backend;
+
+struct shape {
+    char const* name;
+    std::string code;
+};
+
+std::size_t count_nodes(ast::ast const& a)
+{
+    compile_stats stats;
+    stats.count(a);
+    return std::accumulate(std::begin(stats.nodes()), std::end(stats.nodes()), std::size_t{0});
+}
+
+// Reports the rate of a phase which took ns for the source of shape s
+void report_rate(std::string const& phase, shape const& s, double const ns, std::size_t const nodes)
+{
+    auto const label = "throughput/" + phase + " (" + s.name + ")";
+    report(label, s.code.size() / (1024.0 * 1024.0) / (ns / 1e9), "MB/s");
+    report(label, nodes / (ns / 1e9) / 1e6, "Mnodes/s");
+}
+
+// Parse, dump and compile throughput of 2MB programs of each shape.  The
+// programs are generated deterministically and every figure is the median
+// of several runs, so the results are comparable across commits.
+void throughput()
+{
+    std::size_t const bytes = 2 * 1024 * 1024;
+    shape const shapes[] = {
+        {"mixed", generate_program(bytes)},
+        {"let/case depth 24", generate_nested_program(bytes, 24)},
+        {"chain 200", generate_chain_program(bytes, 200)},
+        {"enum_list 1000", generate_enum_list_program(bytes, 1000)},
+        {"one-liners", generate_declaration_program(bytes)},
+    };
+
+    syntax::parser spirit{backend::spirit};
+    syntax::parser descent{backend::recursive_descent};
+    compiler c;
+    for (auto const& s : shapes) {
+        auto const source = helper::source_buffer::copy_of(s.code);
+        boost::optional<ast::ast> tree;
+        try {
+            tree = spirit.parse(source);
+            if (*tree != descent.parse(source)) {
+                std::cerr << "throughput: backends disagree on " << s.name << std::endl;
+            }
+        } catch (syntax::parse_error const& e) {
+            std::cerr << "throughput: " << s.name << " is invalid: " << e.what() << std::endl;
+            continue;
+        }
+        auto const nodes = count_nodes(*tree);
+        report(std::string{"throughput/nodes ("} + s.name + ")", nodes, "nodes");
+
+        report_rate("parse spirit", s, measure_ns([&]{ spirit.parse(source); }, 1, 3), nodes);
+        report_rate("parse rd", s, measure_ns([&]{ descent.parse(source); }, 1, 3), nodes);
+
+        null_buffer buffer;
+        std::ostream out(&buffer);
+        report_rate("dump", s, measure_ns([&]{ ast::dump_ast(out, *tree); }, 1, 3), nodes);
+        report_rate("compile", s, measure_ns([&]{ c.compile(source, out); }, 1, 3), nodes);
+    }
+}
+
+registration const _{"throughput", throughput};
+
+} // namespace
+
+} // namespace bench
+} // namespace templa
@@ -1,7 +1,6 @@
 #include <type_traits>
+#include <vector>
 
-#include <boost/variant/apply_visitor.hpp>
-#include <boost/variant/static_visitor.hpp>
 #include <boost/range/algorithm.hpp>
 
 #include "ast.hpp"
@@ -35,11 +34,47 @@ char const char_list::symbol[] = "CHAR_LIST";
 char const func_call::symbol[] = "FUNC_CALL";
 char const call_args::symbol[] = "CALL_ARGS";
 
+program const* make_program(
+    helper::arena &node_arena,
+    node_list const& declarations,
+    std::size_t const* const offsets,
+    std::int64_t const offset_delta
+)
+{
+    auto const run = node_arena.make<declaration_run>(declaration_run{declarations, 0, offsets, offset_delta});
+    return node_arena.make<program>(program{{run, run + 1}});
+}
+
+std::size_t count_declarations(declaration_runs const& runs)
+{
+    std::size_t count = 0;
+    for (auto const& r : runs) {
+        count += r.declarations.size();
+    }
+    return count;
+}
+
+namespace {
+
+    // The declarations of a program without its runs
+    std::vector<ast_node> declarations_of(program const& p)
+    {
+        std::vector<ast_node> declarations;
+        declarations.reserve(count_declarations(p.function_declarations));
+        for_each_declaration(p.function_declarations, [&](ast_node const& d, std::int64_t){
+            declarations.push_back(d);
+        });
+        return declarations;
+    }
+
+} // namespace
+
 struct equality_checker : boost::static_visitor<bool> {
 
+    // Positions are not compared, so neither are the runs
     bool operator()(program const& lhs, program const& rhs) const
     {
-        return boost::equal(lhs.function_declarations, rhs.function_declarations);
+        return declarations_of(lhs) == declarations_of(rhs);
     }
 
     bool operator()(decl_func const& lhs, decl_func const& rhs) const
@@ -182,7 +217,7 @@ struct equality_checker : boost::static_visitor<bool> {
 
 bool ast_node::operator==(ast_node const& rhs) const
 {
-    return boost::apply_visitor(equality_checker{}, this->value, rhs.value);
+    return visit(equality_checker{}, *this, rhs);
 }
 
 bool ast_node::operator!=(ast_node const& rhs) const
@@ -192,7 +227,7 @@ bool ast_node::operator!=(ast_node const& rhs) const
 
 bool ast::operator==(ast const& rhs) const
 {
-    return boost::apply_visitor(equality_checker{}, this->root.value, rhs.root.value);
+    return visit(equality_checker{}, this->root, rhs.root);
 }
 
 bool ast::operator!=(ast const& rhs) const
@@ -4,12 +4,22 @@
 #include <vector>
 #include <string>
 #include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
 
 #include <boost/optional.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <boost/range/iterator_range.hpp>
 #include <boost/mpl/vector/vector30.hpp>
 #include <boost/mpl/lambda.hpp>
 #include <boost/variant/variant.hpp>
-#include <boost/variant/recursive_wrapper.hpp>
+#include <boost/variant/static_visitor.hpp>
+#include <boost/variant/apply_visitor.hpp>
+
+#include "helper/arena.hpp"
+#include "helper/source_buffer.hpp"
+#include "identifier.hpp"
 
 namespace templa {
 namespace ast {
@@ -40,10 +50,12 @@ struct char_list;
 struct func_call;
 struct call_args;
 
+// Non-owning handle to a node.  Nodes themselves are allocated in the arena
+// owned by the enclosing ast, so copying a handle never copies the subtree.
 class ast_node {
     template<class T>
-    struct make_recursive_wrapper {
-        using type = boost::recursive_wrapper<T>;
+    struct make_node_pointer {
+        using type = T const*;
     };
 
 public:
@@ -51,8 +63,7 @@ public:
     bool operator==(ast_node const& rhs) const;
     bool operator!=(ast_node const& rhs) const;
 
-    // use recursive_wrapper even if the type doesn't have ast_node value
-    // because held types can't be incomplete type.
+    // Held types are pointers because node types are incomplete here.
     using value_type =
         typename boost::make_variant_over<
             typename boost::mpl::transform<
@@ -84,49 +95,98 @@ public:
                     call_args
                 >,
                 typename boost::mpl::lambda<
-                    make_recursive_wrapper<boost::mpl::_1>
+                    make_node_pointer<boost::mpl::_1>
                 >::type
             >::type
         >::type;
 
     value_type value;
 
-    std::size_t line;
-    std::size_t col;
+    std::uint32_t line;
+    std::uint32_t col;
+
+};
 
+// Immutable sequence of child nodes.  Like the nodes, its elements are stored
+// in the arena of the enclosing ast.
+using node_list = boost::iterator_range<ast_node const*>;
+
+// Names of functions, parameters and types are identifiers.  Operators and
+// string literals refer into the source text which the enclosing ast keeps
+// alive.
+using name_list = boost::iterator_range<identifier const*>;
+
+// Top-level declarations which were parsed together.  A reparse shares the
+// runs which an edit does not touch with the previous AST instead of copying
+// them, so their nodes keep the lines they were parsed at: a declaration of
+// the run and each node below it is line_delta lines further down in the
+// source now.
+struct declaration_run {
+    node_list declarations;
+    std::int64_t line_delta;
+    // Byte offset of the first token of each declaration in the source which
+    // the run was parsed from, which is offset_delta further now, or null
+    // while the offsets are not known
+    std::size_t const* offsets;
+    std::int64_t offset_delta;
 };
 
+// The top-level declarations of a program, in order
+using declaration_runs = boost::iterator_range<declaration_run const*>;
+
 struct program{
-    std::vector<ast_node> function_declarations;
+    declaration_runs function_declarations;
     static const char symbol[];
 };
 
+// A program of one run of declarations at the lines they were parsed at, and
+// at offsets if they are known
+program const* make_program(
+    helper::arena &node_arena,
+    node_list const& declarations,
+    std::size_t const* const offsets = nullptr,
+    std::int64_t const offset_delta = 0
+);
+
+// Calls f(declaration, line_delta) for each top-level declaration in order
+template<class F>
+inline void for_each_declaration(declaration_runs const& runs, F &&f)
+{
+    for (auto const& r : runs) {
+        for (auto const& d : r.declarations) {
+            f(d, r.line_delta);
+        }
+    }
+}
+
+std::size_t count_declarations(declaration_runs const& runs);
+
 struct decl_func{
-    std::string function_name;
+    identifier function_name;
     boost::optional<ast_node> maybe_declaration_params;
     ast_node expression;
     static const char symbol[];
 };
 
 struct decl_params{
-    std::vector<ast_node> declaration_params;
+    node_list declaration_params;
     static const char symbol[];
 };
 
 struct decl_param{
-    boost::variant<ast_node, std::string> value;
+    boost::variant<ast_node, identifier> value;
     static const char symbol[];
 };
 
 struct list_match{
-    std::vector<std::string> elements;
-    std::string rest_elems_name;
+    name_list elements;
+    identifier rest_elems_name;
     static const char symbol[];
 };
 
 struct type_match{
-    std::string param_name;
-    std::string type_name;
+    identifier param_name;
+    identifier type_name;
     static const char symbol[];
 };
 
@@ -136,7 +196,7 @@ struct expression{
 };
 
 struct let_expression{
-    std::vector<ast_node> function_declarations;
+    node_list function_declarations;
     ast_node body;
     static const char symbol[];
 };
@@ -149,7 +209,7 @@ struct if_expression{
 };
 
 struct case_expression{
-    std::vector<ast_node> case_when;
+    node_list case_when;
     ast_node otherwise_expression;
     static const char symbol[];
 };
@@ -161,21 +221,21 @@ struct case_when{
 };
 
 struct primary_expression{
-    std::vector<ast_node> formulae;
-    std::vector<ast_node> operators;
+    node_list formulae;
+    node_list operators;
     static const char symbol[];
 };
 
 struct formula{
     boost::optional<char> maybe_sign;
-    std::vector<ast_node> terms;
-    std::vector<ast_node> operators;
+    node_list terms;
+    node_list operators;
     static const char symbol[];
 };
 
 struct term{
-    std::vector<ast_node> factors;
-    std::vector<ast_node> operators;
+    node_list factors;
+    node_list operators;
     static const char symbol[];
 };
 
@@ -185,17 +245,17 @@ struct factor{
 };
 
 struct relational_operator{
-    std::string value;
+    boost::string_ref value;
     static const char symbol[];
 };
 
 struct additive_operator{
-    std::string value;
+    boost::string_ref value;
     static const char symbol[];
 };
 
 struct mult_operator{
-    std::string value;
+    boost::string_ref value;
     static const char symbol[];
 };
 
@@ -203,7 +263,7 @@ struct constant{
     boost::variant< int
                     , char
                     , bool
-                    , std::string
+                    , boost::string_ref
                     , ast_node > value;
     static const char symbol[];
 };
@@ -214,7 +274,7 @@ struct list{
 };
 
 struct enum_list{
-    std::vector<ast_node> elements;
+    node_list elements;
     static const char symbol[];
 };
 
@@ -231,23 +291,107 @@ struct char_list{
 };
 
 struct func_call{
-    std::string function_name;
+    identifier function_name;
     boost::optional<ast_node> maybe_call_arguments;
     static const char symbol[];
 };
 
 struct call_args{
-    std::vector<ast_node> arguments;
+    node_list arguments;
     static const char symbol[];
 };
 
+} // namespace ast
+
+namespace helper {
+
+// Nodes only hold handles, child lists, names and scalars, so destroying them
+// releases nothing.
+template<> struct needs_cleanup<ast::ast_node> : std::false_type {};
+template<> struct needs_cleanup<ast::program> : std::false_type {};
+template<> struct needs_cleanup<ast::decl_func> : std::false_type {};
+template<> struct needs_cleanup<ast::decl_params> : std::false_type {};
+template<> struct needs_cleanup<ast::decl_param> : std::false_type {};
+template<> struct needs_cleanup<ast::list_match> : std::false_type {};
+template<> struct needs_cleanup<ast::type_match> : std::false_type {};
+template<> struct needs_cleanup<ast::expression> : std::false_type {};
+template<> struct needs_cleanup<ast::let_expression> : std::false_type {};
+template<> struct needs_cleanup<ast::if_expression> : std::false_type {};
+template<> struct needs_cleanup<ast::case_expression> : std::false_type {};
+template<> struct needs_cleanup<ast::case_when> : std::false_type {};
+template<> struct needs_cleanup<ast::primary_expression> : std::false_type {};
+template<> struct needs_cleanup<ast::formula> : std::false_type {};
+template<> struct needs_cleanup<ast::term> : std::false_type {};
+template<> struct needs_cleanup<ast::factor> : std::false_type {};
+template<> struct needs_cleanup<ast::relational_operator> : std::false_type {};
+template<> struct needs_cleanup<ast::additive_operator> : std::false_type {};
+template<> struct needs_cleanup<ast::mult_operator> : std::false_type {};
+template<> struct needs_cleanup<ast::constant> : std::false_type {};
+template<> struct needs_cleanup<ast::list> : std::false_type {};
+template<> struct needs_cleanup<ast::enum_list> : std::false_type {};
+template<> struct needs_cleanup<ast::func_call> : std::false_type {};
+template<> struct needs_cleanup<ast::call_args> : std::false_type {};
+
+} // namespace helper
+
+namespace ast {
+
 class ast {
 public:
     ast_node root;
+
+    // Owns all nodes reachable from root
+    std::shared_ptr<helper::arena> node_arena;
+
+    // The text which the nodes were parsed from, and which operators and
+    // string literals in them refer into unless the AST was loaded from its
+    // binary form
+    std::shared_ptr<helper::source_buffer const> source;
+
     bool operator==(ast const& rhs) const;
     bool operator!=(ast const& rhs) const;
 };
 
+namespace detail {
+
+    template<class Visitor>
+    struct dereferencing_visitor : boost::static_visitor<typename Visitor::result_type> {
+        using result_type = typename Visitor::result_type;
+
+        explicit dereferencing_visitor(Visitor const& v)
+            : visitor(v)
+        {}
+
+        template<class T>
+        result_type operator()(T const* const node) const
+        {
+            return visitor(*node);
+        }
+
+        template<class T, class U>
+        result_type operator()(T const* const lhs, U const* const rhs) const
+        {
+            return visitor(*lhs, *rhs);
+        }
+
+        Visitor const& visitor;
+    };
+
+} // namespace detail
+
+// Applies the static visitor to the node which the handle refers to.
+template<class Visitor>
+inline typename Visitor::result_type visit(Visitor const& visitor, ast_node const& node)
+{
+    return boost::apply_visitor(detail::dereferencing_visitor<Visitor>{visitor}, node.value);
+}
+
+template<class Visitor>
+inline typename Visitor::result_type visit(Visitor const& visitor, ast_node const& lhs, ast_node const& rhs)
+{
+    return boost::apply_visitor(detail::dereferencing_visitor<Visitor>{visitor}, lhs.value, rhs.value);
+}
+
 } // namespace ast
 } // namespace templa
 
@@ -0,0 +1,147 @@
+#if !defined TEMPLA_AST_ADAPTED_HPP_INCLUDED
+#define      TEMPLA_AST_ADAPTED_HPP_INCLUDED
+
+#include <cstddef>
+#include <utility>
+#include <type_traits>
+
+#include <boost/fusion/include/adapt_struct.hpp>
+#include <boost/fusion/include/at_c.hpp>
+#include <boost/fusion/include/size.hpp>
+#include <boost/optional.hpp>
+#include <boost/variant/variant.hpp>
+#include <boost/variant/get.hpp>
+#include <boost/variant/static_visitor.hpp>
+
+#include "ast.hpp"
+
+// Fields of each node in declaration order.  Serializers walk nodes through
+// these instead of spelling out every node type.
+BOOST_FUSION_ADAPT_STRUCT(templa::ast::program, function_declarations)
+BOOST_FUSION_ADAPT_STRUCT(templa::ast::decl_func, function_name, maybe_declaration_params, expression)
+BOOST_FUSION_ADAPT_STRUCT(templa::ast::decl_params, declaration_params)
+BOOST_FUSION_ADAPT_STRUCT(templa::ast::decl_param, value)
+BOOST_FUSION_ADAPT_STRUCT(templa::ast::list_match, elements, rest_elems_name)
+BOOST_FUSION_ADAPT_STRUCT(templa::ast::type_match, param_name, type_name)
+BOOST_FUSION_ADAPT_STRUCT(templa::ast::expression, value)
+BOOST_FUSION_ADAPT_STRUCT(templa::ast::let_expression, function_declarations, body)
+BOOST_FUSION_ADAPT_STRUCT(templa::ast::if_expression, condition, expression_if_true, expression_if_false)
+BOOST_FUSION_ADAPT_STRUCT(templa::ast::case_expression, case_when, otherwise_expression)
+BOOST_FUSION_ADAPT_STRUCT(templa::ast::case_when, condition, then_expression)
+BOOST_FUSION_ADAPT_STRUCT(templa::ast::primary_expression, formulae, operators)
+BOOST_FUSION_ADAPT_STRUCT(templa::ast::formula, maybe_sign, terms, operators)
+BOOST_FUSION_ADAPT_STRUCT(templa::ast::term, factors, operators)
+BOOST_FUSION_ADAPT_STRUCT(templa::ast::factor, value)
+BOOST_FUSION_ADAPT_STRUCT(templa::ast::relational_operator, value)
+BOOST_FUSION_ADAPT_STRUCT(templa::ast::additive_operator, value)
+BOOST_FUSION_ADAPT_STRUCT(templa::ast::mult_operator, value)
+BOOST_FUSION_ADAPT_STRUCT(templa::ast::constant, value)
+BOOST_FUSION_ADAPT_STRUCT(templa::ast::list, value)
+BOOST_FUSION_ADAPT_STRUCT(templa::ast::enum_list, elements)
+BOOST_FUSION_ADAPT_STRUCT(templa::ast::int_list, min, max)
+BOOST_FUSION_ADAPT_STRUCT(templa::ast::char_list, begin, end)
+BOOST_FUSION_ADAPT_STRUCT(templa::ast::func_call, function_name, maybe_call_arguments)
+BOOST_FUSION_ADAPT_STRUCT(templa::ast::call_args, arguments)
+
+namespace templa {
+namespace ast {
+
+namespace detail {
+
+    template<class Node, class F, std::size_t... I>
+    void for_each_field(Node &node, F &f, std::index_sequence<I...>)
+    {
+        using adapted = std::remove_const_t<Node>;
+        using expand = int[];
+        (void)expand{0, (
+            f(boost::fusion::extension::struct_member_name<adapted, I>::call(), boost::fusion::at_c<I>(node)),
+            0
+        )...};
+    }
+
+} // namespace detail
+
+// Calls f(field_name, field) for each field of the node in declaration order.
+template<class Node, class F>
+inline void for_each_field(Node &node, F &&f)
+{
+    using adapted = std::remove_const_t<Node>;
+    detail::for_each_field(node, f, std::make_index_sequence<boost::fusion::result_of::size<adapted>::value>{});
+}
+
+namespace detail {
+
+    template<class F>
+    class node_walker : public boost::static_visitor<void> {
+    public:
+        explicit node_walker(F &f)
+            : f(f)
+        {}
+
+        template<class Node>
+        void operator()(Node const& node) const
+        {
+            for_each_field(node, [this](char const*, auto const& field){
+                walk(field);
+            });
+        }
+
+        void walk(ast_node const& node) const
+        {
+            f(node);
+            visit(*this, node);
+        }
+
+    private:
+        void walk(node_list const& nodes) const
+        {
+            for (auto const& n : nodes) {
+                walk(n);
+            }
+        }
+
+        void walk(declaration_runs const& runs) const
+        {
+            for (auto const& r : runs) {
+                walk(r.declarations);
+            }
+        }
+
+        void walk(boost::optional<ast_node> const& maybe) const
+        {
+            if (maybe) {
+                walk(*maybe);
+            }
+        }
+
+        template<class... Types>
+        void walk(boost::variant<Types...> const& v) const
+        {
+            if (auto const n = boost::get<ast_node>(&v)) {
+                walk(*n);
+            }
+        }
+
+        // Names and scalars
+        template<class T>
+        void walk(T const&) const
+        {}
+
+        F &f;
+    };
+
+} // namespace detail
+
+// Calls f(n) for node and each node below it, parents before children.  The
+// lines of the nodes of a program are the ones they were parsed at; see
+// declaration_run.
+template<class F>
+inline void for_each_node(ast_node const& node, F &&f)
+{
+    detail::node_walker<std::remove_reference_t<F>>{f}.walk(node);
+}
+
+} // namespace ast
+} // namespace templa
+
+#endif    // TEMPLA_AST_ADAPTED_HPP_INCLUDED
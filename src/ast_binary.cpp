@@ -0,0 +1,468 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <array>
+#include <utility>
+#include <type_traits>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include <boost/functional/hash.hpp>
+#include <boost/mpl/for_each.hpp>
+#include <boost/mpl/at.hpp>
+#include <boost/mpl/size.hpp>
+#include <boost/variant/apply_visitor.hpp>
+#include <boost/variant/static_visitor.hpp>
+#include <boost/utility/string_ref.hpp>
+
+#include "ast_binary.hpp"
+#include "ast_adapted.hpp"
+
+namespace templa {
+namespace ast {
+
+namespace {
+
+// The first byte is not ASCII, so no templa source begins with the magic
+char const magic[] = "\x89" "TMPLAST";
+std::size_t const magic_size = sizeof(magic) - 1;
+std::uint8_t const format_version = 2;
+
+// Set in the kind of a node which has the same position as the node written
+// before it, which is common because a node often starts at its first child.
+// Otherwise the line is relative to that node.
+std::uint8_t const same_position = 0x80;
+
+struct name_hash {
+    std::size_t operator()(boost::string_ref const s) const
+    {
+        return boost::hash_range(s.begin(), s.end());
+    }
+};
+
+class binary_writer : public boost::static_visitor<void> {
+public:
+    template<class Node>
+    void operator()(Node const& node) const
+    {
+        for_each_field(node, [this](char const*, auto const& field){
+            write(field);
+        });
+    }
+
+    void write(ast_node const& node) const
+    {
+        auto const kind = static_cast<unsigned>(node.value.which());
+        auto const node_line = static_cast<std::uint32_t>(node.line + line_delta);
+        if (node_line == line && node.col == col) {
+            put_byte(kind | same_position);
+        } else {
+            put_byte(kind);
+            put_unsigned(zigzag(static_cast<std::int64_t>(node_line) - line));
+            put_unsigned(node.col);
+            line = node_line;
+            col = node.col;
+        }
+        visit(*this, node);
+    }
+
+    // Header and name table followed by the nodes written so far
+    void flush(std::ostream &out) const
+    {
+        std::string header{magic, magic_size};
+        header += static_cast<char>(format_version);
+        std::swap(header, body);
+        put_unsigned(names.size());
+        for (auto const& n : names) {
+            put_unsigned(n.size());
+            body.append(n.data(), n.size());
+        }
+        std::swap(header, body);
+
+        out.write(header.data(), header.size());
+        out.write(body.data(), body.size());
+    }
+
+private:
+    // The declarations of all runs as one list, at their lines in the source
+    void write(declaration_runs const& runs) const
+    {
+        put_unsigned(count_declarations(runs));
+        for (auto const& r : runs) {
+            line_delta = r.line_delta;
+            for (auto const& d : r.declarations) {
+                write(d);
+            }
+        }
+        line_delta = 0;
+    }
+
+    template<class T>
+    void write(boost::iterator_range<T const*> const& elements) const
+    {
+        put_unsigned(elements.size());
+        for (auto const& e : elements) {
+            write(e);
+        }
+    }
+
+    template<class T>
+    void write(boost::optional<T> const& maybe) const
+    {
+        put_byte(maybe ? 1 : 0);
+        if (maybe) {
+            write(*maybe);
+        }
+    }
+
+    template<class... Types>
+    void write(boost::variant<Types...> const& v) const
+    {
+        put_byte(v.which());
+        boost::apply_visitor(alternative_writer{*this}, v);
+    }
+
+    void write(boost::string_ref const s) const
+    {
+        auto const inserted = name_indices.emplace(s, names.size());
+        if (inserted.second) {
+            names.push_back(s);
+        }
+        put_unsigned(inserted.first->second);
+    }
+
+    // Identifiers share the name table with operators and string literals
+    void write(identifier const i) const
+    {
+        write(i.text());
+    }
+
+    void write(char const c) const
+    {
+        put_byte(static_cast<unsigned char>(c));
+    }
+
+    void write(bool const b) const
+    {
+        put_byte(b ? 1 : 0);
+    }
+
+    void write(int const i) const
+    {
+        put_unsigned(zigzag(i));
+    }
+
+    static std::uint64_t zigzag(std::int64_t const i)
+    {
+        return (static_cast<std::uint64_t>(i) << 1) ^ (i < 0 ? ~std::uint64_t{0} : 0);
+    }
+
+    void put_byte(unsigned const b) const
+    {
+        body += static_cast<char>(b);
+    }
+
+    void put_unsigned(std::uint64_t u) const
+    {
+        while (u >= 0x80) {
+            body += static_cast<char>((u & 0x7f) | 0x80);
+            u >>= 7;
+        }
+        body += static_cast<char>(u);
+    }
+
+    struct alternative_writer : boost::static_visitor<void> {
+        explicit alternative_writer(binary_writer const& w)
+            : w(w)
+        {}
+
+        template<class T>
+        void operator()(T const& value) const
+        {
+            w.write(value);
+        }
+
+        binary_writer const& w;
+    };
+
+    mutable std::string body;
+
+    // Position of the node written last
+    mutable std::uint32_t line = 1;
+    mutable std::uint32_t col = 1;
+
+    // Of the run of the declaration being written
+    mutable std::int64_t line_delta = 0;
+
+    mutable std::vector<boost::string_ref> names;
+    mutable std::unordered_map<boost::string_ref, std::size_t, name_hash> name_indices;
+};
+
+class binary_reader {
+public:
+    binary_reader(char const* const first, char const* const last, helper::arena &node_arena)
+        : current(first), last(last), node_arena(node_arena)
+    {}
+
+    void read_header()
+    {
+        if (static_cast<std::size_t>(last - current) < magic_size + 1
+                || std::memcmp(current, magic, magic_size) != 0) {
+            throw ast_format_error{"not a binary AST"};
+        }
+        current += magic_size;
+        if (get_byte() != format_version) {
+            throw ast_format_error{"unsupported version of binary AST"};
+        }
+
+        auto const count = get_size();
+        names.reserve(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            auto const size = get_size();
+            names.emplace_back(current, size);
+            current += size;
+        }
+        identifiers.resize(count);
+    }
+
+    void read(ast_node &node)
+    {
+        auto kind = get_byte();
+        if (kind & same_position) {
+            kind &= ~same_position;
+        } else {
+            line = static_cast<std::uint32_t>(line + unzigzag(get_unsigned()));
+            col = static_cast<std::uint32_t>(get_unsigned());
+        }
+        node.line = line;
+        node.col = col;
+
+        static auto const readers = make_node_readers(std::make_index_sequence<boost::mpl::size<node_types>::value>{});
+        if (kind >= readers.size()) {
+            throw ast_format_error{"unknown node kind in binary AST"};
+        }
+        readers[kind](*this, node);
+    }
+
+    bool at_end() const
+    {
+        return current == last;
+    }
+
+private:
+    // The declarations are read as one run
+    void read(declaration_runs &runs)
+    {
+        node_list declarations;
+        read(declarations);
+        auto const run = node_arena.make<declaration_run>(declaration_run{declarations, 0, nullptr, 0});
+        runs = {run, run + 1};
+    }
+
+    template<class T>
+    void read(boost::iterator_range<T const*> &elements)
+    {
+        // Elements are read in place, so nested lists need no temporaries
+        auto const size = get_size();
+        auto const first = node_arena.make_array<T>(size);
+        for (std::size_t i = 0; i < size; ++i) {
+            read(first[i]);
+        }
+        elements = {first, first + size};
+    }
+
+    template<class T>
+    void read(boost::optional<T> &maybe)
+    {
+        if (get_byte() != 0) {
+            T value{};
+            read(value);
+            maybe = value;
+        }
+    }
+
+    template<class... Types>
+    void read(boost::variant<Types...> &v)
+    {
+        auto const which = get_byte();
+        int index = 0;
+        bool found = false;
+        boost::mpl::for_each<typename boost::variant<Types...>::types>(
+            alternative_reader<boost::variant<Types...>>{*this, v, which, index, found}
+        );
+        if (!found) {
+            throw ast_format_error{"invalid alternative in binary AST"};
+        }
+    }
+
+    void read(boost::string_ref &s)
+    {
+        auto const index = get_unsigned();
+        if (index >= names.size()) {
+            throw ast_format_error{"invalid name index in binary AST"};
+        }
+        s = names[index];
+    }
+
+    // Each name is interned at most once per AST
+    void read(identifier &i)
+    {
+        auto const index = get_unsigned();
+        if (index >= names.size()) {
+            throw ast_format_error{"invalid name index in binary AST"};
+        }
+        if (identifiers[index] == identifier{} && !names[index].empty()) {
+            identifiers[index] = identifier{names[index]};
+        }
+        i = identifiers[index];
+    }
+
+    void read(char &c)
+    {
+        c = static_cast<char>(get_byte());
+    }
+
+    void read(bool &b)
+    {
+        b = get_byte() != 0;
+    }
+
+    void read(int &i)
+    {
+        i = static_cast<int>(unzigzag(get_unsigned()));
+    }
+
+    static std::int64_t unzigzag(std::uint64_t const u)
+    {
+        return static_cast<std::int64_t>((u >> 1) ^ (~(u & 1) + 1));
+    }
+
+    std::uint8_t get_byte()
+    {
+        if (current == last) {
+            throw ast_format_error{"truncated binary AST"};
+        }
+        return static_cast<std::uint8_t>(*current++);
+    }
+
+    std::uint64_t get_unsigned()
+    {
+        std::uint64_t result = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            auto const b = get_byte();
+            result |= static_cast<std::uint64_t>(b & 0x7f) << shift;
+            if ((b & 0x80) == 0) {
+                return result;
+            }
+        }
+        throw ast_format_error{"malformed number in binary AST"};
+    }
+
+    // A count or size which must fit in the rest of the buffer
+    std::size_t get_size()
+    {
+        auto const size = get_unsigned();
+        if (size > static_cast<std::uint64_t>(last - current)) {
+            throw ast_format_error{"truncated binary AST"};
+        }
+        return static_cast<std::size_t>(size);
+    }
+
+    using node_types = ast_node::value_type::types;
+    using node_reader = void (*)(binary_reader &, ast_node &);
+
+    template<class T>
+    static void read_node(binary_reader &r, ast_node &node)
+    {
+        auto const n = r.node_arena.make<T>();
+        for_each_field(*n, [&r](char const*, auto &field){
+            r.read(field);
+        });
+        node.value = static_cast<T const*>(n);
+    }
+
+    // Reader of each kind indexed by the kind
+    template<std::size_t... I>
+    static std::array<node_reader, sizeof...(I)> make_node_readers(std::index_sequence<I...>)
+    {
+        return {{
+            &read_node<
+                std::remove_const_t<std::remove_pointer_t<typename boost::mpl::at_c<node_types, I>::type>>
+            >...
+        }};
+    }
+
+    template<class Variant>
+    struct alternative_reader {
+        binary_reader &r;
+        Variant &v;
+        int const which;
+        int &index;
+        bool &found;
+
+        template<class T>
+        void operator()(T const&) const
+        {
+            if (index++ != which) {
+                return;
+            }
+            T value{};
+            r.read(value);
+            v = value;
+            found = true;
+        }
+    };
+
+    char const* current;
+    char const* const last;
+    helper::arena &node_arena;
+    std::vector<boost::string_ref> names;
+    // Interned names by index into names, or the empty identifier while not
+    // read yet
+    std::vector<identifier> identifiers;
+
+    // Position of the node read last
+    std::uint32_t line = 1;
+    std::uint32_t col = 1;
+};
+
+} // namespace
+
+void save_ast_binary(std::ostream &out, ast const& a)
+{
+    binary_writer w;
+    w.write(a.root);
+    w.flush(out);
+}
+
+bool is_ast_binary(helper::source_buffer const& buffer)
+{
+    return buffer.size() >= magic_size && std::memcmp(buffer.begin(), magic, magic_size) == 0;
+}
+
+ast load_ast_binary(std::shared_ptr<helper::source_buffer const> const& buffer)
+{
+    return load_ast_binary(buffer, 0);
+}
+
+ast load_ast_binary(std::shared_ptr<helper::source_buffer const> const& buffer, std::size_t const offset)
+{
+    if (offset > buffer->size()) {
+        throw ast_format_error{"not a binary AST"};
+    }
+    auto const node_arena = std::make_shared<helper::arena>();
+    binary_reader r{buffer->begin() + offset, buffer->end(), *node_arena};
+    r.read_header();
+
+    ast_node root;
+    r.read(root);
+    if (!r.at_end()) {
+        throw ast_format_error{"trailing bytes after binary AST"};
+    }
+
+    return {root, node_arena, buffer};
+}
+
+} // namespace ast
+} // namespace templa
@@ -0,0 +1,54 @@
+#if !defined TEMPLA_AST_BINARY_HPP_INCLUDED
+#define      TEMPLA_AST_BINARY_HPP_INCLUDED
+
+#include <ostream>
+#include <memory>
+#include <stdexcept>
+
+#include "ast.hpp"
+#include "helper/source_buffer.hpp"
+
+namespace templa {
+namespace ast {
+
+// Compact binary form of an AST.
+//
+//   magic "\x89TMPLAST" version:u8
+//   name count, then each name as length and bytes
+//   root node
+//
+// The magic begins with a byte which is not ASCII, so that a source whose
+// first name begins with TMPLAST is not taken for a binary AST.
+//
+// A node is its kind (the index in ast_node::value_type), its position and
+// then its fields in declaration order.  The position is omitted if it is the
+// same as the one of the preceding node, otherwise the line is relative to
+// that node.  Names are written once in the name table and fields refer to
+// them by index.  Child lists are their length followed by the elements.  All
+// unsigned numbers are LEB128 and ints are zigzag encoded LEB128.
+void save_ast_binary(std::ostream &out, ast const& a);
+
+// True if the buffer starts with the magic of the binary form
+bool is_ast_binary(helper::source_buffer const& buffer);
+
+// Rebuilds the AST without parsing.  Identifiers are interned, and operators
+// and string literals refer into the name table in the buffer, so the result
+// keeps the buffer alive.  Throws ast_format_error if
+// the buffer is not a valid binary AST.
+ast load_ast_binary(std::shared_ptr<helper::source_buffer const> const& buffer);
+
+// Same for the binary AST which begins offset bytes into the buffer and
+// extends to its end
+ast load_ast_binary(std::shared_ptr<helper::source_buffer const> const& buffer, std::size_t const offset);
+
+class ast_format_error : public std::runtime_error {
+public:
+    explicit ast_format_error(char const* const what)
+        : std::runtime_error(what)
+    {}
+};
+
+} // namespace ast
+} // namespace templa
+
+#endif    // TEMPLA_AST_BINARY_HPP_INCLUDED
@@ -1,14 +1,10 @@
 #include <cstddef>
-
-#define BOOST_RESULT_OF_USE_DECLTYPE 1
+#include <sstream>
 
 #include <boost/variant/apply_visitor.hpp>
 #include <boost/variant/static_visitor.hpp>
 #include <boost/variant/get.hpp>
-#include <boost/range/adaptor/transformed.hpp>
-#include <boost/range/numeric.hpp>
-#include <boost/algorithm/string/join.hpp>
-#include <boost/lexical_cast.hpp>
+#include <boost/utility/string_ref.hpp>
 
 #include "ast_dumper.hpp"
 #include "helper/variant.hpp"
@@ -16,290 +12,501 @@
 namespace templa {
 namespace ast {
 
-using boost::adaptors::transformed;
-using boost::algorithm::join;
+namespace {
+
+void put_indent(std::ostream &out, std::size_t n)
+{
+    static char const spaces[] = "                                ";
+    std::size_t const chunk = sizeof(spaces) - 1;
+    for (; n > chunk; n -= chunk) {
+        out.write(spaces, chunk);
+    }
+    out.write(spaces, n);
+}
+
+} // namespace
 
-struct ast_dumper : boost::static_visitor<std::string> {
+// Note:
+// Writes each node straight into the stream.  One dumper is shared by the
+// whole traversal and only its indent changes while it descends.
+struct ast_dumper : boost::static_visitor<void> {
 
-    ast_dumper(std::size_t const indent)
-        : indent(indent)
+    explicit ast_dumper(std::ostream &out)
+        : out(out)
     {}
 
-    std::string operator()(program const& node) const;
-    std::string operator()(decl_func const& node) const;
-    std::string operator()(decl_params const& node) const;
-    std::string operator()(decl_param const& node) const;
-    std::string operator()(list_match const& node) const;
-    std::string operator()(type_match const& node) const;
-    std::string operator()(expression const& node) const;
-    std::string operator()(let_expression const& node) const;
-    std::string operator()(if_expression const& node) const;
-    std::string operator()(case_expression const& node) const;
-    std::string operator()(case_when const& node) const;
-    std::string operator()(primary_expression const& node) const;
-    std::string operator()(formula const& node) const;
-    std::string operator()(term const& node) const;
-    std::string operator()(factor const& node) const;
-    std::string operator()(relational_operator const& node) const;
-    std::string operator()(additive_operator const& node) const;
-    std::string operator()(mult_operator const& node) const;
-    std::string operator()(constant const& node) const;
-    std::string operator()(list const& node) const;
-    std::string operator()(enum_list const& node) const;
-    std::string operator()(int_list const& node) const;
-    std::string operator()(char_list const& node) const;
-    std::string operator()(func_call const& node) const;
-    std::string operator()(call_args const& node) const;
+    void operator()(program const& node) const;
+    void operator()(decl_func const& node) const;
+    void operator()(decl_params const& node) const;
+    void operator()(decl_param const& node) const;
+    void operator()(list_match const& node) const;
+    void operator()(type_match const& node) const;
+    void operator()(expression const& node) const;
+    void operator()(let_expression const& node) const;
+    void operator()(if_expression const& node) const;
+    void operator()(case_expression const& node) const;
+    void operator()(case_when const& node) const;
+    void operator()(primary_expression const& node) const;
+    void operator()(formula const& node) const;
+    void operator()(term const& node) const;
+    void operator()(factor const& node) const;
+    void operator()(relational_operator const& node) const;
+    void operator()(additive_operator const& node) const;
+    void operator()(mult_operator const& node) const;
+    void operator()(constant const& node) const;
+    void operator()(list const& node) const;
+    void operator()(enum_list const& node) const;
+    void operator()(int_list const& node) const;
+    void operator()(char_list const& node) const;
+    void operator()(func_call const& node) const;
+    void operator()(call_args const& node) const;
+
+    void visit_node(ast_node const& node) const
+    {
+        ++indent;
+        visit(*this, node);
+        --indent;
+    }
 
 private:
-    std::string visit_node(ast_node const& node) const
+    // Children separated by newlines
+    void visit_nodes(node_list const& nodes) const
     {
-        return boost::apply_visitor(ast_dumper{indent + 1}, node.value);
+        bool first = true;
+        for (auto const& n : nodes) {
+            if (!first) {
+                out << '\n';
+            }
+            visit_node(n);
+            first = false;
+        }
+    }
+
+    // Each of them preceded by a newline
+    void visit_operators(node_list const& operators) const
+    {
+        for (auto const& n : operators) {
+            out << '\n';
+            visit_node(n);
+        }
     }
 
     // Deduct A from its argument
     template<class A>
-    auto symbol(A const &) const
+    void symbol(A const &) const
     {
-        return std::string(indent, ' ') + A::symbol + "\n";
+        put_indent(out, indent);
+        out << A::symbol << '\n';
     }
 
     template<class A>
-    auto symbol_prefix(A const &) const
+    void symbol_prefix(A const &) const
+    {
+        put_indent(out, indent);
+        out << A::symbol << ": ";
+    }
+
+    template<class T>
+    void field(char const* const label, T const& value) const
     {
-        return std::string(indent, ' ') + A::symbol + ": ";
+        put_indent(out, indent + 1);
+        out << label << value;
     }
 
-    std::size_t indent;
+    std::ostream &out;
+    mutable std::size_t indent = 0;
 };
 
 // Do not be an inner class because template isn't available in inner classes
-struct constant_visitor : boost::static_visitor<std::string> {
-    constant_visitor(std::size_t const indent)
-        : indent(indent)
+struct constant_visitor : boost::static_visitor<void> {
+    explicit constant_visitor(ast_dumper const& dumper, std::ostream &out)
+        : dumper(dumper), out(out)
     {}
 
-    std::string operator()(ast_node const& n) const
+    void operator()(ast_node const& n) const
     {
-        return boost::apply_visitor(ast_dumper{indent + 1}, n.value);
+        dumper.visit_node(n);
     }
 
-    std::string operator()(std::string const& s) const
+    void operator()(boost::string_ref const& s) const
     {
-        return '"' + s + '"';
+        out << '"' << s << '"';
     }
 
-    std::string operator()(char const& c) const
+    void operator()(char const& c) const
     {
-        return {'\'', c, '\''};
+        out << '\'' << c << '\'';
     }
 
-    template<class T>
-    std::string operator()(T const& t) const
+    void operator()(bool const b) const
+    {
+        out << (b ? '1' : '0');
+    }
+
+    void operator()(int const i) const
     {
-        return boost::lexical_cast<std::string>(t);
+        out << i;
     }
 
-    std::size_t indent;
+    ast_dumper const& dumper;
+    std::ostream &out;
 };
 
-std::string ast_dumper::operator()(program const& node) const
+void ast_dumper::operator()(program const& node) const
 {
-    return symbol(node) + join(
-               node.function_declarations | transformed([this](auto const& n){
-                       return visit_node(n);
-                   })
-               , "\n"
-           );
+    symbol(node);
+    bool first = true;
+    for_each_declaration(node.function_declarations, [&](ast_node const& d, std::int64_t){
+        if (!first) {
+            out << '\n';
+        }
+        visit_node(d);
+        first = false;
+    });
 }
 
-std::string ast_dumper::operator()(decl_func const& node) const
+void ast_dumper::operator()(decl_func const& node) const
 {
-    auto result = symbol(node) + std::string(indent+1, ' ') + "FUNC_NAME: " + node.function_name + "\n";
+    symbol(node);
+    field("FUNC_NAME: ", node.function_name);
+    out << '\n';
     if (node.maybe_declaration_params) {
-        result += visit_node(*node.maybe_declaration_params) + "\n";
+        visit_node(*node.maybe_declaration_params);
+        out << '\n';
     }
-    result += visit_node(node.expression);
-    return result;
+    visit_node(node.expression);
 }
 
-std::string ast_dumper::operator()(decl_params const& node) const 
+void ast_dumper::operator()(decl_params const& node) const
 {
-    return symbol(node) + join(
-                node.declaration_params | transformed([this](auto const& n){ return visit_node(n); })
-              , "\n"
-            );
+    symbol(node);
+    visit_nodes(node.declaration_params);
 }
 
-std::string ast_dumper::operator()(decl_param const& node) const 
+void ast_dumper::operator()(decl_param const& node) const
 {
     if (auto maybe_match = templa::variant::get<ast_node>(node.value)) {
-        return symbol(node) + visit_node(*maybe_match);
+        symbol(node);
+        visit_node(*maybe_match);
     } else {
-        return symbol_prefix(node) + boost::get<std::string>(node.value) + '\n';
+        symbol_prefix(node);
+        out << boost::get<identifier>(node.value) << '\n';
     }
 }
 
-std::string ast_dumper::operator()(list_match const& node) const
+void ast_dumper::operator()(list_match const& node) const
 {
-    return symbol(node) + join(
-                node.elements | transformed([this](auto const& s){ return std::string(indent+1, ' ') + "ELEM_NAME: " + s; })
-              , "\n"
-            ) + '\n' + std::string(indent+1, ' ') + "REST_ELEMS_NAME: " + node.rest_elems_name;
+    symbol(node);
+    for (auto const& e : node.elements) {
+        if (&e != node.elements.begin()) {
+            out << '\n';
+        }
+        field("ELEM_NAME: ", e);
+    }
+    out << '\n';
+    field("REST_ELEMS_NAME: ", node.rest_elems_name);
 }
 
-std::string ast_dumper::operator()(type_match const& node) const
+void ast_dumper::operator()(type_match const& node) const
 {
-    return symbol(node) +
-        std::string(indent+1, ' ') + "PARAM_NAME: " + node.param_name + "\n" +
-        std::string(indent+1, ' ') + "TYPE_NAME: " + node.type_name + "\n";
+    symbol(node);
+    field("PARAM_NAME: ", node.param_name);
+    out << '\n';
+    field("TYPE_NAME: ", node.type_name);
+    out << '\n';
 }
 
-std::string ast_dumper::operator()(expression const& node) const
+void ast_dumper::operator()(expression const& node) const
 {
-    return symbol(node) + visit_node(node.value);
+    symbol(node);
+    visit_node(node.value);
 }
 
-std::string ast_dumper::operator()(let_expression const& node) const
+void ast_dumper::operator()(let_expression const& node) const
 {
-    return symbol(node) + join(
-                node.function_declarations | transformed([this](auto const& n){ return visit_node(n); })
-              , "\n"
-            ) + "\n"
-            + visit_node(node.body);
+    symbol(node);
+    visit_nodes(node.function_declarations);
+    out << '\n';
+    visit_node(node.body);
 }
 
-std::string ast_dumper::operator()(if_expression const& node) const
+void ast_dumper::operator()(if_expression const& node) const
 {
-    return symbol(node) +
-            visit_node(node.condition) + "\n" +
-            visit_node(node.expression_if_true) + "\n" +
-            visit_node(node.expression_if_false);
+    symbol(node);
+    visit_node(node.condition);
+    out << '\n';
+    visit_node(node.expression_if_true);
+    out << '\n';
+    visit_node(node.expression_if_false);
 }
 
-std::string ast_dumper::operator()(case_expression const& node) const
+void ast_dumper::operator()(case_expression const& node) const
 {
-    return symbol(node) + join(
-                node.case_when | transformed([this](auto const& n){ return visit_node(n); })
-              , "\n"
-            ) + "\n" + visit_node(node.otherwise_expression);
+    symbol(node);
+    visit_nodes(node.case_when);
+    out << '\n';
+    visit_node(node.otherwise_expression);
 }
 
-std::string ast_dumper::operator()(case_when const& node) const
+void ast_dumper::operator()(case_when const& node) const
 {
-    return symbol(node) + visit_node(node.condition) + "\n" + visit_node(node.then_expression);
+    symbol(node);
+    visit_node(node.condition);
+    out << '\n';
+    visit_node(node.then_expression);
 }
 
-std::string ast_dumper::operator()(primary_expression const& node) const
+void ast_dumper::operator()(primary_expression const& node) const
 {
-    return symbol(node) + join(
-                node.formulae | transformed([this](auto const& n){ return visit_node(n); })
-              , "\n"
-            ) + boost::accumulate(
-                node.operators | transformed([this](auto const& n){ return "\n" + visit_node(n); })
-              , std::string{}
-            );
+    symbol(node);
+    visit_nodes(node.formulae);
+    visit_operators(node.operators);
 }
 
-std::string ast_dumper::operator()(formula const& node) const
+void ast_dumper::operator()(formula const& node) const
 {
-    auto result = symbol(node);
+    symbol(node);
     if (node.maybe_sign) {
-        result += std::string(indent+1, ' ') + "SIGN: " + *node.maybe_sign + "\n";
+        field("SIGN: ", *node.maybe_sign);
+        out << '\n';
     }
-    result += join(
-                node.terms | transformed([this](auto const& n){ return visit_node(n); })
-              , "\n"
-            ) + boost::accumulate(
-                node.operators | transformed([this](auto const& n){ return "\n" + visit_node(n); })
-              , std::string{}
-            );
-    return result;
+    visit_nodes(node.terms);
+    visit_operators(node.operators);
 }
 
-std::string ast_dumper::operator()(term const& node) const
+void ast_dumper::operator()(term const& node) const
 {
-    return symbol(node) + join(
-                node.factors | transformed([this](auto const& n){ return visit_node(n); })
-              , "\n"
-            ) + boost::accumulate(
-                node.operators | transformed([this](auto const& n){ return "\n" + visit_node(n); })
-              , std::string{}
-            );
+    symbol(node);
+    visit_nodes(node.factors);
+    visit_operators(node.operators);
 }
 
-std::string ast_dumper::operator()(factor const& node) const
+void ast_dumper::operator()(factor const& node) const
 {
-    return symbol(node) + visit_node(node.value);
+    symbol(node);
+    visit_node(node.value);
 }
 
-std::string ast_dumper::operator()(relational_operator const& node) const
+void ast_dumper::operator()(relational_operator const& node) const
 {
-    return std::string(indent, ' ') + relational_operator::symbol + ": " + node.value;
+    symbol_prefix(node);
+    out << node.value;
 }
 
-std::string ast_dumper::operator()(additive_operator const& node) const
+void ast_dumper::operator()(additive_operator const& node) const
 {
-    return std::string(indent, ' ') + additive_operator::symbol + ": " + node.value;
+    symbol_prefix(node);
+    out << node.value;
 }
 
-std::string ast_dumper::operator()(mult_operator const& node) const
+void ast_dumper::operator()(mult_operator const& node) const
 {
-    return std::string(indent, ' ') + mult_operator::symbol + ": " + node.value;
+    symbol_prefix(node);
+    out << node.value;
 }
 
-std::string ast_dumper::operator()(constant const& node) const
+void ast_dumper::operator()(constant const& node) const
 {
-    return symbol_prefix(node) + boost::apply_visitor(constant_visitor{indent}, node.value);
+    symbol_prefix(node);
+    boost::apply_visitor(constant_visitor{*this, out}, node.value);
 }
 
-std::string ast_dumper::operator()(list const& node) const
+void ast_dumper::operator()(list const& node) const
 {
-    return symbol(node) + visit_node(node.value);
+    symbol(node);
+    visit_node(node.value);
 }
 
-std::string ast_dumper::operator()(enum_list const& node) const
+void ast_dumper::operator()(enum_list const& node) const
 {
-    return symbol(node) + join(
-                node.elements | transformed([this](auto const& n){ return visit_node(n); })
-              , "\n"
-            );
+    symbol(node);
+    visit_nodes(node.elements);
 }
 
-std::string ast_dumper::operator()(int_list const& node) const
+void ast_dumper::operator()(int_list const& node) const
 {
-    return symbol(node) +
-        std::string(indent+1, ' ') + "LIST_MIN: " + std::to_string(node.min) + "\n" +
-        std::string(indent+1, ' ') + "LIST_MAX: " + std::to_string(node.max);
+    symbol(node);
+    field("LIST_MIN: ", node.min);
+    out << '\n';
+    field("LIST_MAX: ", node.max);
 }
 
-std::string ast_dumper::operator()(char_list const& node) const
+void ast_dumper::operator()(char_list const& node) const
 {
-    return symbol(node) +
-        std::string(indent+1, ' ') + "CHAR_BEGIN: " + std::to_string(node.begin) + "\n" +
-        std::string(indent+1, ' ') + "CHAR_END: " + std::to_string(node.end);
+    // Characters are dumped as their codes
+    symbol(node);
+    field("CHAR_BEGIN: ", static_cast<int>(node.begin));
+    out << '\n';
+    field("CHAR_END: ", static_cast<int>(node.end));
 }
 
-std::string ast_dumper::operator()(func_call const& node) const
+void ast_dumper::operator()(func_call const& node) const
 {
-    auto result = symbol(node) + std::string(indent+1, ' ') + "FUNC_NAME: " + node.function_name;
+    symbol(node);
+    field("FUNC_NAME: ", node.function_name);
     if (node.maybe_call_arguments) {
-        result += "\n" + visit_node(*node.maybe_call_arguments);
+        out << '\n';
+        visit_node(*node.maybe_call_arguments);
     }
-    return result;
 }
 
-std::string ast_dumper::operator()(call_args const& node) const
+void ast_dumper::operator()(call_args const& node) const
 {
-    return symbol(node) + join(
-                node.arguments | transformed([this](auto const& n){ return visit_node(n); })
-              , "\n"
-            );
+    symbol(node);
+    visit_nodes(node.arguments);
+}
+
+void dump_ast(std::ostream &out, ast const& a)
+{
+    visit(ast_dumper{out}, a.root);
 }
 
 std::string dump_ast(ast const& a)
 {
-    return boost::apply_visitor(ast_dumper{0}, a.root.value);
+    std::ostringstream out;
+    dump_ast(out, a);
+    return out.str();
+}
+
+namespace {
+
+// Writes the text which the node itself contributes.  Children are written
+// after it, separated by newlines, by the caller.
+void dump_flat_node(std::ostream &out, flat_ast const& f, flat_ast::index const i, std::size_t const indent)
+{
+    auto const kind = f.kinds[i];
+    auto const payload = f.payloads[i];
+
+    auto const symbol = [&](char const* const s, char const* const suffix) {
+        put_indent(out, indent);
+        out << s << suffix;
+    };
+
+    auto const line = [&](char const* const label, auto const& value) {
+        put_indent(out, indent + 1);
+        out << label << value;
+    };
+
+    switch (kind) {
+    case node_kind::decl_func:
+        symbol(decl_func::symbol, "\n");
+        line("FUNC_NAME: ", f.names[payload]);
+        out << '\n';
+        break;
+
+    case node_kind::decl_param:
+        symbol(decl_param::symbol, "");
+        if (f.flags[i]) {
+            out << ": " << f.names[payload];
+        }
+        out << '\n';
+        break;
+
+    case node_kind::list_match: {
+        symbol(list_match::symbol, "\n");
+        auto const span = f.name_lists[payload];
+        for (auto n = span.first; n + 1 < span.first + span.size; ++n) {
+            if (n != span.first) {
+                out << '\n';
+            }
+            line("ELEM_NAME: ", f.names[n]);
+        }
+        out << '\n';
+        line("REST_ELEMS_NAME: ", f.names[span.first + span.size - 1]);
+        break;
+    }
+
+    case node_kind::type_match:
+        symbol(type_match::symbol, "\n");
+        line("PARAM_NAME: ", f.names[payload]);
+        out << '\n';
+        line("TYPE_NAME: ", f.names[payload + 1]);
+        out << '\n';
+        break;
+
+    case node_kind::formula:
+        symbol(formula::symbol, "\n");
+        if (f.flags[i]) {
+            line("SIGN: ", static_cast<char>(f.flags[i]));
+            out << '\n';
+        }
+        break;
+
+    case node_kind::relational_operator:
+    case node_kind::additive_operator:
+    case node_kind::mult_operator:
+        symbol(symbol_of(kind), ": ");
+        out << f.names[payload];
+        break;
+
+    case node_kind::constant:
+        symbol(constant::symbol, ": ");
+        switch (f.flags[i]) {
+        case 0: out << f.integers[payload]; break;
+        case 1: out << '\'' << static_cast<char>(payload) << '\''; break;
+        case 2: out << (payload != 0 ? '1' : '0'); break;
+        case 3: out << '"' << f.names[payload] << '"'; break;
+        default: break;
+        }
+        break;
+
+    case node_kind::int_list:
+        symbol(int_list::symbol, "\n");
+        line("LIST_MIN: ", f.integers[payload]);
+        out << '\n';
+        line("LIST_MAX: ", f.integers[payload + 1]);
+        break;
+
+    case node_kind::char_list:
+        symbol(char_list::symbol, "\n");
+        line("CHAR_BEGIN: ", static_cast<int>(static_cast<char>(payload & 0xff)));
+        out << '\n';
+        line("CHAR_END: ", static_cast<int>(static_cast<char>(payload >> 8)));
+        break;
+
+    case node_kind::func_call:
+        symbol(func_call::symbol, "\n");
+        line("FUNC_NAME: ", f.names[payload]);
+        if (f.child_count(i) != 0) {
+            out << '\n';
+        }
+        break;
+
+    default:
+        symbol(symbol_of(kind), "\n");
+        break;
+    }
+}
+
+} // namespace
+
+void dump_ast(std::ostream &out, flat_ast const& f)
+{
+    std::vector<std::uint32_t> depths(f.size(), 0);
+    std::vector<char> follows_sibling(f.size(), false);
+
+    // Parents precede their children, so depth and separators of a node are
+    // known by the time the scan reaches it.
+    for_each_node(f, [&](flat_ast::index const i){
+        if (follows_sibling[i]) {
+            out << '\n';
+        }
+        dump_flat_node(out, f, i, depths[i]);
+
+        bool first = true;
+        for (auto const c : f.children_of(i)) {
+            depths[c] = depths[i] + 1;
+            follows_sibling[c] = !first;
+            first = false;
+        }
+    });
+}
+
+std::string dump_ast(flat_ast const& f)
+{
+    std::ostringstream out;
+    dump_ast(out, f);
+    return out.str();
 }
 
 } // namespace ast
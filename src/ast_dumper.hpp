@@ -2,14 +2,24 @@
 #define      TEMPLA_AST_DUMPER_HPP_INCLUDED
 
 #include <string>
+#include <ostream>
 
 #include "ast.hpp"
+#include "flat_ast.hpp"
 
 namespace templa {
 namespace ast {
 
+// Writes the tree into out as it is traversed.  Time is linear in the size of
+// the tree.
+void dump_ast(std::ostream &out, ast const& a);
 std::string dump_ast(ast const& a);
 
+// Produces the same text as dump_ast(ast const&) in one linear scan over the
+// flat representation.
+void dump_ast(std::ostream &out, flat_ast const& f);
+std::string dump_ast(flat_ast const& f);
+
 } // namespace ast
 } // namespace templa
 
@@ -0,0 +1,193 @@
+#include <cstddef>
+#include <cstdint>
+
+#include <boost/variant/apply_visitor.hpp>
+#include <boost/variant/static_visitor.hpp>
+#include <boost/utility/string_ref.hpp>
+
+#include "ast_json.hpp"
+#include "ast_adapted.hpp"
+
+namespace templa {
+namespace ast {
+
+namespace {
+
+class json_writer : public boost::static_visitor<void> {
+public:
+    explicit json_writer(std::ostream &out)
+        : out(out)
+    {}
+
+    template<class Node>
+    void operator()(Node const& node) const
+    {
+        out << "{\"kind\":\"" << Node::symbol << "\",\"line\":" << line << ",\"col\":" << col;
+        for_each_field(node, [this](char const* const name, auto const& field){
+            out << ",\"" << name << "\":";
+            write(field);
+        });
+        out << '}';
+    }
+
+    void write(ast_node const& node) const
+    {
+        line = static_cast<std::uint32_t>(node.line + line_delta);
+        col = node.col;
+        visit(*this, node);
+    }
+
+private:
+    // The declarations of all runs as one array, at their lines in the
+    // source
+    void write(declaration_runs const& runs) const
+    {
+        out << '[';
+        bool first = true;
+        for (auto const& r : runs) {
+            line_delta = r.line_delta;
+            for (auto const& d : r.declarations) {
+                if (!first) {
+                    out << ',';
+                }
+                first = false;
+                write(d);
+            }
+        }
+        line_delta = 0;
+        out << ']';
+    }
+
+    template<class T>
+    void write(boost::iterator_range<T const*> const& elements) const
+    {
+        out << '[';
+        for (auto const& e : elements) {
+            if (&e != elements.begin()) {
+                out << ',';
+            }
+            write(e);
+        }
+        out << ']';
+    }
+
+    template<class T>
+    void write(boost::optional<T> const& maybe) const
+    {
+        if (maybe) {
+            write(*maybe);
+        } else {
+            out << "null";
+        }
+    }
+
+    template<class... Types>
+    void write(boost::variant<Types...> const& v) const
+    {
+        boost::apply_visitor(alternative_writer{*this}, v);
+    }
+
+    void write(boost::string_ref const s) const
+    {
+        out << '"';
+        // Runs of characters which need no escape are written at once
+        auto run = s.begin();
+        for (auto i = s.begin(); i != s.end(); ++i) {
+            if (needs_escape(*i)) {
+                out.write(run, i - run);
+                write_escaped(*i);
+                run = i + 1;
+            }
+        }
+        out.write(run, s.end() - run);
+        out << '"';
+    }
+
+    void write(identifier const i) const
+    {
+        write(i.text());
+    }
+
+    static bool needs_escape(char const c)
+    {
+        return c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20;
+    }
+
+    void write(char const c) const
+    {
+        out << '"';
+        write_escaped(c);
+        out << '"';
+    }
+
+    void write(bool const b) const
+    {
+        out << (b ? "true" : "false");
+    }
+
+    void write(int const i) const
+    {
+        out << i;
+    }
+
+    void write_escaped(char const c) const
+    {
+        static char const hex[] = "0123456789abcdef";
+        switch (c) {
+        case '"':  out << "\\\""; break;
+        case '\\': out << "\\\\"; break;
+        case '\n': out << "\\n"; break;
+        case '\t': out << "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                out << "\\u00" << hex[c >> 4] << hex[c & 0xf];
+            } else {
+                out << c;
+            }
+            break;
+        }
+    }
+
+    struct alternative_writer : boost::static_visitor<void> {
+        explicit alternative_writer(json_writer const& w)
+            : w(w)
+        {}
+
+        template<class T>
+        void operator()(T const& value) const
+        {
+            w.out << "{\"" << type_name(value) << "\":";
+            w.write(value);
+            w.out << '}';
+        }
+
+        static char const* type_name(ast_node const&) { return "node"; }
+        static char const* type_name(boost::string_ref const&) { return "string"; }
+        static char const* type_name(identifier const&) { return "string"; }
+        static char const* type_name(char const&) { return "char"; }
+        static char const* type_name(bool const&) { return "bool"; }
+        static char const* type_name(int const&) { return "int"; }
+
+        json_writer const& w;
+    };
+
+    std::ostream &out;
+
+    // Position of the node being written
+    mutable std::uint32_t line = 0;
+    mutable std::uint32_t col = 0;
+
+    // Of the run of the declaration being written
+    mutable std::int64_t line_delta = 0;
+};
+
+} // namespace
+
+void dump_ast_json(std::ostream &out, ast const& a)
+{
+    json_writer{out}.write(a.root);
+    out << '\n';
+}
+
+} // namespace ast
+} // namespace templa
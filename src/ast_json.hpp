@@ -0,0 +1,24 @@
+#if !defined TEMPLA_AST_JSON_HPP_INCLUDED
+#define      TEMPLA_AST_JSON_HPP_INCLUDED
+
+#include <ostream>
+
+#include "ast.hpp"
+
+namespace templa {
+namespace ast {
+
+// Writes the tree as one JSON object per node while traversing it:
+//
+//   {"kind":"DECL_FUNC","line":1,"col":1,"function_name":"f",...}
+//
+// Members after the position are the fields of the node.  Child lists are
+// arrays, absent optionals are null and characters are one character strings.
+// A field which may hold different types is written as an object with one
+// member named after the held type, e.g. {"int":42} or {"node":{...}}.
+void dump_ast_json(std::ostream &out, ast const& a);
+
+} // namespace ast
+} // namespace templa
+
+#endif    // TEMPLA_AST_JSON_HPP_INCLUDED
@@ -0,0 +1,85 @@
+#include <boost/variant/apply_visitor.hpp>
+#include <boost/variant/static_visitor.hpp>
+#include <boost/variant/get.hpp>
+
+#include "ast_relocation.hpp"
+#include "ast_adapted.hpp"
+
+namespace templa {
+namespace ast {
+
+namespace {
+
+class relocator : public boost::static_visitor<ast_node> {
+public:
+    relocator(helper::arena &node_arena, std::int64_t const line_delta)
+        : node_arena(node_arena), line_delta(line_delta)
+    {}
+
+    template<class Node>
+    ast_node operator()(Node const& node) const
+    {
+        auto const copied = node_arena.make<Node>(node);
+        for_each_field(*copied, [this](char const*, auto &field){
+            relocate(field);
+        });
+        return {copied, 0, 0};
+    }
+
+    ast_node copy(ast_node const& node) const
+    {
+        auto result = visit(*this, node);
+        result.line = static_cast<std::uint32_t>(node.line + line_delta);
+        result.col = node.col;
+        return result;
+    }
+
+private:
+    void relocate(ast_node &node) const
+    {
+        node = copy(node);
+    }
+
+    void relocate(node_list &nodes) const
+    {
+        auto const first = node_arena.make_array<ast_node>(nodes.size());
+        auto dest = first;
+        for (auto const& n : nodes) {
+            *dest++ = copy(n);
+        }
+        nodes = {first, dest};
+    }
+
+    void relocate(boost::optional<ast_node> &maybe) const
+    {
+        if (maybe) {
+            relocate(*maybe);
+        }
+    }
+
+    template<class... Types>
+    void relocate(boost::variant<Types...> &v) const
+    {
+        if (auto const n = boost::get<ast_node>(&v)) {
+            relocate(*n);
+        }
+    }
+
+    // Names and scalars are shared
+    template<class T>
+    void relocate(T const&) const
+    {}
+
+    helper::arena &node_arena;
+    std::int64_t const line_delta;
+};
+
+} // namespace
+
+ast_node relocate(helper::arena &node_arena, ast_node const& node, std::int64_t const line_delta)
+{
+    return relocator{node_arena, line_delta}.copy(node);
+}
+
+} // namespace ast
+} // namespace templa
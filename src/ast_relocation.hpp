@@ -0,0 +1,20 @@
+#if !defined TEMPLA_AST_RELOCATION_HPP_INCLUDED
+#define      TEMPLA_AST_RELOCATION_HPP_INCLUDED
+
+#include <cstdint>
+
+#include "ast.hpp"
+#include "helper/arena.hpp"
+
+namespace templa {
+namespace ast {
+
+// Copies the subtree into node_arena with line_delta added to the line of
+// every node.  Identifiers are interned, and operators and literals keep
+// referring into the same source text.
+ast_node relocate(helper::arena &node_arena, ast_node const& node, std::int64_t const line_delta);
+
+} // namespace ast
+} // namespace templa
+
+#endif    // TEMPLA_AST_RELOCATION_HPP_INCLUDED
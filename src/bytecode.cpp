@@ -0,0 +1,608 @@
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <utility>
+
+#include <boost/variant/get.hpp>
+
+#include "bytecode.hpp"
+#include "semantic.hpp"
+
+namespace templa {
+namespace eval {
+
+namespace {
+
+using semantic::semantic_error;
+
+template<class Node>
+Node const& get(ast::ast_node const& node)
+{
+    return *boost::get<Node const*>(node.value);
+}
+
+// The position of clause c of f in the source
+location where_clause(semantic::function const& f, std::size_t const c)
+{
+    return {static_cast<std::size_t>(f.clauses[c].line + f.line_deltas[c]), f.clauses[c].col};
+}
+
+// Names while a function is compiled.  A clause binds its parameters to
+// slots of its activation, and a let or the program declare functions.
+struct scope {
+    scope const* parent;
+    // Activations which the scope is nested in, 0 for the program
+    std::size_t level;
+    std::vector<std::pair<ast::identifier, std::uint32_t>> slots;
+    semantic::function_table const* functions;
+};
+
+// A parameter whose int, char or bool constants select the clause of each
+// call, so that a jump table can replace trying the clauses one by one
+struct selector {
+    std::size_t param;
+    int type;
+    // Of each clause with patterns, in order
+    std::vector<int> values;
+};
+
+class bytecode_compiler {
+public:
+    explicit bytecode_compiler(ast::ast const& a)
+        : top_level(get<ast::program>(a.root).function_declarations)
+    {}
+
+    bytecode compile()
+    {
+        emit(opcode::halt, {0, 0});
+        scopes.push_back({nullptr, 0, {}, &top_level});
+        declare(scopes.back());
+        for (std::size_t i = 0; i < top_level.functions().size(); ++i) {
+            out.top_level.emplace(top_level.functions()[i].name, i);
+        }
+
+        while (!pending.empty()) {
+            auto const p = pending.front();
+            pending.pop_front();
+            compile_function(*p.first, *p.second);
+        }
+        return std::move(out);
+    }
+
+private:
+    // Gives each function of s an index.  They are compiled after the
+    // function being compiled, in the order of their declarations.
+    void declare(scope const& s)
+    {
+        for (auto const& f : s.functions->functions()) {
+            indices.emplace(&f, out.functions.size());
+            out.functions.push_back({f.name, f.arity, f.arity, 0, where_clause(f, 0)});
+            pending.emplace_back(&f, &s);
+        }
+    }
+
+    std::size_t emit(
+        opcode const op,
+        location const& at,
+        std::uint32_t const a = 0,
+        std::uint32_t const b = 0,
+        std::uint32_t const c = 0,
+        std::uint32_t const d = 0
+    )
+    {
+        out.code.push_back({op, a, b, c, d});
+        out.locations.push_back(at);
+        return out.code.size() - 1;
+    }
+
+    // Makes the jump of the instruction at pc go to the next instruction
+    void patch(std::size_t const pc)
+    {
+        auto &i = out.code[pc];
+        auto const next = static_cast<std::uint32_t>(out.code.size());
+        switch (i.op) {
+        case opcode::match_value:
+            i.b = next;
+            break;
+        case opcode::match_list:
+        case opcode::match_type:
+            i.d = next;
+            break;
+        default:
+            i.a = next;
+            break;
+        }
+    }
+
+    std::uint32_t constant(value v)
+    {
+        out.constants.push_back(std::move(v));
+        return static_cast<std::uint32_t>(out.constants.size() - 1);
+    }
+
+    void compile_function(semantic::function const& f, scope const& declared_in)
+    {
+        auto const index = indices.at(&f);
+        level = declared_in.level + 1;
+        out.functions[index].entry = out.code.size();
+
+        std::vector<std::size_t> order;
+        for (std::size_t c = 0; c < f.clauses.size(); ++c) {
+            if (!f.general || c != *f.general) {
+                order.push_back(c);
+            }
+        }
+        auto const select = selector_of(f, order);
+        if (f.general) {
+            order.push_back(*f.general);
+        }
+
+        boost::optional<std::size_t> dispatch;
+        if (select) {
+            dispatch = emit(
+                opcode::dispatch, where_clause(f, 0),
+                static_cast<std::uint32_t>(select->param), static_cast<std::uint32_t>(out.tables.size())
+            );
+            out.tables.emplace_back();
+        }
+
+        std::size_t frame_size = f.arity;
+        std::vector<std::uint32_t> bodies;
+        for (auto const c : order) {
+            line_delta = f.line_deltas[c];
+            scopes.push_back({&declared_in, level, {}, nullptr});
+            auto &s = scopes.back();
+            auto const failures = compile_patterns(f, get<ast::decl_func>(f.clauses[c]), s, frame_size);
+            bodies.push_back(static_cast<std::uint32_t>(out.code.size()));
+            compile_expression(get<ast::decl_func>(f.clauses[c]).expression, s);
+            emit(opcode::ret, where_clause(f, c));
+            for (auto const pc : failures) {
+                patch(pc);
+            }
+        }
+
+        auto const no_match = static_cast<std::uint32_t>(out.code.size());
+        if (!f.general) {
+            emit(opcode::no_match, where_clause(f, 0), static_cast<std::uint32_t>(index));
+        }
+        out.functions[index].frame_size = frame_size;
+
+        if (select) {
+            auto &table = out.tables[out.code[*dispatch].b];
+            auto const range = std::minmax_element(select->values.begin(), select->values.end());
+            table.type = select->type;
+            table.min = *range.first;
+            table.otherwise = f.general ? bodies.back() : no_match;
+            table.targets.assign(static_cast<std::size_t>(*range.second - *range.first) + 1, table.otherwise);
+            // The first clause of a value wins, as when they are tried in order
+            for (std::size_t i = select->values.size(); i-- > 0;) {
+                table.targets[select->values[i] - table.min] = bodies[i];
+            }
+        }
+    }
+
+    // The parameter whose constants tell the clauses with patterns apart, if
+    // they have no other patterns and the constants are dense enough
+    boost::optional<selector> selector_of(semantic::function const& f, std::vector<std::size_t> const& order) const
+    {
+        if (order.size() < 2) {
+            return boost::none;
+        }
+
+        auto const constant_of = [](ast::ast_node const& param) -> boost::optional<std::pair<int, int>> {
+            auto const pattern = boost::get<ast::ast_node>(&get<ast::decl_param>(param).value);
+            if (!pattern || !boost::get<ast::constant const*>(&pattern->value)) {
+                return boost::none;
+            }
+            auto const& c = get<ast::constant>(*pattern).value;
+            if (auto const i = boost::get<int>(&c)) {
+                return std::make_pair(0, *i);
+            } else if (auto const ch = boost::get<char>(&c)) {
+                return std::make_pair(1, static_cast<int>(*ch));
+            } else if (auto const b = boost::get<bool>(&c)) {
+                return std::make_pair(2, *b ? 1 : 0);
+            }
+            return boost::none;
+        };
+
+        for (std::size_t p = 0; p < f.arity; ++p) {
+            selector s{p, -1, {}};
+            for (auto const c : order) {
+                auto const params = semantic::parameters(get<ast::decl_func>(f.clauses[c]));
+                auto const k = constant_of(params[p]);
+                if (!k || (s.type != -1 && k->first != s.type)) {
+                    break;
+                }
+                bool const others_are_names = std::all_of(params.begin(), params.end(), [&](ast::ast_node const& param){
+                    return &param == &params[p] || semantic::parameter_name(get<ast::decl_param>(param));
+                });
+                if (!others_are_names) {
+                    break;
+                }
+                s.type = k->first;
+                s.values.push_back(k->second);
+            }
+            if (s.values.size() != order.size()) {
+                continue;
+            }
+            auto const range = std::minmax_element(s.values.begin(), s.values.end());
+            if (static_cast<long long>(*range.second) - *range.first <= 4 * static_cast<long long>(s.values.size()) + 16) {
+                return s;
+            }
+        }
+        return boost::none;
+    }
+
+    // Emits the tests of the patterns of clause and binds its names in s.
+    // Returns the instructions which jump to the next clause.
+    std::vector<std::size_t> compile_patterns(
+        semantic::function const& f,
+        ast::decl_func const& clause,
+        scope &s,
+        std::size_t &frame_size
+    )
+    {
+        auto const bind = [&](ast::identifier const name, std::size_t const slot, ast::ast_node const& at){
+            for (auto const& b : s.slots) {
+                if (b.first == name) {
+                    throw semantic_error{
+                        where(at).line, where(at).col,
+                        "parameter " + name.to_string() + " of " + f.name.to_string() + " is declared twice"
+                    };
+                }
+            }
+            s.slots.emplace_back(name, static_cast<std::uint32_t>(slot));
+        };
+
+        std::vector<std::size_t> failures;
+        auto next = f.arity;
+        auto const params = semantic::parameters(clause);
+        for (std::size_t i = 0; i < params.size(); ++i) {
+            auto const slot = static_cast<std::uint32_t>(i);
+            auto const& param = get<ast::decl_param>(params[i]);
+            if (auto const name = semantic::parameter_name(param)) {
+                bind(*name, i, params[i]);
+                continue;
+            }
+
+            auto const& pattern = boost::get<ast::ast_node>(param.value);
+            if (auto const m = boost::get<ast::list_match const*>(&pattern.value)) {
+                auto const& elements = (*m)->elements;
+                failures.push_back(emit(
+                    opcode::match_list, where(pattern),
+                    slot, static_cast<std::uint32_t>(elements.size()), static_cast<std::uint32_t>(next)
+                ));
+                for (auto const& e : elements) {
+                    bind(e, next++, pattern);
+                }
+                bind((*m)->rest_elems_name, next++, pattern);
+            } else if (auto const t = boost::get<ast::type_match const*>(&pattern.value)) {
+                auto const type = semantic::find_type((*t)->type_name);
+                if (!type) {
+                    throw semantic_error{where(pattern).line, where(pattern).col, "unknown type " + (*t)->type_name.to_string()};
+                }
+                failures.push_back(emit(
+                    opcode::match_type, where(pattern),
+                    slot, static_cast<std::uint32_t>(*type), static_cast<std::uint32_t>(next)
+                ));
+                bind((*t)->param_name, next++, pattern);
+            } else {
+                auto const& c = get<ast::constant>(pattern).value;
+                if (auto const l = boost::get<ast::ast_node>(&c)) {
+                    if (!boost::get<ast::enum_list const*>(&get<ast::list>(*l).value.value)) {
+                        throw semantic_error{where(pattern).line, where(pattern).col, "a range cannot be a pattern"};
+                    }
+                }
+                // Names in the pattern are those of the scope of the function
+                compile_constant(pattern, *s.parent);
+                failures.push_back(emit(opcode::match_value, where(pattern), slot));
+            }
+        }
+        frame_size = std::max(frame_size, next);
+        return failures;
+    }
+
+    void compile_expression(ast::ast_node const& node, scope const& s)
+    {
+        auto const& value_node = get<ast::expression>(node).value;
+
+        if (auto const let = boost::get<ast::let_expression const*>(&value_node.value)) {
+            let_tables.push_back(std::make_unique<semantic::function_table const>((*let)->function_declarations, line_delta));
+            scopes.push_back({&s, s.level, {}, let_tables.back().get()});
+            declare(scopes.back());
+            compile_expression((*let)->body, scopes.back());
+            return;
+        }
+
+        if (auto const i = boost::get<ast::if_expression const*>(&value_node.value)) {
+            compile_expression((*i)->condition, s);
+            auto const unless = emit(opcode::jump_unless, where((*i)->condition));
+            compile_expression((*i)->expression_if_true, s);
+            auto const end = emit(opcode::jump, where(node));
+            patch(unless);
+            compile_expression((*i)->expression_if_false, s);
+            patch(end);
+            return;
+        }
+
+        if (auto const c = boost::get<ast::case_expression const*>(&value_node.value)) {
+            std::vector<std::size_t> ends;
+            for (auto const& w : (*c)->case_when) {
+                auto const& when = get<ast::case_when>(w);
+                compile_expression(when.condition, s);
+                auto const unless = emit(opcode::jump_unless, where(when.condition));
+                compile_expression(when.then_expression, s);
+                ends.push_back(emit(opcode::jump, where(w)));
+                patch(unless);
+            }
+            compile_expression((*c)->otherwise_expression, s);
+            for (auto const pc : ends) {
+                patch(pc);
+            }
+            return;
+        }
+
+        compile_primary(value_node, s);
+    }
+
+    void compile_primary(ast::ast_node const& node, scope const& s)
+    {
+        auto const& primary = get<ast::primary_expression>(node);
+        compile_formula(primary.formulae.front(), s);
+        for (std::size_t i = 0; i < primary.operators.size(); ++i) {
+            auto const& at = primary.operators[i];
+            auto const op = get<ast::relational_operator>(at).value;
+            compile_formula(primary.formulae[i + 1], s);
+            emit(
+                op == "==" ? opcode::eq :
+                op == "!=" ? opcode::ne :
+                op == "<"  ? opcode::lt :
+                op == ">"  ? opcode::gt :
+                op == "<=" ? opcode::le :
+                             opcode::ge,
+                where(at)
+            );
+        }
+    }
+
+    void compile_formula(ast::ast_node const& node, scope const& s)
+    {
+        auto const& f = get<ast::formula>(node);
+        compile_term(f.terms.front(), s);
+        if (f.maybe_sign && *f.maybe_sign == '-') {
+            emit(opcode::neg, where(node));
+        }
+        for (std::size_t i = 0; i < f.operators.size(); ++i) {
+            auto const& at = f.operators[i];
+            auto const op = get<ast::additive_operator>(at).value;
+            if (op == "|" || op == "||") {
+                auto const skip = emit(opcode::or_else, where(at));
+                compile_term(f.terms[i + 1], s);
+                patch(skip);
+                continue;
+            }
+            compile_term(f.terms[i + 1], s);
+            emit(op == "+" ? opcode::add : opcode::sub, where(at));
+        }
+    }
+
+    void compile_term(ast::ast_node const& node, scope const& s)
+    {
+        auto const& t = get<ast::term>(node);
+        compile_factor(t.factors.front(), s);
+        for (std::size_t i = 0; i < t.operators.size(); ++i) {
+            auto const& at = t.operators[i];
+            auto const op = get<ast::mult_operator>(at).value;
+            if (op == "&" || op == "&&") {
+                auto const skip = emit(opcode::and_then, where(at));
+                compile_factor(t.factors[i + 1], s);
+                patch(skip);
+                continue;
+            }
+            compile_factor(t.factors[i + 1], s);
+            emit(op == "*" ? opcode::mul : op == "/" ? opcode::div : opcode::mod, where(at));
+        }
+    }
+
+    void compile_factor(ast::ast_node const& node, scope const& s)
+    {
+        auto const& v = get<ast::factor>(node).value;
+        if (boost::get<ast::factor const*>(&v.value)) {
+            compile_factor(v, s);
+            emit(opcode::not_, where(node));
+        } else if (boost::get<ast::primary_expression const*>(&v.value)) {
+            compile_primary(v, s);
+        } else if (boost::get<ast::constant const*>(&v.value)) {
+            compile_constant(v, s);
+        } else {
+            compile_call(v, s);
+        }
+    }
+
+    void compile_constant(ast::ast_node const& node, scope const& s)
+    {
+        auto const& c = get<ast::constant>(node).value;
+        if (auto const i = boost::get<int>(&c)) {
+            emit(opcode::push_const, where(node), constant(*i));
+            return;
+        } else if (auto const ch = boost::get<char>(&c)) {
+            emit(opcode::push_const, where(node), constant(*ch));
+            return;
+        } else if (auto const b = boost::get<bool>(&c)) {
+            emit(opcode::push_const, where(node), constant(*b));
+            return;
+        } else if (auto const str = boost::get<boost::string_ref>(&c)) {
+            emit(opcode::push_const, where(node), constant(str->to_string()));
+            return;
+        }
+
+        auto const& l = get<ast::list>(boost::get<ast::ast_node>(c)).value;
+        if (auto const r = boost::get<ast::int_list const*>(&l.value)) {
+            emit(opcode::int_range, where(node), static_cast<std::uint32_t>((*r)->min), static_cast<std::uint32_t>((*r)->max));
+        } else if (auto const r = boost::get<ast::char_list const*>(&l.value)) {
+            emit(opcode::char_range, where(node), static_cast<unsigned char>((*r)->begin), static_cast<unsigned char>((*r)->end));
+        } else {
+            auto const& elements = get<ast::enum_list>(l).elements;
+            for (auto const& e : elements) {
+                compile_primary(e, s);
+            }
+            emit(opcode::make_list, where(node), static_cast<std::uint32_t>(elements.size()));
+        }
+    }
+
+    void compile_call(ast::ast_node const& node, scope const& s)
+    {
+        auto const& call = get<ast::func_call>(node);
+        auto const name = [&]{ return call.function_name.to_string(); };
+
+        ast::node_list arguments;
+        if (call.maybe_call_arguments) {
+            arguments = get<ast::call_args>(*call.maybe_call_arguments).arguments;
+        }
+        auto const compile_arguments = [&]{
+            for (auto const& a : arguments) {
+                compile_primary(a, s);
+            }
+        };
+
+        for (auto sc = &s; sc != nullptr; sc = sc->parent) {
+            for (auto const& b : sc->slots) {
+                if (b.first != call.function_name) {
+                    continue;
+                }
+                if (!arguments.empty()) {
+                    throw semantic_error{where(node).line, where(node).col, name() + " is not a function"};
+                }
+                if (sc->level == level) {
+                    emit(opcode::load, where(node), b.second);
+                } else {
+                    emit(opcode::load_outer, where(node), static_cast<std::uint32_t>(level - sc->level), b.second);
+                }
+                return;
+            }
+
+            auto const f = sc->functions ? sc->functions->find(call.function_name) : nullptr;
+            if (f == nullptr) {
+                continue;
+            }
+            if (arguments.size() != f->arity) {
+                throw semantic_error{
+                    where(node).line, where(node).col,
+                    name() + " takes " + std::to_string(f->arity) + (f->arity == 1 ? " argument" : " arguments")
+                        + ", but is called with " + std::to_string(arguments.size())
+                };
+            }
+            compile_arguments();
+            auto const hops = sc->level == 0 ? bytecode::global : static_cast<std::uint32_t>(level - sc->level);
+            emit(opcode::call, where(node), static_cast<std::uint32_t>(indices.at(f)), hops);
+            return;
+        }
+
+        auto const builtin = semantic::find_builtin(call.function_name);
+        if (!builtin) {
+            throw semantic_error{where(node).line, where(node).col, name() + " is not declared"};
+        }
+        if (arguments.size() != 1) {
+            throw semantic_error{where(node).line, where(node).col, name() + " takes 1 argument"};
+        }
+        compile_arguments();
+        switch (*builtin) {
+        case semantic::builtin::print:
+            emit(opcode::print, where(node));
+            break;
+        case semantic::builtin::to_char:
+            emit(opcode::to_char, where(node));
+            break;
+        case semantic::builtin::string:
+            emit(opcode::to_string, where(node));
+            break;
+        }
+    }
+
+    // The position of a node of the clause being compiled in the source
+    location where(ast::ast_node const& node) const
+    {
+        return {static_cast<std::size_t>(node.line + line_delta), node.col};
+    }
+
+    semantic::function_table const top_level;
+    bytecode out;
+    std::deque<scope> scopes;
+    std::vector<std::unique_ptr<semantic::function_table const>> let_tables;
+    std::unordered_map<semantic::function const*, std::size_t> indices;
+    std::deque<std::pair<semantic::function const*, scope const*>> pending;
+    // Activation level of the function being compiled
+    std::size_t level = 0;
+    // Of the clause being compiled
+    std::int64_t line_delta = 0;
+};
+
+// Names and numbers of operands of the opcodes
+struct opcode_info {
+    char const* name;
+    std::size_t operands;
+} const opcodes[] = {
+    {"halt", 0}, {"push_const", 1}, {"load", 1}, {"load_outer", 2}, {"call", 2}, {"ret", 0},
+    {"jump", 1}, {"jump_unless", 1}, {"or_else", 1}, {"and_then", 1},
+    {"add", 0}, {"sub", 0}, {"mul", 0}, {"div", 0}, {"mod", 0},
+    {"eq", 0}, {"ne", 0}, {"lt", 0}, {"gt", 0}, {"le", 0}, {"ge", 0}, {"neg", 0}, {"not", 0},
+    {"print", 0}, {"to_char", 0}, {"to_string", 0}, {"int_range", 2}, {"char_range", 2}, {"make_list", 1},
+    {"match_value", 2}, {"match_list", 4}, {"match_type", 4}, {"dispatch", 2}, {"no_match", 1},
+};
+
+} // namespace
+
+boost::optional<std::size_t> bytecode::find(ast::identifier const name) const
+{
+    auto const i = top_level.find(name);
+    if (i == top_level.end()) {
+        return boost::none;
+    }
+    return i->second;
+}
+
+bytecode compile_bytecode(ast::ast const& a)
+{
+    return bytecode_compiler{a}.compile();
+}
+
+void dump_bytecode(std::ostream &out, bytecode const& b)
+{
+    std::vector<std::size_t> order(b.functions.size());
+    for (std::size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](std::size_t const l, std::size_t const r){
+        return b.functions[l].entry < b.functions[r].entry;
+    });
+
+    auto next = order.begin();
+    for (std::size_t pc = 0; pc < b.code.size(); ++pc) {
+        for (; next != order.end() && b.functions[*next].entry == pc; ++next) {
+            auto const& f = b.functions[*next];
+            out << '#' << *next << ' ' << f.name << '/' << f.arity << " (" << f.frame_size << " slots):\n";
+        }
+        auto const& i = b.code[pc];
+        auto const& info = opcodes[static_cast<std::size_t>(i.op)];
+        out << "  " << pc << ' ' << info.name;
+        if (i.op == opcode::push_const) {
+            out << ' ' << b.constants[i.a];
+        } else if (i.op == opcode::int_range) {
+            out << ' ' << static_cast<int>(i.a) << ' ' << static_cast<int>(i.b);
+        } else if (i.op == opcode::call) {
+            out << ' ' << b.functions[i.a].name;
+            if (i.b != bytecode::global) {
+                out << ' ' << i.b;
+            }
+        } else {
+            std::uint32_t const operands[] = {i.a, i.b, i.c, i.d};
+            for (std::size_t o = 0; o < info.operands; ++o) {
+                out << ' ' << operands[o];
+            }
+        }
+        out << '\n';
+    }
+}
+
+} // namespace eval
+} // namespace templa
@@ -0,0 +1,117 @@
+#if !defined TEMPLA_BYTECODE_HPP_INCLUDED
+#define      TEMPLA_BYTECODE_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <ostream>
+#include <unordered_map>
+#include <limits>
+
+#include <boost/optional.hpp>
+
+#include "ast.hpp"
+#include "evaluator.hpp"
+#include "operations.hpp"
+
+namespace templa {
+namespace eval {
+
+// Instructions of the VM.  They work on a stack of values; a call pushes an
+// activation whose slots are its arguments followed by the names which its
+// patterns bind.  Operands are a, b, c and d of the instruction.
+enum class opcode : std::uint8_t {
+    halt,           // Ends vm::call()
+    push_const,     // Pushes constants[a]
+    load,           // Pushes slot a of the activation
+    load_outer,     // Pushes slot b of the activation a static links out
+    call,           // Calls functions[a], declared b static links out, with its arguments on the stack
+    ret,            // Replaces the arguments of the activation by the top and returns
+    jump,           // Goes to a
+    jump_unless,    // Pops a condition and goes to a if it is false
+    or_else,        // If the top is true, replaces it by true and goes to a, otherwise pops it
+    and_then,       // If the top is false, replaces it by false and goes to a, otherwise pops it
+    add,            // Binary operators on the two values at the top
+    sub,
+    mul,
+    div,
+    mod,
+    eq,
+    ne,
+    lt,
+    gt,
+    le,
+    ge,
+    neg,            // Unary operators on the top
+    not_,
+    print,          // Builtins of one argument
+    to_char,
+    to_string,
+    int_range,      // Pushes the list [a .. b] of ints, or of chars
+    char_range,
+    make_list,      // Pops a values and pushes the list of them
+    match_value,    // Pops a value and goes to b if slot a is not equal to it
+    match_list,     // Goes to d unless slot a is a list of at least b elements, which it binds from slot c on, followed by the rest
+    match_type,     // Goes to d unless slot a has the type whose which() is b, and binds it to slot c
+    dispatch,       // Goes to the target of slot a in tables[b]
+    no_match,       // Fails a call of functions[a]
+};
+
+struct instruction {
+    opcode op;
+    std::uint32_t a = 0;
+    std::uint32_t b = 0;
+    std::uint32_t c = 0;
+    std::uint32_t d = 0;
+};
+
+// A program compiled from an AST.  Every name is resolved to a slot or a
+// function index, so nothing is looked up by name while it runs.
+struct bytecode {
+    // Operand b of a call of a top-level function, which has no static link
+    static constexpr std::uint32_t global = std::numeric_limits<std::uint32_t>::max();
+
+    struct function {
+        ast::identifier name;
+        std::size_t arity;
+        // Slots of an activation, the arguments first
+        std::size_t frame_size;
+        std::size_t entry;
+        location at;
+    };
+
+    // The clause of a function which its constant patterns of one
+    // parameter select, from a call's argument of the type whose which() is
+    // type, at target[value - min]
+    struct jump_table {
+        int type;
+        int min;
+        std::vector<std::uint32_t> targets;
+        // Where other arguments go
+        std::uint32_t otherwise;
+    };
+
+    std::vector<instruction> code;
+    // Of each instruction, for its errors
+    std::vector<location> locations;
+    std::vector<value> constants;
+    std::vector<function> functions;
+    std::vector<jump_table> tables;
+    // Indices into functions of the top-level functions
+    std::unordered_map<ast::identifier, std::size_t> top_level;
+
+    // The top-level function named name
+    boost::optional<std::size_t> find(ast::identifier const name) const;
+};
+
+// Throws semantic::semantic_error as the code generators do, for every
+// function whether it is called or not
+bytecode compile_bytecode(ast::ast const& a);
+
+// Writes the instructions of b, one per line
+void dump_bytecode(std::ostream &out, bytecode const& b);
+
+} // namespace eval
+} // namespace templa
+
+#endif    // TEMPLA_BYTECODE_HPP_INCLUDED
@@ -0,0 +1,279 @@
+#include <ctime>
+#include <iomanip>
+#include <utility>
+
+#include <sys/resource.h>
+
+#include <boost/mpl/at.hpp>
+
+#include "compile_stats.hpp"
+#include "ast_adapted.hpp"
+
+namespace templa {
+
+namespace {
+
+double thread_cpu_ms()
+{
+    timespec t;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+    return t.tv_sec * 1e3 + t.tv_nsec / 1e6;
+}
+
+std::size_t allocations_now()
+{
+    return compile_stats::allocation_counter ? compile_stats::allocation_counter() : 0;
+}
+
+using node_types = ast::ast_node::value_type::types;
+
+template<std::size_t... I>
+std::array<char const*, sizeof...(I)> make_node_kind_names(std::index_sequence<I...>)
+{
+    return {{
+        std::remove_pointer_t<typename boost::mpl::at_c<node_types, I>::type>::symbol...
+    }};
+}
+
+// Allocations are only counted for --stats
+bool counts_allocations()
+{
+    return compile_stats::allocation_counter != nullptr;
+}
+
+void print_table(std::ostream &out, compile_stats const& stats, bool const phases_only)
+{
+    out << std::left << std::setw(16) << "phase" << std::right
+        << std::setw(12) << "wall ms" << std::setw(12) << "cpu ms"
+        << std::setw(8) << "count";
+    if (counts_allocations()) {
+        out << std::setw(14) << "allocations";
+    }
+    out << '\n' << std::fixed << std::setprecision(3);
+    compile_stats::timing total;
+    for (std::size_t i = 0; i < compile_stats::num_phases; ++i) {
+        auto const p = static_cast<compile_stats::phase>(i);
+        auto const& t = stats.time(p);
+        out << std::left << std::setw(16) << compile_stats::name(p) << std::right
+            << std::setw(12) << t.wall_ms << std::setw(12) << t.cpu_ms
+            << std::setw(8) << t.count;
+        if (counts_allocations()) {
+            out << std::setw(14) << t.allocations;
+        }
+        out << '\n';
+        total.wall_ms += t.wall_ms;
+        total.cpu_ms += t.cpu_ms;
+        total.allocations += t.allocations;
+    }
+    out << std::left << std::setw(16) << "total" << std::right
+        << std::setw(12) << total.wall_ms << std::setw(12) << total.cpu_ms;
+    if (counts_allocations()) {
+        out << std::setw(8) << "" << std::setw(14) << total.allocations;
+    }
+    out << '\n';
+    if (phases_only) {
+        return;
+    }
+
+    out << '\n' << std::left << std::setw(16) << "node kind" << std::right << std::setw(12) << "count" << '\n';
+    std::size_t total_nodes = 0;
+    for (std::size_t k = 0; k < stats.nodes().size(); ++k) {
+        out << std::left << std::setw(16) << compile_stats::node_kind_name(k) << std::right
+            << std::setw(12) << stats.nodes()[k] << '\n';
+        total_nodes += stats.nodes()[k];
+    }
+    out << std::left << std::setw(16) << "total" << std::right << std::setw(12) << total_nodes << '\n';
+
+    out << '\n'
+        << "ASTs: " << stats.asts << '\n'
+        << "arena objects: " << stats.arena_objects << '\n'
+        << "arena bytes: " << stats.arena_bytes << '\n'
+        << "arena blocks: " << stats.arena_blocks << '\n'
+        << "peak RSS KB: " << peak_rss_kb() << '\n';
+    if (stats.cache) {
+        out << "cache hits: " << stats.cache->hits << '\n'
+            << "cache misses: " << stats.cache->misses << '\n'
+            << "cache stores: " << stats.cache->stores << '\n'
+            << "cache evictions: " << stats.cache->evictions << '\n';
+    }
+    if (stats.folding) {
+        out << "folded declarations: " << stats.folding->declarations << '\n'
+            << "folded calls: " << stats.folding->calls << '\n'
+            << "fold failures: " << stats.folding->failures << '\n'
+            << "fold steps: " << stats.folding->steps << '\n'
+            << "folded instantiations: " << stats.folding->instantiations << '\n';
+    }
+    if (stats.memo) {
+        out << "memo hits: " << stats.memo->hits << '\n'
+            << "memo misses: " << stats.memo->misses << '\n'
+            << "memo stores: " << stats.memo->stores << '\n'
+            << "memo evictions: " << stats.memo->evictions << '\n'
+            << "memo hit rate: " << stats.memo->hit_rate() << '\n';
+    }
+}
+
+void print_json(std::ostream &out, compile_stats const& stats, bool const phases_only)
+{
+    out << "{\"phases\":{" << std::fixed << std::setprecision(3);
+    for (std::size_t i = 0; i < compile_stats::num_phases; ++i) {
+        auto const p = static_cast<compile_stats::phase>(i);
+        auto const& t = stats.time(p);
+        out << (i == 0 ? "" : ",") << '"' << compile_stats::name(p) << "\":{"
+            << "\"wall_ms\":" << t.wall_ms << ",\"cpu_ms\":" << t.cpu_ms
+            << ",\"count\":" << t.count;
+        if (counts_allocations()) {
+            out << ",\"allocations\":" << t.allocations;
+        }
+        out << '}';
+    }
+    out << '}';
+
+    if (!phases_only) {
+        out << ",\"nodes\":{";
+        for (std::size_t k = 0; k < stats.nodes().size(); ++k) {
+            out << (k == 0 ? "" : ",") << '"' << compile_stats::node_kind_name(k) << "\":" << stats.nodes()[k];
+        }
+        out << "},\"asts\":" << stats.asts
+            << ",\"arena\":{\"objects\":" << stats.arena_objects
+            << ",\"bytes\":" << stats.arena_bytes
+            << ",\"blocks\":" << stats.arena_blocks << '}'
+            << ",\"peak_rss_kb\":" << peak_rss_kb();
+        if (stats.cache) {
+            out << ",\"cache\":{\"hits\":" << stats.cache->hits
+                << ",\"misses\":" << stats.cache->misses
+                << ",\"stores\":" << stats.cache->stores
+                << ",\"evictions\":" << stats.cache->evictions << '}';
+        }
+        if (stats.folding) {
+            out << ",\"folding\":{\"declarations\":" << stats.folding->declarations
+                << ",\"calls\":" << stats.folding->calls
+                << ",\"failures\":" << stats.folding->failures
+                << ",\"steps\":" << stats.folding->steps
+                << ",\"instantiations\":" << stats.folding->instantiations << '}';
+        }
+        if (stats.memo) {
+            out << ",\"memo\":{\"hits\":" << stats.memo->hits
+                << ",\"misses\":" << stats.memo->misses
+                << ",\"stores\":" << stats.memo->stores
+                << ",\"evictions\":" << stats.memo->evictions
+                << ",\"hit_rate\":" << stats.memo->hit_rate() << '}';
+        }
+    }
+    out << "}\n";
+}
+
+} // namespace
+
+std::size_t (*compile_stats::allocation_counter)() = nullptr;
+
+compile_stats::scope::scope(compile_stats *const stats, phase const p)
+    : stats(stats)
+    , measured(p)
+    , wall_start(stats ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{})
+    , cpu_start(stats ? thread_cpu_ms() : 0)
+    , allocations_start(stats ? allocations_now() : 0)
+{}
+
+compile_stats::scope::~scope()
+{
+    if (stats == nullptr) {
+        return;
+    }
+    timing t;
+    t.wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wall_start).count();
+    t.cpu_ms = thread_cpu_ms() - cpu_start;
+    t.count = 1;
+    t.allocations = allocations_now() - allocations_start;
+    stats->add(measured, t);
+}
+
+void compile_stats::add(phase const p, timing const& t)
+{
+    auto &sum = phases[static_cast<std::size_t>(p)];
+    sum.wall_ms += t.wall_ms;
+    sum.cpu_ms += t.cpu_ms;
+    sum.count += t.count;
+    sum.allocations += t.allocations;
+}
+
+void compile_stats::count(ast::ast const& a)
+{
+    ast::for_each_node(a.root, [this](ast::ast_node const& n){
+        ++kinds[static_cast<std::size_t>(n.value.which())];
+    });
+    ++asts;
+    // Note:
+    // An AST parsed in chunks or reparsed keeps further arenas alive, whose
+    // objects are not included
+    arena_objects += a.node_arena->object_count();
+    arena_bytes += a.node_arena->used_bytes();
+    arena_blocks += a.node_arena->block_count();
+}
+
+void compile_stats::merge(compile_stats const& other)
+{
+    for (std::size_t i = 0; i < num_phases; ++i) {
+        add(static_cast<phase>(i), other.phases[i]);
+    }
+    for (std::size_t k = 0; k < kinds.size(); ++k) {
+        kinds[k] += other.kinds[k];
+    }
+    asts += other.asts;
+    arena_objects += other.arena_objects;
+    arena_bytes += other.arena_bytes;
+    arena_blocks += other.arena_blocks;
+    if (other.folding) {
+        if (!folding) {
+            folding = eval::folding_statistics{};
+        }
+        folding->merge(*other.folding);
+    }
+    if (other.memo) {
+        if (!memo) {
+            memo = eval::memo_statistics{};
+        }
+        memo->merge(*other.memo);
+    }
+}
+
+char const* compile_stats::name(phase const p)
+{
+    switch (p) {
+    case phase::setup:       return "setup";
+    case phase::read:        return "read";
+    case phase::cache_load:  return "cache_load";
+    case phase::parse:       return "parse";
+    case phase::cache_store: return "cache_store";
+    case phase::fold:        return "fold";
+    case phase::emit:        return "emit";
+    }
+    return "";
+}
+
+char const* compile_stats::node_kind_name(std::size_t const kind)
+{
+    static auto const names = make_node_kind_names(std::make_index_sequence<std::tuple_size<node_counts>::value>{});
+    return names[kind];
+}
+
+std::size_t peak_rss_kb()
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<std::size_t>(usage.ru_maxrss);
+}
+
+void print_stats(std::ostream &out, compile_stats const& stats, stats_format const format, bool const phases_only)
+{
+    switch (format) {
+    case stats_format::table:
+        print_table(out, stats, phases_only);
+        break;
+    case stats_format::json:
+        print_json(out, stats, phases_only);
+        break;
+    }
+    out.flush();
+}
+
+} // namespace templa
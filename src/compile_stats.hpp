@@ -0,0 +1,123 @@
+#if !defined TEMPLA_COMPILE_STATS_HPP_INCLUDED
+#define      TEMPLA_COMPILE_STATS_HPP_INCLUDED
+
+#include <cstddef>
+#include <array>
+#include <chrono>
+#include <ostream>
+
+#include <boost/optional.hpp>
+#include <boost/mpl/size.hpp>
+
+#include "ast.hpp"
+#include "parse_cache.hpp"
+#include "constant_folding.hpp"
+
+namespace templa {
+
+// Where compiles spend their time and memory.  A compiler given the
+// statistics by use_stats() adds the phases of each compile to them.
+//
+// Note:
+// CPU time is the time of the calling thread, so the statistics of one
+// compiler must only be updated from one thread at a time.  Compilers in
+// different threads keep their own statistics, which are merged afterwards.
+class compile_stats {
+public:
+    enum class phase {
+        setup,          // Building the grammar of a compiler
+        read,           // Opening or mapping the source
+        cache_load,
+        parse,
+        cache_store,
+        fold,           // Evaluating closed declarations and calls
+        emit,           // Writing the output
+    };
+    static std::size_t const num_phases = 7;
+
+    struct timing {
+        double wall_ms = 0;
+        double cpu_ms = 0;
+        std::size_t count = 0;
+        std::size_t allocations = 0;
+    };
+
+    using node_counts = std::array<std::size_t, boost::mpl::size<ast::ast_node::value_type::types>::value>;
+
+    // Number of heap allocations made by the calling thread so far.  The
+    // program which counts them sets it; allocations are neither counted
+    // nor printed if it is null.
+    static std::size_t (*allocation_counter)();
+
+    // Adds the time from its construction to its destruction to a phase.
+    // Nothing is measured if the statistics are null.
+    class scope {
+    public:
+        scope(compile_stats *const stats, phase const p);
+        ~scope();
+
+        scope(scope const&) = delete;
+        scope &operator=(scope const&) = delete;
+
+    private:
+        compile_stats *const stats;
+        phase const measured;
+        std::chrono::steady_clock::time_point const wall_start;
+        double const cpu_start;
+        std::size_t const allocations_start;
+    };
+
+    void add(phase const p, timing const& t);
+
+    // Counts the nodes of a by kind, and the objects and bytes of its arena
+    void count(ast::ast const& a);
+
+    // Adds the counts of other, e.g. of a compiler in another thread
+    void merge(compile_stats const& other);
+
+    timing const& time(phase const p) const
+    {
+        return phases[static_cast<std::size_t>(p)];
+    }
+
+    static char const* name(phase const p);
+
+    // Indexed by ast_node::value.which()
+    node_counts const& nodes() const
+    {
+        return kinds;
+    }
+
+    static char const* node_kind_name(std::size_t const kind);
+
+    std::size_t asts = 0;
+    std::size_t arena_objects = 0;
+    std::size_t arena_bytes = 0;
+    std::size_t arena_blocks = 0;
+
+    // Printed with the other statistics if set
+    boost::optional<parse_cache::statistics> cache;
+    boost::optional<eval::folding_statistics> folding;
+    // Of --run, and of folding too
+    boost::optional<eval::memo_statistics> memo;
+
+private:
+    std::array<timing, num_phases> phases;
+    node_counts kinds = {};
+};
+
+enum class stats_format {
+    table,
+    json,
+};
+
+// Peak resident set size of the process in kilobytes
+std::size_t peak_rss_kb();
+
+// Prints the statistics.  If phases_only, only the time of each phase is
+// printed.
+void print_stats(std::ostream &out, compile_stats const& stats, stats_format const format, bool const phases_only);
+
+} // namespace templa
+
+#endif    // TEMPLA_COMPILE_STATS_HPP_INCLUDED
@@ -1,17 +1,187 @@
 #include "compiler.hpp"
 #include "ast_dumper.hpp"
+#include "ast_json.hpp"
+#include "ast_binary.hpp"
+#include "mpl_generator.hpp"
+#include "constexpr_generator.hpp"
+#include "constant_folding.hpp"
+#include "bytecode.hpp"
+#include "vm.hpp"
 
-#include <iostream>
+#include <sstream>
 
 namespace templa {
 
+compiler::compiler(emit_kind const emit, syntax::parser::backend const parsing)
+    : emit(emit), parser(parsing)
+{}
+
 std::string compiler::compile(std::string const& code)
 {
-    ast::ast a = parser.parse(code);
+    return compile(helper::source_buffer::copy_of(code));
+}
+
+std::string compiler::compile(std::shared_ptr<helper::source_buffer const> const& source)
+{
+    std::ostringstream out;
+    compile(source, out);
+    return out.str();
+}
+
+void compiler::compile(
+    std::shared_ptr<helper::source_buffer const> const& source,
+    std::ostream &out,
+    syntax::diagnostics *const diags
+)
+{
+    auto const a = parse(source, diags);
+    if (stats) {
+        stats->count(a);
+    }
+    write(a, out);
+}
+
+void compiler::write(ast::ast const& a, std::ostream &out) const
+{
+    if (emit == emit_kind::cpp && folding) {
+        output(fold(a), out);
+    } else {
+        output(a, out);
+    }
+}
+
+ast::ast compiler::fold(ast::ast const& a) const
+{
+    compile_stats::scope const measure{stats, compile_stats::phase::fold};
+    if (stats == nullptr) {
+        return eval::fold_constants(a, *folding);
+    }
+    eval::folding_statistics counts;
+    auto folded = eval::fold_constants(a, *folding, &counts);
+    if (!stats->folding) {
+        stats->folding = eval::folding_statistics{};
+    }
+    stats->folding->merge(counts);
+    if (folding->memo != 0) {
+        merge_memo(counts.memo);
+    }
+    return folded;
+}
+
+void compiler::merge_memo(eval::memo_statistics const& memo) const
+{
+    if (!stats->memo) {
+        stats->memo = eval::memo_statistics{};
+    }
+    stats->memo->merge(memo);
+}
+
+void compiler::output(ast::ast const& a, std::ostream &out) const
+{
+    compile_stats::scope const measure{stats, compile_stats::phase::emit};
+    switch (emit) {
+    case emit_kind::ast:
+        ast::dump_ast(out, a);
+        out << '\n';
+        break;
+    case emit_kind::ast_json:
+        ast::dump_ast_json(out, a);
+        break;
+    case emit_kind::ast_bin:
+        ast::save_ast_binary(out, a);
+        break;
+    case emit_kind::cpp:
+        if (backend == cpp_backend::constexpr_) {
+            codegen::generate_constexpr(out, a);
+        } else {
+            codegen::generate_mpl(out, a);
+        }
+        break;
+    case emit_kind::bytecode:
+        eval::dump_bytecode(out, eval::compile_bytecode(a));
+        break;
+    case emit_kind::run: {
+        eval::memo_statistics memo;
+        if (runner == run_engine::tree) {
+            eval::run(out, a, run_limits, &memo);
+        } else {
+            eval::run_vm(out, a, run_limits, &memo);
+        }
+        if (stats && run_limits.memo != 0) {
+            merge_memo(memo);
+        }
+        break;
+    }
+    }
+    out.flush();
+}
+
+ast::ast compiler::reparse(
+    ast::ast const& previous,
+    std::shared_ptr<helper::source_buffer const> const& source,
+    syntax::parser::text_edit const& edit,
+    syntax::diagnostics *const diags
+)
+{
+    compile_stats::scope const measure{stats, compile_stats::phase::parse};
+    try {
+        return parser.reparse(previous, source, edit);
+    } catch (syntax::parse_error const&) {
+        if (diags == nullptr) {
+            throw;
+        }
+    }
+    // Parsed once more to collect every error
+    return parse_source(source, diags);
+}
+
+ast::ast compiler::parse(std::shared_ptr<helper::source_buffer const> const& source, syntax::diagnostics *const diags)
+{
+    if (ast::is_ast_binary(*source)) {
+        compile_stats::scope const measure{stats, compile_stats::phase::parse};
+        return ast::load_ast_binary(source);
+    }
+
+    if (cache) {
+        compile_stats::scope const measure{stats, compile_stats::phase::cache_load};
+        if (auto cached = cache->load(source)) {
+            return std::move(*cached);
+        }
+    }
+
+    auto a = [&]{
+        compile_stats::scope const measure{stats, compile_stats::phase::parse};
+        return parse_source(source, diags);
+    }();
+    if (cache) {
+        compile_stats::scope const measure{stats, compile_stats::phase::cache_store};
+        cache->store(*source, a);
+    }
+    return a;
+}
+
+ast::ast compiler::parse_source(std::shared_ptr<helper::source_buffer const> const& source, syntax::diagnostics *const diags)
+{
+    if (diags == nullptr) {
+        return threads ? parser.parse(source, *threads) : parser.parse(source);
+    }
+
+    if (threads) {
+        try {
+            return parser.parse(source, *threads);
+        } catch (syntax::parse_error const&) {
+            // Parsed once more to collect every error
+        }
+    }
 
-    // TODO: Temporary
-    std::cout << ast::dump_ast(a) << std::endl;
-    return "";
+    // All errors are reported, but the first one fails the compile
+    auto const num_reported = diags->entries().size();
+    auto a = parser.parse_recovering(source, *diags);
+    if (diags->entries().size() != num_reported) {
+        auto const& first = diags->entries()[num_reported];
+        throw syntax::parse_error{first.line, first.col, first.message};
+    }
+    return a;
 }
 
 } // namespace templa
@@ -2,16 +2,133 @@
 #define      TEMPLA_COMPILER_HPP_INCLUDED
 
 #include <string>
+#include <memory>
+#include <ostream>
+
+#include <boost/optional.hpp>
 
 #include "parser.hpp"
+#include "parse_cache.hpp"
+#include "compile_stats.hpp"
+#include "evaluator.hpp"
 
 namespace templa {
 
+// What compile() outputs
+enum class emit_kind {
+    ast,        // Indented text of ast::dump_ast
+    ast_json,   // ast::dump_ast_json
+    ast_bin,    // ast::save_ast_binary
+    cpp,        // C++ program of the cpp_backend
+    bytecode,   // Instructions of eval::dump_bytecode
+    run,        // What the C++ program prints, computed by the run_engine
+};
+
+// How emit_kind::cpp computes the program at compile time
+enum class cpp_backend {
+    mpl,        // Class templates of codegen::generate_mpl
+    constexpr_, // constexpr functions of codegen::generate_constexpr
+};
+
+// How emit_kind::run evaluates the program
+enum class run_engine {
+    vm,         // Bytecode on eval::vm, by eval::run_vm
+    tree,       // eval::evaluator on the AST, by eval::run
+};
+
 class compiler{
 public:
+    // Sources are parsed by the parser of parsing.  Only the spirit backend
+    // builds its grammar, once here.
+    explicit compiler(
+        emit_kind const emit = emit_kind::ast,
+        syntax::parser::backend const parsing = syntax::parser::backend::spirit
+    );
+
     std::string compile(std::string const& code);
+    std::string compile(std::shared_ptr<helper::source_buffer const> const& source);
+
+    // Writes the output into out as it is produced.  A source which is a
+    // binary AST is loaded instead of parsed.  If diags is given, every
+    // syntax error is reported into it, not just the first one.
+    void compile(
+        std::shared_ptr<helper::source_buffer const> const& source,
+        std::ostream &out,
+        syntax::diagnostics *const diags = nullptr
+    );
+
+    // The steps of compile(), for callers which keep ASTs between compiles.
+    // parse() loads a binary AST or parses source, and write() outputs a.
+    ast::ast parse(std::shared_ptr<helper::source_buffer const> const& source, syntax::diagnostics *const diags = nullptr);
+    void write(ast::ast const& a, std::ostream &out) const;
+
+    // Parses source, which is the source of previous with the edit applied,
+    // reusing the declarations of previous which the edit does not touch
+    ast::ast reparse(
+        ast::ast const& previous,
+        std::shared_ptr<helper::source_buffer const> const& source,
+        syntax::parser::text_edit const& edit,
+        syntax::diagnostics *const diags = nullptr
+    );
+
+    // Following compiles look sources up in the cache before parsing them
+    void use_cache(parse_cache &c)
+    {
+        cache = &c;
+    }
+
+    // Following compiles parse sources in parallel on pool
+    void use_threads(helper::thread_pool &pool)
+    {
+        threads = &pool;
+    }
+
+    // Following compiles emit C++ with backend
+    void use_backend(cpp_backend const b)
+    {
+        backend = b;
+    }
+
+    // Following compiles of C++ replace closed declarations and calls by
+    // their values, evaluated within l, before generating the code
+    void use_folding(eval::limits const& l)
+    {
+        folding = l;
+    }
+
+    // Following compiles of emit_kind::run evaluate within l
+    void use_run_limits(eval::limits const& l)
+    {
+        run_limits = l;
+    }
+
+    // Following compiles of emit_kind::run evaluate with engine
+    void use_run_engine(run_engine const engine)
+    {
+        runner = engine;
+    }
+
+    // Following compiles add their phases and ASTs to stats
+    void use_stats(compile_stats &s)
+    {
+        stats = &s;
+    }
+
 private:
+    ast::ast parse_source(std::shared_ptr<helper::source_buffer const> const& source, syntax::diagnostics *const diags);
+    ast::ast fold(ast::ast const& a) const;
+    void output(ast::ast const& a, std::ostream &out) const;
+    void merge_memo(eval::memo_statistics const& memo) const;
+
+    emit_kind const emit;
     syntax::parser parser;
+    parse_cache *cache = nullptr;
+    helper::thread_pool *threads = nullptr;
+    compile_stats *stats = nullptr;
+    cpp_backend backend = cpp_backend::mpl;
+    boost::optional<eval::limits> folding;
+    eval::limits run_limits;
+    run_engine runner = run_engine::vm;
 };
 
 } // namespace templa
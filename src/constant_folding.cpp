@@ -0,0 +1,336 @@
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#include <boost/optional.hpp>
+#include <boost/variant/get.hpp>
+#include <boost/variant/apply_visitor.hpp>
+#include <boost/variant/static_visitor.hpp>
+
+#include "constant_folding.hpp"
+#include "ast_adapted.hpp"
+
+namespace templa {
+namespace eval {
+
+namespace {
+
+template<class Node>
+Node const& get(ast::ast_node const& node)
+{
+    return *boost::get<Node const*>(node.value);
+}
+
+class constant_folder : public boost::static_visitor<boost::optional<ast::ast_node>> {
+public:
+    constant_folder(ast::ast const& a, limits const& l, folding_statistics *const stats)
+        : source(a)
+        , node_arena(std::make_shared<helper::arena>())
+        , evaluator(a, l)
+        , stats(stats)
+    {
+        node_arena->retain(a.node_arena);
+        if (stats) {
+            evaluator.count_calls();
+        }
+    }
+
+    ast::ast fold()
+    {
+        // The runs stay as they are, so the folded nodes, which are at the
+        // positions of the nodes they replace, keep the line_delta of theirs
+        auto const& runs = get<ast::program>(source.root).function_declarations;
+        auto const folded_runs = node_arena->copy_array(runs.begin(), runs.size());
+        bool changed = false;
+        for (std::size_t r = 0; r < runs.size(); ++r) {
+            auto const& declarations = runs[r].declarations;
+            line_delta = runs[r].line_delta;
+            auto const first = node_arena->make_array<ast::ast_node>(declarations.size());
+            bool run_changed = false;
+            for (std::size_t i = 0; i < declarations.size(); ++i) {
+                auto const folded = fold_declaration(declarations[i]);
+                run_changed |= static_cast<bool>(folded);
+                first[i] = folded ? *folded : declarations[i];
+            }
+            if (run_changed) {
+                folded_runs[r].declarations = {first, first + declarations.size()};
+                changed = true;
+            }
+        }
+        if (stats) {
+            stats->instantiations += evaluator.distinct_calls();
+            if (auto const memo = evaluator.memoized()) {
+                stats->memo.merge(memo->stats());
+            }
+        }
+
+        auto root = source.root;
+        if (changed) {
+            root.value = node_arena->make<ast::program>(ast::program{{folded_runs, folded_runs + runs.size()}});
+        }
+        return {root, node_arena, source.source};
+    }
+
+    // Each node type is rebuilt if one of its fields changes
+    template<class Node>
+    result_type operator()(Node const& node)
+    {
+        auto copy = node;
+        bool changed = false;
+        ast::for_each_field(copy, [&](char const*, auto &field){
+            changed |= rebuild(field);
+        });
+        if (!changed) {
+            return boost::none;
+        }
+        return ast::ast_node{node_arena->make<Node>(copy), 0, 0};
+    }
+
+    // Parameters hide top-level functions in the clause
+    result_type operator()(ast::decl_func const& clause)
+    {
+        locals.emplace_back();
+        for (auto const& p : semantic::parameters(clause)) {
+            auto const& param = get<ast::decl_param>(p);
+            if (auto const name = semantic::parameter_name(param)) {
+                locals.back().push_back(*name);
+                continue;
+            }
+            auto const& pattern = boost::get<ast::ast_node>(param.value);
+            if (auto const m = boost::get<ast::list_match const*>(&pattern.value)) {
+                locals.back().insert(locals.back().end(), (*m)->elements.begin(), (*m)->elements.end());
+                locals.back().push_back((*m)->rest_elems_name);
+            } else if (auto const t = boost::get<ast::type_match const*>(&pattern.value)) {
+                locals.back().push_back((*t)->param_name);
+            }
+        }
+        auto result = this->template operator()<ast::decl_func>(clause);
+        locals.pop_back();
+        return result;
+    }
+
+    // And local functions hide them in the let
+    result_type operator()(ast::let_expression const& let)
+    {
+        locals.emplace_back();
+        for (auto const& d : let.function_declarations) {
+            locals.back().push_back(get<ast::decl_func>(d).function_name);
+        }
+        auto result = this->template operator()<ast::let_expression>(let);
+        locals.pop_back();
+        return result;
+    }
+
+    result_type operator()(ast::factor const& factor)
+    {
+        if (closed(factor.value) && boost::get<ast::func_call const*>(&factor.value.value)) {
+            if (auto const v = evaluate(factor.value)) {
+                if (stats) {
+                    ++stats->calls;
+                }
+                return ast::ast_node{node_arena->make<ast::factor>(ast::factor{constant_of(*v, factor.value)}), 0, 0};
+            }
+        }
+        return this->template operator()<ast::factor>(factor);
+    }
+
+private:
+    boost::optional<ast::ast_node> fold_declaration(ast::ast_node const& node)
+    {
+        auto const& clause = get<ast::decl_func>(node);
+        if (!clause.maybe_declaration_params) {
+            if (auto const v = evaluate(clause.expression)) {
+                if (stats) {
+                    ++stats->declarations;
+                }
+                auto copy = clause;
+                copy.expression = expression_of(constant_of(*v, clause.expression));
+                return ast::ast_node{node_arena->make<ast::decl_func>(copy), node.line, node.col};
+            }
+        }
+        return rebuild_node(node);
+    }
+
+    boost::optional<value> evaluate(ast::ast_node const& node)
+    {
+        evaluator.reset_steps();
+        try {
+            auto v = evaluator.evaluate(node, line_delta);
+            if (stats) {
+                stats->steps += evaluator.steps();
+            }
+            return v;
+        } catch (evaluation_error const&) {
+        } catch (semantic::semantic_error const&) {
+        }
+        if (stats) {
+            stats->steps += evaluator.steps();
+            ++stats->failures;
+        }
+        return boost::none;
+    }
+
+    // Whether no name in node is a parameter or a local function
+    bool closed(ast::ast_node const& node) const
+    {
+        bool result = true;
+        ast::for_each_node(node, [&](ast::ast_node const& n){
+            if (auto const c = boost::get<ast::func_call const*>(&n.value)) {
+                for (auto const& names : locals) {
+                    result &= std::find(names.begin(), names.end(), (*c)->function_name) == names.end();
+                }
+            }
+        });
+        return result;
+    }
+
+    struct dispatch : boost::static_visitor<result_type> {
+        explicit dispatch(constant_folder &folder)
+            : folder(folder)
+        {}
+
+        template<class Node>
+        result_type operator()(Node const* const node) const
+        {
+            return folder(*node);
+        }
+
+        constant_folder &folder;
+    };
+
+    boost::optional<ast::ast_node> rebuild_node(ast::ast_node const& node)
+    {
+        auto result = boost::apply_visitor(dispatch{*this}, node.value);
+        if (result) {
+            result->line = node.line;
+            result->col = node.col;
+        }
+        return result;
+    }
+
+    bool rebuild(ast::ast_node &node)
+    {
+        if (auto const r = rebuild_node(node)) {
+            node = *r;
+            return true;
+        }
+        return false;
+    }
+
+    bool rebuild(ast::node_list &nodes)
+    {
+        std::vector<boost::optional<ast::ast_node>> rebuilt;
+        rebuilt.reserve(nodes.size());
+        for (auto const& n : nodes) {
+            rebuilt.push_back(rebuild_node(n));
+        }
+        if (std::none_of(rebuilt.begin(), rebuilt.end(), [](auto const& r){ return static_cast<bool>(r); })) {
+            return false;
+        }
+        auto const first = node_arena->make_array<ast::ast_node>(nodes.size());
+        for (std::size_t i = 0; i < nodes.size(); ++i) {
+            first[i] = rebuilt[i] ? *rebuilt[i] : nodes[i];
+        }
+        nodes = {first, first + nodes.size()};
+        return true;
+    }
+
+    bool rebuild(boost::optional<ast::ast_node> &maybe)
+    {
+        return maybe && rebuild(*maybe);
+    }
+
+    template<class... Types>
+    bool rebuild(boost::variant<Types...> &v)
+    {
+        auto const n = boost::get<ast::ast_node>(&v);
+        return n && rebuild(*n);
+    }
+
+    // Names and scalars
+    template<class T>
+    bool rebuild(T const&)
+    {
+        return false;
+    }
+
+    template<class Node>
+    ast::ast_node make(ast::ast_node const& at, Node const& node)
+    {
+        return {node_arena->make<Node>(node), at.line, at.col};
+    }
+
+    // A constant node of v at the position of at
+    ast::ast_node constant_of(value const& v, ast::ast_node const& at)
+    {
+        if (auto const i = boost::get<int>(&v)) {
+            return make(at, ast::constant{*i});
+        } else if (auto const c = boost::get<char>(&v)) {
+            return make(at, ast::constant{*c});
+        } else if (auto const b = boost::get<bool>(&v)) {
+            return make(at, ast::constant{*b});
+        } else if (auto const s = boost::get<std::string>(&v)) {
+            auto const chars = node_arena->copy_array(s->data(), s->size());
+            return make(at, ast::constant{boost::string_ref{chars, s->size()}});
+        }
+
+        auto const& l = boost::get<list>(v);
+        auto const first = node_arena->make_array<ast::ast_node>(l.size());
+        for (std::size_t i = 0; i < l.size(); ++i) {
+            first[i] = primary_of(constant_of(l[i], at));
+        }
+        auto const elements = make(at, ast::enum_list{{first, first + l.size()}});
+        return make(at, ast::constant{make(at, ast::list{elements})});
+    }
+
+    // The primary_expression which consists of the constant alone
+    ast::ast_node primary_of(ast::ast_node const& constant)
+    {
+        auto const one = [&](ast::ast_node const& n){
+            auto const p = node_arena->make_array<ast::ast_node>(1);
+            *p = n;
+            return ast::node_list{p, p + 1};
+        };
+        auto const factor = make(constant, ast::factor{constant});
+        auto const term = make(constant, ast::term{one(factor), {}});
+        auto const formula = make(constant, ast::formula{boost::none, one(term), {}});
+        return make(constant, ast::primary_expression{one(formula), {}});
+    }
+
+    ast::ast_node expression_of(ast::ast_node const& constant)
+    {
+        return make(constant, ast::expression{primary_of(constant)});
+    }
+
+    ast::ast const& source;
+    std::shared_ptr<helper::arena> const node_arena;
+    eval::evaluator evaluator;
+    folding_statistics *const stats;
+    // Of the run of the declaration being folded
+    std::int64_t line_delta = 0;
+    // Names of the parameters and local functions in scope, innermost last
+    std::vector<std::vector<ast::identifier>> locals;
+};
+
+} // namespace
+
+void folding_statistics::merge(folding_statistics const& other)
+{
+    declarations += other.declarations;
+    calls += other.calls;
+    failures += other.failures;
+    steps += other.steps;
+    instantiations += other.instantiations;
+    memo.merge(other.memo);
+}
+
+ast::ast fold_constants(ast::ast const& a, limits const& l, folding_statistics *const stats)
+{
+    boost::optional<ast::ast> folded;
+    on_evaluation_stack(l, [&]{ folded = constant_folder{a, l, stats}.fold(); });
+    return *folded;
+}
+
+} // namespace eval
+} // namespace templa
@@ -0,0 +1,47 @@
+#if !defined TEMPLA_CONSTANT_FOLDING_HPP_INCLUDED
+#define      TEMPLA_CONSTANT_FOLDING_HPP_INCLUDED
+
+#include <cstddef>
+
+#include "ast.hpp"
+#include "evaluator.hpp"
+#include "memo.hpp"
+
+namespace templa {
+namespace eval {
+
+struct folding_statistics {
+    // Top-level declarations without parameters which became their value
+    std::size_t declarations = 0;
+    // Other calls which became their value
+    std::size_t calls = 0;
+    // Evaluations which were given up, e.g. at a limit
+    std::size_t failures = 0;
+    std::size_t steps = 0;
+    // Distinct calls of templa functions which the evaluations took, i.e.
+    // about the class templates the MPL output no longer instantiates when
+    // no evaluation fails
+    std::size_t instantiations = 0;
+    // Of the results remembered by the limits, shared by all evaluations
+    memo_statistics memo;
+
+    void merge(folding_statistics const& other);
+};
+
+// A copy of a in which each top-level declaration without parameters, and
+// each call which only refers to top-level functions and builtins, is
+// replaced by a constant of its value, so that the C++ compiler does not
+// compute it on every build.
+//
+// Note:
+// Each declaration or call is evaluated with l on its own, on the stack of
+// on_evaluation_stack().  One which fails or exceeds a limit, the stack
+// included, is kept as it is, and so are the errors it has for the
+// code generator to report.  Unchanged subtrees are shared with a, whose
+// arena the result keeps alive.
+ast::ast fold_constants(ast::ast const& a, limits const& l, folding_statistics *const stats = nullptr);
+
+} // namespace eval
+} // namespace templa
+
+#endif    // TEMPLA_CONSTANT_FOLDING_HPP_INCLUDED
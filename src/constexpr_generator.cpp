@@ -0,0 +1,929 @@
+#include <cstddef>
+#include <string>
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include <deque>
+#include <bitset>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <boost/optional.hpp>
+#include <boost/variant/get.hpp>
+
+#include "constexpr_generator.hpp"
+#include "cpp_output.hpp"
+
+namespace templa {
+namespace codegen {
+
+namespace {
+
+using semantic::semantic_error;
+
+// The type of a value in the output.  A value is mixed if it has different
+// types in different calls.
+enum class value_type {
+    unknown,
+    int_,
+    char_,
+    bool_,
+    string,
+    mixed,
+};
+
+value_type join(value_type const a, value_type const b)
+{
+    if (a == value_type::unknown || a == b) {
+        return b;
+    }
+    if (b == value_type::unknown) {
+        return a;
+    }
+    return value_type::mixed;
+}
+
+bool is_known(value_type const t)
+{
+    return t != value_type::unknown && t != value_type::mixed;
+}
+
+// Templates and functions of the prelude, written in this order
+enum class snippet : std::size_t {
+    string,
+    add,
+    equal,
+    print,
+    none,
+};
+
+std::size_t const num_snippets = static_cast<std::size_t>(snippet::none);
+
+struct snippet_info {
+    char const* header;
+    snippet dependency;
+    char const* code;
+};
+
+// Chars of a string unless the program has a longer literal, e.g. a folded
+// main
+std::size_t const default_string_capacity = 1024;
+
+snippet_info const snippets[] = {
+    // Preceded by the definition of TEMPLA_STRING_CAPACITY
+    {"cstddef", snippet::none,
+        "struct string {\n"
+        "    char chars[TEMPLA_STRING_CAPACITY];\n"
+        "    int size;\n"
+        "};\n"
+        "\n"
+        "template<std::size_t N>\n"
+        "constexpr string make_string(char const (&text)[N])\n"
+        "{\n"
+        "    static_assert(N - 1 <= TEMPLA_STRING_CAPACITY, \"a string is longer than TEMPLA_STRING_CAPACITY\");\n"
+        "    string s{{}, static_cast<int>(N - 1)};\n"
+        "    for (std::size_t i = 0; i + 1 < N; ++i) {\n"
+        "        s.chars[i] = text[i];\n"
+        "    }\n"
+        "    return s;\n"
+        "}\n"
+        "\n"
+        "// Throwing is not a constant expression, so a string longer than the\n"
+        "// capacity is a compile error\n"
+        "constexpr string add(string a, string const& b)\n"
+        "{\n"
+        "    if (a.size + b.size > TEMPLA_STRING_CAPACITY) {\n"
+        "        throw \"a string is longer than TEMPLA_STRING_CAPACITY\";\n"
+        "    }\n"
+        "    for (int i = 0; i < b.size; ++i) {\n"
+        "        a.chars[a.size + i] = b.chars[i];\n"
+        "    }\n"
+        "    a.size += b.size;\n"
+        "    return a;\n"
+        "}\n"
+        "\n"
+        "constexpr string add(string a, char const b)\n"
+        "{\n"
+        "    if (a.size == TEMPLA_STRING_CAPACITY) {\n"
+        "        throw \"a string is longer than TEMPLA_STRING_CAPACITY\";\n"
+        "    }\n"
+        "    a.chars[a.size++] = b;\n"
+        "    return a;\n"
+        "}\n"
+        "\n"
+        "constexpr string add(char const a, string const& b)\n"
+        "{\n"
+        "    return add(string{{a}, 1}, b);\n"
+        "}\n"
+        "\n"
+        "constexpr string to_string(char const c)\n"
+        "{\n"
+        "    return string{{c}, 1};\n"
+        "}\n"
+        "\n"
+        "constexpr string to_string(string const& s)\n"
+        "{\n"
+        "    return s;\n"
+        "}\n"
+        "\n"
+        "constexpr bool equal(string const& a, string const& b)\n"
+        "{\n"
+        "    if (a.size != b.size) {\n"
+        "        return false;\n"
+        "    }\n"
+        "    for (int i = 0; i < a.size; ++i) {\n"
+        "        if (a.chars[i] != b.chars[i]) {\n"
+        "            return false;\n"
+        "        }\n"
+        "    }\n"
+        "    return true;\n"
+        "}\n"},
+    {nullptr, snippet::string,
+        "constexpr int add(int const a, int const b)\n"
+        "{\n"
+        "    return a + b;\n"
+        "}\n"
+        "\n"
+        "constexpr char add(char const a, int const b)\n"
+        "{\n"
+        "    return static_cast<char>(a + b);\n"
+        "}\n"
+        "\n"
+        "constexpr int add(char const a, char const b)\n"
+        "{\n"
+        "    return a + b;\n"
+        "}\n"},
+    {nullptr, snippet::string,
+        "// Values of different types are not equal\n"
+        "template<class A, class B>\n"
+        "constexpr bool equal(A const&, B const&)\n"
+        "{\n"
+        "    return false;\n"
+        "}\n"
+        "\n"
+        "constexpr bool equal(int const a, int const b)\n"
+        "{\n"
+        "    return a == b;\n"
+        "}\n"
+        "\n"
+        "constexpr bool equal(char const a, char const b)\n"
+        "{\n"
+        "    return a == b;\n"
+        "}\n"
+        "\n"
+        "constexpr bool equal(bool const a, bool const b)\n"
+        "{\n"
+        "    return a == b;\n"
+        "}\n"},
+    {"iostream", snippet::string,
+        "inline void print(std::ostream &out, int const i)\n"
+        "{\n"
+        "    out << i;\n"
+        "}\n"
+        "\n"
+        "inline void print(std::ostream &out, char const c)\n"
+        "{\n"
+        "    out << c;\n"
+        "}\n"
+        "\n"
+        "inline void print(std::ostream &out, bool const b)\n"
+        "{\n"
+        "    out << (b ? \"true\" : \"false\");\n"
+        "}\n"
+        "\n"
+        "inline void print(std::ostream &out, string const& s)\n"
+        "{\n"
+        "    out.write(s.chars, s.size);\n"
+        "}\n"},
+};
+
+static_assert(sizeof(snippets) / sizeof(snippets[0]) == num_snippets, "a snippet is missing");
+
+class constexpr_generator {
+public:
+    explicit constexpr_generator(ast::ast const& a)
+        : top_level(get<ast::program>(a.root).function_declarations)
+        , identifiers(identifiers_of(a))
+    {}
+
+    void write(std::ostream &out);
+
+private:
+    static std::size_t const npos = static_cast<std::size_t>(-1);
+
+    // A function of the output.  Local functions of let take the values they
+    // capture after their own parameters.
+    struct function_info {
+        semantic::function const* function;
+        std::string cpp;
+        std::vector<std::string> params;
+        // Indices into types, of each parameter and of the result
+        std::vector<std::size_t> param_types;
+        std::size_t result;
+        std::string body;
+        // Indices into functions which the body calls
+        std::vector<std::size_t> uses;
+        bool defined;
+    };
+
+    struct binding {
+        std::string cpp;
+        // Index into types if the name is a value
+        std::size_t type;
+        // Index into functions if the name is a function, otherwise npos
+        std::size_t function;
+    };
+
+    using scope = std::unordered_map<ast::identifier, binding>;
+
+    struct lowered {
+        std::string text;
+        value_type type;
+    };
+
+    std::string fresh(std::string const& base);
+    std::size_t new_type();
+    void set_type(std::size_t const index, value_type const t);
+    binding const* lookup(ast::identifier const name) const;
+
+    std::size_t add_function(semantic::function const& f, std::string const& cpp, std::vector<binding> const& captures);
+    boost::optional<std::string> parameter_name(semantic::function const& f, std::size_t const p) const;
+    void define(std::size_t const index);
+    void bind_value(semantic::function const& f, ast::identifier const name, std::size_t const param, ast::ast_node const& at);
+
+    lowered lower_expression(ast::ast_node const& node);
+    lowered lower_let(ast::let_expression const& let);
+    lowered lower_primary(ast::ast_node const& node);
+    lowered lower_formula(ast::ast_node const& node);
+    lowered lower_term(ast::ast_node const& node);
+    lowered lower_factor(ast::ast_node const& node);
+    lowered lower_constant(ast::ast_node const& node);
+    lowered lower_call(ast::ast_node const& node);
+
+    lowered equality(lowered const& a, lowered const& b, bool const negated);
+    lowered plus(lowered const& a, lowered const& b);
+
+    std::string rt(snippet const s);
+    std::string type_name(value_type const t) const;
+    value_type type_named(ast::identifier const name, ast::ast_node const& at) const;
+    void write_function(std::string &out, function_info const& f, bool const prototype);
+
+    // The line of a node of the clause being lowered in the source
+    std::size_t line_of(ast::ast_node const& node) const
+    {
+        return static_cast<std::size_t>(node.line + line_delta);
+    }
+
+    semantic::function_table const top_level;
+    std::deque<semantic::function_table> local_tables;
+    // The functions of each let
+    std::unordered_map<ast::let_expression const*, std::vector<std::size_t>> lets;
+    std::deque<function_info> functions;
+    std::vector<value_type> types;
+    std::deque<scope> scopes;
+    // The function being defined and those enclosing it
+    std::vector<std::size_t> defining;
+    std::unordered_set<std::string> identifiers;
+    std::unordered_map<std::string, std::size_t> suffixes;
+    // Names of the functions in the namespace of the output
+    std::unordered_set<std::string> namespace_names;
+    std::bitset<num_snippets> used;
+    bool changed = false;
+    // Chars of the longest string literal
+    std::size_t longest_string = 0;
+    // Of the clause being lowered
+    std::int64_t line_delta = 0;
+};
+
+std::string constexpr_generator::fresh(std::string const& base)
+{
+    for (auto &n = suffixes[base];;) {
+        auto name = base + '_' + std::to_string(++n);
+        if (!identifiers.count(name) && !is_reserved(name)) {
+            identifiers.insert(name);
+            return name;
+        }
+    }
+}
+
+std::size_t constexpr_generator::new_type()
+{
+    types.push_back(value_type::unknown);
+    return types.size() - 1;
+}
+
+// Types only become more precise, so inference ends when no call of this
+// changes anything
+void constexpr_generator::set_type(std::size_t const index, value_type const t)
+{
+    auto const joined = join(types[index], t);
+    if (joined != types[index]) {
+        types[index] = joined;
+        changed = true;
+    }
+}
+
+constexpr_generator::binding const* constexpr_generator::lookup(ast::identifier const name) const
+{
+    for (auto s = scopes.rbegin(); s != scopes.rend(); ++s) {
+        auto const found = s->find(name);
+        if (found != s->end()) {
+            return &found->second;
+        }
+    }
+    return nullptr;
+}
+
+std::size_t constexpr_generator::add_function(
+    semantic::function const& f,
+    std::string const& cpp,
+    std::vector<binding> const& captures
+)
+{
+    function_info info{&f, cpp, {}, {}, new_type(), {}, {}, false};
+
+    // A parameter must not hide a function or another parameter
+    std::unordered_set<std::string> taken;
+    for (auto const& c : captures) {
+        taken.insert(c.cpp);
+    }
+    for (std::size_t p = 0; p < f.arity; ++p) {
+        auto const name = parameter_name(f, p);
+        auto const cpp_name = !name || is_reserved(*name) || namespace_names.count(*name) || taken.count(*name)
+            ? fresh(name ? *name : "arg")
+            : *name;
+        taken.insert(cpp_name);
+        info.params.push_back(cpp_name);
+        info.param_types.push_back(new_type());
+    }
+    for (auto const& c : captures) {
+        info.params.push_back(c.cpp);
+        info.param_types.push_back(c.type);
+    }
+
+    functions.push_back(std::move(info));
+    return functions.size() - 1;
+}
+
+// The name of the p-th parameter in the general clause, or else in the
+// first clause which names it
+boost::optional<std::string> constexpr_generator::parameter_name(semantic::function const& f, std::size_t const p) const
+{
+    std::vector<ast::ast_node const*> clauses;
+    if (f.general) {
+        clauses.push_back(&f.clauses[*f.general]);
+    }
+    for (auto const& c : f.clauses) {
+        clauses.push_back(&c);
+    }
+    for (auto const c : clauses) {
+        auto const& param = get<ast::decl_param>(semantic::parameters(get<ast::decl_func>(*c))[p]);
+        if (auto const name = semantic::parameter_name(param)) {
+            return name->to_string();
+        }
+        auto const& pattern = boost::get<ast::ast_node>(param.value);
+        if (auto const t = boost::get<ast::type_match const*>(&pattern.value)) {
+            return (*t)->param_name.to_string();
+        }
+    }
+    return boost::none;
+}
+
+void constexpr_generator::bind_value(
+    semantic::function const& f,
+    ast::identifier const name,
+    std::size_t const param,
+    ast::ast_node const& at
+)
+{
+    auto const& info = functions[defining.back()];
+    auto const inserted = scopes.back().emplace(name, binding{info.params[param], info.param_types[param], npos});
+    if (!inserted.second) {
+        throw semantic_error{line_of(at), at.col, "parameter " + name.to_string() + " of " + f.name.to_string() + " is declared twice"};
+    }
+}
+
+// A body which returns the value of the first clause with patterns which
+// match, or else of the general clause
+void constexpr_generator::define(std::size_t const index)
+{
+    auto &f = functions[index];
+    auto const& function = *f.function;
+    f.uses.clear();
+    defining.push_back(index);
+
+    std::vector<ast::ast_node const*> clauses;
+    for (std::size_t i = 0; i < function.clauses.size(); ++i) {
+        if (!function.general || i != *function.general) {
+            clauses.push_back(&function.clauses[i]);
+        }
+    }
+    if (function.general) {
+        clauses.push_back(&function.clauses[*function.general]);
+    }
+
+    std::string body;
+    bool exhaustive = false;
+    auto const outer_delta = line_delta;
+    for (auto const node : clauses) {
+        auto const& clause = get<ast::decl_func>(*node);
+        line_delta = function.line_deltas[node - function.clauses.data()];
+        scopes.emplace_back();
+
+        std::string conditions;
+        auto const params = semantic::parameters(clause);
+        for (std::size_t p = 0; p < params.size(); ++p) {
+            auto const& param = get<ast::decl_param>(params[p]);
+            if (auto const name = semantic::parameter_name(param)) {
+                bind_value(function, *name, p, params[p]);
+                continue;
+            }
+
+            auto const& pattern = boost::get<ast::ast_node>(param.value);
+            auto const type = f.param_types[p];
+            if (auto const t = boost::get<ast::type_match const*>(&pattern.value)) {
+                // The type of a parameter is fixed, so a type pattern always
+                // matches
+                set_type(type, type_named((*t)->type_name, pattern));
+                if (types[type] == value_type::mixed) {
+                    throw semantic_error{
+                        line_of(pattern), pattern.col,
+                        "the constexpr backend cannot match the type of a parameter of " + function.name.to_string()
+                            + " which has values of different types; use --backend=mpl"
+                    };
+                }
+                bind_value(function, (*t)->param_name, p, pattern);
+            } else if (boost::get<ast::list_match const*>(&pattern.value)) {
+                throw semantic_error{line_of(pattern), pattern.col, "lists are not supported by the constexpr backend; use --backend=mpl"};
+            } else {
+                auto const c = lower_constant(pattern);
+                set_type(type, c.type);
+                auto const matched = equality({f.params[p], types[type]}, c, false);
+                conditions += (conditions.empty() ? "" : " && ") + matched.text;
+            }
+        }
+
+        auto const result = lower_expression(clause.expression);
+        set_type(f.result, result.type);
+        scopes.pop_back();
+
+        if (conditions.empty()) {
+            put_line(body, 1, "return " + result.text + ";");
+            exhaustive = true;
+            break;
+        }
+        put_line(body, 1, "if (" + conditions + ") {");
+        put_line(body, 2, "return " + result.text + ";");
+        put_line(body, 1, "}");
+    }
+    if (!exhaustive) {
+        put_line(body, 1, "throw \"no clause of " + function.name.to_string() + " matches\";");
+    }
+
+    line_delta = outer_delta;
+
+    f.body = std::move(body);
+    f.defined = true;
+    defining.pop_back();
+}
+
+constexpr_generator::lowered constexpr_generator::lower_expression(ast::ast_node const& node)
+{
+    auto const& value = get<ast::expression>(node).value;
+
+    if (auto const let = boost::get<ast::let_expression const*>(&value.value)) {
+        return lower_let(**let);
+    }
+
+    if (auto const i = boost::get<ast::if_expression const*>(&value.value)) {
+        auto const condition = lower_expression((*i)->condition);
+        auto const then = lower_expression((*i)->expression_if_true);
+        auto const otherwise = lower_expression((*i)->expression_if_false);
+        return {"(" + condition.text + " ? " + then.text + " : " + otherwise.text + ")", join(then.type, otherwise.type)};
+    }
+
+    if (auto const c = boost::get<ast::case_expression const*>(&value.value)) {
+        auto result = lower_expression((*c)->otherwise_expression);
+        auto const& whens = (*c)->case_when;
+        for (auto w = whens.end(); w != whens.begin();) {
+            auto const& when = get<ast::case_when>(*--w);
+            auto const condition = lower_expression(when.condition);
+            auto const then = lower_expression(when.then_expression);
+            result = {"(" + condition.text + " ? " + then.text + " : " + result.text + ")", join(then.type, result.type)};
+        }
+        return result;
+    }
+
+    return lower_primary(value);
+}
+
+// The local functions are defined in the namespace, capturing every value
+// which their bodies could use.  The let itself is its body.
+constexpr_generator::lowered constexpr_generator::lower_let(ast::let_expression const& let)
+{
+    auto found = lets.find(&let);
+    if (found == lets.end()) {
+        local_tables.emplace_back(let.function_declarations, line_delta);
+
+        std::vector<binding> captures;
+        std::unordered_set<ast::identifier> names;
+        std::unordered_set<std::string> cpp_names;
+        // The outermost scope has only functions
+        for (auto s = scopes.rbegin(); s + 1 != scopes.rend(); ++s) {
+            for (auto const& b : *s) {
+                if (names.insert(b.first).second && b.second.function == npos && cpp_names.insert(b.second.cpp).second) {
+                    captures.push_back(b.second);
+                }
+            }
+        }
+        std::sort(captures.begin(), captures.end(), [](binding const& a, binding const& b){ return a.cpp < b.cpp; });
+
+        std::vector<std::size_t> indices;
+        for (auto const& f : local_tables.back().functions()) {
+            indices.push_back(add_function(f, fresh(f.name.to_string()), captures));
+        }
+        found = lets.emplace(&let, std::move(indices)).first;
+    }
+
+    auto const indices = found->second;
+    scopes.emplace_back();
+    for (auto const i : indices) {
+        scopes.back()[functions[i].function->name] = {functions[i].cpp, npos, i};
+    }
+    for (auto const i : indices) {
+        define(i);
+    }
+    auto const body = lower_expression(let.body);
+    scopes.pop_back();
+    return body;
+}
+
+constexpr_generator::lowered constexpr_generator::lower_primary(ast::ast_node const& node)
+{
+    auto const& primary = get<ast::primary_expression>(node);
+    auto result = lower_formula(primary.formulae.front());
+    for (std::size_t i = 0; i < primary.operators.size(); ++i) {
+        auto const op = get<ast::relational_operator>(primary.operators[i]).value;
+        auto const rhs = lower_formula(primary.formulae[i + 1]);
+        if (op == "==" || op == "!=") {
+            result = equality(result, rhs, op == "!=");
+        } else {
+            result = {"(" + result.text + " " + op.to_string() + " " + rhs.text + ")", value_type::bool_};
+        }
+    }
+    return result;
+}
+
+constexpr_generator::lowered constexpr_generator::lower_formula(ast::ast_node const& node)
+{
+    auto const& f = get<ast::formula>(node);
+    auto result = lower_term(f.terms.front());
+    if (f.maybe_sign && *f.maybe_sign == '-') {
+        result = {"(-" + result.text + ")", value_type::int_};
+    }
+    for (std::size_t i = 0; i < f.operators.size(); ++i) {
+        auto const op = get<ast::additive_operator>(f.operators[i]).value;
+        auto const rhs = lower_term(f.terms[i + 1]);
+        if (op == "+") {
+            result = plus(result, rhs);
+        } else if (op == "-") {
+            result = {"(" + result.text + " - " + rhs.text + ")", value_type::int_};
+        } else {
+            result = {"(" + result.text + " || " + rhs.text + ")", value_type::bool_};
+        }
+    }
+    return result;
+}
+
+constexpr_generator::lowered constexpr_generator::lower_term(ast::ast_node const& node)
+{
+    auto const& t = get<ast::term>(node);
+    auto result = lower_factor(t.factors.front());
+    for (std::size_t i = 0; i < t.operators.size(); ++i) {
+        auto const op = get<ast::mult_operator>(t.operators[i]).value;
+        auto const rhs = lower_factor(t.factors[i + 1]);
+        if (op == "*" || op == "/" || op == "%") {
+            result = {"(" + result.text + " " + op.to_string() + " " + rhs.text + ")", value_type::int_};
+        } else {
+            result = {"(" + result.text + " && " + rhs.text + ")", value_type::bool_};
+        }
+    }
+    return result;
+}
+
+constexpr_generator::lowered constexpr_generator::lower_factor(ast::ast_node const& node)
+{
+    auto const& value = get<ast::factor>(node).value;
+    if (boost::get<ast::factor const*>(&value.value)) {
+        return {"!" + lower_factor(value).text, value_type::bool_};
+    } else if (boost::get<ast::primary_expression const*>(&value.value)) {
+        return lower_primary(value);
+    } else if (boost::get<ast::constant const*>(&value.value)) {
+        return lower_constant(value);
+    }
+    return lower_call(value);
+}
+
+constexpr_generator::lowered constexpr_generator::lower_constant(ast::ast_node const& node)
+{
+    auto const& value = get<ast::constant>(node).value;
+    if (auto const i = boost::get<int>(&value)) {
+        auto const text = std::to_string(*i);
+        return {*i < 0 ? "(" + text + ")" : text, value_type::int_};
+    } else if (auto const c = boost::get<char>(&value)) {
+        return {char_literal(*c), value_type::char_};
+    } else if (auto const b = boost::get<bool>(&value)) {
+        return {*b ? "true" : "false", value_type::bool_};
+    } else if (auto const s = boost::get<boost::string_ref>(&value)) {
+        longest_string = std::max(longest_string, s->size());
+        return {rt(snippet::string) + "make_string(" + string_literal(*s) + ")", value_type::string};
+    }
+    throw semantic_error{line_of(node), node.col, "lists are not supported by the constexpr backend; use --backend=mpl"};
+}
+
+constexpr_generator::lowered constexpr_generator::lower_call(ast::ast_node const& node)
+{
+    auto const& call = get<ast::func_call>(node);
+    std::vector<lowered> args;
+    if (call.maybe_call_arguments) {
+        for (auto const& a : get<ast::call_args>(*call.maybe_call_arguments).arguments) {
+            args.push_back(lower_primary(a));
+        }
+    }
+    auto const name = call.function_name.to_string();
+
+    auto const b = lookup(call.function_name);
+    if (b == nullptr) {
+        auto const builtin = semantic::find_builtin(call.function_name);
+        if (!builtin) {
+            throw semantic_error{line_of(node), node.col, name + " is not declared"};
+        }
+        if (args.size() != 1) {
+            throw semantic_error{line_of(node), node.col, name + " takes 1 argument"};
+        }
+        switch (*builtin) {
+        case semantic::builtin::print:
+            return args.front();
+        case semantic::builtin::to_char:
+            return {"static_cast<char>(" + args.front().text + ")", value_type::char_};
+        case semantic::builtin::string:
+            return {rt(snippet::string) + "to_string(" + args.front().text + ")", value_type::string};
+        }
+    }
+
+    if (b->function == npos) {
+        if (!args.empty()) {
+            throw semantic_error{line_of(node), node.col, name + " is not a function"};
+        }
+        return {b->cpp, types[b->type]};
+    }
+
+    auto const& f = functions[b->function];
+    if (args.size() != f.function->arity) {
+        throw semantic_error{
+            line_of(node), node.col,
+            name + " takes " + std::to_string(f.function->arity) + (f.function->arity == 1 ? " argument" : " arguments")
+                + ", but is called with " + std::to_string(args.size())
+        };
+    }
+    functions[defining.back()].uses.push_back(b->function);
+
+    std::string text = f.cpp + "(";
+    for (std::size_t i = 0; i < f.params.size(); ++i) {
+        if (i < args.size()) {
+            set_type(f.param_types[i], args[i].type);
+            text += (i == 0 ? "" : ", ") + args[i].text;
+        } else {
+            // A captured value has the same name everywhere it is visible
+            text += (i == 0 ? "" : ", ") + f.params[i];
+        }
+    }
+    return {text + ")", types[f.result]};
+}
+
+// Values of different types are not equal, as in generate_mpl
+constexpr_generator::lowered constexpr_generator::equality(lowered const& a, lowered const& b, bool const negated)
+{
+    if (a.type == b.type && is_known(a.type) && a.type != value_type::string) {
+        return {"(" + a.text + (negated ? " != " : " == ") + b.text + ")", value_type::bool_};
+    }
+    if (is_known(a.type) && is_known(b.type) && a.type != b.type) {
+        return {negated ? "true" : "false", value_type::bool_};
+    }
+    auto const function = a.type == value_type::string && b.type == value_type::string ? rt(snippet::string) : rt(snippet::equal);
+    return {(negated ? "!" : "") + function + "equal(" + a.text + ", " + b.text + ")", value_type::bool_};
+}
+
+// + of integers, a char and an integer, strings and chars
+constexpr_generator::lowered constexpr_generator::plus(lowered const& a, lowered const& b)
+{
+    if (a.type == value_type::int_ && b.type == value_type::int_) {
+        return {"(" + a.text + " + " + b.text + ")", value_type::int_};
+    }
+    if (a.type == value_type::char_ && b.type == value_type::int_) {
+        return {"static_cast<char>(" + a.text + " + " + b.text + ")", value_type::char_};
+    }
+    bool const strings =
+        (a.type == value_type::string && (b.type == value_type::string || b.type == value_type::char_))
+        || (a.type == value_type::char_ && b.type == value_type::string);
+    if (strings) {
+        return {rt(snippet::string) + "add(" + a.text + ", " + b.text + ")", value_type::string};
+    }
+    auto const type = a.type == value_type::string || b.type == value_type::string ? value_type::string : value_type::unknown;
+    return {rt(snippet::add) + "add(" + a.text + ", " + b.text + ")", type};
+}
+
+std::string constexpr_generator::rt(snippet const s)
+{
+    auto const i = static_cast<std::size_t>(s);
+    if (!used[i]) {
+        used[i] = true;
+        if (snippets[i].dependency != snippet::none) {
+            rt(snippets[i].dependency);
+        }
+    }
+    return "templa_rt::";
+}
+
+std::string constexpr_generator::type_name(value_type const t) const
+{
+    switch (t) {
+    case value_type::int_:   return "int";
+    case value_type::char_:  return "char";
+    case value_type::bool_:  return "bool";
+    case value_type::string: return "templa_rt::string";
+    default:                 return "auto";
+    }
+}
+
+value_type constexpr_generator::type_named(ast::identifier const name, ast::ast_node const& at) const
+{
+    auto const type = semantic::find_type(name);
+    if (!type) {
+        throw semantic_error{line_of(at), at.col, "unknown type " + name.to_string()};
+    }
+    switch (*type) {
+    case 0:  return value_type::int_;
+    case 1:  return value_type::char_;
+    case 2:  return value_type::bool_;
+    case 3:  return value_type::string;
+    default: throw semantic_error{line_of(at), at.col, "lists are not supported by the constexpr backend; use --backend=mpl"};
+    }
+}
+
+// Parameters of unknown or mixed type are template parameters, and the
+// result of a function whose type is not known is deduced
+void constexpr_generator::write_function(std::string &out, function_info const& f, bool const prototype)
+{
+    std::string template_params, params;
+    for (std::size_t p = 0; p < f.params.size(); ++p) {
+        auto const t = types[f.param_types[p]];
+        std::string param;
+        if (!is_known(t)) {
+            auto const name = fresh("T");
+            template_params += (template_params.empty() ? "" : ", ") + ("class " + name);
+            param = name + " const& ";
+        } else if (t == value_type::string) {
+            rt(snippet::string);
+            param = "templa_rt::string const& ";
+        } else {
+            param = type_name(t) + " const ";
+        }
+        params += (params.empty() ? "" : ", ") + param + f.params[p];
+    }
+
+    if (!template_params.empty()) {
+        put_line(out, 0, "template<" + template_params + ">");
+    }
+    auto const signature = "constexpr " + type_name(types[f.result]) + " " + f.cpp + "(" + params + ")";
+    if (prototype) {
+        put_line(out, 0, signature + ";");
+        return;
+    }
+    put_line(out, 0, signature);
+    put_line(out, 0, "{");
+    out += f.body;
+    put_line(out, 0, "}");
+}
+
+void constexpr_generator::write(std::ostream &out)
+{
+    scopes.emplace_back();
+    std::vector<std::string> cpp_names;
+    for (auto const& f : top_level.functions()) {
+        auto const name = f.name.to_string();
+        cpp_names.push_back(is_reserved(name) ? fresh(name) : name);
+        namespace_names.insert(cpp_names.back());
+    }
+    std::vector<std::size_t> top;
+    for (std::size_t i = 0; i < cpp_names.size(); ++i) {
+        auto const& f = top_level.functions()[i];
+        top.push_back(add_function(f, cpp_names[i], {}));
+        scopes.front()[f.name] = {cpp_names[i], npos, top.back()};
+    }
+
+    // Each pass may learn types which earlier functions need, so pass until
+    // nothing changes.  The output of the last pass is the final one.
+    do {
+        changed = false;
+        used.reset();
+        for (auto &f : functions) {
+            f.defined = false;
+        }
+        for (auto const i : top) {
+            define(i);
+        }
+    } while (changed);
+
+    // Callees before their callers, which a function with a deduced result
+    // needs; the others are declared first anyway
+    std::vector<std::size_t> order;
+    std::vector<char> seen(functions.size(), 0);
+    std::vector<std::pair<std::size_t, std::size_t>> stack;
+    for (std::size_t start = 0; start < functions.size(); ++start) {
+        if (seen[start] || !functions[start].defined) {
+            continue;
+        }
+        seen[start] = 1;
+        stack.emplace_back(start, 0);
+        while (!stack.empty()) {
+            auto &top = stack.back();
+            auto const i = top.first;
+            if (top.second < functions[i].uses.size()) {
+                auto const next = functions[i].uses[top.second++];
+                if (!seen[next]) {
+                    seen[next] = 1;
+                    stack.emplace_back(next, 0);
+                }
+                continue;
+            }
+            order.push_back(i);
+            stack.pop_back();
+        }
+    }
+
+    std::string prototypes, definitions;
+    for (auto const i : order) {
+        if (is_known(types[functions[i].result])) {
+            write_function(prototypes, functions[i], true);
+        }
+        definitions += '\n';
+        write_function(definitions, functions[i], false);
+    }
+
+    auto const main = top_level.find(ast::identifier{"main"});
+    bool const has_main = main && main->arity == 0;
+    if (has_main) {
+        rt(snippet::print);
+    }
+
+    out << "// Generated by templa\n";
+    bool first_header = true;
+    for (std::size_t i = 0; i < num_snippets; ++i) {
+        if (used[i] && snippets[i].header) {
+            out << (first_header ? "\n" : "") << "#include <" << snippets[i].header << ">\n";
+            first_header = false;
+        }
+    }
+
+    if (used.any()) {
+        out << "\nnamespace templa_rt {\n";
+        for (std::size_t i = 0; i < num_snippets; ++i) {
+            if (i == static_cast<std::size_t>(snippet::string) && used[i]) {
+                out << "\n#if !defined TEMPLA_STRING_CAPACITY\n"
+                       "#define TEMPLA_STRING_CAPACITY " << std::max(default_string_capacity, longest_string) << "\n"
+                       "#endif\n";
+            }
+            if (used[i]) {
+                out << '\n' << snippets[i].code;
+            }
+        }
+        out << "\n} // namespace templa_rt\n";
+    }
+
+    out << "\nnamespace program {\n";
+    if (!prototypes.empty()) {
+        out << '\n' << prototypes;
+    }
+    out << definitions << "\n} // namespace program\n";
+
+    if (has_main) {
+        out << "\nint main()\n"
+               "{\n"
+               "    constexpr auto value = program::" << scopes.front().at(ast::identifier{"main"}).cpp << "();\n"
+               "    templa_rt::print(std::cout, value);\n"
+               "    std::cout << '\\n';\n"
+               "}\n";
+    }
+    scopes.pop_back();
+}
+
+} // namespace
+
+void generate_constexpr(std::ostream &out, ast::ast const& a)
+{
+    constexpr_generator{a}.write(out);
+}
+
+} // namespace codegen
+} // namespace templa
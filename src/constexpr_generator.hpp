@@ -0,0 +1,37 @@
+#if !defined TEMPLA_CONSTEXPR_GENERATOR_HPP_INCLUDED
+#define      TEMPLA_CONSTEXPR_GENERATOR_HPP_INCLUDED
+
+#include <ostream>
+
+#include "ast.hpp"
+#include "semantic.hpp"
+
+namespace templa {
+namespace codegen {
+
+// Writes a C++14 program in which each templa function is a constexpr
+// function, evaluated by the C++ compiler as a constant expression.  If the
+// program declares main, the output has a main() printing its value.
+//
+// Note:
+// Integers, chars and bools are int, char and bool, and strings are char
+// arrays of at most TEMPLA_STRING_CAPACITY chars.  Unless defined otherwise
+// it is 1024 or the length of the longest string literal, which holds a
+// folded main.  A longer string computed by the C++ compiler fails its
+// compile with an error naming TEMPLA_STRING_CAPACITY.  The types of parameters and results are inferred from constants,
+// patterns and calls; a parameter whose type is not known or differs between
+// calls is a template parameter, and a result of such a function is auto.
+// Local functions of let become functions of the namespace which take the
+// values they may use as more parameters.
+//
+// Unlike generate_mpl, each recursion step is a call, not a new class, so
+// the C++ compiler needs much less time and memory for deep recursion.
+//
+// Throws semantic::semantic_error like generate_mpl, and also if the program
+// uses lists, which this backend does not support.
+void generate_constexpr(std::ostream &out, ast::ast const& a);
+
+} // namespace codegen
+} // namespace templa
+
+#endif    // TEMPLA_CONSTEXPR_GENERATOR_HPP_INCLUDED
@@ -0,0 +1,171 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "counting_new.hpp"
+
+namespace {
+
+std::atomic<bool> counting{false};
+thread_local std::size_t allocations = 0;
+
+void *allocate(std::size_t const size) noexcept
+{
+    if (counting.load(std::memory_order_relaxed)) {
+        ++allocations;
+    }
+    return std::malloc(size ? size : 1);
+}
+
+void *allocate_or_throw(std::size_t const size)
+{
+    if (auto const p = allocate(size)) {
+        return p;
+    }
+    throw std::bad_alloc{};
+}
+
+#if defined __cpp_aligned_new
+
+// aligned_alloc() takes a size which is a multiple of the alignment
+void *allocate(std::size_t const size, std::align_val_t const alignment) noexcept
+{
+    auto const a = static_cast<std::size_t>(alignment);
+    if (counting.load(std::memory_order_relaxed)) {
+        ++allocations;
+    }
+    return std::aligned_alloc(a, ((size ? size : 1) + a - 1) / a * a);
+}
+
+void *allocate_or_throw(std::size_t const size, std::align_val_t const alignment)
+{
+    if (auto const p = allocate(size, alignment)) {
+        return p;
+    }
+    throw std::bad_alloc{};
+}
+
+#endif
+
+} // namespace
+
+namespace templa {
+
+void start_counting_allocations()
+{
+    counting.store(true, std::memory_order_relaxed);
+}
+
+std::size_t thread_allocations()
+{
+    return allocations;
+}
+
+} // namespace templa
+
+// Every form of operator new allocates with malloc, so every form of
+// operator delete frees with free
+
+void *operator new(std::size_t const size)
+{
+    return allocate_or_throw(size);
+}
+
+void *operator new[](std::size_t const size)
+{
+    return allocate_or_throw(size);
+}
+
+void *operator new(std::size_t const size, std::nothrow_t const&) noexcept
+{
+    return allocate(size);
+}
+
+void *operator new[](std::size_t const size, std::nothrow_t const&) noexcept
+{
+    return allocate(size);
+}
+
+void operator delete(void *const p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *const p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *const p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *const p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *const p, std::nothrow_t const&) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *const p, std::nothrow_t const&) noexcept
+{
+    std::free(p);
+}
+
+#if defined __cpp_aligned_new
+
+void *operator new(std::size_t const size, std::align_val_t const alignment)
+{
+    return allocate_or_throw(size, alignment);
+}
+
+void *operator new[](std::size_t const size, std::align_val_t const alignment)
+{
+    return allocate_or_throw(size, alignment);
+}
+
+void *operator new(std::size_t const size, std::align_val_t const alignment, std::nothrow_t const&) noexcept
+{
+    return allocate(size, alignment);
+}
+
+void *operator new[](std::size_t const size, std::align_val_t const alignment, std::nothrow_t const&) noexcept
+{
+    return allocate(size, alignment);
+}
+
+void operator delete(void *const p, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *const p, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *const p, std::size_t, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *const p, std::size_t, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *const p, std::align_val_t, std::nothrow_t const&) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *const p, std::align_val_t, std::nothrow_t const&) noexcept
+{
+    std::free(p);
+}
+
+#endif
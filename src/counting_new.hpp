@@ -0,0 +1,23 @@
+#if !defined TEMPLA_COUNTING_NEW_HPP_INCLUDED
+#define      TEMPLA_COUNTING_NEW_HPP_INCLUDED
+
+#include <cstddef>
+
+namespace templa {
+
+// The templa executable replaces the global operator new and delete by ones
+// on malloc and free which can count the allocations of each thread for
+// --stats.  Nothing is counted until start_counting_allocations().
+//
+// Note:
+// The replacements are in their own translation unit and only linked into
+// the executable, so no caller sees the body of operator delete and g++
+// does not pair an inlined free() with operator new.
+void start_counting_allocations();
+
+// Allocations of the calling thread since counting started
+std::size_t thread_allocations();
+
+} // namespace templa
+
+#endif    // TEMPLA_COUNTING_NEW_HPP_INCLUDED
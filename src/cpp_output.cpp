@@ -0,0 +1,99 @@
+#include "cpp_output.hpp"
+#include "ast_adapted.hpp"
+#include "semantic.hpp"
+
+namespace templa {
+namespace codegen {
+
+namespace {
+
+std::unordered_set<std::string> const reserved_names = {
+    "alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand", "bitor", "bool", "break", "case", "catch",
+    "char", "char16_t", "char32_t", "class", "compl", "const", "constexpr", "const_cast", "continue",
+    "decltype", "default", "delete", "do", "double", "dynamic_cast", "else", "enum", "explicit", "export",
+    "extern", "false", "float", "for", "friend", "goto", "if", "inline", "int", "long", "mutable",
+    "namespace", "new", "noexcept", "not", "not_eq", "nullptr", "operator", "or", "or_eq", "private",
+    "protected", "public", "register", "reinterpret_cast", "return", "short", "signed", "sizeof", "static",
+    "static_assert", "static_cast", "struct", "switch", "template", "this", "thread_local", "throw", "true",
+    "try", "typedef", "typeid", "typename", "union", "unsigned", "using", "virtual", "void", "volatile",
+    "wchar_t", "while", "xor", "xor_eq",
+    // Names the output itself uses
+    "type", "mpl", "boost", "std", "templa_rt", "program",
+};
+
+char const hex[] = "0123456789abcdef";
+
+} // namespace
+
+bool is_reserved(std::string const& name)
+{
+    return reserved_names.count(name) != 0;
+}
+
+std::unordered_set<std::string> identifiers_of(ast::ast const& a)
+{
+    std::unordered_set<std::string> identifiers;
+    auto const add = [&](ast::identifier const name){ identifiers.insert(name.to_string()); };
+    ast::for_each_node(a.root, [&](ast::ast_node const& node){
+        if (auto const f = boost::get<ast::decl_func const*>(&node.value)) {
+            add((*f)->function_name);
+        } else if (auto const p = boost::get<ast::decl_param const*>(&node.value)) {
+            if (auto const name = semantic::parameter_name(**p)) {
+                add(*name);
+            }
+        } else if (auto const m = boost::get<ast::list_match const*>(&node.value)) {
+            for (auto const& e : (*m)->elements) {
+                add(e);
+            }
+            add((*m)->rest_elems_name);
+        } else if (auto const t = boost::get<ast::type_match const*>(&node.value)) {
+            add((*t)->param_name);
+        } else if (auto const c = boost::get<ast::func_call const*>(&node.value)) {
+            add((*c)->function_name);
+        }
+    });
+    return identifiers;
+}
+
+void put_line(std::string &out, std::size_t const indent, std::string const& text)
+{
+    out.append(indent * 4, ' ');
+    out += text;
+    out += '\n';
+}
+
+std::string char_literal(char const c)
+{
+    if (c == '\'' || c == '\\') {
+        return std::string{"'\\"} + c + '\'';
+    }
+    if (c >= ' ' && c <= '~') {
+        return std::string{'\''} + c + '\'';
+    }
+    auto const u = static_cast<unsigned char>(c);
+    return std::string{"'\\x"} + hex[u >> 4] + hex[u & 15] + '\'';
+}
+
+std::string string_literal(boost::string_ref const s)
+{
+    std::string literal = "\"";
+    for (auto const c : s) {
+        if (c == '"' || c == '\\') {
+            literal += '\\';
+            literal += c;
+        } else if (c >= ' ' && c <= '~') {
+            literal += c;
+        } else {
+            // Octal, as a hex escape would take the digits after it
+            auto const u = static_cast<unsigned char>(c);
+            literal += '\\';
+            literal += static_cast<char>('0' + (u >> 6));
+            literal += static_cast<char>('0' + ((u >> 3) & 7));
+            literal += static_cast<char>('0' + (u & 7));
+        }
+    }
+    return literal + '"';
+}
+
+} // namespace codegen
+} // namespace templa
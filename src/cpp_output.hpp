@@ -0,0 +1,41 @@
+#if !defined TEMPLA_CPP_OUTPUT_HPP_INCLUDED
+#define      TEMPLA_CPP_OUTPUT_HPP_INCLUDED
+
+#include <cstddef>
+#include <string>
+#include <unordered_set>
+
+#include <boost/variant/get.hpp>
+#include <boost/utility/string_ref.hpp>
+
+#include "ast.hpp"
+
+// Helpers of the C++ code generators
+namespace templa {
+namespace codegen {
+
+// C++ keywords and the names which the output itself uses.  Templa names
+// like these are renamed in the output.
+bool is_reserved(std::string const& name);
+
+// Every name which the program declares or calls, which the output must
+// not use for anything else
+std::unordered_set<std::string> identifiers_of(ast::ast const& a);
+
+// Appends text and a newline to out, indented by indent levels
+void put_line(std::string &out, std::size_t const indent, std::string const& text);
+
+// C++ literals which mean the same char and string
+std::string char_literal(char const c);
+std::string string_literal(boost::string_ref const s);
+
+template<class Node>
+Node const& get(ast::ast_node const& node)
+{
+    return *boost::get<Node const*>(node.value);
+}
+
+} // namespace codegen
+} // namespace templa
+
+#endif    // TEMPLA_CPP_OUTPUT_HPP_INCLUDED
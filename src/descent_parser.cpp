@@ -0,0 +1,555 @@
+#include <vector>
+#include <limits>
+#include <utility>
+
+#include <boost/optional.hpp>
+
+#include "descent_parser.hpp"
+#include "parser.hpp"
+
+namespace templa {
+namespace syntax {
+
+namespace {
+
+bool is_keyword(token const& t)
+{
+    return t.is(token_kind::identifier) && is_continuation_keyword(t.text());
+}
+
+} // namespace
+
+descent_parser::descent_parser(
+    helper::arena &node_arena,
+    char const* const begin,
+    char const* const end,
+    std::uint32_t const line,
+    std::uint32_t const col
+)
+    : node_arena(node_arena), tokens(begin, end, line, col)
+{}
+
+template<class NodeType, class... Args>
+ast::ast_node descent_parser::make(token const& first, Args &&... args)
+{
+    NodeType const* const node = node_arena.make<NodeType>(std::forward<Args>(args)...);
+    return {node, first.line, first.col};
+}
+
+ast::node_list descent_parser::take_nodes(std::size_t const mark)
+{
+    auto const size = scratch.size() - mark;
+    auto const first = node_arena.copy_array(scratch.data() + mark, size);
+    scratch.resize(mark);
+    return {first, first + size};
+}
+
+std::pair<ast::node_list, ast::node_list> descent_parser::take_operands_and_operators(std::size_t const mark)
+{
+    // Operands and operators were pushed alternately, starting with an operand.
+    // Both lists are allocated with placeholder elements first and then the
+    // elements are distributed to them.
+    std::size_t const size = scratch.size() - mark;
+    std::size_t const num_operators = size / 2;
+    auto const operands = node_arena.copy_array(scratch.data() + mark, size - num_operators);
+    auto const operators = node_arena.copy_array(scratch.data() + mark, num_operators);
+    for (std::size_t i = 0; i < size; ++i) {
+        auto &dest = i % 2 == 0 ? operands[i / 2] : operators[i / 2];
+        dest = scratch[mark + i];
+    }
+    scratch.resize(mark);
+    return {{operands, operands + size - num_operators}, {operators, operators + num_operators}};
+}
+
+void descent_parser::fail(token const& t) const
+{
+    switch (t.kind) {
+    case token_kind::newline:
+        throw parse_error{t.line, t.col, "unexpected newline"};
+    case token_kind::end:
+        throw parse_error{t.line, t.col, "unexpected end of input"};
+    default:
+        throw parse_error{t.line, t.col, "unexpected \"" + t.text().to_string() + '"'};
+    }
+}
+
+token descent_parser::expect(token_kind const kind)
+{
+    if (!tokens.peek().is(kind)) {
+        fail(tokens.peek());
+    }
+    return tokens.next();
+}
+
+token descent_parser::expect_word(char const* const word)
+{
+    if (!tokens.peek().is_word(word)) {
+        fail(tokens.peek());
+    }
+    return tokens.next();
+}
+
+void descent_parser::skip_newline()
+{
+    if (tokens.peek().is(token_kind::newline)) {
+        tokens.next();
+    }
+}
+
+// PROGRAM : DECL_FUNC {"\n" DECL_FUNC} ["\n"]
+ast::ast_node descent_parser::parse_program(diagnostics *const recover)
+{
+    auto const first = tokens.peek();
+    auto const mark = scratch.size();
+
+    // End of the parsed declarations on the scratch stack.  A failed
+    // declaration may leave its children above it.
+    auto decls_end = mark;
+    for (;;) {
+        try {
+            scratch.push_back(parse_decl_func());
+            decls_end = scratch.size();
+
+            while (tokens.peek().is(token_kind::newline) && tokens.peek(1).is(token_kind::identifier)) {
+                tokens.next();
+                scratch.push_back(parse_decl_func());
+                decls_end = scratch.size();
+            }
+
+            skip_newline();
+            expect(token_kind::end);
+            break;
+        } catch (parse_error const& e) {
+            if (recover == nullptr) {
+                throw;
+            }
+            recover->report(e.line, e.col, e.message);
+            scratch.resize(decls_end);
+            if (!skip_to_declaration()) {
+                break;
+            }
+        }
+    }
+
+    return {ast::make_program(node_arena, take_nodes(mark)), first.line, first.col};
+}
+
+// Skips tokens to the next newline followed by a name at column 1 which is
+// not a keyword continuing a declaration, and then the newline.  Returns
+// false at the end of the input.
+bool descent_parser::skip_to_declaration()
+{
+    for (;; tokens.next()) {
+        auto const& t = tokens.peek();
+        if (t.is(token_kind::end)) {
+            return false;
+        }
+        if (!t.is(token_kind::newline)) {
+            continue;
+        }
+        auto const& name = tokens.peek(1);
+        if (name.is(token_kind::identifier) && name.col == 1 && !is_keyword(name)) {
+            tokens.next();
+            return true;
+        }
+    }
+}
+
+// DECL_FUNC : FUNC_NAME ["(" DECL_PARAMS ")"] "=" EXPR
+ast::ast_node descent_parser::parse_decl_func()
+{
+    auto const name = expect(token_kind::identifier);
+
+    boost::optional<ast::ast_node> params;
+    if (tokens.peek().is(token_kind::left_paren)) {
+        tokens.next();
+        params = parse_decl_params();
+        expect(token_kind::right_paren);
+    }
+
+    expect(token_kind::equal);
+    auto const body = parse_expression();
+
+    return make<ast::decl_func>(name, ast::identifier{name.text()}, params, body);
+}
+
+ast::ast_node descent_parser::parse_decl_params()
+{
+    auto const first = tokens.peek();
+    auto const mark = scratch.size();
+    scratch.push_back(parse_decl_param());
+    while (tokens.peek().is(token_kind::comma)) {
+        tokens.next();
+        scratch.push_back(parse_decl_param());
+    }
+    return make<ast::decl_params>(first, take_nodes(mark));
+}
+
+// DECL_PARAM : LIST_MATCH | TYPE_MATCH | PARAM_NAME | CONSTANT
+ast::ast_node descent_parser::parse_decl_param()
+{
+    auto const first = tokens.peek();
+
+    if (first.is(token_kind::identifier)) {
+        auto const& following = tokens.peek(1);
+        if (following.is(token_kind::colon)) {
+            return make<ast::decl_param>(first, parse_list_match());
+        } else if (following.is(token_kind::double_colon)) {
+            return make<ast::decl_param>(first, parse_type_match());
+        } else if (!first.is_word("true") && !first.is_word("false")) {
+            tokens.next();
+            return make<ast::decl_param>(first, ast::identifier{first.text()});
+        }
+    }
+
+    return make<ast::decl_param>(first, parse_constant());
+}
+
+// LIST_MATCH : ELEM_NAME ":" {ELEM_NAME ":"} ELEMS_NAME
+ast::ast_node descent_parser::parse_list_match()
+{
+    auto const first = tokens.peek();
+    name_scratch.clear();
+    do {
+        name_scratch.emplace_back(expect(token_kind::identifier).text());
+        expect(token_kind::colon);
+    } while (tokens.peek(1).is(token_kind::colon));
+    auto const rest = expect(token_kind::identifier);
+    auto const elements = node_arena.copy_array(name_scratch.data(), name_scratch.size());
+    return make<ast::list_match>(first, ast::name_list{elements, elements + name_scratch.size()}, ast::identifier{rest.text()});
+}
+
+// TYPE_MATCH : PARAM_NAME "::" TYPE_NAME
+ast::ast_node descent_parser::parse_type_match()
+{
+    auto const param = expect(token_kind::identifier);
+    expect(token_kind::double_colon);
+    auto const type = expect(token_kind::identifier);
+    return make<ast::type_match>(param, ast::identifier{param.text()}, ast::identifier{type.text()});
+}
+
+// EXPR : LET_EXPR | IF_EXPR | CASE_EXPR | PRIMARY_EXPR
+ast::ast_node descent_parser::parse_expression()
+{
+    auto const first = tokens.peek();
+
+    if (first.is_word("let")) {
+        return make<ast::expression>(first, parse_let_expression());
+    } else if (first.is_word("if")) {
+        return make<ast::expression>(first, parse_if_expression());
+    } else if (first.is_word("case")) {
+        return make<ast::expression>(first, parse_case_expression());
+    } else {
+        return make<ast::expression>(first, parse_primary_expression());
+    }
+}
+
+// LET_EXPR : "let" DECL_FUNC {"\n" DECL_FUNC} "in" EXPR
+ast::ast_node descent_parser::parse_let_expression()
+{
+    auto const first = expect_word("let");
+    skip_newline();
+
+    auto const mark = scratch.size();
+    scratch.push_back(parse_decl_func());
+    while (tokens.peek().is(token_kind::newline)
+            && tokens.peek(1).is(token_kind::identifier)
+            && !tokens.peek(1).is_word("in")) {
+        tokens.next();
+        scratch.push_back(parse_decl_func());
+    }
+    auto const decls = take_nodes(mark);
+
+    skip_newline();
+    expect_word("in");
+    skip_newline();
+    auto const body = parse_expression();
+
+    return make<ast::let_expression>(first, decls, body);
+}
+
+// IF_EXPR : "if" EXPR "then" EXPR "else" EXPR
+ast::ast_node descent_parser::parse_if_expression()
+{
+    auto const first = expect_word("if");
+    auto const condition = parse_expression();
+    expect_word("then");
+    skip_newline();
+    auto const if_true = parse_expression();
+    skip_newline();
+    expect_word("else");
+    skip_newline();
+    auto const if_false = parse_expression();
+    return make<ast::if_expression>(first, condition, if_true, if_false);
+}
+
+// CASE_EXPR : "case" "\n" {CASE_WHEN "\n"} "|" "otherwise" EXPR
+ast::ast_node descent_parser::parse_case_expression()
+{
+    auto const first = expect_word("case");
+    expect(token_kind::newline);
+
+    auto const mark = scratch.size();
+    while (tokens.peek().is(token_kind::pipe) && !tokens.peek(1).is_word("otherwise")) {
+        scratch.push_back(parse_case_when());
+        expect(token_kind::newline);
+    }
+    auto const whens = take_nodes(mark);
+
+    expect(token_kind::pipe);
+    expect_word("otherwise");
+    skip_newline();
+    auto const otherwise = parse_expression();
+
+    return make<ast::case_expression>(first, whens, otherwise);
+}
+
+// CASE_WHEN : "|" EXPR "then" EXPR
+ast::ast_node descent_parser::parse_case_when()
+{
+    auto const first = expect(token_kind::pipe);
+    auto const condition = parse_expression();
+    skip_newline();
+    expect_word("then");
+    skip_newline();
+    auto const then = parse_expression();
+    return make<ast::case_when>(first, condition, then);
+}
+
+// PRIMARY_EXPR : FORM {RELATIONAL_OP FORM}
+ast::ast_node descent_parser::parse_primary_expression()
+{
+    auto const first = tokens.peek();
+    auto const mark = scratch.size();
+
+    scratch.push_back(parse_formula());
+    for (;;) {
+        auto const& t = tokens.peek();
+        if (!(t.is(token_kind::equal_equal) || t.is(token_kind::not_equal)
+                || t.is(token_kind::less) || t.is(token_kind::greater)
+                || t.is(token_kind::less_equal) || t.is(token_kind::greater_equal))) {
+            break;
+        }
+        auto const op = tokens.next();
+        scratch.push_back(make<ast::relational_operator>(op, op.text()));
+        scratch.push_back(parse_formula());
+    }
+
+    auto const lists = take_operands_and_operators(mark);
+    return make<ast::primary_expression>(first, lists.first, lists.second);
+}
+
+// FORM : ["+" | "-"] TERM {ADDITIVE_OP TERM}
+ast::ast_node descent_parser::parse_formula()
+{
+    auto const first = tokens.peek();
+    boost::optional<char> sign;
+    if (first.is(token_kind::plus) || first.is(token_kind::minus)) {
+        sign = *tokens.next().begin;
+    }
+
+    auto const mark = scratch.size();
+    scratch.push_back(parse_term());
+    for (;;) {
+        auto const& t = tokens.peek();
+        if (!(t.is(token_kind::plus) || t.is(token_kind::minus)
+                || t.is(token_kind::pipe) || t.is(token_kind::double_pipe))) {
+            break;
+        }
+        auto const op = tokens.next();
+        scratch.push_back(make<ast::additive_operator>(op, op.text()));
+        scratch.push_back(parse_term());
+    }
+
+    auto const lists = take_operands_and_operators(mark);
+    return make<ast::formula>(first, sign, lists.first, lists.second);
+}
+
+// TERM : FACTOR {MULT_OP FACTOR}
+ast::ast_node descent_parser::parse_term()
+{
+    auto const first = tokens.peek();
+    auto const mark = scratch.size();
+
+    scratch.push_back(parse_factor());
+    for (;;) {
+        auto const& t = tokens.peek();
+        if (!(t.is(token_kind::star) || t.is(token_kind::slash) || t.is(token_kind::percent)
+                || t.is(token_kind::ampersand) || t.is(token_kind::double_ampersand))) {
+            break;
+        }
+        auto const op = tokens.next();
+        scratch.push_back(make<ast::mult_operator>(op, op.text()));
+        scratch.push_back(parse_factor());
+    }
+
+    auto const lists = take_operands_and_operators(mark);
+    return make<ast::term>(first, lists.first, lists.second);
+}
+
+// FACTOR : CONSTANT | FUNC_CALL | "!" FACTOR | "(" PRIMARY_EXPR ")"
+ast::ast_node descent_parser::parse_factor()
+{
+    auto const first = tokens.peek();
+
+    if (first.is(token_kind::bang)) {
+        tokens.next();
+        return make<ast::factor>(first, parse_factor());
+    } else if (first.is(token_kind::left_paren)) {
+        tokens.next();
+        auto const inner = parse_primary_expression();
+        expect(token_kind::right_paren);
+        return make<ast::factor>(first, inner);
+    } else if (starts_constant()) {
+        return make<ast::factor>(first, parse_constant());
+    } else {
+        return make<ast::factor>(first, parse_func_call());
+    }
+}
+
+bool descent_parser::starts_constant()
+{
+    auto const& t = tokens.peek();
+    return t.is(token_kind::integer)
+        || t.is(token_kind::character)
+        || t.is(token_kind::string)
+        || t.is(token_kind::left_bracket)
+        || t.is_word("true")
+        || t.is_word("false")
+        || is_signed_integer(0);
+}
+
+// A sign immediately followed by digits is a part of the integer literal
+bool descent_parser::is_signed_integer(std::size_t const n)
+{
+    auto const& sign = tokens.peek(n);
+    if (!sign.is(token_kind::plus) && !sign.is(token_kind::minus)) {
+        return false;
+    }
+    auto const& digits = tokens.peek(n + 1);
+    return digits.is(token_kind::integer) && digits.begin == sign.end;
+}
+
+int descent_parser::parse_integer()
+{
+    auto const first = tokens.peek();
+    bool negative = false;
+    if (is_signed_integer(0)) {
+        negative = tokens.next().is(token_kind::minus);
+    }
+
+    auto const digits = expect(token_kind::integer);
+    long long value = 0;
+    long long const limit = negative
+        ? -static_cast<long long>(std::numeric_limits<int>::min())
+        : std::numeric_limits<int>::max();
+    for (auto c = digits.begin; c != digits.end; ++c) {
+        value = value * 10 + (*c - '0');
+        if (value > limit) {
+            fail(first);
+        }
+    }
+
+    return static_cast<int>(negative ? -value : value);
+}
+
+// CONSTANT : INTEGER | CHAR | BOOL | STRING | LIST
+ast::ast_node descent_parser::parse_constant()
+{
+    auto const first = tokens.peek();
+
+    if (first.is(token_kind::integer) || is_signed_integer(0)) {
+        return make<ast::constant>(first, parse_integer());
+    } else if (first.is(token_kind::character)) {
+        tokens.next();
+        return make<ast::constant>(first, first.begin[1]);
+    } else if (first.is_word("true") || first.is_word("false")) {
+        tokens.next();
+        return make<ast::constant>(first, first.is_word("true"));
+    } else if (first.is(token_kind::string)) {
+        tokens.next();
+        return make<ast::constant>(first, boost::string_ref(first.begin + 1, first.size() - 2));
+    } else if (first.is(token_kind::left_bracket)) {
+        return make<ast::constant>(first, parse_list());
+    }
+
+    fail(first);
+}
+
+// LIST      : INT_LIST | CHAR_LIST | ENUM_LIST
+// INT_LIST  : "[" INTEGER ".." INTEGER "]"
+// CHAR_LIST : "[" CHAR ".." CHAR "]"
+// ENUM_LIST : "[" PRIMARY_EXPR {"," PRIMARY_EXPR} "]"
+//
+// CHAR in CHAR_LIST is any single character written without quotes.
+ast::ast_node descent_parser::parse_list()
+{
+    auto const first = expect(token_kind::left_bracket);
+
+    std::size_t const min_width = is_signed_integer(0) ? 2 : 1;
+    if (tokens.peek(min_width - 1).is(token_kind::integer)) {
+        std::size_t const max_pos = min_width + 1;
+        std::size_t const max_width = is_signed_integer(max_pos) ? 2 : 1;
+        if (tokens.peek(min_width).is(token_kind::dot_dot)
+                && tokens.peek(max_pos + max_width - 1).is(token_kind::integer)
+                && tokens.peek(max_pos + max_width).is(token_kind::right_bracket)) {
+            auto const min = parse_integer();
+            expect(token_kind::dot_dot);
+            auto const max = parse_integer();
+            expect(token_kind::right_bracket);
+            return make<ast::list>(first, make<ast::int_list>(first, min, max));
+        }
+    }
+
+    if (tokens.peek().size() == 1
+            && tokens.peek(1).is(token_kind::dot_dot)
+            && tokens.peek(2).size() == 1
+            && tokens.peek(3).is(token_kind::right_bracket)) {
+        auto const begin = *tokens.next().begin;
+        tokens.next();
+        auto const end = *tokens.next().begin;
+        tokens.next();
+        return make<ast::list>(first, make<ast::char_list>(first, begin, end));
+    }
+
+    auto const mark = scratch.size();
+    scratch.push_back(parse_primary_expression());
+    while (tokens.peek().is(token_kind::comma)) {
+        tokens.next();
+        scratch.push_back(parse_primary_expression());
+    }
+    expect(token_kind::right_bracket);
+
+    return make<ast::list>(first, make<ast::enum_list>(first, take_nodes(mark)));
+}
+
+// FUNC_CALL : FUNC_NAME ["(" CALL_ARGS ")"]
+ast::ast_node descent_parser::parse_func_call()
+{
+    auto const name = expect(token_kind::identifier);
+
+    boost::optional<ast::ast_node> args;
+    if (tokens.peek().is(token_kind::left_paren)) {
+        tokens.next();
+        args = parse_call_args();
+        expect(token_kind::right_paren);
+    }
+
+    return make<ast::func_call>(name, ast::identifier{name.text()}, args);
+}
+
+// CALL_ARGS : PRIMARY_EXPR {"," PRIMARY_EXPR}
+ast::ast_node descent_parser::parse_call_args()
+{
+    auto const first = tokens.peek();
+    auto const mark = scratch.size();
+    scratch.push_back(parse_primary_expression());
+    while (tokens.peek().is(token_kind::comma)) {
+        tokens.next();
+        scratch.push_back(parse_primary_expression());
+    }
+    return make<ast::call_args>(first, take_nodes(mark));
+}
+
+} // namespace syntax
+} // namespace templa
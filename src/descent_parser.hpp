@@ -0,0 +1,83 @@
+#if !defined TEMPLA_DESCENT_PARSER_HPP_INCLUDED
+#define      TEMPLA_DESCENT_PARSER_HPP_INCLUDED
+
+#include <cstddef>
+#include <vector>
+#include <utility>
+
+#include "ast.hpp"
+#include "lexer.hpp"
+#include "diagnostics.hpp"
+#include "helper/arena.hpp"
+
+namespace templa {
+namespace syntax {
+
+// Predictive recursive descent parser for the grammar in misc/templa.bnf.
+// It accepts the same language as the Spirit grammar and builds the same AST,
+// but decides each alternative by looking ahead at most a few tokens instead
+// of backtracking.  Nodes are allocated in the given arena.
+class descent_parser {
+public:
+    // line and col are the position of begin in the whole source
+    descent_parser(
+        helper::arena &node_arena,
+        char const* const begin,
+        char const* const end,
+        std::uint32_t const line = 1,
+        std::uint32_t const col = 1
+    );
+
+    // Throws parse_error on syntax error.  If recover is given, an error is
+    // reported into it instead, the declaration with the error is dropped
+    // and parsing resumes at the next top-level declaration.
+    ast::ast_node parse_program(diagnostics *const recover = nullptr);
+
+private:
+    ast::ast_node parse_decl_func();
+    ast::ast_node parse_decl_params();
+    ast::ast_node parse_decl_param();
+    ast::ast_node parse_list_match();
+    ast::ast_node parse_type_match();
+    ast::ast_node parse_expression();
+    ast::ast_node parse_let_expression();
+    ast::ast_node parse_if_expression();
+    ast::ast_node parse_case_expression();
+    ast::ast_node parse_case_when();
+    ast::ast_node parse_primary_expression();
+    ast::ast_node parse_formula();
+    ast::ast_node parse_term();
+    ast::ast_node parse_factor();
+    ast::ast_node parse_constant();
+    ast::ast_node parse_list();
+    ast::ast_node parse_func_call();
+    ast::ast_node parse_call_args();
+
+    bool starts_constant();
+    bool is_signed_integer(std::size_t const n);
+    int parse_integer();
+
+    void skip_newline();
+    bool skip_to_declaration();
+    token expect(token_kind const kind);
+    token expect_word(char const* const word);
+    [[noreturn]] void fail(token const& t) const;
+
+    template<class NodeType, class... Args>
+    ast::ast_node make(token const& first, Args &&... args);
+
+    // Child lists are collected on the scratch stack while their elements are
+    // parsed and then copied into the arena in one piece.
+    ast::node_list take_nodes(std::size_t const mark);
+    std::pair<ast::node_list, ast::node_list> take_operands_and_operators(std::size_t const mark);
+
+    helper::arena &node_arena;
+    lexer tokens;
+    std::vector<ast::ast_node> scratch;
+    std::vector<ast::identifier> name_scratch;
+};
+
+} // namespace syntax
+} // namespace templa
+
+#endif    // TEMPLA_DESCENT_PARSER_HPP_INCLUDED
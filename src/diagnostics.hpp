@@ -0,0 +1,68 @@
+#if !defined TEMPLA_DIAGNOSTICS_HPP_INCLUDED
+#define      TEMPLA_DIAGNOSTICS_HPP_INCLUDED
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <utility>
+#include <ostream>
+
+namespace templa {
+namespace syntax {
+
+struct diagnostic {
+    std::size_t line;
+    std::size_t col;
+    std::string message;
+};
+
+// Errors found by a parse.  The caller owns it and passes it to the parse, so
+// parses in different threads never share one.
+class diagnostics {
+public:
+    void report(std::size_t const line, std::size_t const col, std::string message)
+    {
+        reported.push_back({line, col, std::move(message)});
+    }
+
+    std::vector<diagnostic> const& entries() const
+    {
+        return reported;
+    }
+
+    bool empty() const
+    {
+        return reported.empty();
+    }
+
+    void clear()
+    {
+        reported.clear();
+    }
+
+private:
+    std::vector<diagnostic> reported;
+};
+
+// "line 3, col 5: expecting ']'"
+inline
+std::string format_diagnostic(std::size_t const line, std::size_t const col, std::string const& message)
+{
+    auto result = "line " + std::to_string(line) + ", col " + std::to_string(col);
+    if (!message.empty()) {
+        result += ": ";
+        result += message;
+    }
+    return result;
+}
+
+inline
+std::ostream &operator<<(std::ostream &out, diagnostic const& d)
+{
+    return out << format_diagnostic(d.line, d.col, d.message);
+}
+
+} // namespace syntax
+} // namespace templa
+
+#endif    // TEMPLA_DIAGNOSTICS_HPP_INCLUDED
@@ -0,0 +1,695 @@
+#include <algorithm>
+#include <utility>
+#include <exception>
+#include <system_error>
+
+#include <pthread.h>
+
+#include <boost/optional.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/variant/get.hpp>
+#include <boost/variant/apply_visitor.hpp>
+#include <boost/variant/static_visitor.hpp>
+
+#include "evaluator.hpp"
+#include "operations.hpp"
+#include "memo.hpp"
+
+namespace templa {
+namespace eval {
+
+namespace {
+
+using semantic::semantic_error;
+
+template<class Node>
+Node const& get(ast::ast_node const& node)
+{
+    return *boost::get<Node const*>(node.value);
+}
+
+// Stack left below the floor for what the evaluator calls without checking
+// the stack, e.g. the operations on values and the library
+constexpr std::size_t stack_margin = 256 * 1024;
+
+// The floor of the stack of this thread, or null if it is unknown
+char const* find_stack_floor()
+{
+    thread_local char const* const floor = []() -> char const* {
+        pthread_attr_t attr;
+        if (::pthread_getattr_np(::pthread_self(), &attr) != 0) {
+            return nullptr;
+        }
+        void *lowest = nullptr;
+        std::size_t size = 0;
+        ::pthread_attr_getstack(&attr, &lowest, &size);
+        ::pthread_attr_destroy(&attr);
+        return size > stack_margin ? static_cast<char const*>(lowest) + stack_margin : nullptr;
+    }();
+    return floor;
+}
+
+struct hasher : boost::static_visitor<std::size_t> {
+    template<class T>
+    std::size_t operator()(T const& v) const
+    {
+        return boost::hash<T>{}(v);
+    }
+
+    std::size_t operator()(list const& l) const
+    {
+        std::size_t seed = l.size();
+        for (auto const& e : l) {
+            boost::hash_combine(seed, hash(e));
+        }
+        return seed;
+    }
+};
+
+struct printer : boost::static_visitor<void> {
+    explicit printer(std::ostream &out)
+        : out(out)
+    {}
+
+    template<class T>
+    void operator()(T const& v) const
+    {
+        out << v;
+    }
+
+    void operator()(bool const b) const
+    {
+        out << (b ? "true" : "false");
+    }
+
+    void operator()(list const& l) const
+    {
+        out << '[';
+        for (auto e = l.begin(); e != l.end(); ++e) {
+            if (e != l.begin()) {
+                out << ", ";
+            }
+            out << *e;
+        }
+        out << ']';
+    }
+
+    std::ostream &out;
+};
+
+} // namespace
+
+list::list(std::vector<value> elements)
+    : elements(std::make_shared<std::vector<value> const>(std::move(elements)))
+    , first(0)
+    , length(this->elements->size())
+{}
+
+value const* list::begin() const
+{
+    return elements ? elements->data() + first : nullptr;
+}
+
+value const* list::end() const
+{
+    return begin() + length;
+}
+
+list list::drop(std::size_t const n) const
+{
+    auto rest = *this;
+    auto const dropped = std::min(n, length);
+    rest.first += dropped;
+    rest.length -= dropped;
+    return rest;
+}
+
+bool equal(value const& lhs, value const& rhs)
+{
+    if (lhs.which() != rhs.which()) {
+        return false;
+    }
+    if (auto const l = boost::get<list>(&lhs)) {
+        auto const& r = boost::get<list>(rhs);
+        return l->size() == r.size() && std::equal(l->begin(), l->end(), r.begin(), equal);
+    }
+    if (auto const s = boost::get<std::string>(&lhs)) {
+        return *s == boost::get<std::string>(rhs);
+    }
+    return numeric(lhs) == numeric(rhs);
+}
+
+std::size_t hash(value const& v)
+{
+    auto seed = static_cast<std::size_t>(v.which());
+    boost::hash_combine(seed, boost::apply_visitor(hasher{}, v));
+    return seed;
+}
+
+std::ostream &operator<<(std::ostream &out, value const& v)
+{
+    boost::apply_visitor(printer{out}, v);
+    return out;
+}
+
+char const* type_name(value const& v)
+{
+    switch (v.which()) {
+    case 0:  return "Int";
+    case 1:  return "Char";
+    case 2:  return "Bool";
+    case 3:  return "String";
+    default: return "List";
+    }
+}
+
+// Names bound in one scope.  A clause binds its parameters, and a let or
+// the program declare functions.  Frames live on the C++ stack while their
+// scope is evaluated, and a function refers to the frame it is declared in.
+struct evaluator::frame {
+    frame const* parent;
+    std::vector<std::pair<ast::identifier, value>> values;
+    semantic::function_table const* functions;
+};
+
+// What a name in a call refers to
+struct evaluator::callee {
+    ast::identifier name;
+    value const* bound;
+    semantic::function const* function;
+    // The frame which function is declared in
+    frame const* scope;
+    boost::optional<semantic::builtin> builtin;
+};
+
+std::size_t evaluator::call_key_hash::operator()(call_key const& k) const
+{
+    auto seed = boost::hash<void const*>{}(k.function);
+    for (auto const& a : k.args) {
+        boost::hash_combine(seed, hash(a));
+    }
+    return seed;
+}
+
+bool evaluator::call_key_equal::operator()(call_key const& lhs, call_key const& rhs) const
+{
+    return lhs.function == rhs.function && std::equal(lhs.args.begin(), lhs.args.end(), rhs.args.begin(), equal);
+}
+
+evaluator::evaluator(ast::ast const& a, limits const& l)
+    : top_level(get<ast::program>(a.root).function_declarations)
+    , bounds(l)
+    , memo(l.memo != 0 ? std::make_unique<memo_table>(l.memo) : nullptr)
+{}
+
+evaluator::~evaluator() = default;
+
+value evaluator::call(boost::string_ref const name, std::vector<value> const& args)
+{
+    stack_floor = find_stack_floor();
+    frame const global{nullptr, {}, &top_level};
+    auto const f = resolve(global, ast::identifier{name});
+    auto const at = f.function ? f.function->clauses.front() : ast::ast_node{};
+    line_delta = f.function ? f.function->line_deltas.front() : 0;
+    if (f.function == nullptr) {
+        throw semantic_error{where(at).line, where(at).col, name.to_string() + " is not declared"};
+    }
+    if (args.size() != f.function->arity) {
+        throw semantic_error{where(at).line, where(at).col, name.to_string() + " takes " + std::to_string(f.function->arity) + " arguments"};
+    }
+    auto copied = args;
+    return apply(f, copied, at);
+}
+
+value evaluator::evaluate(ast::ast_node const& node, std::int64_t const line_delta)
+{
+    stack_floor = find_stack_floor();
+    this->line_delta = line_delta;
+    frame const global{nullptr, {}, &top_level};
+    if (boost::get<ast::expression const*>(&node.value)) {
+        return evaluate_expression(node, global);
+    } else if (boost::get<ast::func_call const*>(&node.value)) {
+        return evaluate_call(node, global);
+    }
+    return evaluate_primary(node, global);
+}
+
+evaluator::callee evaluator::resolve(frame const& env, ast::identifier const name) const
+{
+    for (auto f = &env; f != nullptr; f = f->parent) {
+        for (auto const& v : f->values) {
+            if (v.first == name) {
+                return {name, &v.second, nullptr, nullptr, boost::none};
+            }
+        }
+        if (f->functions) {
+            if (auto const declared = f->functions->find(name)) {
+                return {name, nullptr, declared, f, boost::none};
+            }
+        }
+    }
+    return {name, nullptr, nullptr, nullptr, semantic::find_builtin(name)};
+}
+
+location evaluator::where(ast::ast_node const& node) const
+{
+    return {static_cast<std::size_t>(node.line + line_delta), node.col};
+}
+
+void evaluator::step(ast::ast_node const& at, std::size_t const n)
+{
+    taken += n;
+    if (taken > bounds.steps) {
+        throw limit_exceeded{where(at).line, where(at).col, "evaluation takes more than " + std::to_string(bounds.steps) + " steps"};
+    }
+}
+
+void evaluator::check_length(ast::ast_node const& at, std::size_t const length) const
+{
+    if (length > bounds.length) {
+        throw limit_exceeded{where(at).line, where(at).col, "a value is longer than " + std::to_string(bounds.length) + " elements"};
+    }
+}
+
+// The stack is measured rather than estimated from the depth of calls, as
+// one call may nest expressions arbitrarily deep
+void evaluator::check_stack(ast::ast_node const& at) const
+{
+    char const here = 0;
+    if (&here < stack_floor) {
+        throw limit_exceeded{where(at).line, where(at).col, "calls and expressions nest too deeply for the stack"};
+    }
+}
+
+value evaluator::apply(callee const& f, std::vector<value> &args, ast::ast_node const& at)
+{
+    step(at);
+
+    if (f.builtin) {
+        return apply_builtin(where(at), *f.builtin, f.name.text(), std::move(args.front()));
+    }
+
+    // Only top-level functions, whose values depend on their arguments alone
+    bool const remembered = memo && f.scope->parent == nullptr;
+    if (remembered) {
+        if (auto const r = memo->find(f.function, args.data(), args.size())) {
+            return *r;
+        }
+    }
+    auto result = apply_clauses(f, args, at);
+    if (remembered) {
+        memo->store(f.function, args.data(), args.size(), result);
+    }
+    return result;
+}
+
+value evaluator::apply_clauses(callee const& f, std::vector<value> const& args, ast::ast_node const& at)
+{
+    if (depth >= bounds.depth) {
+        throw limit_exceeded{where(at).line, where(at).col, "calls nest more than " + std::to_string(bounds.depth) + " deep"};
+    }
+    struct nesting {
+        explicit nesting(std::size_t &depth)
+            : depth(++depth)
+        {}
+        ~nesting()
+        {
+            --depth;
+        }
+        std::size_t &depth;
+    } const nested{depth};
+
+    auto const& function = *f.function;
+    if (counting) {
+        distinct.insert({&function, args});
+    }
+    // Errors of the clause are at its lines, and errors after it at the ones
+    // of the caller
+    struct placing {
+        placing(std::int64_t &line_delta, std::int64_t const clause_delta)
+            : line_delta(line_delta), caller_delta(line_delta)
+        {
+            line_delta = clause_delta;
+        }
+        ~placing()
+        {
+            line_delta = caller_delta;
+        }
+        std::int64_t &line_delta;
+        std::int64_t const caller_delta;
+    };
+
+    auto const try_clause = [&](std::size_t const c) -> boost::optional<value> {
+        placing const placed{line_delta, function.line_deltas[c]};
+        auto const& clause = get<ast::decl_func>(function.clauses[c]);
+        frame bound{f.scope, {}, nullptr};
+        auto const params = semantic::parameters(clause);
+        for (std::size_t i = 0; i < params.size(); ++i) {
+            if (!match(params[i], args[i], bound, function.name)) {
+                return boost::none;
+            }
+        }
+        return evaluate_expression(clause.expression, bound);
+    };
+
+    for (std::size_t c = 0; c < function.clauses.size(); ++c) {
+        if (!function.general || c != *function.general) {
+            if (auto result = try_clause(c)) {
+                return std::move(*result);
+            }
+        }
+    }
+    if (function.general) {
+        return std::move(*try_clause(*function.general));
+    }
+
+    std::string types;
+    for (auto const& a : args) {
+        types += (types.empty() ? "" : ", ") + std::string{type_name(a)};
+    }
+    throw evaluation_error{where(at).line, where(at).col, "no clause of " + function.name.to_string() + " matches (" + types + ")"};
+}
+
+bool evaluator::match(ast::ast_node const& param_node, value const& arg, frame &bound, ast::identifier const function_name)
+{
+    auto const bind = [&](ast::identifier const name, value const& v){
+        for (auto const& b : bound.values) {
+            if (b.first == name) {
+                throw semantic_error{
+                    where(param_node).line, where(param_node).col,
+                    "parameter " + name.to_string() + " of " + function_name.to_string() + " is declared twice"
+                };
+            }
+        }
+        bound.values.emplace_back(name, v);
+    };
+
+    auto const& param = get<ast::decl_param>(param_node);
+    if (auto const name = semantic::parameter_name(param)) {
+        bind(*name, arg);
+        return true;
+    }
+
+    auto const& pattern = boost::get<ast::ast_node>(param.value);
+    if (auto const m = boost::get<ast::list_match const*>(&pattern.value)) {
+        auto const l = boost::get<list>(&arg);
+        if (!l || l->size() < (*m)->elements.size()) {
+            return false;
+        }
+        for (std::size_t i = 0; i < (*m)->elements.size(); ++i) {
+            bind((*m)->elements[i], (*l)[i]);
+        }
+        bind((*m)->rest_elems_name, l->drop((*m)->elements.size()));
+        return true;
+    }
+
+    if (auto const t = boost::get<ast::type_match const*>(&pattern.value)) {
+        auto const type = semantic::find_type((*t)->type_name);
+        if (!type) {
+            throw semantic_error{where(pattern).line, where(pattern).col, "unknown type " + (*t)->type_name.to_string()};
+        }
+        if (*type != static_cast<std::size_t>(arg.which())) {
+            return false;
+        }
+        bind((*t)->param_name, arg);
+        return true;
+    }
+
+    auto const& c = get<ast::constant>(pattern).value;
+    if (auto const l = boost::get<ast::ast_node>(&c)) {
+        if (!boost::get<ast::enum_list const*>(&get<ast::list>(*l).value.value)) {
+            throw semantic_error{where(pattern).line, where(pattern).col, "a range cannot be a pattern"};
+        }
+    }
+    return equal(evaluate_constant(pattern, *bound.parent), arg);
+}
+
+value evaluator::evaluate_expression(ast::ast_node const& node, frame const& env)
+{
+    check_stack(node);
+    auto const& value_node = get<ast::expression>(node).value;
+
+    if (auto const let = boost::get<ast::let_expression const*>(&value_node.value)) {
+        auto &functions = let_functions[*let];
+        if (!functions) {
+            functions = std::make_unique<semantic::function_table const>((*let)->function_declarations, line_delta);
+        }
+        frame const local{&env, {}, functions.get()};
+        return evaluate_expression((*let)->body, local);
+    }
+
+    auto const holds = [&](ast::ast_node const& condition){
+        return truth(where(condition), evaluate_expression(condition, env));
+    };
+
+    if (auto const i = boost::get<ast::if_expression const*>(&value_node.value)) {
+        return evaluate_expression(holds((*i)->condition) ? (*i)->expression_if_true : (*i)->expression_if_false, env);
+    }
+
+    if (auto const c = boost::get<ast::case_expression const*>(&value_node.value)) {
+        for (auto const& w : (*c)->case_when) {
+            auto const& when = get<ast::case_when>(w);
+            if (holds(when.condition)) {
+                return evaluate_expression(when.then_expression, env);
+            }
+        }
+        return evaluate_expression((*c)->otherwise_expression, env);
+    }
+
+    return evaluate_primary(value_node, env);
+}
+
+value evaluator::evaluate_primary(ast::ast_node const& node, frame const& env)
+{
+    auto const& primary = get<ast::primary_expression>(node);
+    auto result = evaluate_formula(primary.formulae.front(), env);
+    for (std::size_t i = 0; i < primary.operators.size(); ++i) {
+        auto const& at = primary.operators[i];
+        auto const op = get<ast::relational_operator>(at).value;
+        auto const rhs = evaluate_formula(primary.formulae[i + 1], env);
+        if (op == "==") {
+            result = equal(result, rhs);
+        } else if (op == "!=") {
+            result = !equal(result, rhs);
+        } else {
+            result = compare(where(at), op, result, rhs);
+        }
+    }
+    return result;
+}
+
+value evaluator::evaluate_formula(ast::ast_node const& node, frame const& env)
+{
+    auto const& f = get<ast::formula>(node);
+    auto result = evaluate_term(f.terms.front(), env);
+    if (f.maybe_sign && *f.maybe_sign == '-') {
+        result = checked(where(node), -static_cast<long long>(operand(where(node), "-", result)));
+    }
+    for (std::size_t i = 0; i < f.operators.size(); ++i) {
+        auto const& at = f.operators[i];
+        auto const op = get<ast::additive_operator>(at).value;
+        if (op == "|" || op == "||") {
+            // true_ if the left operand is true, otherwise the right one, as
+            // mpl::eval_if does
+            if (operand(where(at), op, result) != 0) {
+                result = true;
+            } else {
+                result = evaluate_term(f.terms[i + 1], env);
+            }
+            continue;
+        }
+        auto const rhs = evaluate_term(f.terms[i + 1], env);
+        if (op == "+") {
+            result = add(where(at), result, rhs);
+            check_length(at, length_of(result));
+        } else {
+            result = arithmetic(where(at), '-', result, rhs);
+        }
+    }
+    return result;
+}
+
+value evaluator::evaluate_term(ast::ast_node const& node, frame const& env)
+{
+    auto const& t = get<ast::term>(node);
+    auto result = evaluate_factor(t.factors.front(), env);
+    for (std::size_t i = 0; i < t.operators.size(); ++i) {
+        auto const& at = t.operators[i];
+        auto const op = get<ast::mult_operator>(at).value;
+        if (op == "&" || op == "&&") {
+            if (operand(where(at), op, result) == 0) {
+                result = false;
+            } else {
+                result = evaluate_factor(t.factors[i + 1], env);
+            }
+            continue;
+        }
+        result = arithmetic(where(at), op.front(), result, evaluate_factor(t.factors[i + 1], env));
+    }
+    return result;
+}
+
+value evaluator::evaluate_factor(ast::ast_node const& node, frame const& env)
+{
+    check_stack(node);
+    auto const& v = get<ast::factor>(node).value;
+    if (boost::get<ast::factor const*>(&v.value)) {
+        return operand(where(node), "!", evaluate_factor(v, env)) == 0;
+    } else if (boost::get<ast::primary_expression const*>(&v.value)) {
+        return evaluate_primary(v, env);
+    } else if (boost::get<ast::constant const*>(&v.value)) {
+        return evaluate_constant(v, env);
+    }
+    return evaluate_call(v, env);
+}
+
+value evaluator::evaluate_constant(ast::ast_node const& node, frame const& env)
+{
+    auto const& c = get<ast::constant>(node).value;
+    if (auto const i = boost::get<int>(&c)) {
+        return *i;
+    } else if (auto const ch = boost::get<char>(&c)) {
+        return *ch;
+    } else if (auto const b = boost::get<bool>(&c)) {
+        return *b;
+    } else if (auto const s = boost::get<boost::string_ref>(&c)) {
+        return s->to_string();
+    }
+
+    auto const& l = get<ast::list>(boost::get<ast::ast_node>(c)).value;
+    std::vector<value> elements;
+    if (auto const r = boost::get<ast::int_list const*>(&l.value)) {
+        if ((*r)->min <= (*r)->max) {
+            auto const size = static_cast<std::size_t>(static_cast<long long>((*r)->max) - (*r)->min + 1);
+            check_length(node, size);
+            step(node, size);
+            elements.reserve(size);
+            for (long long i = (*r)->min; i <= (*r)->max; ++i) {
+                elements.emplace_back(static_cast<int>(i));
+            }
+        }
+    } else if (auto const r = boost::get<ast::char_list const*>(&l.value)) {
+        for (int ch = (*r)->begin; ch <= (*r)->end; ++ch) {
+            step(node);
+            elements.emplace_back(static_cast<char>(ch));
+        }
+    } else {
+        for (auto const& e : get<ast::enum_list>(l).elements) {
+            elements.push_back(evaluate_primary(e, env));
+        }
+    }
+    return list{std::move(elements)};
+}
+
+value evaluator::evaluate_call(ast::ast_node const& node, frame const& env)
+{
+    auto const& call = get<ast::func_call>(node);
+    auto const name = [&]{ return call.function_name.to_string(); };
+    auto const f = resolve(env, call.function_name);
+
+    std::vector<value> args;
+    if (call.maybe_call_arguments) {
+        auto const& arguments = get<ast::call_args>(*call.maybe_call_arguments).arguments;
+        args.reserve(arguments.size());
+        for (auto const& a : arguments) {
+            args.push_back(evaluate_primary(a, env));
+        }
+    }
+
+    if (f.bound) {
+        if (!args.empty()) {
+            throw semantic_error{where(node).line, where(node).col, name() + " is not a function"};
+        }
+        return *f.bound;
+    }
+    if (f.builtin) {
+        if (args.size() != 1) {
+            throw semantic_error{where(node).line, where(node).col, name() + " takes 1 argument"};
+        }
+        return apply(f, args, node);
+    }
+    if (f.function == nullptr) {
+        throw semantic_error{where(node).line, where(node).col, name() + " is not declared"};
+    }
+    if (args.size() != f.function->arity) {
+        throw semantic_error{
+            where(node).line, where(node).col,
+            name() + " takes " + std::to_string(f.function->arity) + (f.function->arity == 1 ? " argument" : " arguments")
+                + ", but is called with " + std::to_string(args.size())
+        };
+    }
+    return apply(f, args, node);
+}
+
+namespace {
+
+// Stack which the evaluation of a nested call of a few nested expressions
+// takes, and the stack of the rest of run().  Deeper expressions run out of
+// it before l.depth calls and fail in check_stack().
+constexpr std::size_t stack_per_call = 8 * 1024;
+constexpr std::size_t base_stack = 1024 * 1024;
+
+// Calls f on a new thread whose stack is size bytes and rethrows what f
+// throws.  std::thread cannot choose the size of its stack.
+template<class F>
+void call_on_stack(std::size_t const size, F const& f)
+{
+    struct job {
+        F const& f;
+        std::exception_ptr error;
+    } j{f, nullptr};
+
+    pthread_attr_t attr;
+    ::pthread_attr_init(&attr);
+    ::pthread_attr_setstacksize(&attr, size);
+    pthread_t thread;
+    auto const started = ::pthread_create(&thread, &attr, [](void *const p) -> void* {
+        auto &j = *static_cast<job*>(p);
+        try {
+            j.f();
+        } catch (...) {
+            j.error = std::current_exception();
+        }
+        return nullptr;
+    }, &j);
+    ::pthread_attr_destroy(&attr);
+    if (started != 0) {
+        throw std::system_error{started, std::generic_category(), "cannot start the evaluation thread"};
+    }
+
+    ::pthread_join(thread, nullptr);
+    if (j.error) {
+        std::rethrow_exception(j.error);
+    }
+}
+
+} // namespace
+
+void on_evaluation_stack(limits const& l, std::function<void()> const& f)
+{
+    call_on_stack(base_stack + l.depth * stack_per_call, f);
+}
+
+void run(std::ostream &out, ast::ast const& a, limits const& l, memo_statistics *const memo_stats)
+{
+    evaluator e{a, l};
+    auto const main = e.functions().find(ast::identifier{"main"});
+    if (main == nullptr) {
+        throw semantic_error{1, 1, "main is not declared"};
+    }
+    if (main->arity != 0) {
+        auto const& at = main->clauses.front();
+        throw semantic_error{static_cast<std::size_t>(at.line + main->line_deltas.front()), at.col, "main cannot take parameters"};
+    }
+
+    value result;
+    auto evaluate_main = [&]{ result = e.call("main", {}); };
+    on_evaluation_stack(l, evaluate_main);
+    if (memo_stats && e.memoized()) {
+        memo_stats->merge(e.memoized()->stats());
+    }
+    out << result << '\n';
+}
+
+} // namespace eval
+} // namespace templa
@@ -0,0 +1,244 @@
+#if !defined TEMPLA_EVALUATOR_HPP_INCLUDED
+#define      TEMPLA_EVALUATOR_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <ostream>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <boost/variant/variant.hpp>
+#include <boost/utility/string_ref.hpp>
+
+#include "ast.hpp"
+#include "semantic.hpp"
+#include "diagnostics.hpp"
+
+namespace templa {
+namespace eval {
+
+class list;
+class memo_table;
+struct location;
+struct memo_statistics;
+
+// A value of templa.  Integers, chars and bools are distinct types, as
+// mpl::int_, mpl::char_ and mpl::bool_ are in the MPL output.
+using value = boost::variant<int, char, bool, std::string, list>;
+
+// Immutable list whose elements are shared between copies, so that binding
+// the rest of a list_match copies nothing
+class list {
+public:
+    list() = default;
+    explicit list(std::vector<value> elements);
+
+    value const* begin() const;
+    value const* end() const;
+
+    std::size_t size() const
+    {
+        return length;
+    }
+
+    bool empty() const
+    {
+        return length == 0;
+    }
+
+    value const& operator[](std::size_t const i) const
+    {
+        return begin()[i];
+    }
+
+    // The elements after the first n
+    list drop(std::size_t const n) const;
+
+private:
+    std::shared_ptr<std::vector<value> const> elements;
+    std::size_t first = 0;
+    std::size_t length = 0;
+};
+
+// Whether the values have the same type and the same contents, like types
+// in equal<> of the MPL output
+bool equal(value const& lhs, value const& rhs);
+
+// Hash of the type and the contents, consistent with equal()
+std::size_t hash(value const& v);
+
+// Writes v as print() of the C++ output does, e.g. [1, 'a', "s"] as [1, a, s]
+std::ostream &operator<<(std::ostream &out, value const& v);
+
+// "Int", "Char", "Bool", "String" or "List", as in a type_match
+char const* type_name(value const& v);
+
+// A program which is meaningful, but whose evaluation fails, e.g. a call
+// which no clause matches
+class evaluation_error : public std::runtime_error {
+public:
+    evaluation_error(std::size_t const line, std::size_t const col, std::string const& message)
+        : std::runtime_error(syntax::format_diagnostic(line, col, message)), line(line), col(col), message(message)
+    {}
+
+    std::size_t const line, col;
+    std::string const message;
+};
+
+// An evaluation which took more steps, nested calls more deeply or built a
+// larger string or list than its limits allow, or whose calls and
+// expressions nest too deeply for the stack
+class limit_exceeded : public evaluation_error {
+public:
+    using evaluation_error::evaluation_error;
+};
+
+struct limits {
+    // Calls of functions, builtins included, and elements of ranges
+    std::size_t steps = 1000000;
+    // Calls in progress at once.  The evaluator recurses on the C++ stack,
+    // and throws limit_exceeded before it overflows the stack of the calling
+    // thread, which run() sizes by this.
+    std::size_t depth = 1000;
+    // Chars of a string or elements of a list
+    std::size_t length = 1u << 20;
+    // Results of calls of top-level functions which are remembered and
+    // reused, 0 for none.  See memo_table.
+    std::size_t memo = 0;
+};
+
+// Evaluates templa expressions directly on the AST.
+//
+// Note:
+// The value of an expression is what ::type of its type is in the MPL
+// output.  Only a clause which a call uses is evaluated, and only the branch
+// of if and case which is taken.  Clauses with patterns are tried in the
+// order of their declaration before the general clause; unlike partial
+// specializations, two clauses which match the same arguments are not an
+// error.
+//
+// Throws semantic::semantic_error if a name is undeclared or a call has the
+// wrong number of arguments, evaluation_error if a call matches no clause or
+// an operator is applied to values of the wrong type, and limit_exceeded if
+// the limits are reached.
+class evaluator {
+public:
+    evaluator(ast::ast const& a, limits const& l = {});
+    ~evaluator();
+
+    // Functions declared at the top level
+    semantic::function_table const& functions() const
+    {
+        return top_level;
+    }
+
+    // Calls the top-level function named name
+    value call(boost::string_ref const name, std::vector<value> const& args);
+
+    // The value of an expression, primary_expression or func_call node which
+    // only refers to top-level functions and builtins.  Its lines are off by
+    // line_delta, as in the run of its declaration.
+    value evaluate(ast::ast_node const& node, std::int64_t const line_delta);
+
+    // Steps taken since the construction or reset_steps()
+    std::size_t steps() const
+    {
+        return taken;
+    }
+
+    void reset_steps()
+    {
+        taken = 0;
+    }
+
+    // Following evaluations record each distinct call of a templa function by
+    // the function and its arguments.  The MPL output would instantiate a
+    // class template for each of them.
+    void count_calls()
+    {
+        counting = true;
+    }
+
+    std::size_t distinct_calls() const
+    {
+        return distinct.size();
+    }
+
+    // The results remembered by the limits, or null
+    memo_table const* memoized() const
+    {
+        return memo.get();
+    }
+
+private:
+    struct frame;
+    struct callee;
+
+    struct call_key {
+        semantic::function const* function;
+        std::vector<value> args;
+    };
+
+    struct call_key_hash {
+        std::size_t operator()(call_key const& k) const;
+    };
+
+    struct call_key_equal {
+        bool operator()(call_key const& lhs, call_key const& rhs) const;
+    };
+
+    callee resolve(frame const& env, ast::identifier const name) const;
+    value apply(callee const& f, std::vector<value> &args, ast::ast_node const& at);
+    value apply_clauses(callee const& f, std::vector<value> const& args, ast::ast_node const& at);
+    bool match(ast::ast_node const& param, value const& arg, frame &bound, ast::identifier const function_name);
+
+    value evaluate_expression(ast::ast_node const& node, frame const& env);
+    value evaluate_primary(ast::ast_node const& node, frame const& env);
+    value evaluate_formula(ast::ast_node const& node, frame const& env);
+    value evaluate_term(ast::ast_node const& node, frame const& env);
+    value evaluate_factor(ast::ast_node const& node, frame const& env);
+    value evaluate_constant(ast::ast_node const& node, frame const& env);
+    value evaluate_call(ast::ast_node const& node, frame const& env);
+
+    // The position of a node of the clause being evaluated in the source
+    location where(ast::ast_node const& node) const;
+
+    void step(ast::ast_node const& at, std::size_t const n = 1);
+    void check_length(ast::ast_node const& at, std::size_t const length) const;
+    void check_stack(ast::ast_node const& at) const;
+
+    semantic::function_table const top_level;
+    limits const bounds;
+    std::size_t taken = 0;
+    std::size_t depth = 0;
+    // The lowest address of the stack of the calling thread which the
+    // evaluation may use
+    char const* stack_floor = nullptr;
+    // Of the clause being evaluated
+    std::int64_t line_delta = 0;
+    // Functions of each let, built when it is first evaluated
+    std::unordered_map<ast::let_expression const*, std::unique_ptr<semantic::function_table const>> let_functions;
+    bool counting = false;
+    std::unordered_set<call_key, call_key_hash, call_key_equal> distinct;
+    std::unique_ptr<memo_table> const memo;
+};
+
+// Calls f on a new thread with a stack for l.depth nested calls of an
+// evaluator, and rethrows what f throws
+void on_evaluation_stack(limits const& l, std::function<void()> const& f);
+
+// Writes the value of main, which takes no parameters, into out as the C++
+// program generated from a prints it.  The evaluation runs on the stack of
+// on_evaluation_stack().  The hits and misses of l.memo are
+// added to memo_stats if it is given.
+void run(std::ostream &out, ast::ast const& a, limits const& l = {}, memo_statistics *const memo_stats = nullptr);
+
+} // namespace eval
+} // namespace templa
+
+#endif    // TEMPLA_EVALUATOR_HPP_INCLUDED
@@ -0,0 +1,392 @@
+#include <algorithm>
+
+#include <boost/mpl/size.hpp>
+#include <boost/variant/static_visitor.hpp>
+#include <boost/variant/get.hpp>
+
+#include "flat_ast.hpp"
+
+namespace templa {
+namespace ast {
+
+char const* symbol_of(node_kind const kind)
+{
+    static char const* const symbols[] = {
+        program::symbol,
+        decl_func::symbol,
+        decl_params::symbol,
+        decl_param::symbol,
+        list_match::symbol,
+        type_match::symbol,
+        expression::symbol,
+        let_expression::symbol,
+        if_expression::symbol,
+        case_expression::symbol,
+        case_when::symbol,
+        primary_expression::symbol,
+        formula::symbol,
+        term::symbol,
+        factor::symbol,
+        relational_operator::symbol,
+        additive_operator::symbol,
+        mult_operator::symbol,
+        constant::symbol,
+        list::symbol,
+        enum_list::symbol,
+        int_list::symbol,
+        char_list::symbol,
+        func_call::symbol,
+        call_args::symbol,
+    };
+    return symbols[static_cast<std::size_t>(kind)];
+}
+
+namespace {
+
+static_assert(
+    boost::mpl::size<ast_node::value_type::types>::value == static_cast<std::size_t>(node_kind::call_args) + 1,
+    "node_kind must have an enumerator for each bounded type of ast_node::value_type"
+);
+
+using index = flat_ast::index;
+
+class flattener {
+public:
+    explicit flattener(flat_ast &f)
+        : flat(f)
+    {}
+
+    index emit(ast_node const& node);
+
+private:
+    struct node_visitor;
+
+    // Reserves contiguous slots for the children of node i and fills them.
+    // Grandchildren are emitted after the reserved slots, so the children of
+    // each node stay contiguous.
+    template<class... Ranges>
+    void emit_children(index const i, Ranges const&... ranges)
+    {
+        std::size_t const count = sum_sizes(ranges...);
+        index const begin = flat.children.size();
+        flat.children.resize(begin + count);
+        flat.child_begin[i] = begin;
+        flat.child_end[i] = begin + count;
+        index slot = begin;
+        fill(slot, ranges...);
+    }
+
+    static std::size_t sum_sizes()
+    {
+        return 0;
+    }
+
+    template<class Range, class... Ranges>
+    static std::size_t sum_sizes(Range const& r, Ranges const&... rs)
+    {
+        return size_of(r) + sum_sizes(rs...);
+    }
+
+    static std::size_t size_of(node_list const& v)
+    {
+        return v.size();
+    }
+
+    static std::size_t size_of(declaration_runs const& runs)
+    {
+        return count_declarations(runs);
+    }
+
+    static std::size_t size_of(boost::optional<ast_node> const& o)
+    {
+        return o ? 1 : 0;
+    }
+
+    static std::size_t size_of(ast_node const&)
+    {
+        return 1;
+    }
+
+    void fill(index &)
+    {}
+
+    template<class Range, class... Ranges>
+    void fill(index &slot, Range const& r, Ranges const&... rs)
+    {
+        fill_one(slot, r);
+        fill(slot, rs...);
+    }
+
+    void fill_one(index &slot, node_list const& v)
+    {
+        for (auto const& n : v) {
+            fill_one(slot, n);
+        }
+    }
+
+    // Nodes are flattened at their lines in the source
+    void fill_one(index &slot, declaration_runs const& runs)
+    {
+        for (auto const& r : runs) {
+            line_delta = r.line_delta;
+            fill_one(slot, r.declarations);
+        }
+        line_delta = 0;
+    }
+
+    void fill_one(index &slot, boost::optional<ast_node> const& o)
+    {
+        if (o) {
+            fill_one(slot, *o);
+        }
+    }
+
+    void fill_one(index &slot, ast_node const& n)
+    {
+        auto const child = emit(n);
+        flat.children[slot++] = child;
+    }
+
+    index add_name(boost::string_ref const name)
+    {
+        flat.names.push_back(name.to_string());
+        return flat.names.size() - 1;
+    }
+
+    index add_name(identifier const name)
+    {
+        return add_name(name.text());
+    }
+
+    index add_integer(int const i)
+    {
+        flat.integers.push_back(i);
+        return flat.integers.size() - 1;
+    }
+
+    flat_ast &flat;
+
+    // Of the run of the declaration being flattened
+    std::int64_t line_delta = 0;
+};
+
+struct flattener::node_visitor : boost::static_visitor<void> {
+    node_visitor(flattener &f, index const i)
+        : f(f), i(i)
+    {}
+
+    void operator()(program const& node) const
+    {
+        f.emit_children(i, node.function_declarations);
+    }
+
+    void operator()(decl_func const& node) const
+    {
+        f.flat.payloads[i] = f.add_name(node.function_name);
+        f.emit_children(i, node.maybe_declaration_params, node.expression);
+    }
+
+    void operator()(decl_params const& node) const
+    {
+        f.emit_children(i, node.declaration_params);
+    }
+
+    void operator()(decl_param const& node) const
+    {
+        if (auto const n = boost::get<ast_node>(&node.value)) {
+            f.emit_children(i, *n);
+        } else {
+            f.flat.flags[i] = 1;
+            f.flat.payloads[i] = f.add_name(boost::get<identifier>(node.value));
+        }
+    }
+
+    void operator()(list_match const& node) const
+    {
+        index const first = f.flat.names.size();
+        for (auto const& e : node.elements) {
+            f.add_name(e);
+        }
+        f.add_name(node.rest_elems_name);
+        f.flat.name_lists.push_back({first, static_cast<index>(node.elements.size() + 1)});
+        f.flat.payloads[i] = f.flat.name_lists.size() - 1;
+    }
+
+    void operator()(type_match const& node) const
+    {
+        f.flat.payloads[i] = f.add_name(node.param_name);
+        f.add_name(node.type_name);
+    }
+
+    void operator()(expression const& node) const
+    {
+        f.emit_children(i, node.value);
+    }
+
+    void operator()(let_expression const& node) const
+    {
+        f.emit_children(i, node.function_declarations, node.body);
+    }
+
+    void operator()(if_expression const& node) const
+    {
+        f.emit_children(i, node.condition, node.expression_if_true, node.expression_if_false);
+    }
+
+    void operator()(case_expression const& node) const
+    {
+        f.emit_children(i, node.case_when, node.otherwise_expression);
+    }
+
+    void operator()(case_when const& node) const
+    {
+        f.emit_children(i, node.condition, node.then_expression);
+    }
+
+    void operator()(primary_expression const& node) const
+    {
+        f.emit_children(i, node.formulae, node.operators);
+    }
+
+    void operator()(formula const& node) const
+    {
+        f.flat.flags[i] = node.maybe_sign ? static_cast<std::uint8_t>(*node.maybe_sign) : 0;
+        f.emit_children(i, node.terms, node.operators);
+    }
+
+    void operator()(term const& node) const
+    {
+        f.emit_children(i, node.factors, node.operators);
+    }
+
+    void operator()(factor const& node) const
+    {
+        f.emit_children(i, node.value);
+    }
+
+    void operator()(relational_operator const& node) const
+    {
+        f.flat.payloads[i] = f.add_name(node.value);
+    }
+
+    void operator()(additive_operator const& node) const
+    {
+        f.flat.payloads[i] = f.add_name(node.value);
+    }
+
+    void operator()(mult_operator const& node) const
+    {
+        f.flat.payloads[i] = f.add_name(node.value);
+    }
+
+    void operator()(constant const& node) const
+    {
+        f.flat.flags[i] = node.value.which();
+        if (auto const v = boost::get<int>(&node.value)) {
+            f.flat.payloads[i] = f.add_integer(*v);
+        } else if (auto const c = boost::get<char>(&node.value)) {
+            f.flat.payloads[i] = static_cast<unsigned char>(*c);
+        } else if (auto const b = boost::get<bool>(&node.value)) {
+            f.flat.payloads[i] = *b;
+        } else if (auto const s = boost::get<boost::string_ref>(&node.value)) {
+            f.flat.payloads[i] = f.add_name(*s);
+        } else {
+            f.emit_children(i, boost::get<ast_node>(node.value));
+        }
+    }
+
+    void operator()(list const& node) const
+    {
+        f.emit_children(i, node.value);
+    }
+
+    void operator()(enum_list const& node) const
+    {
+        f.emit_children(i, node.elements);
+    }
+
+    void operator()(int_list const& node) const
+    {
+        f.flat.payloads[i] = f.add_integer(node.min);
+        f.add_integer(node.max);
+    }
+
+    void operator()(char_list const& node) const
+    {
+        f.flat.payloads[i] = static_cast<unsigned char>(node.begin)
+                           | static_cast<unsigned char>(node.end) << 8;
+    }
+
+    void operator()(func_call const& node) const
+    {
+        f.flat.payloads[i] = f.add_name(node.function_name);
+        f.emit_children(i, node.maybe_call_arguments);
+    }
+
+    void operator()(call_args const& node) const
+    {
+        f.emit_children(i, node.arguments);
+    }
+
+    flattener &f;
+    index const i;
+};
+
+index flattener::emit(ast_node const& node)
+{
+    index const i = flat.kinds.size();
+    flat.kinds.push_back(static_cast<node_kind>(node.value.which()));
+    flat.flags.push_back(0);
+    flat.payloads.push_back(0);
+    flat.child_begin.push_back(0);
+    flat.child_end.push_back(0);
+    flat.lines.push_back(static_cast<std::uint32_t>(node.line + line_delta));
+    flat.cols.push_back(node.col);
+    visit(node_visitor{*this, i}, node);
+    return i;
+}
+
+} // namespace
+
+flat_ast flatten(ast const& a)
+{
+    flat_ast result;
+    flattener{result}.emit(a.root);
+    return result;
+}
+
+std::vector<std::uint32_t> node_depths(flat_ast const& f)
+{
+    std::vector<std::uint32_t> depths(f.size(), 0);
+    for_each_node(f, [&](index const i){
+        for (auto const c : f.children_of(i)) {
+            depths[c] = depths[i] + 1;
+        }
+    });
+    return depths;
+}
+
+bool flat_ast::operator==(flat_ast const& rhs) const
+{
+    // Both sides are laid out in preorder, so equal trees have identical
+    // columns and side tables.
+    return kinds == rhs.kinds
+        && flags == rhs.flags
+        && payloads == rhs.payloads
+        && child_begin == rhs.child_begin
+        && child_end == rhs.child_end
+        && children == rhs.children
+        && integers == rhs.integers
+        && names == rhs.names
+        && std::equal(std::begin(name_lists), std::end(name_lists),
+                      std::begin(rhs.name_lists), std::end(rhs.name_lists),
+                      [](auto const& l, auto const& r){ return l.first == r.first && l.size == r.size; });
+}
+
+bool flat_ast::operator!=(flat_ast const& rhs) const
+{
+    return !(*this == rhs);
+}
+
+} // namespace ast
+} // namespace templa
@@ -0,0 +1,142 @@
+#if !defined TEMPLA_FLAT_AST_HPP_INCLUDED
+#define      TEMPLA_FLAT_AST_HPP_INCLUDED
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+#include <boost/range/iterator_range.hpp>
+
+#include "ast.hpp"
+
+namespace templa {
+namespace ast {
+
+// Same order as the bounded types of ast_node::value_type
+enum class node_kind : std::uint8_t {
+    program,
+    decl_func,
+    decl_params,
+    decl_param,
+    list_match,
+    type_match,
+    expression,
+    let_expression,
+    if_expression,
+    case_expression,
+    case_when,
+    primary_expression,
+    formula,
+    term,
+    factor,
+    relational_operator,
+    additive_operator,
+    mult_operator,
+    constant,
+    list,
+    enum_list,
+    int_list,
+    char_list,
+    func_call,
+    call_args,
+};
+
+char const* symbol_of(node_kind const kind);
+
+// Index based representation of an AST stored as struct-of-arrays.
+//
+// Nodes are stored in preorder, so the root is node 0, a parent always
+// precedes its children and scanning the columns from the front visits the
+// tree depth first.  The children of node i are
+// children[child_begin[i]] ... children[child_end[i] - 1].
+//
+// What payload and flags mean depends on the kind of the node:
+//
+//   decl_func           payload: names index of the function name
+//                       children: [decl_params] expression
+//   decl_param          flags: 1 if it is a bare name (payload: names index),
+//                       0 if it has one child
+//   list_match          payload: name_lists index.  The last name of the span
+//                       is the name of the rest elements
+//   type_match          payload: names index of the parameter name.  The type
+//                       name follows it
+//   let_expression      children: declarations... body
+//   case_expression     children: case_when... otherwise expression
+//   primary_expression  children: formulae... operators...
+//   formula             flags: sign character or 0
+//                       children: terms... operators...
+//   term                children: factors... operators...
+//   *_operator          payload: names index of the operator
+//   constant            flags: index of the alternative in constant::value
+//                       payload: integers index (int), the character (char),
+//                       0 or 1 (bool) or names index (string).  A list
+//                       constant has one child instead
+//   int_list            payload: integers index of min.  max follows it
+//   char_list           payload: begin | end << 8
+//   func_call           payload: names index of the function name
+//                       children: [call_args]
+//
+// Other kinds only have children.
+class flat_ast {
+public:
+    using index = std::uint32_t;
+
+    struct name_span {
+        index first;
+        index size;
+    };
+
+    std::vector<node_kind> kinds;
+    std::vector<std::uint8_t> flags;
+    std::vector<index> payloads;
+    std::vector<index> child_begin;
+    std::vector<index> child_end;
+    std::vector<std::uint32_t> lines;
+    std::vector<std::uint32_t> cols;
+
+    std::vector<index> children;
+
+    // Side tables
+    std::vector<std::string> names;
+    std::vector<int> integers;
+    std::vector<name_span> name_lists;
+
+    std::size_t size() const
+    {
+        return kinds.size();
+    }
+
+    boost::iterator_range<index const*> children_of(index const node) const
+    {
+        return {children.data() + child_begin[node], children.data() + child_end[node]};
+    }
+
+    std::size_t child_count(index const node) const
+    {
+        return child_end[node] - child_begin[node];
+    }
+
+    // Positions are ignored as ast::operator== does.
+    bool operator==(flat_ast const& rhs) const;
+    bool operator!=(flat_ast const& rhs) const;
+};
+
+flat_ast flatten(ast const& a);
+
+// Calls f(node_index) for each node in preorder.  This is a linear scan.
+template<class F>
+inline void for_each_node(flat_ast const& f, F &&func)
+{
+    for (flat_ast::index i = 0, size = f.size(); i < size; ++i) {
+        func(i);
+    }
+}
+
+// Depth of each node (the root is 0), computed in one linear pass.
+std::vector<std::uint32_t> node_depths(flat_ast const& f);
+
+} // namespace ast
+} // namespace templa
+
+#endif    // TEMPLA_FLAT_AST_HPP_INCLUDED
@@ -0,0 +1,161 @@
+#if !defined TEMPLA_HELPER_ARENA_HPP_INCLUDED
+#define      TEMPLA_HELPER_ARENA_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+#include <type_traits>
+
+namespace templa {
+namespace helper {
+
+// Whether arena must run the destructor of T.  Specialize this as false for
+// types whose destructor is not trivial but has no effect to release, to save
+// a cleanup record per object.
+template<class T>
+struct needs_cleanup : std::integral_constant<bool, !std::is_trivially_destructible<T>::value> {};
+
+// Bump allocator which owns every object created by make() and releases all
+// of them at once on destruction.  Destructors of non-trivially destructible
+// objects are run in reverse order of construction.
+class arena {
+    struct cleanup {
+        void (*destroy)(void *, std::size_t);
+        void *object;
+        std::size_t count;
+        cleanup *next;
+    };
+
+public:
+    explicit arena(std::size_t const block_size = 64 * 1024)
+        : block_size(block_size)
+    {}
+
+    arena(arena const&) = delete;
+    arena &operator=(arena const&) = delete;
+
+    ~arena()
+    {
+        for (auto c = cleanups; c; c = c->next) {
+            c->destroy(c->object, c->count);
+        }
+    }
+
+    void *allocate(std::size_t const size, std::size_t const align)
+    {
+        auto const offset = (align - reinterpret_cast<std::uintptr_t>(current) % align) % align;
+        if (current == nullptr || offset + size > static_cast<std::size_t>(limit - current)) {
+            grow(size + align);
+            return allocate(size, align);
+        }
+        auto const result = current + offset;
+        current = result + size;
+        used += size;
+        return result;
+    }
+
+    template<class T, class... Args>
+    T *make(Args &&... args)
+    {
+        auto const ptr = new (allocate(sizeof(T), alignof(T))) T{std::forward<Args>(args)...};
+        register_cleanup(ptr, 1, needs_cleanup<T>{});
+        ++objects;
+        return ptr;
+    }
+
+    // Value-initialized array of n objects
+    template<class T>
+    T *make_array(std::size_t const n)
+    {
+        if (n == 0) {
+            return nullptr;
+        }
+        auto const ptr = static_cast<T *>(allocate(sizeof(T) * n, alignof(T)));
+        for (std::size_t i = 0; i < n; ++i) {
+            new (ptr + i) T{};
+        }
+        register_cleanup(ptr, n, needs_cleanup<T>{});
+        return ptr;
+    }
+
+    // Copies [first, first + n) into the arena
+    template<class T>
+    T *copy_array(T const* const first, std::size_t const n)
+    {
+        if (n == 0) {
+            return nullptr;
+        }
+        auto const ptr = static_cast<T *>(allocate(sizeof(T) * n, alignof(T)));
+        std::uninitialized_copy(first, first + n, ptr);
+        register_cleanup(ptr, n, needs_cleanup<T>{});
+        return ptr;
+    }
+
+    // Keeps the dependency alive as long as this arena, for objects which
+    // refer into it (e.g. subtrees shared with another arena)
+    void retain(std::shared_ptr<void const> dependency)
+    {
+        dependencies.push_back(std::move(dependency));
+    }
+
+    std::size_t object_count() const
+    {
+        return objects;
+    }
+
+    std::size_t used_bytes() const
+    {
+        return used;
+    }
+
+    std::size_t block_count() const
+    {
+        return blocks.size();
+    }
+
+private:
+    void grow(std::size_t const min_size)
+    {
+        auto const size = min_size > block_size ? min_size : block_size;
+        blocks.emplace_back(new char[size]);
+        current = blocks.back().get();
+        limit = current + size;
+    }
+
+    template<class T>
+    void register_cleanup(T *const, std::size_t const, std::false_type)
+    {}
+
+    template<class T>
+    void register_cleanup(T *const ptr, std::size_t const count, std::true_type)
+    {
+        auto const c = new (allocate(sizeof(cleanup), alignof(cleanup))) cleanup{
+            [](void *p, std::size_t const n){
+                for (std::size_t i = 0; i < n; ++i) {
+                    static_cast<T *>(p)[i].~T();
+                }
+            },
+            ptr,
+            count,
+            cleanups
+        };
+        cleanups = c;
+    }
+
+    std::size_t block_size;
+    std::vector<std::unique_ptr<char[]>> blocks;
+    std::vector<std::shared_ptr<void const>> dependencies;
+    char *current = nullptr;
+    char *limit = nullptr;
+    cleanup *cleanups = nullptr;
+    std::size_t objects = 0;
+    std::size_t used = 0;
+};
+
+} // namespace helper
+} // namespace templa
+
+#endif    // TEMPLA_HELPER_ARENA_HPP_INCLUDED
@@ -0,0 +1,59 @@
+#if !defined TEMPLA_HELPER_POSITION_ITERATOR_HPP_INCLUDED
+#define      TEMPLA_HELPER_POSITION_ITERATOR_HPP_INCLUDED
+
+#include <cstddef>
+
+#include <boost/iterator/iterator_adaptor.hpp>
+
+namespace templa {
+namespace helper {
+
+// Forward iterator adaptor which counts lines and columns while it advances.
+// Querying the position of the iterator is O(1).
+template<class Iterator>
+class position_iterator
+    : public boost::iterator_adaptor<
+        position_iterator<Iterator>,
+        Iterator,
+        boost::use_default,
+        boost::forward_traversal_tag
+    > {
+    friend class boost::iterator_core_access;
+
+public:
+    position_iterator() = default;
+
+    explicit position_iterator(Iterator const& it, std::size_t const line = 1, std::size_t const col = 1)
+        : position_iterator::iterator_adaptor_(it), current_line(line), current_col(col)
+    {}
+
+    std::size_t line() const
+    {
+        return current_line;
+    }
+
+    std::size_t col() const
+    {
+        return current_col;
+    }
+
+private:
+    void increment()
+    {
+        if (*this->base_reference() == '\n') {
+            ++current_line;
+            current_col = 1;
+        } else {
+            ++current_col;
+        }
+        ++this->base_reference();
+    }
+
+    std::size_t current_line = 1;
+    std::size_t current_col = 1;
+};
+
+} // namespace helper
+} // namespace templa
+
+#endif    // TEMPLA_HELPER_POSITION_ITERATOR_HPP_INCLUDED
@@ -0,0 +1,102 @@
+#include <cstring>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "helper/source_buffer.hpp"
+
+namespace templa {
+namespace helper {
+
+std::shared_ptr<source_buffer const> source_buffer::map_file(std::string const& file_name)
+{
+    int const fd = ::open(file_name.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    struct ::stat st;
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    auto const size = static_cast<std::size_t>(st.st_size);
+    if (size == 0) {
+        // mmap() rejects an empty mapping
+        ::close(fd);
+        return copy_of("");
+    }
+
+    void *const mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // Note: The mapping stays valid after the descriptor is closed.
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        return nullptr;
+    }
+    ::madvise(mapping, size, MADV_SEQUENTIAL);
+
+    return std::make_shared<source_buffer>(private_tag{}, static_cast<char const*>(mapping), size, true);
+}
+
+std::shared_ptr<source_buffer const> source_buffer::read_file(std::string const& file_name)
+{
+    int const fd = ::open(file_name.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    struct ::stat st;
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    auto const size = static_cast<std::size_t>(st.st_size);
+    std::unique_ptr<char[]> text{new char[size + 1]};
+    std::size_t done = 0;
+    while (done < size) {
+        auto const n = ::read(fd, text.get() + done, size - done);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        done += n;
+    }
+    ::close(fd);
+    if (done != size) {
+        // Truncated while it was read
+        return nullptr;
+    }
+    text[size] = '\0';
+
+    return std::make_shared<source_buffer>(private_tag{}, text.release(), size, false);
+}
+
+std::shared_ptr<source_buffer const> source_buffer::copy_of(std::string const& code)
+{
+    auto const copy = new char[code.size() + 1];
+    std::memcpy(copy, code.c_str(), code.size() + 1);
+    return std::make_shared<source_buffer>(private_tag{}, copy, code.size(), false);
+}
+
+source_buffer::source_buffer(private_tag, char const* const data, std::size_t const size, bool const mapped)
+    : first(data), length(size), mapped(mapped)
+{}
+
+source_buffer::~source_buffer()
+{
+    if (mapped) {
+        ::munmap(const_cast<char *>(first), length);
+    } else {
+        delete[] first;
+    }
+}
+
+} // namespace helper
+} // namespace templa
@@ -0,0 +1,60 @@
+#if !defined TEMPLA_HELPER_SOURCE_BUFFER_HPP_INCLUDED
+#define      TEMPLA_HELPER_SOURCE_BUFFER_HPP_INCLUDED
+
+#include <cstddef>
+#include <string>
+#include <memory>
+
+namespace templa {
+namespace helper {
+
+// Read-only, contiguous source text.  A buffer made by map_file() is backed by
+// a private memory mapping of the file, so loading never copies the text and
+// pages are read on demand.  Operators and string literals in an AST refer
+// into the buffer it was parsed from.
+class source_buffer {
+    struct private_tag {};
+
+public:
+    // Returns nullptr if the file cannot be opened or mapped.
+    static std::shared_ptr<source_buffer const> map_file(std::string const& file_name);
+
+    // Reads the file into memory owned by the buffer, so that the text stays
+    // the same even if the file is rewritten in place.  Returns nullptr if the
+    // file cannot be read.
+    static std::shared_ptr<source_buffer const> read_file(std::string const& file_name);
+
+    // Copies code.  This is meant for small inputs.
+    static std::shared_ptr<source_buffer const> copy_of(std::string const& code);
+
+    source_buffer(private_tag, char const* const data, std::size_t const size, bool const mapped);
+    ~source_buffer();
+
+    source_buffer(source_buffer const&) = delete;
+    source_buffer &operator=(source_buffer const&) = delete;
+
+    char const* begin() const
+    {
+        return first;
+    }
+
+    char const* end() const
+    {
+        return first + length;
+    }
+
+    std::size_t size() const
+    {
+        return length;
+    }
+
+private:
+    char const* const first;
+    std::size_t const length;
+    bool const mapped;
+};
+
+} // namespace helper
+} // namespace templa
+
+#endif    // TEMPLA_HELPER_SOURCE_BUFFER_HPP_INCLUDED
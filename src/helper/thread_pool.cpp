@@ -0,0 +1,114 @@
+#include <algorithm>
+
+#include "thread_pool.hpp"
+
+namespace templa {
+namespace helper {
+
+thread_pool::thread_pool(std::size_t num_threads)
+{
+    if (num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads.reserve(num_threads - 1);
+    for (std::size_t worker = 1; worker < num_threads; ++worker) {
+        threads.emplace_back([this, worker]{ work(worker); });
+    }
+}
+
+thread_pool::~thread_pool()
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        stopping = true;
+    }
+    started.notify_all();
+    for (auto &t : threads) {
+        t.join();
+    }
+}
+
+bool thread_pool::steal(share *const shares, std::size_t const thief) const
+{
+    auto const num_workers = size();
+    for (std::size_t k = 1; k < num_workers; ++k) {
+        auto &victim = shares[(thief + k) % num_workers];
+        std::size_t begin, end;
+        {
+            std::lock_guard<std::mutex> lock{victim.mutex};
+            if (victim.begin == victim.end) {
+                continue;
+            }
+            begin = victim.begin + (victim.end - victim.begin) / 2;
+            end = victim.end;
+            victim.end = begin;
+        }
+        std::lock_guard<std::mutex> lock{shares[thief].mutex};
+        shares[thief].begin = begin;
+        shares[thief].end = end;
+        return true;
+    }
+    return false;
+}
+
+void thread_pool::run(std::function<void(std::size_t)> const& job)
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        current_job = &job;
+        running = threads.size();
+        ++generation;
+        error = nullptr;
+    }
+    started.notify_all();
+
+    try {
+        job(0);
+    } catch (...) {
+        std::lock_guard<std::mutex> lock{mutex};
+        if (!error) {
+            error = std::current_exception();
+        }
+    }
+
+    std::unique_lock<std::mutex> lock{mutex};
+    finished.wait(lock, [this]{ return running == 0; });
+    current_job = nullptr;
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void thread_pool::work(std::size_t const worker)
+{
+    std::size_t seen = 0;
+    for (;;) {
+        std::function<void(std::size_t)> const* job;
+        {
+            std::unique_lock<std::mutex> lock{mutex};
+            started.wait(lock, [&]{ return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+            job = current_job;
+        }
+
+        try {
+            (*job)(worker);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock{mutex};
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+
+        std::lock_guard<std::mutex> lock{mutex};
+        if (--running == 0) {
+            finished.notify_one();
+        }
+    }
+}
+
+} // namespace helper
+} // namespace templa
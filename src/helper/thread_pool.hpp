@@ -0,0 +1,104 @@
+#if !defined TEMPLA_HELPER_THREAD_POOL_HPP_INCLUDED
+#define      TEMPLA_HELPER_THREAD_POOL_HPP_INCLUDED
+
+#include <cstddef>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <vector>
+#include <memory>
+
+namespace templa {
+namespace helper {
+
+// Fixed set of threads which run parallel loops.  The calling thread takes
+// part in each loop as worker 0, so a pool of size 1 starts no thread.
+class thread_pool {
+public:
+    // 0 means the number of hardware threads
+    explicit thread_pool(std::size_t num_threads = 0);
+    ~thread_pool();
+
+    thread_pool(thread_pool const&) = delete;
+    thread_pool &operator=(thread_pool const&) = delete;
+
+    // Number of workers including the calling thread
+    std::size_t size() const
+    {
+        return threads.size() + 1;
+    }
+
+    // Calls f(i, worker) for each i in [0, n) and returns when all calls have
+    // finished.  worker is in [0, size()) and no two calls with the same
+    // worker run at once, so it can index per-worker state.  If calls throw,
+    // the first exception is rethrown after the loop.
+    //
+    // Each worker starts with an equal share of the indices and takes them
+    // from the front of its share.  A worker whose share runs out steals the
+    // back half of the share of another one, so uneven calls are balanced
+    // without a queue shared by all workers.
+    template<class F>
+    void parallel_for(std::size_t const n, F const& f)
+    {
+        auto const num_workers = size();
+        std::unique_ptr<share[]> shares{new share[num_workers]};
+        for (std::size_t w = 0; w < num_workers; ++w) {
+            shares[w].begin = n * w / num_workers;
+            shares[w].end = n * (w + 1) / num_workers;
+        }
+
+        run([&](std::size_t const worker){
+            for (;;) {
+                std::size_t i;
+                if (shares[worker].take(i)) {
+                    f(i, worker);
+                } else if (!steal(shares.get(), worker)) {
+                    return;
+                }
+            }
+        });
+    }
+
+private:
+    // Indices [begin, end) left to a worker
+    struct share {
+        std::mutex mutex;
+        std::size_t begin = 0;
+        std::size_t end = 0;
+
+        bool take(std::size_t &i)
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            if (begin == end) {
+                return false;
+            }
+            i = begin++;
+            return true;
+        }
+    };
+
+    // Moves the back half of the share of another worker into the empty
+    // share of thief.  Returns false if all shares are empty.
+    bool steal(share *const shares, std::size_t const thief) const;
+
+    // Runs job(worker) on every worker and waits for all of them
+    void run(std::function<void(std::size_t)> const& job);
+    void work(std::size_t const worker);
+
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable started, finished;
+    std::function<void(std::size_t)> const* current_job = nullptr;
+    std::size_t generation = 0;
+    std::size_t running = 0;
+    bool stopping = false;
+    std::exception_ptr error;
+};
+
+} // namespace helper
+} // namespace templa
+
+#endif    // TEMPLA_HELPER_THREAD_POOL_HPP_INCLUDED
@@ -0,0 +1,221 @@
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include "identifier.hpp"
+#include "helper/arena.hpp"
+
+namespace templa {
+namespace ast {
+
+namespace {
+
+struct slot {
+    std::size_t hash;
+    std::uint32_t id;
+};
+
+constexpr std::uint32_t none = ~std::uint32_t{0};
+
+// FNV-1a
+std::size_t hash_of(boost::string_ref const name)
+{
+    std::uint64_t h = 14695981039346656037ull;
+    for (auto const c : name) {
+        h = (h ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+    }
+    return static_cast<std::size_t>(h);
+}
+
+// Open addressing index from names to ids, whose text is looked up by
+// text_of
+template<class TextOf>
+class name_index {
+public:
+    explicit name_index(TextOf const& text_of)
+        : slots(1024, slot{0, none}), text_of(text_of)
+    {}
+
+    // The slot of name, or the empty slot where it belongs
+    slot &find(boost::string_ref const name, std::size_t const hash)
+    {
+        auto const mask = slots.size() - 1;
+        for (auto i = hash & mask;; i = (i + 1) & mask) {
+            auto &s = slots[i];
+            if (s.id == none || (s.hash == hash && text_of(s.id) == name)) {
+                return s;
+            }
+        }
+    }
+
+    // Fills the empty slot which find() returned
+    void add(slot &empty, std::size_t const hash, std::uint32_t const id)
+    {
+        empty = {hash, id};
+        if (++count * 2 > slots.size()) {
+            rehash();
+        }
+    }
+
+    std::size_t size() const
+    {
+        return count;
+    }
+
+private:
+    void rehash()
+    {
+        std::vector<slot> larger(slots.size() * 2, slot{0, none});
+        auto const mask = larger.size() - 1;
+        for (auto const& s : slots) {
+            if (s.id == none) {
+                continue;
+            }
+            auto i = s.hash & mask;
+            while (larger[i].id != none) {
+                i = (i + 1) & mask;
+            }
+            larger[i] = s;
+        }
+        slots.swap(larger);
+    }
+
+    std::vector<slot> slots;
+    std::size_t count = 0;
+    TextOf text_of;
+};
+
+// Names by id, which every thread shares so that ids are the same whichever
+// thread, parse or cached AST they come from.
+//
+// Note:
+// Names are only added, into chunks which never move, so text() reads an
+// id without locking: whoever holds an id got it from intern(), whose lock
+// orders the write of the name before.
+class symbol_table {
+    struct text_by_id {
+        symbol_table const* table;
+        boost::string_ref operator()(std::uint32_t const id) const
+        {
+            return table->text(id);
+        }
+    };
+
+public:
+    symbol_table()
+        : index(text_by_id{this})
+    {
+        intern("", hash_of(""));
+    }
+
+    ~symbol_table()
+    {
+        for (auto &c : chunks) {
+            delete[] c.load(std::memory_order_relaxed);
+        }
+    }
+
+    std::uint32_t intern(boost::string_ref const name, std::size_t const hash)
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        auto &s = index.find(name, hash);
+        if (s.id != none) {
+            return s.id;
+        }
+        auto const id = add(name);
+        index.add(s, hash, id);
+        return id;
+    }
+
+    boost::string_ref text(std::uint32_t const id) const
+    {
+        return chunks[id / chunk_size].load(std::memory_order_acquire)[id % chunk_size];
+    }
+
+    std::size_t size() const
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        return index.size();
+    }
+
+private:
+    static constexpr std::size_t chunk_size = 4096;
+    static constexpr std::size_t max_chunks = 16384;
+
+    std::uint32_t add(boost::string_ref const name)
+    {
+        auto const count = index.size();
+        if (count == chunk_size * max_chunks) {
+            throw std::length_error{"too many distinct names"};
+        }
+        auto const id = static_cast<std::uint32_t>(count);
+        auto &chunk = chunks[id / chunk_size];
+        if (id % chunk_size == 0) {
+            chunk.store(new boost::string_ref[chunk_size], std::memory_order_release);
+        }
+        auto const copied = texts.copy_array(name.data(), name.size());
+        chunk.load(std::memory_order_relaxed)[id % chunk_size] = {copied, name.size()};
+        return id;
+    }
+
+    mutable std::mutex mutex;
+    name_index<text_by_id> index;
+    std::atomic<boost::string_ref *> chunks[max_chunks] = {};
+    helper::arena texts;
+};
+
+symbol_table &symbols()
+{
+    static symbol_table table;
+    return table;
+}
+
+struct shared_text {
+    boost::string_ref operator()(std::uint32_t const id) const
+    {
+        return symbols().text(id);
+    }
+};
+
+// The ids of the names which the calling thread has interned.  A parse
+// looks each name up here without locking and only takes the lock of the
+// shared table for the first occurrence of a name in the thread, which then
+// merges it into this table.
+std::uint32_t intern(boost::string_ref const name)
+{
+    thread_local name_index<shared_text> local{shared_text{}};
+    auto const hash = hash_of(name);
+    auto &s = local.find(name, hash);
+    if (s.id != none) {
+        return s.id;
+    }
+    auto const id = symbols().intern(name, hash);
+    local.add(s, hash, id);
+    return id;
+}
+
+} // namespace
+
+identifier::identifier(boost::string_ref const name)
+    : index(intern(name))
+{}
+
+boost::string_ref identifier::text() const
+{
+    return symbols().text(index);
+}
+
+std::size_t identifier::interned()
+{
+    return symbols().size();
+}
+
+std::ostream &operator<<(std::ostream &out, identifier const i)
+{
+    return out << i.text();
+}
+
+} // namespace ast
+} // namespace templa
@@ -0,0 +1,91 @@
+#if !defined TEMPLA_IDENTIFIER_HPP_INCLUDED
+#define      TEMPLA_IDENTIFIER_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <ostream>
+#include <functional>
+
+#include <boost/utility/string_ref.hpp>
+
+namespace templa {
+namespace ast {
+
+// A name of a function, parameter or type, interned in the symbol table of
+// the process.  Identifiers of equal names have equal ids whichever source,
+// parse or thread they come from, so comparing and hashing them costs as
+// much as for an integer.
+//
+// Note:
+// Each thread interns into its own table of the names it has seen, without
+// locking.  Only the first occurrence of a name in a thread locks the table
+// of the process to get its id, so threads parsing in parallel hardly
+// contend.  The tables only grow, by the distinct names of the programs the
+// process parses.  Their text stays valid until the process exits.
+class identifier {
+public:
+    // The empty name
+    identifier() = default;
+
+    // Interns name.  It may be called from several threads at once.
+    explicit identifier(boost::string_ref const name);
+
+    std::uint32_t id() const
+    {
+        return index;
+    }
+
+    boost::string_ref text() const;
+
+    std::string to_string() const
+    {
+        return text().to_string();
+    }
+
+    bool empty() const
+    {
+        return index == 0;
+    }
+
+    // Distinct names interned so far, including the empty one
+    static std::size_t interned();
+
+private:
+    std::uint32_t index = 0;
+};
+
+inline bool operator==(identifier const lhs, identifier const rhs)
+{
+    return lhs.id() == rhs.id();
+}
+
+inline bool operator!=(identifier const lhs, identifier const rhs)
+{
+    return lhs.id() != rhs.id();
+}
+
+// By id, i.e. in the order of interning rather than of the names
+inline bool operator<(identifier const lhs, identifier const rhs)
+{
+    return lhs.id() < rhs.id();
+}
+
+std::ostream &operator<<(std::ostream &out, identifier const i);
+
+} // namespace ast
+} // namespace templa
+
+namespace std {
+
+template<>
+struct hash<templa::ast::identifier> {
+    std::size_t operator()(templa::ast::identifier const i) const
+    {
+        return i.id();
+    }
+};
+
+} // namespace std
+
+#endif    // TEMPLA_IDENTIFIER_HPP_INCLUDED
@@ -0,0 +1,149 @@
+#include <cstring>
+
+#include "lexer.hpp"
+
+namespace templa {
+namespace syntax {
+
+namespace {
+
+bool is_alpha(char const c)
+{
+    return ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') || c == '_';
+}
+
+bool is_digit(char const c)
+{
+    return '0' <= c && c <= '9';
+}
+
+} // namespace
+
+bool token::is_word(char const* const word) const
+{
+    auto const len = std::strlen(word);
+    return kind == token_kind::identifier && size() == len && std::memcmp(begin, word, len) == 0;
+}
+
+bool is_continuation_keyword(boost::string_ref const word)
+{
+    for (auto const keyword : {"in", "then", "else", "otherwise", "let", "if", "case"}) {
+        if (word == keyword) {
+            return true;
+        }
+    }
+    return false;
+}
+
+lexer::lexer(char const* const begin, char const* const end, std::uint32_t const line, std::uint32_t const col)
+    : current(begin), last(end), line(line), col(col)
+{}
+
+void lexer::advance()
+{
+    if (*current == '\n') {
+        ++line;
+        col = 1;
+    } else {
+        ++col;
+    }
+    ++current;
+}
+
+token lexer::scan()
+{
+    while (current != last && (*current == ' ' || *current == '\t')) {
+        advance();
+    }
+
+    token t{token_kind::end, current, current, line, col};
+    if (current == last) {
+        return t;
+    }
+
+    auto const single = [&](token_kind const k) {
+        advance();
+        t.kind = k;
+    };
+
+    // Scans an operator which may be followed by `second` to make a longer one
+    auto const one_or_two = [&](token_kind const one, char const second, token_kind const two) {
+        advance();
+        if (current != last && *current == second) {
+            advance();
+            t.kind = two;
+        } else {
+            t.kind = one;
+        }
+    };
+
+    char const c = *current;
+    if (is_alpha(c)) {
+        do {
+            advance();
+        } while (current != last && (is_alpha(*current) || is_digit(*current)));
+        t.kind = token_kind::identifier;
+    } else if (is_digit(c)) {
+        do {
+            advance();
+        } while (current != last && is_digit(*current));
+        t.kind = token_kind::integer;
+    } else {
+        switch (c) {
+        case '\n': single(token_kind::newline); break;
+        case '(': single(token_kind::left_paren); break;
+        case ')': single(token_kind::right_paren); break;
+        case '[': single(token_kind::left_bracket); break;
+        case ']': single(token_kind::right_bracket); break;
+        case ',': single(token_kind::comma); break;
+        case '+': single(token_kind::plus); break;
+        case '-': single(token_kind::minus); break;
+        case '*': single(token_kind::star); break;
+        case '/': single(token_kind::slash); break;
+        case '%': single(token_kind::percent); break;
+        case '=': one_or_two(token_kind::equal, '=', token_kind::equal_equal); break;
+        case ':': one_or_two(token_kind::colon, ':', token_kind::double_colon); break;
+        case '!': one_or_two(token_kind::bang, '=', token_kind::not_equal); break;
+        case '|': one_or_two(token_kind::pipe, '|', token_kind::double_pipe); break;
+        case '&': one_or_two(token_kind::ampersand, '&', token_kind::double_ampersand); break;
+        case '<': one_or_two(token_kind::less, '=', token_kind::less_equal); break;
+        case '>': one_or_two(token_kind::greater, '=', token_kind::greater_equal); break;
+        case '.':
+            one_or_two(token_kind::invalid, '.', token_kind::dot_dot);
+            break;
+        case '\'':
+            advance();
+            if (current != last) {
+                advance();
+            }
+            if (current != last && *current == '\'') {
+                advance();
+                t.kind = token_kind::character;
+            } else {
+                t.kind = token_kind::invalid;
+            }
+            break;
+        case '"':
+            advance();
+            while (current != last && *current != '"') {
+                advance();
+            }
+            if (current != last) {
+                advance();
+                t.kind = token_kind::string;
+            } else {
+                t.kind = token_kind::invalid;
+            }
+            break;
+        default:
+            single(token_kind::invalid);
+            break;
+        }
+    }
+
+    t.end = current;
+    return t;
+}
+
+} // namespace syntax
+} // namespace templa
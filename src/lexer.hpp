@@ -0,0 +1,123 @@
+#if !defined TEMPLA_LEXER_HPP_INCLUDED
+#define      TEMPLA_LEXER_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+
+#include <boost/utility/string_ref.hpp>
+
+namespace templa {
+namespace syntax {
+
+enum class token_kind : std::uint8_t {
+    identifier,
+    integer,
+    character,
+    string,
+    newline,
+    left_paren,
+    right_paren,
+    left_bracket,
+    right_bracket,
+    comma,
+    equal,
+    colon,
+    double_colon,
+    dot_dot,
+    plus,
+    minus,
+    star,
+    slash,
+    percent,
+    bang,
+    pipe,
+    double_pipe,
+    ampersand,
+    double_ampersand,
+    equal_equal,
+    not_equal,
+    less,
+    greater,
+    less_equal,
+    greater_equal,
+    end,
+    invalid,
+};
+
+struct token {
+    token_kind kind;
+    char const* begin;
+    char const* end;
+    std::uint32_t line;
+    std::uint32_t col;
+
+    std::size_t size() const
+    {
+        return end - begin;
+    }
+
+    // Refers into the source text
+    boost::string_ref text() const
+    {
+        return {begin, size()};
+    }
+
+    bool is(token_kind const k) const
+    {
+        return kind == k;
+    }
+
+    // True if this token is the identifier `word`
+    bool is_word(char const* const word) const;
+};
+
+// True if word is a keyword which may begin a line inside a declaration.
+// Both parsers take a line which begins with any other name at column 1 for
+// the beginning of a top-level declaration.
+bool is_continuation_keyword(boost::string_ref const word);
+
+// Splits a templa source into tokens on demand.  Blanks (spaces and tabs) are
+// skipped, newlines are tokens because they are significant in the grammar.
+// The lexer keeps a small ring buffer of tokens so that the parser can look
+// ahead by up to `max_lookahead` tokens.
+class lexer {
+public:
+    static std::size_t const max_lookahead = 8;
+
+    lexer(char const* const begin, char const* const end, std::uint32_t const line = 1, std::uint32_t const col = 1);
+
+    token const& peek(std::size_t const n = 0)
+    {
+        while (buffered <= n) {
+            buffer[(head + buffered) % max_lookahead] = scan();
+            ++buffered;
+        }
+        return buffer[(head + n) % max_lookahead];
+    }
+
+    token next()
+    {
+        auto const t = peek();
+        head = (head + 1) % max_lookahead;
+        --buffered;
+        return t;
+    }
+
+private:
+    token scan();
+    void advance();
+
+    char const* current;
+    char const* const last;
+    std::uint32_t line;
+    std::uint32_t col;
+
+    token buffer[max_lookahead];
+    std::size_t head = 0;
+    std::size_t buffered = 0;
+};
+
+} // namespace syntax
+} // namespace templa
+
+#endif    // TEMPLA_LEXER_HPP_INCLUDED
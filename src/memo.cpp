@@ -0,0 +1,96 @@
+#include <algorithm>
+
+#include <boost/functional/hash.hpp>
+
+#include "memo.hpp"
+
+namespace templa {
+namespace eval {
+
+void memo_statistics::merge(memo_statistics const& other)
+{
+    hits += other.hits;
+    misses += other.misses;
+    stores += other.stores;
+    evictions += other.evictions;
+}
+
+double memo_statistics::hit_rate() const
+{
+    auto const lookups = hits + misses;
+    return lookups == 0 ? 0.0 : static_cast<double>(hits) / lookups;
+}
+
+memo_table::memo_table(std::size_t const capacity)
+    : capacity(capacity)
+{}
+
+std::size_t memo_table::hash_of(void const* const function, value const* const args, std::size_t const n)
+{
+    auto seed = boost::hash<void const*>{}(function);
+    for (std::size_t i = 0; i < n; ++i) {
+        boost::hash_combine(seed, hash(args[i]));
+    }
+    return seed;
+}
+
+std::list<memo_table::entry>::iterator memo_table::lookup(
+    std::size_t const hash,
+    void const* const function,
+    value const* const args,
+    std::size_t const n
+)
+{
+    auto const range = index.equal_range(hash);
+    for (auto i = range.first; i != range.second; ++i) {
+        auto const& e = *i->second;
+        if (e.function == function && e.args.size() == n && std::equal(args, args + n, e.args.begin(), equal)) {
+            return i->second;
+        }
+    }
+    return entries.end();
+}
+
+value const* memo_table::find(void const* const function, value const* const args, std::size_t const n)
+{
+    auto const e = lookup(hash_of(function, args, n), function, args, n);
+    if (e == entries.end()) {
+        ++counts.misses;
+        return nullptr;
+    }
+    ++counts.hits;
+    entries.splice(entries.begin(), entries, e);
+    return &e->result;
+}
+
+void memo_table::store(void const* const function, value const* const args, std::size_t const n, value const& result)
+{
+    if (capacity == 0) {
+        return;
+    }
+
+    auto const h = hash_of(function, args, n);
+    if (lookup(h, function, args, n) != entries.end()) {
+        return;
+    }
+
+    if (entries.size() == capacity) {
+        auto const& oldest = entries.back();
+        auto const range = index.equal_range(oldest.hash);
+        for (auto i = range.first; i != range.second; ++i) {
+            if (&*i->second == &oldest) {
+                index.erase(i);
+                break;
+            }
+        }
+        entries.pop_back();
+        ++counts.evictions;
+    }
+
+    entries.push_front({h, function, std::vector<value>(args, args + n), result});
+    index.emplace(h, entries.begin());
+    ++counts.stores;
+}
+
+} // namespace eval
+} // namespace templa
@@ -0,0 +1,77 @@
+#if !defined TEMPLA_MEMO_HPP_INCLUDED
+#define      TEMPLA_MEMO_HPP_INCLUDED
+
+#include <cstddef>
+#include <list>
+#include <vector>
+#include <unordered_map>
+
+#include "evaluator.hpp"
+
+namespace templa {
+namespace eval {
+
+struct memo_statistics {
+    std::size_t hits = 0;
+    std::size_t misses = 0;
+    std::size_t stores = 0;
+    std::size_t evictions = 0;
+
+    void merge(memo_statistics const& other);
+
+    // Hits per lookup, 0 without lookups
+    double hit_rate() const;
+};
+
+// Results of calls of pure functions, keyed by the function and the values
+// of the arguments.  Least recently used results are forgotten first when
+// more than capacity are remembered.
+//
+// Note:
+// Keys hash lists and strings by their elements, as equal() compares them,
+// so a lookup costs as much as the arguments are long.  Templa functions
+// have no side effects, but one declared in a let may refer to parameters
+// of the enclosing clause, which are not part of the key; callers only
+// remember top-level functions.
+class memo_table {
+public:
+    explicit memo_table(std::size_t const capacity);
+
+    // The remembered result of function called with args[0, n), or null.
+    // It stays valid until the next store().
+    value const* find(void const* const function, value const* const args, std::size_t const n);
+
+    void store(void const* const function, value const* const args, std::size_t const n, value const& result);
+
+    memo_statistics const& stats() const
+    {
+        return counts;
+    }
+
+    std::size_t size() const
+    {
+        return entries.size();
+    }
+
+private:
+    struct entry {
+        std::size_t hash;
+        void const* function;
+        std::vector<value> args;
+        value result;
+    };
+
+    static std::size_t hash_of(void const* const function, value const* const args, std::size_t const n);
+    std::list<entry>::iterator lookup(std::size_t const hash, void const* const function, value const* const args, std::size_t const n);
+
+    std::size_t const capacity;
+    // Most recently used first
+    std::list<entry> entries;
+    std::unordered_multimap<std::size_t, std::list<entry>::iterator> index;
+    memo_statistics counts;
+};
+
+} // namespace eval
+} // namespace templa
+
+#endif    // TEMPLA_MEMO_HPP_INCLUDED
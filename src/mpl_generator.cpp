@@ -0,0 +1,1318 @@
+#include <cstddef>
+#include <string>
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include <deque>
+#include <bitset>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <boost/variant/get.hpp>
+
+#include "mpl_generator.hpp"
+#include "cpp_output.hpp"
+#include "ast_adapted.hpp"
+
+namespace templa {
+namespace codegen {
+
+namespace {
+
+using semantic::semantic_error;
+
+// Headers which the output includes, as bits
+enum header : unsigned {
+    mpl_int      = 1u << 0,
+    mpl_char     = 1u << 1,
+    mpl_bool     = 1u << 2,
+    mpl_eval_if  = 1u << 3,
+    type_traits  = 1u << 4,
+    utility      = 1u << 5,
+    iostream     = 1u << 6,
+};
+
+char const* const header_names[] = {
+    "boost/mpl/int.hpp",
+    "boost/mpl/char.hpp",
+    "boost/mpl/bool.hpp",
+    "boost/mpl/eval_if.hpp",
+    "type_traits",
+    "utility",
+    "iostream",
+};
+
+unsigned const mpl_headers = mpl_int | mpl_char | mpl_bool | mpl_eval_if;
+
+// Templates of the prelude.  They are written in this order, so each one
+// only depends on those before it.
+enum class snippet : std::size_t {
+    string_,
+    list_,
+    call,
+    make_list,
+    if_,
+    add,
+    plus,
+    minus,
+    times,
+    divides,
+    modulus,
+    negate,
+    equal,
+    not_equal,
+    less,
+    greater,
+    less_equal,
+    greater_equal,
+    or_,
+    and_,
+    not_,
+    int_range,
+    char_range,
+    fold_range,
+    fold_list,
+    to_char,
+    to_string,
+    print,
+    none,
+};
+
+std::size_t const num_snippets = static_cast<std::size_t>(snippet::none);
+
+struct snippet_info {
+    char const* name;
+    unsigned headers;
+    snippet dependencies[2];
+    char const* code;
+};
+
+snippet_info const snippets[] = {
+    {"string_", 0, {snippet::none, snippet::none},
+        "template<char... C>\n"
+        "struct string_ {\n"
+        "    using type = string_;\n"
+        "};\n"},
+    {"list_", 0, {snippet::none, snippet::none},
+        "template<class... T>\n"
+        "struct list_ {\n"
+        "    using type = list_;\n"
+        "};\n"},
+    {"call", 0, {snippet::none, snippet::none},
+        "// The arguments are evaluated only when the result is\n"
+        "template<template<class...> class F, class... A>\n"
+        "struct call : F<typename A::type...> {};\n"},
+    {"make_list", 0, {snippet::list_, snippet::none},
+        "template<class... T>\n"
+        "struct make_list {\n"
+        "    using type = list_<typename T::type...>;\n"
+        "};\n"},
+    {"if_", mpl_eval_if, {snippet::none, snippet::none},
+        "// Unlike mpl::eval_if, the condition is evaluated only when the result is\n"
+        "template<class C, class T, class E>\n"
+        "struct if_ : mpl::eval_if<typename C::type, T, E> {};\n"},
+    {"add", mpl_int | mpl_char, {snippet::string_, snippet::list_},
+        "template<class A, class B>\n"
+        "struct add : mpl::int_<(A::value + B::value)> {};\n"
+        "\n"
+        "template<char A, int B>\n"
+        "struct add<mpl::char_<A>, mpl::int_<B>> : mpl::char_<static_cast<char>(A + B)> {};\n"
+        "\n"
+        "template<char... A, char... B>\n"
+        "struct add<string_<A...>, string_<B...>> : string_<A..., B...> {};\n"
+        "\n"
+        "template<char... A, char B>\n"
+        "struct add<string_<A...>, mpl::char_<B>> : string_<A..., B> {};\n"
+        "\n"
+        "template<char A, char... B>\n"
+        "struct add<mpl::char_<A>, string_<B...>> : string_<A, B...> {};\n"
+        "\n"
+        "template<class... A, class... B>\n"
+        "struct add<list_<A...>, list_<B...>> : list_<A..., B...> {};\n"},
+    {"plus", 0, {snippet::add, snippet::none},
+        "template<class A, class B>\n"
+        "struct plus : add<typename A::type, typename B::type> {};\n"},
+    {"minus", mpl_int, {snippet::none, snippet::none},
+        "template<class A, class B>\n"
+        "struct minus : mpl::int_<(A::type::value - B::type::value)> {};\n"},
+    {"times", mpl_int, {snippet::none, snippet::none},
+        "template<class A, class B>\n"
+        "struct times : mpl::int_<(A::type::value * B::type::value)> {};\n"},
+    {"divides", mpl_int, {snippet::none, snippet::none},
+        "template<class A, class B>\n"
+        "struct divides : mpl::int_<(A::type::value / B::type::value)> {};\n"},
+    {"modulus", mpl_int, {snippet::none, snippet::none},
+        "template<class A, class B>\n"
+        "struct modulus : mpl::int_<(A::type::value % B::type::value)> {};\n"},
+    {"negate", mpl_int, {snippet::none, snippet::none},
+        "template<class A>\n"
+        "struct negate : mpl::int_<(-A::type::value)> {};\n"},
+    {"equal", mpl_bool | type_traits, {snippet::none, snippet::none},
+        "template<class A, class B>\n"
+        "struct equal : mpl::bool_<std::is_same<typename A::type, typename B::type>::value> {};\n"},
+    {"not_equal", mpl_bool | type_traits, {snippet::none, snippet::none},
+        "template<class A, class B>\n"
+        "struct not_equal : mpl::bool_<!std::is_same<typename A::type, typename B::type>::value> {};\n"},
+    {"less", mpl_bool, {snippet::none, snippet::none},
+        "template<class A, class B>\n"
+        "struct less : mpl::bool_<(A::type::value < B::type::value)> {};\n"},
+    {"greater", mpl_bool, {snippet::none, snippet::none},
+        "template<class A, class B>\n"
+        "struct greater : mpl::bool_<(A::type::value > B::type::value)> {};\n"},
+    {"less_equal", mpl_bool, {snippet::none, snippet::none},
+        "template<class A, class B>\n"
+        "struct less_equal : mpl::bool_<(A::type::value <= B::type::value)> {};\n"},
+    {"greater_equal", mpl_bool, {snippet::none, snippet::none},
+        "template<class A, class B>\n"
+        "struct greater_equal : mpl::bool_<(A::type::value >= B::type::value)> {};\n"},
+    {"or_", mpl_bool | mpl_eval_if, {snippet::none, snippet::none},
+        "template<class A, class B>\n"
+        "struct or_ : mpl::eval_if<typename A::type, mpl::true_, B> {};\n"},
+    {"and_", mpl_bool | mpl_eval_if, {snippet::none, snippet::none},
+        "template<class A, class B>\n"
+        "struct and_ : mpl::eval_if<typename A::type, B, mpl::false_> {};\n"},
+    {"not_", mpl_bool, {snippet::none, snippet::none},
+        "template<class A>\n"
+        "struct not_ : mpl::bool_<!A::type::value> {};\n"},
+    {"int_range", mpl_int | utility, {snippet::list_, snippet::none},
+        "template<int First, class Offsets>\n"
+        "struct int_range_of;\n"
+        "\n"
+        "template<int First, int... Offsets>\n"
+        "struct int_range_of<First, std::integer_sequence<int, Offsets...>> : list_<mpl::int_<First + Offsets>...> {};\n"
+        "\n"
+        "template<int First, int Last>\n"
+        "struct int_range : int_range_of<First, std::make_integer_sequence<int, (Last < First ? 0 : Last - First + 1)>> {};\n"},
+    {"char_range", mpl_char | utility, {snippet::list_, snippet::none},
+        "template<char First, class Offsets>\n"
+        "struct char_range_of;\n"
+        "\n"
+        "template<char First, int... Offsets>\n"
+        "struct char_range_of<First, std::integer_sequence<int, Offsets...>> : list_<mpl::char_<static_cast<char>(First + Offsets)>...> {};\n"
+        "\n"
+        "template<char First, char Last>\n"
+        "struct char_range : char_range_of<First, std::make_integer_sequence<int, (Last < First ? 0 : Last - First + 1)>> {};\n"},
+    {"fold_range", mpl_int | type_traits, {snippet::none, snippet::none},
+        "// Seg<mpl::int_<First>> Op ... Op Seg<mpl::int_<Last>>, or Identity if\n"
+        "// Last < First.  Down folds from Last to First instead.  As the range is\n"
+        "// halved, instantiations nest only log(Last - First) deep.\n"
+        "template<\n"
+        "    template<class> class Seg, template<class, class> class Op, class Identity, bool Down,\n"
+        "    int First, int Last, int Size = (Last < First ? 0 : Last - First + 1)\n"
+        ">\n"
+        "struct fold_range {\n"
+        "    using lower = fold_range<Seg, Op, Identity, Down, First, First + Size / 2 - 1>;\n"
+        "    using upper = fold_range<Seg, Op, Identity, Down, First + Size / 2, Last>;\n"
+        "    using type = typename std::conditional<Down, Op<upper, lower>, Op<lower, upper>>::type::type;\n"
+        "};\n"
+        "\n"
+        "template<template<class> class Seg, template<class, class> class Op, class Identity, bool Down, int First, int Last>\n"
+        "struct fold_range<Seg, Op, Identity, Down, First, Last, 1> : Seg<mpl::int_<First>> {};\n"
+        "\n"
+        "template<template<class> class Seg, template<class, class> class Op, class Identity, bool Down, int First, int Last>\n"
+        "struct fold_range<Seg, Op, Identity, Down, First, Last, 0> : Identity {};\n"},
+    {"fold_list", type_traits | utility, {snippet::list_, snippet::none},
+        "template<std::size_t>\n"
+        "using ignored = void*;\n"
+        "\n"
+        "template<class T, std::size_t>\n"
+        "using repeat = T;\n"
+        "\n"
+        "template<class T, class...>\n"
+        "struct front : T {};\n"
+        "\n"
+        "// Each T covers Stride elements.  Op-ing each T with the one Stride\n"
+        "// elements later, deduced from the list shifted by Stride, doubles the\n"
+        "// stride, so that after log(n) levels the first T covers all of the n\n"
+        "// elements.  Only that first T is evaluated, log(n) deep.\n"
+        "template<template<class, class> class Op, class Identity, bool Down, class Stride, class List>\n"
+        "struct fold_level;\n"
+        "\n"
+        "template<template<class, class> class Op, class Identity, bool Down, std::size_t... I, class... T>\n"
+        "struct fold_level<Op, Identity, Down, std::index_sequence<I...>, list_<T...>> {\n"
+        "    template<class... S>\n"
+        "    static list_<typename std::conditional<Down, Op<S, T>, Op<T, S>>::type...> combine(ignored<I>..., S*...);\n"
+        "\n"
+        "    using next = decltype(combine(static_cast<T*>(nullptr)..., static_cast<repeat<Identity, I>*>(nullptr)...));\n"
+        "    using type = typename std::conditional<\n"
+        "        (sizeof...(T) <= sizeof...(I)),\n"
+        "        front<T...>,\n"
+        "        fold_level<Op, Identity, Down, std::make_index_sequence<2 * sizeof...(I)>, next>\n"
+        "    >::type::type;\n"
+        "};\n"
+        "\n"
+        "template<template<class, class> class Op, class Identity, bool Down, class Stride>\n"
+        "struct fold_level<Op, Identity, Down, Stride, list_<>> : Identity {};\n"
+        "\n"
+        "// Base Op (Seg<T> Op ... for the elements T of List) if Left, otherwise\n"
+        "// the fold Op Base.  Down folds from the last element to the first.\n"
+        "template<\n"
+        "    template<class> class Seg, template<class, class> class Op, class Identity, bool Down,\n"
+        "    class Base, bool Left, class List\n"
+        ">\n"
+        "struct fold_list;\n"
+        "\n"
+        "template<\n"
+        "    template<class> class Seg, template<class, class> class Op, class Identity, bool Down,\n"
+        "    class Base, bool Left, class... T\n"
+        ">\n"
+        "struct fold_list<Seg, Op, Identity, Down, Base, Left, list_<T...>> {\n"
+        "    using folded = fold_level<Op, Identity, Down, std::index_sequence<0>, list_<Seg<T>...>>;\n"
+        "    using type = typename std::conditional<Left, Op<Base, folded>, Op<folded, Base>>::type::type;\n"
+        "};\n"},
+    {"to_char", mpl_char, {snippet::none, snippet::none},
+        "template<class A>\n"
+        "struct to_char : mpl::char_<static_cast<char>(A::type::value)> {};\n"},
+    {"to_string", mpl_char, {snippet::string_, snippet::none},
+        "template<class T>\n"
+        "struct to_string_of;\n"
+        "\n"
+        "template<char C>\n"
+        "struct to_string_of<mpl::char_<C>> : string_<C> {};\n"
+        "\n"
+        "template<char... C>\n"
+        "struct to_string_of<string_<C...>> : string_<C...> {};\n"
+        "\n"
+        "template<class A>\n"
+        "struct to_string : to_string_of<typename A::type> {};\n"},
+    {"print", mpl_int | mpl_char | mpl_bool | iostream, {snippet::string_, snippet::list_},
+        "template<int N>\n"
+        "void print(std::ostream &out, mpl::int_<N>)\n"
+        "{\n"
+        "    out << N;\n"
+        "}\n"
+        "\n"
+        "template<char C>\n"
+        "void print(std::ostream &out, mpl::char_<C>)\n"
+        "{\n"
+        "    out << C;\n"
+        "}\n"
+        "\n"
+        "template<bool B>\n"
+        "void print(std::ostream &out, mpl::bool_<B>)\n"
+        "{\n"
+        "    out << (B ? \"true\" : \"false\");\n"
+        "}\n"
+        "\n"
+        "template<char... C>\n"
+        "void print(std::ostream &out, string_<C...>)\n"
+        "{\n"
+        "    char const text[] = {C..., '\\0'};\n"
+        "    out << text;\n"
+        "}\n"
+        "\n"
+        "inline void print(std::ostream &out, list_<>)\n"
+        "{\n"
+        "    out << \"[]\";\n"
+        "}\n"
+        "\n"
+        "template<class T, class... U>\n"
+        "void print(std::ostream &out, list_<T, U...>)\n"
+        "{\n"
+        "    out << '[';\n"
+        "    print(out, T{});\n"
+        "    using expand = int[];\n"
+        "    (void)expand{0, (out << \", \", print(out, U{}), 0)...};\n"
+        "    out << ']';\n"
+        "}\n"},
+};
+
+static_assert(sizeof(snippets) / sizeof(snippets[0]) == num_snippets, "a snippet is missing");
+
+// The operand which a primary expression consists of alone, i.e. the value
+// of its only factor, or null
+ast::ast_node const* sole_operand_of_term(ast::ast_node const& term)
+{
+    auto const& t = get<ast::term>(term);
+    return t.factors.size() == 1 ? &get<ast::factor>(t.factors.front()).value : nullptr;
+}
+
+ast::ast_node const* sole_operand_of_formula(ast::ast_node const& formula)
+{
+    auto const& f = get<ast::formula>(formula);
+    return f.maybe_sign || f.terms.size() != 1 ? nullptr : sole_operand_of_term(f.terms.front());
+}
+
+ast::ast_node const* sole_operand(ast::ast_node const& primary)
+{
+    auto const& p = get<ast::primary_expression>(primary);
+    return p.formulae.size() == 1 ? sole_operand_of_formula(p.formulae.front()) : nullptr;
+}
+
+// The primary expression which an expression is, or null if it is a let,
+// if or case
+ast::ast_node const* as_primary(ast::ast_node const& expression)
+{
+    auto const& value = get<ast::expression>(expression).value;
+    return boost::get<ast::primary_expression const*>(&value.value) ? &value : nullptr;
+}
+
+// Whether operand is a reference to the value name
+bool is_name(ast::ast_node const* const operand, ast::identifier const name)
+{
+    if (operand == nullptr) {
+        return false;
+    }
+    auto const c = boost::get<ast::func_call const*>(&operand->value);
+    return c && (*c)->function_name == name && !(*c)->maybe_call_arguments;
+}
+
+boost::optional<int> as_int(ast::ast_node const* const operand)
+{
+    if (operand == nullptr) {
+        return boost::none;
+    }
+    if (auto const c = boost::get<ast::constant const*>(&operand->value)) {
+        if (auto const i = boost::get<int>(&(*c)->value)) {
+            return *i;
+        }
+    }
+    return boost::none;
+}
+
+// Whether a call of name, or a reference to it, is in node
+bool mentions(ast::ast_node const& node, ast::identifier const name)
+{
+    bool found = false;
+    ast::for_each_node(node, [&](ast::ast_node const& n){
+        if (auto const c = boost::get<ast::func_call const*>(&n.value)) {
+            found |= (*c)->function_name == name;
+        }
+    });
+    return found;
+}
+
+class mpl_generator {
+public:
+    explicit mpl_generator(ast::ast const& a)
+        : root(get<ast::program>(a.root))
+        , top_level(root.function_declarations)
+        , identifiers(identifiers_of(a))
+    {}
+
+    void write(std::ostream &out);
+
+private:
+    struct binding {
+        std::string cpp;
+        // Null if the name is a value, e.g. a parameter
+        semantic::function const* function;
+    };
+
+    // A namespace or a struct whose members are being generated
+    struct scope {
+        bool is_class;
+        std::size_t indent;
+        std::unordered_map<ast::identifier, binding> bindings;
+        std::unordered_set<std::string> cpp_names;
+        std::string members;
+    };
+
+    // A type whose ::type is the value of an expression.  If it is a value
+    // already, it is its own ::type.
+    struct lowered {
+        std::string text;
+        bool value;
+    };
+
+    // A function of one parameter whose recursive clause is
+    //
+    //   f(n) = f(n - 1) op e1 op e2 ...   or   f(x:rest) = f(rest) op e1 ...
+    //
+    // or the same with the recursive call last, where op is + or * and the
+    // only other clause is f(K) = B or f(xs) = B for a constant B.  Such a
+    // function is op folded over the integers from K to n, or over the
+    // elements of the list, so it is lowered to a fold_range or a fold_list
+    // whose instantiations nest log(n) deep instead of n deep.  When n is
+    // below K the recursion never reaches K, so the clause instantiates
+    // itself linearly as it would without the fold.
+    struct fold {
+        ast::ast_node const* step;
+        snippet op;
+        // The recursive call is the left operand
+        bool left;
+        // The other operands, terms of + or factors of *
+        std::vector<ast::ast_node> operands;
+        // The constant which the recursion ends with
+        ast::ast_node base;
+        // The n of n == K or f(K), or none for a list
+        boost::optional<int> last;
+        // The name which the operands use for n or the element
+        ast::identifier element;
+        ast::identifier rest;
+        // The value of the operands with the recursive call left out, e.g. 0
+        std::string identity;
+    };
+
+    bool clashes(std::string const& cpp) const;
+    std::string fresh(std::string const& base);
+    std::string declare(scope &s, std::string const& name);
+    binding const* lookup(ast::identifier const name) const;
+
+    void define_functions(semantic::function_table const& table, std::string &out, std::size_t const indent, bool const member);
+    void define_clause(
+        semantic::function const& f,
+        std::string const& cpp_name,
+        std::size_t const c,
+        bool const primary,
+        bool const dummy,
+        std::string &out,
+        std::size_t const indent,
+        fold const* const folding = nullptr,
+        std::string const& segment = {}
+    );
+    std::vector<std::size_t> definition_order(semantic::function_table const& table) const;
+    boost::optional<fold> find_fold(semantic::function const& f);
+    bool find_fold_step(semantic::function const& f, ast::ast_node const& step, fold &folding) const;
+    std::string define_segment(semantic::function const& f, fold const& folding, std::string &out, std::size_t const indent);
+
+    lowered lower_expression(ast::ast_node const& node, bool const evaluated);
+    lowered lower_let(ast::let_expression const& let);
+    lowered lower_primary(ast::ast_node const& node);
+    lowered lower_formula(ast::ast_node const& node);
+    lowered lower_term(ast::ast_node const& node);
+    lowered lower_factor(ast::ast_node const& node);
+    lowered lower_constant(ast::ast_node const& node);
+    lowered lower_call(ast::ast_node const& node);
+
+    std::string rt(snippet const s);
+    lowered apply(snippet const s, std::vector<lowered> const& args);
+
+    std::string evaluated(lowered const& l) const
+    {
+        return l.value ? l.text : "typename " + l.text + "::type";
+    }
+
+    // The line of a node of the clause being lowered in the source
+    std::size_t line_of(ast::ast_node const& node) const
+    {
+        return static_cast<std::size_t>(node.line + line_delta);
+    }
+
+    ast::program const& root;
+    semantic::function_table const top_level;
+    std::deque<scope> scopes;
+    std::unordered_set<std::string> identifiers;
+    // The last suffix fresh gave each base
+    std::unordered_map<std::string, std::size_t> suffixes;
+    std::bitset<num_snippets> used;
+    unsigned headers = 0;
+    // Of the clause being lowered
+    std::int64_t line_delta = 0;
+};
+
+// Template parameters must not be redeclared in nested scopes, and a member
+// must not be named like a template parameter of its class
+bool mpl_generator::clashes(std::string const& cpp) const
+{
+    if (is_reserved(cpp)) {
+        return true;
+    }
+    for (auto const& s : scopes) {
+        if (s.is_class && s.cpp_names.count(cpp)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// A name which no templa name and no enclosing C++ name is
+std::string mpl_generator::fresh(std::string const& base)
+{
+    for (auto &n = suffixes[base];;) {
+        auto name = base + '_' + std::to_string(++n);
+        if (!identifiers.count(name) && !clashes(name)) {
+            identifiers.insert(name);
+            return name;
+        }
+    }
+}
+
+std::string mpl_generator::declare(scope &s, std::string const& name)
+{
+    auto cpp = clashes(name) || s.cpp_names.count(name) ? fresh(name) : name;
+    s.cpp_names.insert(cpp);
+    return cpp;
+}
+
+mpl_generator::binding const* mpl_generator::lookup(ast::identifier const name) const
+{
+    for (auto s = scopes.rbegin(); s != scopes.rend(); ++s) {
+        auto const found = s->bindings.find(name);
+        if (found != s->bindings.end()) {
+            return &found->second;
+        }
+    }
+    return nullptr;
+}
+
+// Functions without parameters are structs which are evaluated where they
+// are defined unless they are members of a template.  So they come after all
+// templates, each after the ones it may use.
+std::vector<std::size_t> mpl_generator::definition_order(semantic::function_table const& table) const
+{
+    auto const& functions = table.functions();
+    std::vector<std::vector<std::size_t>> uses(functions.size());
+    for (std::size_t i = 0; i < functions.size(); ++i) {
+        for (auto const& clause : functions[i].clauses) {
+            ast::for_each_node(clause, [&](ast::ast_node const& n){
+                if (auto const c = boost::get<ast::func_call const*>(&n.value)) {
+                    if (auto const f = table.find((*c)->function_name)) {
+                        uses[i].push_back(static_cast<std::size_t>(f - functions.data()));
+                    }
+                }
+            });
+        }
+    }
+
+    std::vector<std::size_t> order;
+    for (std::size_t i = 0; i < functions.size(); ++i) {
+        if (functions[i].arity != 0) {
+            order.push_back(i);
+        }
+    }
+
+    // Depth first in postorder through the functions which one uses, also
+    // through templates, so each nullary function comes after the ones it may
+    // reach.  A cycle does not hang here; it would not terminate in C++ either.
+    std::vector<char> seen(functions.size(), 0);
+    std::vector<std::pair<std::size_t, std::size_t>> stack;
+    for (std::size_t start = 0; start < functions.size(); ++start) {
+        if (seen[start]) {
+            continue;
+        }
+        seen[start] = 1;
+        stack.emplace_back(start, 0);
+        while (!stack.empty()) {
+            auto &top = stack.back();
+            auto const i = top.first;
+            if (top.second < uses[i].size()) {
+                auto const next = uses[i][top.second++];
+                if (!seen[next]) {
+                    seen[next] = 1;
+                    stack.emplace_back(next, 0);
+                }
+                continue;
+            }
+            if (functions[i].arity == 0) {
+                order.push_back(i);
+            }
+            stack.pop_back();
+        }
+    }
+    return order;
+}
+
+void mpl_generator::define_functions(
+    semantic::function_table const& table,
+    std::string &out,
+    std::size_t const indent,
+    bool const member
+)
+{
+    auto &s = scopes.back();
+    std::vector<std::string> names;
+    for (auto const& f : table.functions()) {
+        names.push_back(declare(s, f.name.to_string()));
+        s.bindings[f.name] = {names.back(), &f};
+    }
+
+    // Members cannot be fully specialized in their class, so members with
+    // patterns take one more parameter which their specializations leave open
+    auto const dummy = [member](semantic::function const& f){
+        return member && f.clauses.size() > (f.general ? 1u : 0u);
+    };
+
+    for (std::size_t i = 0; i < names.size(); ++i) {
+        auto const& f = table.functions()[i];
+        if (f.arity == 0) {
+            put_line(out, indent, "struct " + names[i] + ";");
+            continue;
+        }
+        std::string params;
+        for (std::size_t p = 0; p < f.arity; ++p) {
+            params += p == 0 ? "class" : ", class";
+        }
+        if (dummy(f)) {
+            params += ", class = void";
+        }
+        put_line(out, indent, "template<" + params + ">");
+        put_line(out, indent, "struct " + names[i] + ";");
+    }
+
+    for (auto const i : definition_order(table)) {
+        auto const& f = table.functions()[i];
+        auto const folding = find_fold(f);
+        std::string segment;
+        if (folding) {
+            out += '\n';
+            auto const outer_delta = line_delta;
+            line_delta = f.line_deltas[folding->step - f.clauses.data()];
+            segment = define_segment(f, *folding, out, indent);
+            line_delta = outer_delta;
+        }
+        auto const fold_of = [&](std::size_t const c){
+            return folding && folding->step == &f.clauses[c] ? &*folding : nullptr;
+        };
+
+        if (f.general) {
+            out += '\n';
+            define_clause(f, names[i], *f.general, true, dummy(f), out, indent, fold_of(*f.general), segment);
+        }
+        for (std::size_t c = 0; c < f.clauses.size(); ++c) {
+            if (!f.general || c != *f.general) {
+                out += '\n';
+                define_clause(f, names[i], c, false, dummy(f), out, indent, fold_of(c), segment);
+            }
+        }
+    }
+}
+
+boost::optional<mpl_generator::fold> mpl_generator::find_fold(semantic::function const& f)
+{
+    // A recursive clause which tests n itself, as in if n == K, may skip K
+    // and recurse forever, which the fold would not show
+    if (f.arity != 1 || !f.general || f.clauses.size() != 2) {
+        return boost::none;
+    }
+    auto const& general = get<ast::decl_func>(f.clauses[*f.general]);
+    auto const n = *semantic::parameter_name(get<ast::decl_param>(semantic::parameters(general).front()));
+
+    fold folding{nullptr, snippet::none, false, {}, {}, boost::none, {}, {}, {}};
+    ast::ast_node const* base = nullptr;
+    ast::ast_node const* step = nullptr;
+    auto const& other = get<ast::decl_func>(f.clauses[1 - *f.general]);
+    auto const& pattern = boost::get<ast::ast_node>(get<ast::decl_param>(semantic::parameters(other).front()).value);
+    if (auto const m = boost::get<ast::list_match const*>(&pattern.value)) {
+        // f(x:rest) = ..., f(xs) = B
+        if ((*m)->elements.size() != 1) {
+            return boost::none;
+        }
+        base = as_primary(general.expression);
+        step = as_primary(other.expression);
+        folding.step = &f.clauses[1 - *f.general];
+        folding.element = (*m)->elements.front();
+        folding.rest = (*m)->rest_elems_name;
+    } else {
+        // f(K) = B, f(n) = ...
+        folding.last = as_int(&pattern);
+        base = as_primary(other.expression);
+        step = as_primary(general.expression);
+        folding.step = &f.clauses[*f.general];
+        folding.element = n;
+    }
+    if (!folding.rest.empty() == static_cast<bool>(folding.last)) {
+        return boost::none;
+    }
+    if (!base || !step || (folding.rest.empty() && !folding.last)) {
+        return boost::none;
+    }
+
+    auto const base_operand = sole_operand(*base);
+    if (!base_operand || !boost::get<ast::constant const*>(&base_operand->value) || !find_fold_step(f, *step, folding)) {
+        return boost::none;
+    }
+    folding.base = *base_operand;
+
+    // Only these bases make op associative and have an identity
+    auto const& constant = get<ast::constant>(folding.base).value;
+    if (boost::get<int>(&constant)) {
+        headers |= mpl_int;
+        folding.identity = folding.op == snippet::plus ? "mpl::int_<0>" : "mpl::int_<1>";
+    } else if (folding.op != snippet::plus) {
+        return boost::none;
+    } else if (boost::get<boost::string_ref>(&constant)) {
+        folding.identity = rt(snippet::string_) + "<>";
+    } else if (boost::get<ast::ast_node>(&constant)) {
+        folding.identity = rt(snippet::list_) + "<>";
+    } else {
+        return boost::none;
+    }
+    rt(folding.rest.empty() ? snippet::fold_range : snippet::fold_list);
+    return folding;
+}
+
+// Finds the operator, the operands and the side of the recursive call in
+// step, which must be a chain of + or of *
+bool mpl_generator::find_fold_step(semantic::function const& f, ast::ast_node const& step, fold &folding) const
+{
+    auto const& p = get<ast::primary_expression>(step);
+    if (p.formulae.size() != 1) {
+        return false;
+    }
+    auto const& formula = get<ast::formula>(p.formulae.front());
+    if (formula.maybe_sign) {
+        return false;
+    }
+
+    ast::node_list const* chain;
+    if (formula.terms.size() > 1) {
+        folding.op = snippet::plus;
+        chain = &formula.terms;
+        for (auto const& o : formula.operators) {
+            if (get<ast::additive_operator>(o).value != "+") {
+                return false;
+            }
+        }
+    } else {
+        auto const& t = get<ast::term>(formula.terms.front());
+        folding.op = snippet::times;
+        chain = &t.factors;
+        for (auto const& o : t.operators) {
+            if (get<ast::mult_operator>(o).value != "*") {
+                return false;
+            }
+        }
+    }
+    if (chain->size() < 2) {
+        return false;
+    }
+    auto const operand = [&](ast::ast_node const& e){
+        return folding.op == snippet::plus ? sole_operand_of_term(e) : &get<ast::factor>(e).value;
+    };
+
+    // f(n - 1) or f(rest)
+    auto const recursive = [&](ast::ast_node const* const o){
+        auto const c = o ? boost::get<ast::func_call const*>(&o->value) : nullptr;
+        if (!c || (*c)->function_name != f.name || !(*c)->maybe_call_arguments) {
+            return false;
+        }
+        auto const& args = get<ast::call_args>(*(*c)->maybe_call_arguments).arguments;
+        if (args.size() != 1) {
+            return false;
+        }
+        if (!folding.rest.empty()) {
+            return is_name(sole_operand(args.front()), folding.rest);
+        }
+        auto const& a = get<ast::primary_expression>(args.front());
+        if (a.formulae.size() != 1) {
+            return false;
+        }
+        auto const& difference = get<ast::formula>(a.formulae.front());
+        return !difference.maybe_sign
+            && difference.terms.size() == 2
+            && get<ast::additive_operator>(difference.operators.front()).value == "-"
+            && is_name(sole_operand_of_term(difference.terms[0]), folding.element)
+            && as_int(sole_operand_of_term(difference.terms[1])) == 1;
+    };
+
+    if (recursive(operand(chain->front()))) {
+        folding.left = true;
+        folding.operands.assign(chain->begin() + 1, chain->end());
+    } else if (recursive(operand(chain->back()))) {
+        folding.left = false;
+        folding.operands.assign(chain->begin(), chain->end() - 1);
+    } else {
+        return false;
+    }
+    return std::none_of(folding.operands.begin(), folding.operands.end(), [&](ast::ast_node const& o){
+        return mentions(o, f.name) || (!folding.rest.empty() && mentions(o, folding.rest));
+    });
+}
+
+// A template of the element which computes the operands of one step, folded
+// with the identity in place of the recursive call
+std::string mpl_generator::define_segment(semantic::function const& f, fold const& folding, std::string &out, std::size_t const indent)
+{
+    auto const name = fresh(f.name.to_string() + "_segment");
+    scopes.back().cpp_names.insert(name);
+    scopes.push_back({true, indent + 1, {}, {name}, {}});
+    auto &s = scopes.back();
+    auto const param = declare(s, folding.element.to_string());
+    s.bindings[folding.element] = {param, nullptr};
+
+    auto const lower_operand = [&](ast::ast_node const& o){
+        return folding.op == snippet::plus ? lower_term(o) : lower_factor(o);
+    };
+    lowered result{folding.identity, true};
+    if (folding.left) {
+        for (auto const& o : folding.operands) {
+            result = apply(folding.op, {result, lower_operand(o)});
+        }
+    } else {
+        for (auto o = folding.operands.rbegin(); o != folding.operands.rend(); ++o) {
+            result = apply(folding.op, {lower_operand(*o), result});
+        }
+    }
+
+    put_line(out, indent, "template<class " + param + ">");
+    put_line(out, indent, "struct " + name + " {");
+    out += s.members;
+    put_line(out, indent + 1, "using type = " + evaluated(result) + ";");
+    put_line(out, indent, "};");
+    scopes.pop_back();
+    return name;
+}
+
+void mpl_generator::define_clause(
+    semantic::function const& f,
+    std::string const& cpp_name,
+    std::size_t const c,
+    bool const primary,
+    bool const dummy,
+    std::string &out,
+    std::size_t const indent,
+    fold const* const folding,
+    std::string const& segment
+)
+{
+    auto const& clause = get<ast::decl_func>(f.clauses[c]);
+    auto const outer_delta = line_delta;
+    line_delta = f.line_deltas[c];
+    scopes.push_back({true, indent + 1, {}, {cpp_name}, {}});
+    auto &s = scopes.back();
+
+    std::vector<std::string> params, args, aliases;
+    auto const bind_value = [&](ast::identifier const name, ast::ast_node const& at){
+        if (s.bindings.count(name)) {
+            throw semantic_error{line_of(at), at.col, "parameter " + name.to_string() + " of " + f.name.to_string() + " is declared twice"};
+        }
+        auto const cpp = declare(s, name.to_string());
+        s.bindings[name] = {cpp, nullptr};
+        return cpp;
+    };
+
+    for (auto const& p : semantic::parameters(clause)) {
+        auto const& param = get<ast::decl_param>(p);
+        if (auto const name = semantic::parameter_name(param)) {
+            auto const cpp = bind_value(*name, p);
+            params.push_back("class " + cpp);
+            args.push_back(cpp);
+            continue;
+        }
+
+        auto const& pattern = boost::get<ast::ast_node>(param.value);
+        if (auto const m = boost::get<ast::list_match const*>(&pattern.value)) {
+            std::string elements;
+            for (auto const& e : (*m)->elements) {
+                auto const cpp = bind_value(e, pattern);
+                params.push_back("class " + cpp);
+                elements += cpp + ", ";
+            }
+            auto const pack = fresh((*m)->rest_elems_name.to_string());
+            s.cpp_names.insert(pack);
+            params.push_back("class... " + pack);
+            aliases.push_back("using " + bind_value((*m)->rest_elems_name, pattern) + " = " + rt(snippet::list_) + "<" + pack + "...>;");
+            args.push_back(rt(snippet::list_) + "<" + elements + pack + "...>");
+        } else if (auto const t = boost::get<ast::type_match const*>(&pattern.value)) {
+            auto const type = semantic::find_type((*t)->type_name);
+            if (!type) {
+                throw semantic_error{line_of(pattern), pattern.col, "unknown type " + (*t)->type_name.to_string()};
+            }
+            auto const v = fresh((*t)->param_name.to_string());
+            s.cpp_names.insert(v);
+            std::string matched;
+            switch (*type) {
+            case 0:
+                headers |= mpl_int;
+                params.push_back("int " + v);
+                matched = "mpl::int_<" + v + ">";
+                break;
+            case 1:
+                headers |= mpl_char;
+                params.push_back("char " + v);
+                matched = "mpl::char_<" + v + ">";
+                break;
+            case 2:
+                headers |= mpl_bool;
+                params.push_back("bool " + v);
+                matched = "mpl::bool_<" + v + ">";
+                break;
+            case 3:
+                params.push_back("char... " + v);
+                matched = rt(snippet::string_) + "<" + v + "...>";
+                break;
+            default:
+                params.push_back("class... " + v);
+                matched = rt(snippet::list_) + "<" + v + "...>";
+                break;
+            }
+            aliases.push_back("using " + bind_value((*t)->param_name, pattern) + " = " + matched + ";");
+            args.push_back(matched);
+        } else {
+            auto const c = lower_constant(pattern);
+            if (!c.value) {
+                throw semantic_error{line_of(pattern), pattern.col, "a range cannot be a pattern"};
+            }
+            args.push_back(c.text);
+        }
+    }
+
+    if (dummy) {
+        if (primary) {
+            params.push_back("class");
+        } else {
+            auto const d = fresh("D");
+            s.cpp_names.insert(d);
+            params.push_back("class " + d);
+            args.push_back(d);
+        }
+    }
+
+    auto body = lower_expression(clause.expression, folding == nullptr);
+    if (folding) {
+        // The body above has checked the names, and is instantiated when n
+        // is below K
+        auto const base = lower_constant(folding->base);
+        auto const op = rt(folding->op);
+        auto const head = segment + ", " + op + ", " + folding->identity + ", ";
+        if (folding->last) {
+            lowered const range{
+                rt(snippet::fold_range) + "<" + head + (folding->left ? "false" : "true") + ", "
+                    + std::to_string(*folding->last + 1) + ", " + s.bindings.at(folding->element).cpp + "::value>",
+                false
+            };
+            auto const folded = folding->left ? apply(folding->op, {base, range}) : apply(folding->op, {range, base});
+            headers |= mpl_bool | mpl_eval_if;
+            body = {
+                "mpl::eval_if<mpl::bool_<(" + s.bindings.at(folding->element).cpp + "::value > " + std::to_string(*folding->last) + ")>, "
+                    + folded.text + ", " + body.text + ">",
+                false
+            };
+        } else {
+            // The elements are folded from the last one if the recursive call
+            // is the left operand
+            auto const left = folding->left ? "true" : "false";
+            body = {
+                rt(snippet::fold_list) + "<" + head + left + ", " + base.text + ", " + left + ", " + args.front() + ">",
+                false
+            };
+        }
+    }
+
+    std::string params_text, args_text;
+    for (auto const& p : params) {
+        params_text += (params_text.empty() ? "" : ", ") + p;
+    }
+    for (auto const& a : args) {
+        args_text += (args_text.empty() ? "" : ", ") + a;
+    }
+    if (!primary) {
+        put_line(out, indent, "template<" + params_text + ">");
+        put_line(out, indent, "struct " + cpp_name + "<" + args_text + "> {");
+    } else if (!params.empty()) {
+        put_line(out, indent, "template<" + params_text + ">");
+        put_line(out, indent, "struct " + cpp_name + " {");
+    } else {
+        put_line(out, indent, "struct " + cpp_name + " {");
+    }
+    for (auto const& a : aliases) {
+        put_line(out, indent + 1, a);
+    }
+    out += s.members;
+    put_line(out, indent + 1, "using type = " + evaluated(body) + ";");
+    put_line(out, indent, "};");
+
+    scopes.pop_back();
+    line_delta = outer_delta;
+}
+
+mpl_generator::lowered mpl_generator::lower_expression(ast::ast_node const& node, bool const evaluated_position)
+{
+    auto const& value = get<ast::expression>(node).value;
+
+    if (auto const let = boost::get<ast::let_expression const*>(&value.value)) {
+        return lower_let(**let);
+    }
+
+    if (auto const i = boost::get<ast::if_expression const*>(&value.value)) {
+        auto const condition = lower_expression((*i)->condition, false);
+        auto const then = lower_expression((*i)->expression_if_true, false);
+        auto const otherwise = lower_expression((*i)->expression_if_false, false);
+        if (evaluated_position) {
+            // Evaluated right away anyway, so no wrapper delays the condition
+            headers |= mpl_eval_if;
+            return {"mpl::eval_if<" + evaluated(condition) + ", " + then.text + ", " + otherwise.text + ">", false};
+        }
+        return {rt(snippet::if_) + "<" + condition.text + ", " + then.text + ", " + otherwise.text + ">", false};
+    }
+
+    if (auto const c = boost::get<ast::case_expression const*>(&value.value)) {
+        auto result = lower_expression((*c)->otherwise_expression, false);
+        auto const& whens = (*c)->case_when;
+        for (auto w = whens.end(); w != whens.begin();) {
+            auto const& when = get<ast::case_when>(*--w);
+            auto const condition = lower_expression(when.condition, false);
+            auto const then = lower_expression(when.then_expression, false);
+            if (evaluated_position && w == whens.begin()) {
+                headers |= mpl_eval_if;
+                result = {"mpl::eval_if<" + evaluated(condition) + ", " + then.text + ", " + result.text + ">", false};
+            } else {
+                result = {rt(snippet::if_) + "<" + condition.text + ", " + then.text + ", " + result.text + ">", false};
+            }
+        }
+        return result;
+    }
+
+    return lower_primary(value);
+}
+
+// A struct whose members are the local functions and whose ::type is the
+// body
+mpl_generator::lowered mpl_generator::lower_let(ast::let_expression const& let)
+{
+    auto const name = fresh("let");
+    scopes.back().cpp_names.insert(name);
+    auto const indent = scopes.back().indent;
+    scopes.push_back({true, indent + 1, {}, {}, {}});
+
+    semantic::function_table const locals{let.function_declarations, line_delta};
+    std::string definitions;
+    define_functions(locals, definitions, indent + 1, true);
+    auto const body = lower_expression(let.body, true);
+
+    std::string text;
+    put_line(text, indent, "struct " + name + " {");
+    text += definitions;
+    text += scopes.back().members;
+    put_line(text, indent + 1, "using type = " + evaluated(body) + ";");
+    put_line(text, indent, "};");
+
+    scopes.pop_back();
+    scopes.back().members += text;
+    return {name, false};
+}
+
+mpl_generator::lowered mpl_generator::lower_primary(ast::ast_node const& node)
+{
+    auto const& primary = get<ast::primary_expression>(node);
+    auto result = lower_formula(primary.formulae.front());
+    for (std::size_t i = 0; i < primary.operators.size(); ++i) {
+        auto const op = get<ast::relational_operator>(primary.operators[i]).value;
+        auto const rhs = lower_formula(primary.formulae[i + 1]);
+        auto const s =
+            op == "==" ? snippet::equal :
+            op == "!=" ? snippet::not_equal :
+            op == "<"  ? snippet::less :
+            op == ">"  ? snippet::greater :
+            op == "<=" ? snippet::less_equal :
+                         snippet::greater_equal;
+        result = apply(s, {result, rhs});
+    }
+    return result;
+}
+
+mpl_generator::lowered mpl_generator::lower_formula(ast::ast_node const& node)
+{
+    auto const& f = get<ast::formula>(node);
+    auto result = lower_term(f.terms.front());
+    if (f.maybe_sign && *f.maybe_sign == '-') {
+        result = apply(snippet::negate, {result});
+    }
+    for (std::size_t i = 0; i < f.operators.size(); ++i) {
+        auto const op = get<ast::additive_operator>(f.operators[i]).value;
+        auto const rhs = lower_term(f.terms[i + 1]);
+        auto const s =
+            op == "+" ? snippet::plus :
+            op == "-" ? snippet::minus :
+                        snippet::or_;
+        result = apply(s, {result, rhs});
+    }
+    return result;
+}
+
+mpl_generator::lowered mpl_generator::lower_term(ast::ast_node const& node)
+{
+    auto const& t = get<ast::term>(node);
+    auto result = lower_factor(t.factors.front());
+    for (std::size_t i = 0; i < t.operators.size(); ++i) {
+        auto const op = get<ast::mult_operator>(t.operators[i]).value;
+        auto const rhs = lower_factor(t.factors[i + 1]);
+        auto const s =
+            op == "*" ? snippet::times :
+            op == "/" ? snippet::divides :
+            op == "%" ? snippet::modulus :
+                        snippet::and_;
+        result = apply(s, {result, rhs});
+    }
+    return result;
+}
+
+mpl_generator::lowered mpl_generator::lower_factor(ast::ast_node const& node)
+{
+    auto const& value = get<ast::factor>(node).value;
+    if (boost::get<ast::factor const*>(&value.value)) {
+        return apply(snippet::not_, {lower_factor(value)});
+    } else if (boost::get<ast::primary_expression const*>(&value.value)) {
+        return lower_primary(value);
+    } else if (boost::get<ast::constant const*>(&value.value)) {
+        return lower_constant(value);
+    }
+    return lower_call(value);
+}
+
+mpl_generator::lowered mpl_generator::lower_constant(ast::ast_node const& node)
+{
+    auto const& value = get<ast::constant>(node).value;
+    if (auto const i = boost::get<int>(&value)) {
+        headers |= mpl_int;
+        return {"mpl::int_<" + std::to_string(*i) + ">", true};
+    } else if (auto const c = boost::get<char>(&value)) {
+        headers |= mpl_char;
+        return {"mpl::char_<" + char_literal(*c) + ">", true};
+    } else if (auto const b = boost::get<bool>(&value)) {
+        headers |= mpl_bool;
+        return {*b ? "mpl::true_" : "mpl::false_", true};
+    } else if (auto const s = boost::get<boost::string_ref>(&value)) {
+        std::string chars;
+        for (auto const ch : *s) {
+            chars += (chars.empty() ? "" : ", ") + char_literal(ch);
+        }
+        return {rt(snippet::string_) + "<" + chars + ">", true};
+    }
+
+    auto const& list = get<ast::list>(boost::get<ast::ast_node>(value)).value;
+    if (auto const r = boost::get<ast::int_list const*>(&list.value)) {
+        return {rt(snippet::int_range) + "<" + std::to_string((*r)->min) + ", " + std::to_string((*r)->max) + ">", false};
+    } else if (auto const r = boost::get<ast::char_list const*>(&list.value)) {
+        return {rt(snippet::char_range) + "<" + char_literal((*r)->begin) + ", " + char_literal((*r)->end) + ">", false};
+    }
+
+    std::vector<lowered> elements;
+    for (auto const& e : get<ast::enum_list>(list).elements) {
+        elements.push_back(lower_primary(e));
+    }
+    bool const values = std::all_of(elements.begin(), elements.end(), [](lowered const& l){ return l.value; });
+    std::string text = rt(values ? snippet::list_ : snippet::make_list) + "<";
+    for (std::size_t i = 0; i < elements.size(); ++i) {
+        text += (i == 0 ? "" : ", ") + elements[i].text;
+    }
+    return {text + ">", values};
+}
+
+mpl_generator::lowered mpl_generator::lower_call(ast::ast_node const& node)
+{
+    auto const& call = get<ast::func_call>(node);
+    std::vector<lowered> args;
+    if (call.maybe_call_arguments) {
+        for (auto const& a : get<ast::call_args>(*call.maybe_call_arguments).arguments) {
+            args.push_back(lower_primary(a));
+        }
+    }
+    auto const name = call.function_name.to_string();
+
+    auto const b = lookup(call.function_name);
+    if (b == nullptr) {
+        auto const builtin = semantic::find_builtin(call.function_name);
+        if (!builtin) {
+            throw semantic_error{line_of(node), node.col, name + " is not declared"};
+        }
+        if (args.size() != 1) {
+            throw semantic_error{line_of(node), node.col, name + " takes 1 argument"};
+        }
+        switch (*builtin) {
+        case semantic::builtin::print:
+            return args.front();
+        case semantic::builtin::to_char:
+            return apply(snippet::to_char, args);
+        case semantic::builtin::string:
+            return apply(snippet::to_string, args);
+        }
+    }
+
+    if (b->function == nullptr) {
+        if (!args.empty()) {
+            throw semantic_error{line_of(node), node.col, name + " is not a function"};
+        }
+        return {b->cpp, true};
+    }
+    if (args.size() != b->function->arity) {
+        throw semantic_error{
+            line_of(node), node.col,
+            name + " takes " + std::to_string(b->function->arity) + (b->function->arity == 1 ? " argument" : " arguments")
+                + ", but is called with " + std::to_string(args.size())
+        };
+    }
+    if (args.empty()) {
+        return {b->cpp, false};
+    }
+
+    // Naming a template with values as arguments evaluates nothing, so
+    // call<> is needed only if an argument has to be evaluated first
+    bool const values = std::all_of(args.begin(), args.end(), [](lowered const& l){ return l.value; });
+    std::string text = values ? b->cpp + "<" : rt(snippet::call) + "<" + b->cpp + ", ";
+    for (std::size_t i = 0; i < args.size(); ++i) {
+        text += (i == 0 ? "" : ", ") + args[i].text;
+    }
+    return {text + ">", false};
+}
+
+std::string mpl_generator::rt(snippet const s)
+{
+    auto const i = static_cast<std::size_t>(s);
+    if (!used[i]) {
+        used[i] = true;
+        headers |= snippets[i].headers;
+        for (auto const d : snippets[i].dependencies) {
+            if (d != snippet::none) {
+                rt(d);
+            }
+        }
+    }
+    return std::string{"templa_rt::"} + snippets[i].name;
+}
+
+mpl_generator::lowered mpl_generator::apply(snippet const s, std::vector<lowered> const& args)
+{
+    auto text = rt(s) + "<";
+    for (std::size_t i = 0; i < args.size(); ++i) {
+        text += (i == 0 ? "" : ", ") + args[i].text;
+    }
+    return {text + ">", false};
+}
+
+void mpl_generator::write(std::ostream &out)
+{
+    scopes.push_back({false, 0, {}, {}, {}});
+    std::string program;
+    define_functions(top_level, program, 0, false);
+
+    auto const main = top_level.find(ast::identifier{"main"});
+    if (main && main->arity == 0) {
+        rt(snippet::print);
+    }
+
+    out << "// Generated by templa\n";
+    if (headers != 0) {
+        out << '\n';
+    }
+    for (std::size_t h = 0; h < sizeof(header_names) / sizeof(header_names[0]); ++h) {
+        if (headers & (1u << h)) {
+            out << "#include <" << header_names[h] << ">\n";
+        }
+    }
+    if (headers & mpl_headers) {
+        out << "\nnamespace mpl = boost::mpl;\n";
+    }
+
+    if (used.any()) {
+        out << "\nnamespace templa_rt {\n";
+        for (std::size_t i = 0; i < num_snippets; ++i) {
+            if (used[i]) {
+                out << '\n' << snippets[i].code;
+            }
+        }
+        out << "\n} // namespace templa_rt\n";
+    }
+
+    out << "\nnamespace program {\n\n" << program << "\n} // namespace program\n";
+
+    if (main && main->arity == 0) {
+        out << "\nint main()\n"
+               "{\n"
+               "    templa_rt::print(std::cout, program::" << scopes.front().bindings.at(ast::identifier{"main"}).cpp << "::type{});\n"
+               "    std::cout << '\\n';\n"
+               "}\n";
+    }
+    scopes.pop_back();
+}
+
+} // namespace
+
+void generate_mpl(std::ostream &out, ast::ast const& a)
+{
+    mpl_generator{a}.write(out);
+}
+
+} // namespace codegen
+} // namespace templa
@@ -0,0 +1,31 @@
+#if !defined TEMPLA_MPL_GENERATOR_HPP_INCLUDED
+#define      TEMPLA_MPL_GENERATOR_HPP_INCLUDED
+
+#include <ostream>
+
+#include "ast.hpp"
+#include "semantic.hpp"
+
+namespace templa {
+namespace codegen {
+
+// Writes a C++ program in which each templa function is a class template
+// computing its result in ::type, as in misc/fizzbuzz.cpp.  Integers, chars
+// and bools are Boost.MPL integral constants, and strings and lists are packs
+// of a small prelude which is written along with the program.  If the program
+// declares main, the output has a main() printing its value.
+//
+// Note:
+// Every expression becomes a type whose ::type is its value, and nothing
+// names ::type before the value is needed.  So branches of if and case are
+// lazy, as in mpl::eval_if, and so are arguments which are not values yet.
+// Only the headers and prelude templates which the program uses are written.
+//
+// Throws semantic::semantic_error if a name is undeclared or a call has the
+// wrong number of arguments.
+void generate_mpl(std::ostream &out, ast::ast const& a);
+
+} // namespace codegen
+} // namespace templa
+
+#endif    // TEMPLA_MPL_GENERATOR_HPP_INCLUDED
@@ -0,0 +1,142 @@
+#include <climits>
+#include <string>
+#include <utility>
+
+#include <boost/variant/get.hpp>
+
+#include "operations.hpp"
+
+namespace templa {
+namespace eval {
+
+boost::optional<int> numeric(value const& v)
+{
+    if (auto const i = boost::get<int>(&v)) {
+        return *i;
+    } else if (auto const c = boost::get<char>(&v)) {
+        return *c;
+    } else if (auto const b = boost::get<bool>(&v)) {
+        return *b ? 1 : 0;
+    }
+    return boost::none;
+}
+
+int checked(location const& at, long long const result)
+{
+    if (result < INT_MIN || result > INT_MAX) {
+        throw evaluation_error{at.line, at.col, "integer overflow"};
+    }
+    return static_cast<int>(result);
+}
+
+int operand(location const& at, boost::string_ref const op, value const& v)
+{
+    if (auto const n = numeric(v)) {
+        return *n;
+    }
+    throw evaluation_error{at.line, at.col, op.to_string() + " cannot take " + type_name(v)};
+}
+
+bool truth(location const& at, value const& condition)
+{
+    auto const n = numeric(condition);
+    if (!n) {
+        throw evaluation_error{at.line, at.col, std::string{"a condition cannot be "} + type_name(condition)};
+    }
+    return *n != 0;
+}
+
+value add(location const& at, value const& lhs, value const& rhs)
+{
+    auto const ls = boost::get<std::string>(&lhs);
+    auto const rs = boost::get<std::string>(&rhs);
+    auto const lc = boost::get<char>(&lhs);
+    auto const rc = boost::get<char>(&rhs);
+    if (ls && rs) {
+        return *ls + *rs;
+    } else if (ls && rc) {
+        return *ls + *rc;
+    } else if (lc && rs) {
+        return *lc + *rs;
+    } else if (lc && boost::get<int>(&rhs)) {
+        return static_cast<char>(*lc + boost::get<int>(rhs));
+    }
+
+    auto const ll = boost::get<list>(&lhs);
+    auto const rl = boost::get<list>(&rhs);
+    if (ll && rl) {
+        std::vector<value> elements(ll->begin(), ll->end());
+        elements.insert(elements.end(), rl->begin(), rl->end());
+        return list{std::move(elements)};
+    }
+
+    auto const ln = numeric(lhs);
+    auto const rn = numeric(rhs);
+    if (!ln || !rn) {
+        throw evaluation_error{at.line, at.col, std::string{"+ cannot take "} + type_name(lhs) + " and " + type_name(rhs)};
+    }
+    return checked(at, static_cast<long long>(*ln) + *rn);
+}
+
+value arithmetic(location const& at, char const op, value const& lhs, value const& rhs)
+{
+    char const name[] = {op, '\0'};
+    long long const l = operand(at, name, lhs);
+    long long const r = operand(at, name, rhs);
+    switch (op) {
+    case '-':
+        return checked(at, l - r);
+    case '*':
+        return checked(at, l * r);
+    default:
+        if (r == 0) {
+            throw evaluation_error{at.line, at.col, "division by zero"};
+        }
+        return checked(at, op == '/' ? l / r : l % r);
+    }
+}
+
+bool compare(location const& at, boost::string_ref const op, value const& lhs, value const& rhs)
+{
+    auto const l = operand(at, op, lhs);
+    auto const r = operand(at, op, rhs);
+    return
+        op == "<"  ? l < r :
+        op == ">"  ? l > r :
+        op == "<=" ? l <= r :
+                     l >= r;
+}
+
+std::size_t length_of(value const& v)
+{
+    if (auto const s = boost::get<std::string>(&v)) {
+        return s->size();
+    } else if (auto const l = boost::get<list>(&v)) {
+        return l->size();
+    }
+    return 0;
+}
+
+value apply_builtin(location const& at, semantic::builtin const b, boost::string_ref const name, value arg)
+{
+    switch (b) {
+    case semantic::builtin::print:
+        return arg;
+    case semantic::builtin::to_char:
+        if (auto const i = numeric(arg)) {
+            return static_cast<char>(*i);
+        }
+        break;
+    case semantic::builtin::string:
+        if (auto const c = boost::get<char>(&arg)) {
+            return std::string(1, *c);
+        } else if (boost::get<std::string>(&arg)) {
+            return arg;
+        }
+        break;
+    }
+    throw evaluation_error{at.line, at.col, name.to_string() + " cannot take " + type_name(arg)};
+}
+
+} // namespace eval
+} // namespace templa
@@ -0,0 +1,54 @@
+#if !defined TEMPLA_OPERATIONS_HPP_INCLUDED
+#define      TEMPLA_OPERATIONS_HPP_INCLUDED
+
+#include <cstddef>
+
+#include <boost/optional.hpp>
+#include <boost/utility/string_ref.hpp>
+
+#include "evaluator.hpp"
+#include "semantic.hpp"
+
+// Operators and builtins on values, shared by the evaluator and the VM so
+// that both compute and fail the same way
+namespace templa {
+namespace eval {
+
+// Where an operation is written, for its errors
+struct location {
+    std::size_t line;
+    std::size_t col;
+};
+
+// The integer which an integer, a char or a bool is in arithmetic, as
+// A::type::value is in the MPL output
+boost::optional<int> numeric(value const& v);
+
+// Integer arithmetic which fails like a constant expression of C++ does
+int checked(location const& at, long long const result);
+
+// The numeric operand of op
+int operand(location const& at, boost::string_ref const op, value const& v);
+
+// Whether the condition of an if or a case is true
+bool truth(location const& at, value const& condition);
+
+// + of integers, chars, strings and lists as templa_rt::plus
+value add(location const& at, value const& lhs, value const& rhs);
+
+// - * / % of integers, named by op
+value arithmetic(location const& at, char const op, value const& lhs, value const& rhs);
+
+// < > <= >= of integers, named by op
+bool compare(location const& at, boost::string_ref const op, value const& lhs, value const& rhs);
+
+// Chars of a string or elements of a list, otherwise 0
+std::size_t length_of(value const& v);
+
+// The result of calling b named name with arg
+value apply_builtin(location const& at, semantic::builtin const b, boost::string_ref const name, value arg);
+
+} // namespace eval
+} // namespace templa
+
+#endif    // TEMPLA_OPERATIONS_HPP_INCLUDED
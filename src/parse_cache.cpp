@@ -0,0 +1,239 @@
+#include <cerrno>
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "parse_cache.hpp"
+#include "ast_binary.hpp"
+#include "parser.hpp"
+
+namespace templa {
+
+namespace {
+
+std::uint64_t fnv1a(char const* first, char const* const last)
+{
+    std::uint64_t hash = 14695981039346656037ull;
+    for (; first != last; ++first) {
+        hash ^= static_cast<unsigned char>(*first);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// mkdir -p
+bool make_directories(std::string const& path)
+{
+    for (std::size_t i = 1; i <= path.size(); ++i) {
+        if (i != path.size() && path[i] != '/') {
+            continue;
+        }
+        auto const prefix = path.substr(0, i);
+        if (::mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST) {
+            return false;
+        }
+    }
+    struct ::stat st;
+    return ::stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+bool is_entry_name(std::string const& name)
+{
+    return name.size() > 4 && name.compare(name.size() - 4, 4, ".ast") == 0 && name[0] != '.';
+}
+
+struct entry {
+    std::string path;
+    std::uint64_t size;
+    struct ::timespec modified;
+};
+
+std::vector<entry> list_entries(std::string const& directory)
+{
+    std::vector<entry> entries;
+    DIR *const dir = ::opendir(directory.c_str());
+    if (dir == nullptr) {
+        return entries;
+    }
+    while (auto const e = ::readdir(dir)) {
+        std::string const name = e->d_name;
+        if (!is_entry_name(name)) {
+            continue;
+        }
+        auto path = directory + '/' + name;
+        struct ::stat st;
+        if (::stat(path.c_str(), &st) != 0) {
+            continue;
+        }
+        entries.push_back({std::move(path), static_cast<std::uint64_t>(st.st_size), st.st_mtim});
+    }
+    ::closedir(dir);
+    return entries;
+}
+
+std::uint64_t total_size(std::vector<entry> const& entries)
+{
+    std::uint64_t total = 0;
+    for (auto const& e : entries) {
+        total += e.size;
+    }
+    return total;
+}
+
+// Size of the file at path, or 0 if there is none
+std::uint64_t file_size(std::string const& path)
+{
+    struct ::stat st;
+    return ::stat(path.c_str(), &st) == 0 ? static_cast<std::uint64_t>(st.st_size) : 0;
+}
+
+} // namespace
+
+parse_cache::parse_cache(std::string const& directory, std::uint64_t const max_bytes)
+    : directory(directory), max_bytes(max_bytes), usable(make_directories(directory))
+{
+    if (usable) {
+        tracked_bytes = total_size(list_entries(directory));
+    }
+}
+
+std::string parse_cache::default_directory()
+{
+    if (auto const xdg = std::getenv("XDG_CACHE_HOME")) {
+        if (*xdg != '\0') {
+            return std::string{xdg} + "/templa";
+        }
+    }
+    if (auto const home = std::getenv("HOME")) {
+        return std::string{home} + "/.cache/templa";
+    }
+    return ".templa-cache";
+}
+
+std::string parse_cache::entry_path(helper::source_buffer const& source) const
+{
+    char name[64];
+    std::snprintf(
+        name, sizeof(name), "%016llx-%llx-%u.ast",
+        static_cast<unsigned long long>(fnv1a(source.begin(), source.end())),
+        static_cast<unsigned long long>(source.size()),
+        static_cast<unsigned>(syntax::parser::version)
+    );
+    return directory + '/' + name;
+}
+
+boost::optional<ast::ast> parse_cache::load(std::shared_ptr<helper::source_buffer const> const& source)
+{
+    if (!usable) {
+        ++misses;
+        return boost::none;
+    }
+
+    auto const path = entry_path(*source);
+    auto const entry = helper::source_buffer::map_file(path);
+    if (!entry) {
+        ++misses;
+        return boost::none;
+    }
+
+    // A different source of the same hash and size
+    if (entry->size() < source->size() || std::memcmp(entry->begin(), source->begin(), source->size()) != 0) {
+        ++misses;
+        return boost::none;
+    }
+
+    try {
+        auto a = ast::load_ast_binary(entry, source->size());
+        // Reparses and diffs need the text, not the entry
+        a.node_arena->retain(entry);
+        a.source = source;
+        // Marks the entry as recently used
+        ::utimensat(AT_FDCWD, path.c_str(), nullptr, 0);
+        ++hits;
+        return a;
+    } catch (ast::ast_format_error const&) {
+        // Written by an incompatible version or corrupted
+        ::unlink(path.c_str());
+        ++misses;
+        return boost::none;
+    }
+}
+
+void parse_cache::store(helper::source_buffer const& source, ast::ast const& a)
+{
+    if (!usable) {
+        return;
+    }
+
+    auto const path = entry_path(source);
+    // Unique among the threads and processes writing the same entry
+    static std::atomic<std::uint64_t> sequence{0};
+    auto const temporary = directory + "/.tmp-" + std::to_string(::getpid()) + '-' + std::to_string(sequence++)
+                           + '-' + path.substr(directory.size() + 1);
+    {
+        std::ofstream out(temporary, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            return;
+        }
+        out.write(source.begin(), source.size());
+        ast::save_ast_binary(out, a);
+        if (!out.good()) {
+            out.close();
+            ::unlink(temporary.c_str());
+            return;
+        }
+    }
+    // The entry may replace one which another compiler stored meanwhile
+    auto const replaced = file_size(path);
+    auto const size = file_size(temporary);
+    if (::rename(temporary.c_str(), path.c_str()) != 0) {
+        ::unlink(temporary.c_str());
+        return;
+    }
+    ++stores;
+
+    if ((tracked_bytes += size > replaced ? size - replaced : 0) > max_bytes) {
+        evict();
+    }
+}
+
+void parse_cache::evict()
+{
+    std::unique_lock<std::mutex> lock{evicting, std::try_to_lock};
+    if (!lock.owns_lock()) {
+        // Another thread is evicting already
+        return;
+    }
+
+    auto entries = list_entries(directory);
+    auto total = total_size(entries);
+    auto const low_water = max_bytes / 4 * 3;
+    if (total > max_bytes) {
+        std::sort(std::begin(entries), std::end(entries), [](entry const& lhs, entry const& rhs){
+            return lhs.modified.tv_sec != rhs.modified.tv_sec
+                ? lhs.modified.tv_sec < rhs.modified.tv_sec
+                : lhs.modified.tv_nsec < rhs.modified.tv_nsec;
+        });
+        for (auto const& e : entries) {
+            if (total <= low_water) {
+                break;
+            }
+            if (::unlink(e.path.c_str()) == 0) {
+                total -= e.size;
+                ++evictions;
+            }
+        }
+    }
+    tracked_bytes = total;
+}
+
+} // namespace templa
@@ -0,0 +1,82 @@
+#if !defined TEMPLA_PARSE_CACHE_HPP_INCLUDED
+#define      TEMPLA_PARSE_CACHE_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <mutex>
+
+#include <boost/optional.hpp>
+
+#include "ast.hpp"
+#include "helper/source_buffer.hpp"
+
+namespace templa {
+
+// Directory of binary ASTs (see ast_binary.hpp) keyed by a hash of the source
+// text, so that an unchanged source is loaded instead of parsed.
+//
+// Note:
+// Each entry is a file named after the FNV-1a hash and the size of the
+// source and syntax::parser::version.  It holds the source text followed by
+// the binary AST, and a hit compares the text with the source, so a hash
+// collision is a miss rather than the AST of another program.
+//
+// A hit updates the modification time of the entry.  The size of the
+// directory is measured on construction and then tracked by the stores of
+// this parse_cache.  Only when it exceeds max_bytes does store() measure the
+// directory again and evict the entries modified least recently until it is
+// at most 3/4 of max_bytes, so eviction scans the directory once every many
+// stores rather than after each.  Entries of other processes sharing the
+// directory are only seen by these scans.
+//
+// Entries are written to a temporary file and renamed, so concurrent
+// compilers sharing the directory never see a partial entry.  One
+// parse_cache may also be shared by compilers in different threads.
+class parse_cache {
+public:
+    struct statistics {
+        std::size_t hits = 0;
+        std::size_t misses = 0;
+        std::size_t stores = 0;
+        std::size_t evictions = 0;
+    };
+
+    parse_cache(std::string const& directory, std::uint64_t const max_bytes);
+
+    // The cached AST of source, whose source is source as if it had been
+    // parsed.  Its operators and string literals refer into the mapped cache
+    // entry, which its arena keeps alive.
+    boost::optional<ast::ast> load(std::shared_ptr<helper::source_buffer const> const& source);
+
+    void store(helper::source_buffer const& source, ast::ast const& a);
+
+    statistics stats() const
+    {
+        return {hits, misses, stores, evictions};
+    }
+
+    // $XDG_CACHE_HOME/templa, or ~/.cache/templa
+    static std::string default_directory();
+
+private:
+    std::string entry_path(helper::source_buffer const& source) const;
+    void evict();
+
+    std::string const directory;
+    std::uint64_t const max_bytes;
+    bool const usable;
+    // Bytes of the entries in the directory, as far as this cache knows
+    std::atomic<std::uint64_t> tracked_bytes{0};
+    std::mutex evicting;
+    std::atomic<std::size_t> hits{0};
+    std::atomic<std::size_t> misses{0};
+    std::atomic<std::size_t> stores{0};
+    std::atomic<std::size_t> evictions{0};
+};
+
+} // namespace templa
+
+#endif    // TEMPLA_PARSE_CACHE_HPP_INCLUDED
@@ -2,6 +2,12 @@
 #define BOOST_RESULT_OF_USE_DECLTYPE 1
 
 #include <utility>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <atomic>
+#include <vector>
+#include <sstream>
 
 #include <boost/spirit/include/qi.hpp>
 #include <boost/spirit/include/qi_as.hpp>
@@ -10,9 +16,13 @@
 #include <boost/spirit/include/phoenix_operator.hpp>
 #include <boost/spirit/include/phoenix_stl.hpp>
 #include <boost/spirit/include/phoenix_bind.hpp>
-#include <boost/spirit/include/support_line_pos_iterator.hpp>
+#include <boost/spirit/include/phoenix_function.hpp>
 
 #include "parser.hpp"
+#include "descent_parser.hpp"
+#include "lexer.hpp"
+#include "ast_relocation.hpp"
+#include "helper/position_iterator.hpp"
 
 namespace templa {
 namespace syntax {
@@ -28,44 +38,84 @@ using qi::_2;
 using qi::_3;
 using qi::_a;
 using qi::_b;
-using qi::string;
 using phx::bind;
 
 namespace detail {
 
+    template<class T>
+    T const& to_node_field(helper::arena &, T const& value)
+    {
+        return value;
+    }
+
+    template<class T>
+    boost::iterator_range<T const*> to_node_field(helper::arena &a, std::vector<T> const& elements)
+    {
+        auto const first = a.copy_array(elements.data(), elements.size());
+        return {first, first + elements.size()};
+    }
+
+    // The text matched by qi::raw.  Iterator adapts a pointer into the source.
+    template<class Iterator>
+    boost::string_ref to_string_ref(boost::iterator_range<Iterator> const& matched)
+    {
+        auto const first = matched.begin().base();
+        return {first, static_cast<std::size_t>(matched.end().base() - first)};
+    }
+
+    template<class Iterator>
+    ast::identifier to_identifier(boost::iterator_range<Iterator> const& matched)
+    {
+        return ast::identifier{to_string_ref(matched)};
+    }
+
+    template<class Iterator>
+    boost::string_ref to_node_field(helper::arena &, boost::iterator_range<Iterator> const& matched)
+    {
+        return to_string_ref(matched);
+    }
+
+    // Allocates the node in the arena of the parse in progress.  Child lists
+    // collected by Spirit are copied into the arena as well and matched text
+    // becomes a reference into the source.
     template<class NodeType>
     struct construct_node {
+        helper::arena *const *node_arena;
+
         template<class... Args>
         ast::ast_node operator()(Args &&... args) const
         {
-            return {NodeType{args...}, 0, 0};
+            auto &a = **node_arena;
+            NodeType const* const node = a.make<NodeType>(to_node_field(a, args)...);
+            return {node, 0, 0};
         }
     };
 
-} // namespace detail
+    // A program is one run of the declarations
+    template<>
+    struct construct_node<ast::program> {
+        helper::arena *const *node_arena;
 
-template<class NodeType, class... Holders>
-inline auto bind_node(Holders &&... holders)
-{
-    return phx::bind(detail::construct_node<NodeType>{}, holders...);
-}
+        ast::ast_node operator()(std::vector<ast::ast_node> const& declarations) const
+        {
+            auto &a = **node_arena;
+            return {ast::make_program(a, to_node_field(a, declarations)), 0, 0};
+        }
+    };
 
-namespace detail {
-    template<class Iterator>
-    auto position_of(Iterator begin, Iterator current)
-    {
-        std::size_t line = 1;
-        std::size_t col = 1;
-        for (; begin != current; ++begin) {
-            if (*begin == '\n') {
-                col = 1;
-                line++;
-                continue;
-            }
-            col++;
+    // Called on success of each rule with the iterator pointing to the first
+    // character of the matched node (after skipping blanks).
+    struct position_annotator {
+        template<class Iterator>
+        void operator()(ast::ast_node &node, Iterator const& first) const
+        {
+            node.line = static_cast<std::uint32_t>(first.line());
+            node.col = static_cast<std::uint32_t>(first.col());
         }
-        return std::make_pair(line, col);
-    }
+    };
+
+    using iterator = helper::position_iterator<char const*>;
+
 } // namespace detail
 
 template<class Iterator>
@@ -73,6 +123,12 @@ class grammar : public qi::grammar<Iterator, ast::ast_node(), ascii::blank_type>
     template<class Value, class... Extra>
     using rule = qi::rule<Iterator, Value, ascii::blank_type, Extra...>;
 
+    template<class NodeType, class... Holders>
+    auto bind_node(Holders &&... holders) const
+    {
+        return phx::bind(detail::construct_node<NodeType>{&node_arena}, holders...);
+    }
+
 public:
     grammar() : grammar::base_type(program)
     {
@@ -238,12 +294,14 @@ public:
 
         relational_operator
             = (
-                  string("==")
-                | string("!=")
-                | string("<")
-                | string(">")
-                | string("<=")
-                | string(">=")
+                qi::raw[
+                      lit("==")
+                    | lit("!=")
+                    | lit("<=")
+                    | lit(">=")
+                    | lit("<")
+                    | lit(">")
+                ]
               ) [
                 _val = bind_node<ast::relational_operator>(_1)
             ]
@@ -251,10 +309,12 @@ public:
 
         additive_operator
             = (
-                  string("+")
-                | string("-")
-                | string("|")
-                | string("||")
+                qi::raw[
+                      lit("+")
+                    | lit("-")
+                    | lit("||")
+                    | lit("|")
+                ]
               ) [
                 _val = bind_node<ast::additive_operator>(_1)
             ]
@@ -262,11 +322,13 @@ public:
 
         mult_operator
             = (
-                  string("*")
-                | string("/")
-                | string("%")
-                | string("&")
-                | string("&&")
+                qi::raw[
+                      lit("*")
+                    | lit("/")
+                    | lit("%")
+                    | lit("&&")
+                    | lit("&")
+                ]
             ) [
                 _val = bind_node<ast::mult_operator>(_1)
             ]
@@ -276,17 +338,19 @@ public:
             = (
                   qi::int_
                 | ('\'' > qi::char_ > '\'')
-                | qi::bool_
-                | qi::as_string[qi::lexeme['"' > *(qi::char_ - '"') > '"']]
+                | qi::lexeme[qi::bool_ >> !(qi::alnum | '_')]
+                | string_literal
                 | list
             ) [
                 _val = bind_node<ast::constant>(_1)
             ]
         ;
 
+        // enum_list must be the last because its expectation point on ']'
+        // makes a range like [1 .. 10] a hard error.
         list
             = (
-                enum_list | int_list | char_list
+                int_list | char_list | enum_list
             ) [
                 _val = bind_node<ast::list>(_1)
             ]
@@ -348,25 +412,52 @@ public:
         ;
 
         name
-            =
-                qi::as_string[(qi::alpha | qi::char_('_'))
-                >> *(qi::alnum | qi::char_('_'))]
+            = qi::raw[
+                (qi::alpha | '_')
+                >> *(qi::alnum | '_')
+            ] [
+                _val = phx::bind(&detail::to_identifier<Iterator>, _1)
+            ]
         ;
 
-        qi::on_error<qi::fail>
-        (
-            program,
-            // qi::_2 : end of string to parse
-            // qi::_3 : iterator at failed point
-            // qi::_4 : what failed?
-            std::cerr
-                << phx::val( "Error: Expecting " )
-                << qi::_4
-                << phx::val( "\nhere:\n\"" )
-                << phx::construct<std::string>( _3, _2 ) // TODO: get line and col from iterators
-                << phx::val( "\"" )
-                << std::endl
-        );
+        string_literal
+            = (
+                '"' > qi::raw[*(qi::char_ - '"')] > '"'
+            ) [
+                _val = phx::bind(&detail::to_string_ref<Iterator>, _1)
+            ]
+        ;
+
+        auto const annotate = phx::function<detail::position_annotator>{}(_val, _1);
+        qi::on_success(program, annotate);
+        qi::on_success(decl_func, annotate);
+        qi::on_success(decl_params, annotate);
+        qi::on_success(decl_param, annotate);
+        qi::on_success(list_match, annotate);
+        qi::on_success(type_match, annotate);
+        qi::on_success(expression, annotate);
+        qi::on_success(let_expression, annotate);
+        qi::on_success(if_expression, annotate);
+        qi::on_success(case_expression, annotate);
+        qi::on_success(case_when, annotate);
+        qi::on_success(primary_expression, annotate);
+        qi::on_success(formula, annotate);
+        qi::on_success(term, annotate);
+        qi::on_success(factor, annotate);
+        qi::on_success(relational_operator, annotate);
+        qi::on_success(additive_operator, annotate);
+        qi::on_success(mult_operator, annotate);
+        qi::on_success(constant, annotate);
+        qi::on_success(list, annotate);
+        qi::on_success(enum_list, annotate);
+        qi::on_success(int_list, annotate);
+        qi::on_success(char_list, annotate);
+        qi::on_success(func_call, annotate);
+        qi::on_success(call_args, annotate);
+
+        // qi::_3 : iterator at failed point
+        // qi::_4 : what failed?
+        qi::on_error<qi::fail>(program, phx::bind(&grammar::expectation_failed, this, _3, qi::_4));
     }
 
 private:
@@ -403,31 +494,582 @@ private:
     , primary_expression
     , term;
 
-    rule<std::string()> name;
+    // No skipper, so they are lexemes
+    qi::rule<Iterator, ast::identifier()> name;
+    qi::rule<Iterator, boost::string_ref()> string_literal;
+
+    helper::arena *node_arena = nullptr;
+
+    void expectation_failed(Iterator const& where, boost::spirit::info const& what)
+    {
+        // A stream per call; nothing is shared between grammars
+        std::ostringstream message;
+        message << "expecting " << what;
+        failure = {true, where.line(), where.col(), message.str()};
+    }
+
+public:
+    // DECL_FUNC alone, for parsing a program one declaration at a time
+    rule<ast::ast_node()> const& declaration() const
+    {
+        return decl_func;
+    }
+
+    // Nodes built by following parses are allocated in a.
+    void use_arena(helper::arena &a)
+    {
+        node_arena = &a;
+        failure = {};
+    }
+
+    struct expectation_failure {
+        bool happened = false;
+        std::size_t line = 0, col = 0;
+        std::string expected;
+    };
+
+    // The last expectation failure of the current parse
+    expectation_failure failure;
 };
 
-ast::ast parser::parse(std::string const& code)
+struct parser::impl {
+    backend const selected;
+
+    // Only built for backend::spirit
+    std::unique_ptr<grammar<detail::iterator>> spiritual_parser;
+
+    // Parsers of the other workers of a parallel parse, built on first use
+    std::vector<std::unique_ptr<impl>> workers;
+
+    static std::unique_ptr<impl> make(backend const b)
+    {
+        std::unique_ptr<impl> i{new impl{b, nullptr, {}}};
+        if (b == backend::spirit) {
+            i->spiritual_parser = std::make_unique<grammar<detail::iterator>>();
+        }
+        return i;
+    }
+
+    // Parses [begin, end) as a program.  line and col are the position of
+    // begin in the whole source.  A syntax error is reported into diags if
+    // it is not null and thrown.
+    ast::ast_node parse_program(
+        char const* const begin,
+        char const* const end,
+        std::uint32_t const line,
+        std::uint32_t const col,
+        helper::arena &node_arena,
+        diagnostics *const diags
+    );
+
+    // Parses [begin, end) as a program, reporting every syntax error into
+    // diags and skipping to the next top-level declaration after it
+    ast::ast_node recover_program(
+        char const* const begin,
+        char const* const end,
+        helper::arena &node_arena,
+        diagnostics &diags
+    );
+};
+
+parser::parser(backend const b)
+    : pimpl(impl::make(b))
+{}
+
+parser::~parser() = default;
+parser::parser(parser &&) noexcept = default;
+parser &parser::operator=(parser &&) noexcept = default;
+
+ast::ast parser::parse(std::string const& code, diagnostics *const diags)
+{
+    return parse(helper::source_buffer::copy_of(code), diags);
+}
+
+ast::ast parser::parse(std::shared_ptr<helper::source_buffer const> const& source, diagnostics *const diags)
+{
+    auto const node_arena = std::make_shared<helper::arena>();
+    auto const root = pimpl->parse_program(source->begin(), source->end(), 1, 1, *node_arena, diags);
+    return {root, node_arena, source};
+}
+
+namespace {
+
+    std::size_t count_lines(char const* first, char const* const last)
+    {
+        std::size_t count = 0;
+        while ((first = static_cast<char const*>(std::memchr(first, '\n', last - first)))) {
+            ++count;
+            ++first;
+        }
+        return count;
+    }
+
+    // Offsets from begin of the declarations, whose lines are off by
+    // line_delta, in [begin, end) whose first character is at line and col
+    std::size_t *declaration_offsets(
+        helper::arena &node_arena,
+        char const* const begin,
+        char const* const end,
+        std::size_t line,
+        std::size_t const col,
+        ast::node_list const& declarations,
+        std::int64_t const line_delta
+    )
+    {
+        auto const offsets = node_arena.make_array<std::size_t>(declarations.size());
+        // The first line begins before begin unless col is 1
+        auto line_start = -static_cast<std::ptrdiff_t>(col - 1);
+        char const* p = begin;
+        for (std::size_t i = 0; i < declarations.size(); ++i) {
+            auto const& d = declarations[i];
+            for (auto const target = static_cast<std::size_t>(d.line + line_delta); line < target && p != nullptr; ++line) {
+                p = static_cast<char const*>(std::memchr(p, '\n', end - p));
+                if (p != nullptr) {
+                    line_start = ++p - begin;
+                }
+            }
+            offsets[i] = static_cast<std::size_t>(line_start + d.col - 1);
+        }
+        return offsets;
+    }
+
+    // True if [begin, end) ends with a line break, ignoring blanks
+    bool ends_with_line_break(char const* const begin, char const* end)
+    {
+        while (end != begin && (end[-1] == ' ' || end[-1] == '\t')) {
+            --end;
+        }
+        return end != begin && (end[-1] == '\n' || end[-1] == '\r');
+    }
+
+    bool is_identifier_start(char const c)
+    {
+        return ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') || c == '_';
+    }
+
+    bool starts_with_keyword(char const* const p, char const* const end)
+    {
+        auto word_end = p;
+        while (word_end != end && (is_identifier_start(*word_end) || ('0' <= *word_end && *word_end <= '9'))) {
+            ++word_end;
+        }
+        return is_continuation_keyword({p, static_cast<std::size_t>(word_end - p)});
+    }
+
+    // Beginning of the first line after p which starts with a name at column
+    // 1, or end.  The name is likely the one of a top-level declaration.
+    char const* next_declaration_start(char const* p, char const* const end)
+    {
+        while ((p = static_cast<char const*>(std::memchr(p, '\n', end - p)))) {
+            ++p;
+            if (p != end && is_identifier_start(*p) && !starts_with_keyword(p, end)) {
+                return p;
+            }
+        }
+        return end;
+    }
+
+} // namespace
+
+ast::ast parser::parse(
+    std::shared_ptr<helper::source_buffer const> const& source,
+    helper::thread_pool &pool,
+    diagnostics *const diags
+)
+{
+    // Smaller chunks don't pay for the merge
+    std::size_t const min_chunk_size = 256 * 1024;
+    // More chunks than workers balance chunks which parse slower than others
+    auto const num_chunks = std::min(pool.size() * 4, source->size() / min_chunk_size);
+    if (pool.size() == 1 || num_chunks < 2) {
+        return parse(source, diags);
+    }
+
+    struct chunk {
+        char const* begin;
+        char const* end;
+        std::uint32_t line;
+        std::shared_ptr<helper::arena> node_arena;
+        ast::ast_node root;
+    };
+
+    std::vector<chunk> chunks;
+    chunks.reserve(num_chunks);
+    chunks.push_back({source->begin(), source->end(), 1, nullptr, {}});
+    for (std::size_t i = 1; i < num_chunks; ++i) {
+        auto const nominal = source->begin() + source->size() / num_chunks * i;
+        auto const start = next_declaration_start(std::max(nominal, chunks.back().begin), source->end());
+        if (start == source->end()) {
+            break;
+        }
+        auto &previous = chunks.back();
+        previous.end = start - 1;
+        // A chunk must not end with a blank line, which parses on its own but
+        // not between declarations
+        if (ends_with_line_break(previous.begin, previous.end)) {
+            return parse(source, diags);
+        }
+        auto const line = previous.line + 1 + count_lines(previous.begin, previous.end);
+        chunks.push_back({start, source->end(), static_cast<std::uint32_t>(line), nullptr, {}});
+    }
+
+    while (pimpl->workers.size() + 1 < pool.size()) {
+        pimpl->workers.push_back(impl::make(pimpl->selected));
+    }
+
+    std::atomic<bool> failed{false};
+    pool.parallel_for(chunks.size(), [&](std::size_t const i, std::size_t const worker){
+        if (failed) {
+            return;
+        }
+        auto &p = worker == 0 ? *pimpl : *pimpl->workers[worker - 1];
+        auto &c = chunks[i];
+        c.node_arena = std::make_shared<helper::arena>();
+        try {
+            c.root = p.parse_program(c.begin, c.end, c.line, 1, *c.node_arena, nullptr);
+        } catch (parse_error const&) {
+            failed = true;
+        }
+    });
+    if (failed) {
+        // Either the source is invalid or a split was not at a declaration.
+        // The whole parse reports the right error in both cases.
+        return parse(source, diags);
+    }
+
+    // The declarations of each chunk are a run of the program
+    auto const node_arena = std::make_shared<helper::arena>();
+    auto const runs = node_arena->make_array<ast::declaration_run>(chunks.size());
+    auto dest = runs;
+    for (auto const& c : chunks) {
+        auto const& chunk_runs = boost::get<ast::program const*>(c.root.value)->function_declarations;
+        for (auto r : chunk_runs) {
+            r.offset_delta += c.begin - source->begin();
+            *dest++ = r;
+        }
+        node_arena->retain(c.node_arena);
+    }
+
+    ast::ast_node const root{
+        node_arena->make<ast::program>(ast::program{{runs, dest}}),
+        chunks.front().root.line,
+        chunks.front().root.col
+    };
+    return {root, node_arena, source};
+}
+
+ast::ast parser::parse_recovering(std::shared_ptr<helper::source_buffer const> const& source, diagnostics &diags)
+{
+    auto const node_arena = std::make_shared<helper::arena>();
+    auto const root = pimpl->recover_program(source->begin(), source->end(), *node_arena, diags);
+    return {root, node_arena, source};
+}
+
+ast::ast_node parser::impl::recover_program(
+    char const* const begin,
+    char const* const end,
+    helper::arena &node_arena,
+    diagnostics &diags
+)
+{
+    if (selected == backend::recursive_descent) {
+        auto const root = descent_parser{node_arena, begin, end}.parse_program(&diags);
+        auto const& declarations = boost::get<ast::program const*>(root.value)->function_declarations.front().declarations;
+        return {
+            ast::make_program(node_arena, declarations, declaration_offsets(node_arena, begin, end, 1, 1, declarations, 0)),
+            root.line,
+            root.col
+        };
+    }
+
+    // Same as the program rule, DECL_FUNC % '\n' > (eol | eoi), but with the
+    // declarations parsed one by one so that a failed one can be skipped
+    spiritual_parser->use_arena(node_arena);
+    detail::iterator itr{begin};
+    detail::iterator const last{end};
+    std::vector<ast::ast_node> decls;
+
+    // Reports the error at where and moves itr to the next declaration
+    auto const skip_error = [&](detail::iterator const& where, std::string const& message)
+    {
+        diags.report(where.line(), where.col(), message);
+        auto const next = next_declaration_start(where.base(), end);
+        if (next == end) {
+            return false;
+        }
+        itr = detail::iterator{next, where.line() + count_lines(where.base(), next), 1};
+        return true;
+    };
+
+    for (;;) {
+        ast::ast_node decl;
+        try {
+            if (!qi::phrase_parse(itr, last, spiritual_parser->declaration(), ascii::blank, decl)) {
+                if (skip_error(itr, "expecting a declaration")) {
+                    continue;
+                }
+                break;
+            }
+        } catch (qi::expectation_failure<detail::iterator> const& e) {
+            std::ostringstream message;
+            message << "expecting " << e.what_;
+            if (skip_error(e.first, message.str())) {
+                continue;
+            }
+            break;
+        }
+        decls.push_back(decl);
+
+        auto rest = itr;
+        if (qi::parse(rest, last, -qi::eol >> qi::eoi)) {
+            break;
+        }
+        if (*itr == '\n') {
+            ++itr;
+            continue;
+        }
+        if (!skip_error(itr, "expecting <alternative><eol><eoi>")) {
+            break;
+        }
+    }
+
+    // The program is at its first token, as in the program rule
+    detail::iterator first{begin};
+    while (first != last && (*first == ' ' || *first == '\t')) {
+        ++first;
+    }
+    auto const elements = node_arena.copy_array(decls.data(), decls.size());
+    ast::node_list const declarations{elements, elements + decls.size()};
+    return {
+        ast::make_program(node_arena, declarations, declaration_offsets(node_arena, begin, end, 1, 1, declarations, 0)),
+        static_cast<std::uint32_t>(first.line()),
+        static_cast<std::uint32_t>(first.col())
+    };
+}
+
+ast::ast parser::reparse(
+    ast::ast const& previous,
+    std::shared_ptr<helper::source_buffer const> const& source,
+    text_edit const& edit,
+    diagnostics *const diags
+)
 {
-    auto itr = std::begin(code);
-    auto const end = std::end(code);
-    grammar<decltype(itr)> spiritual_parser;
-    ast::ast_node root;
+    // Each reparse adds at most two runs.  More runs than this are merged
+    // into one, which copies the nodes of the runs whose lines moved, at most
+    // once every max_runs / 2 reparses.
+    std::size_t const max_runs = 64;
+
+    auto const& old_text = *previous.source;
+    auto const program = boost::get<ast::program const*>(&previous.root.value);
+    if (program == nullptr
+            || ast::count_declarations((*program)->function_declarations) == 0
+            || edit.offset + edit.old_length > old_text.size()
+            || old_text.size() - edit.old_length + edit.new_length != source->size()) {
+        return parse(source, diags);
+    }
+
+    auto const node_arena = std::make_shared<helper::arena>();
+
+    // The offsets of an AST which was not parsed, e.g. loaded from its binary
+    // form, are found once by scanning the text
+    std::vector<ast::declaration_run> runs;
+    std::vector<std::size_t> run_starts;
+    std::size_t num_decls = 0;
+    for (auto r : (*program)->function_declarations) {
+        if (r.declarations.empty()) {
+            continue;
+        }
+        if (r.offsets == nullptr) {
+            r.offsets = declaration_offsets(*node_arena, old_text.begin(), old_text.end(), 1, 1, r.declarations, r.line_delta);
+            r.offset_delta = 0;
+        }
+        runs.push_back(r);
+        run_starts.push_back(num_decls);
+        num_decls += r.declarations.size();
+    }
+
+    // The i-th declaration at its position in the old text
+    struct located {
+        std::size_t line;
+        std::size_t col;
+        std::size_t offset;
+    };
+    auto const at = [&](std::size_t const i){
+        auto const r = std::upper_bound(run_starts.begin(), run_starts.end(), i) - run_starts.begin() - 1;
+        auto const& run = runs[r];
+        auto const k = i - run_starts[r];
+        auto const& d = run.declarations[k];
+        return located{
+            static_cast<std::size_t>(d.line + run.line_delta),
+            d.col,
+            static_cast<std::size_t>(run.offsets[k] + run.offset_delta)
+        };
+    };
+    // The number of declarations from the first one for which holds(d) is
+    // true, as it is for a prefix of them
+    auto const count_while = [&](auto const& holds){
+        std::size_t low = 0, high = num_decls;
+        while (low < high) {
+            auto const middle = low + (high - low) / 2;
+            if (holds(at(middle))) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        return low;
+    };
+
+    // Lines of the edit in the old text, counted from the declaration before
+    // it rather than from the beginning of the text
+    auto const edit_begin = old_text.begin() + edit.offset;
+    auto const edit_end = edit_begin + edit.old_length;
+    auto const preceding = count_while([&](located const& d){ return d.offset <= edit.offset; });
+    auto const anchor = preceding == 0 ? located{1, 1, 0} : at(preceding - 1);
+    auto const edit_first_line = anchor.line + count_lines(old_text.begin() + anchor.offset, edit_begin);
+    auto const edit_last_line = edit_first_line + count_lines(edit_begin, edit_end);
+
+    // The touched declarations are [first, last].  The declaration before the
+    // edited line is included, so that an edit at the very beginning of a
+    // declaration is also seen by the one before it.
+    auto const after_first = count_while([&](located const& d){ return d.line < edit_first_line; });
+    std::size_t const first = after_first == 0 ? 0 : after_first - 1;
+    auto const through_last = count_while([&](located const& d){ return d.line <= edit_last_line; });
+    std::size_t const last = std::max(first, through_last == 0 ? 0 : through_last - 1);
+
+    // The region is from the first touched declaration to the newline before
+    // the next untouched one
+    auto const first_decl = at(first);
+    auto const region_begin = old_text.begin() + first_decl.offset;
+    char const* region_end = old_text.end();
+    if (last + 1 != num_decls) {
+        auto const next = at(last + 1);
+        region_end = old_text.begin() + (next.offset - (next.col - 1)) - 1;
+    }
+    if (region_begin > edit_begin || region_end < edit_end) {
+        return parse(source, diags);
+    }
+
+    std::ptrdiff_t const size_delta = edit.new_length - edit.old_length;
+    auto const new_region_begin = source->begin() + (region_begin - old_text.begin());
+    auto const new_region_end = source->begin() + (region_end - old_text.begin()) + size_delta;
+
+    // A program may end with a line break, but between declarations it would
+    // be a blank line, which the whole program does not accept
+    if (last + 1 != num_decls && ends_with_line_break(new_region_begin, new_region_end)) {
+        return parse(source, diags);
+    }
+
+    ast::ast_node region;
+    try {
+        region = pimpl->parse_program(
+            new_region_begin, new_region_end,
+            static_cast<std::uint32_t>(first_decl.line), static_cast<std::uint32_t>(first_decl.col),
+            *node_arena, nullptr
+        );
+    } catch (parse_error const&) {
+        return parse(source, diags);
+    }
+
+    std::int64_t const line_delta
+        = static_cast<std::int64_t>(count_lines(new_region_begin, new_region_end))
+        - static_cast<std::int64_t>(count_lines(region_begin, region_end));
+
+    // Declarations before the region are shared as they are, and the ones
+    // after it with their runs moved by the edit
+    std::vector<ast::declaration_run> new_runs;
+    auto const share = [&](std::size_t const from, std::size_t const to, std::int64_t const lines, std::int64_t const bytes){
+        for (std::size_t r = 0; r < runs.size(); ++r) {
+            auto const run_begin = run_starts[r];
+            auto const run_end = run_begin + runs[r].declarations.size();
+            auto const lo = std::max(from, run_begin), hi = std::min(to, run_end);
+            if (lo < hi) {
+                auto const& d = runs[r].declarations;
+                new_runs.push_back({
+                    {d.begin() + (lo - run_begin), d.begin() + (hi - run_begin)},
+                    runs[r].line_delta + lines,
+                    runs[r].offsets + (lo - run_begin),
+                    runs[r].offset_delta + bytes
+                });
+            }
+        }
+    };
+    share(0, first, 0, 0);
+    for (auto r : boost::get<ast::program const*>(region.value)->function_declarations) {
+        r.offset_delta += new_region_begin - source->begin();
+        new_runs.push_back(r);
+    }
+    share(last + 1, num_decls, line_delta, size_delta);
 
-    if (!qi::phrase_parse(itr, end, spiritual_parser, ascii::blank, root) || itr != end) {
-        auto const pos = detail::position_of(std::begin(code), itr);
-        throw parse_error{pos.first, pos.second};
+    if (new_runs.size() > max_runs) {
+        std::size_t total = 0;
+        for (auto const& r : new_runs) {
+            total += r.declarations.size();
+        }
+        auto const decls = node_arena->make_array<ast::ast_node>(total);
+        auto const offsets = node_arena->make_array<std::size_t>(total);
+        std::size_t i = 0;
+        for (auto const& r : new_runs) {
+            for (std::size_t k = 0; k < r.declarations.size(); ++k, ++i) {
+                auto const& d = r.declarations[k];
+                decls[i] = r.line_delta == 0 ? d : ast::relocate(*node_arena, d, r.line_delta);
+                offsets[i] = static_cast<std::size_t>(r.offsets[k] + r.offset_delta);
+            }
+        }
+        new_runs.assign(1, {{decls, decls + total}, 0, offsets, 0});
     }
 
-    return {root};
+    node_arena->retain(previous.node_arena);
+    node_arena->retain(previous.source);
+
+    auto const new_runs_first = node_arena->copy_array(new_runs.data(), new_runs.size());
+    auto const& root_position = first == 0 ? region : previous.root;
+    ast::ast_node const root{
+        node_arena->make<ast::program>(ast::program{{new_runs_first, new_runs_first + new_runs.size()}}),
+        root_position.line,
+        root_position.col
+    };
+    return {root, node_arena, source};
 }
 
-std::ostringstream parse_error::buffer;
-char const* parse_error::what() const noexcept
+ast::ast_node parser::impl::parse_program(
+    char const* const begin,
+    char const* const end,
+    std::uint32_t const line,
+    std::uint32_t const col,
+    helper::arena &node_arena,
+    diagnostics *const diags
+)
 {
-    auto &buf = parse_error::buffer;
-    buf.str() = "";
-    buf << std::runtime_error::what() << "line " << line << ", col " << col;
-    return buf.str().c_str();
+    try {
+        ast::ast_node root;
+        if (selected == backend::recursive_descent) {
+            root = descent_parser{node_arena, begin, end, line, col}.parse_program();
+        } else {
+            detail::iterator itr{begin, line, col};
+            detail::iterator const last{end};
+            spiritual_parser->use_arena(node_arena);
+
+            if (!qi::phrase_parse(itr, last, *spiritual_parser, ascii::blank, root) || itr != last) {
+                auto const& failure = spiritual_parser->failure;
+                if (failure.happened) {
+                    throw parse_error{failure.line, failure.col, failure.expected};
+                }
+                throw parse_error{itr.line(), itr.col()};
+            }
+        }
+
+        // reparse() finds the declarations which an edit touches by their
+        // offsets
+        auto const& declarations = boost::get<ast::program const*>(root.value)->function_declarations.front().declarations;
+        auto const offsets = declaration_offsets(node_arena, begin, end, line, col, declarations, 0);
+        return {ast::make_program(node_arena, declarations, offsets), root.line, root.col};
+    } catch (parse_error const& e) {
+        if (diags) {
+            diags->report(e.line, e.col, e.message);
+        }
+        throw;
+    }
 }
 
 } // namespace syntax
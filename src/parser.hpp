@@ -4,29 +4,114 @@
 #include <string>
 #include <stdexcept>
 #include <cstddef>
-#include <sstream>
+#include <cstdint>
+#include <memory>
 
 #include "ast.hpp"
+#include "diagnostics.hpp"
+#include "helper/source_buffer.hpp"
+#include "helper/thread_pool.hpp"
 
 namespace templa {
 namespace syntax {
 
 using std::size_t;
 
+// Note:
+// The Spirit grammar is built once on construction and reused by every
+// parse() call because building its rules is far more expensive than parsing
+// small inputs.
+//
+// backend::recursive_descent selects the hand-written lexer and predictive
+// parser instead.  It produces the same AST and is much faster on large
+// inputs.
+//
+// reparse() and the parallel parse() rely on top-level declarations parsing
+// independently of each other: a complete declaration never continues on the
+// following line, so a run of declarations parses the same on its own as in
+// the whole program.
+//
+// A parser keeps state between parses (the Spirit grammar and scratch
+// buffers), so an instance must be used by one thread at a time.  Different
+// instances share nothing and can parse in parallel.  Syntax errors throw
+// parse_error; the parse functions also report them into diags if it is
+// given.
 class parser{
 public:
-    ast::ast parse(std::string const& code);
+    enum class backend {
+        spirit,
+        recursive_descent,
+    };
+
+    // Changes with every change of the AST which a source parses to, e.g.
+    // of the grammar, so that ASTs cached by another version are not used
+    static std::uint32_t const version = 3;
+
+    explicit parser(backend const b = backend::spirit);
+    ~parser();
+    parser(parser &&) noexcept;
+    parser &operator=(parser &&) noexcept;
+
+    // Parses a copy of code.  This is meant for small inputs.
+    ast::ast parse(std::string const& code, diagnostics *const diags = nullptr);
+
+    // Identifiers in the result are interned.  Operators and string literals
+    // refer into source and the result keeps it alive.
+    ast::ast parse(std::shared_ptr<helper::source_buffer const> const& source, diagnostics *const diags = nullptr);
+
+    // Parses source without stopping at the first syntax error.  Each error
+    // is reported into diags, the declaration with it is dropped and parsing
+    // resumes at the next line which starts with a name at column 1.  The
+    // result has the other declarations, in one pass over source.  Without
+    // errors it is the same as parse(source).
+    ast::ast parse_recovering(std::shared_ptr<helper::source_buffer const> const& source, diagnostics &diags);
+
+    // Splits source into chunks at lines which look like the start of a
+    // top-level declaration and parses the chunks on the workers of pool.
+    // The result is the same as parse(source).  If a chunk does not parse on
+    // its own because the split was wrong, this falls back to parse(source).
+    ast::ast parse(
+        std::shared_ptr<helper::source_buffer const> const& source,
+        helper::thread_pool &pool,
+        diagnostics *const diags = nullptr
+    );
+
+    // Replacement of old_length bytes at offset by new_length bytes
+    struct text_edit {
+        std::size_t offset;
+        std::size_t old_length;
+        std::size_t new_length;
+    };
+
+    // Parses source, which is the source of previous with the edit applied.
+    // Only the top-level declarations which the edit touches are parsed again
+    // and the others are shared with previous, so the result keeps previous
+    // alive.  The declarations after the edit are shared as they are, in runs
+    // whose line_delta moves them, so that a reparse takes time in the size
+    // of the touched declarations and the number of runs rather than of the
+    // whole source.  If the touched declarations do not parse on their own,
+    // this falls back to parse(source).
+    ast::ast reparse(
+        ast::ast const& previous,
+        std::shared_ptr<helper::source_buffer const> const& source,
+        text_edit const& edit,
+        diagnostics *const diags = nullptr
+    );
+
+private:
+    struct impl;
+    std::unique_ptr<impl> pimpl;
 };
 
+// what() is formatted on construction, so it needs no shared buffer
 class parse_error : public std::runtime_error {
-    static std::ostringstream buffer;
-    size_t line, col;
 public:
-    parse_error(size_t const line, size_t const col)
-        : std::runtime_error(""), line(line), col(col)
+    parse_error(size_t const line, size_t const col, std::string const& message = "")
+        : std::runtime_error(format_diagnostic(line, col, message)), line(line), col(col), message(message)
     {}
 
-    virtual char const* what() const noexcept;
+    size_t const line, col;
+    std::string const message;
 };
 
 } // namespace syntax
@@ -0,0 +1,104 @@
+#include <algorithm>
+
+#include <boost/variant/get.hpp>
+
+#include "semantic.hpp"
+
+namespace templa {
+namespace semantic {
+
+boost::optional<builtin> find_builtin(ast::identifier const name)
+{
+    static ast::identifier const print{"print"}, to_char{"to_char"}, string{"String"};
+    if (name == print) {
+        return builtin::print;
+    } else if (name == to_char) {
+        return builtin::to_char;
+    } else if (name == string) {
+        return builtin::string;
+    }
+    return boost::none;
+}
+
+boost::optional<std::size_t> find_type(ast::identifier const name)
+{
+    static ast::identifier const types[] = {
+        ast::identifier{"Int"}, ast::identifier{"Char"}, ast::identifier{"Bool"}, ast::identifier{"String"}, ast::identifier{"List"},
+    };
+    auto const found = std::find(std::begin(types), std::end(types), name);
+    if (found == std::end(types)) {
+        return boost::none;
+    }
+    return static_cast<std::size_t>(found - std::begin(types));
+}
+
+ast::node_list parameters(ast::decl_func const& clause)
+{
+    if (!clause.maybe_declaration_params) {
+        return {};
+    }
+    return boost::get<ast::decl_params const*>(clause.maybe_declaration_params->value)->declaration_params;
+}
+
+boost::optional<ast::identifier> parameter_name(ast::decl_param const& param)
+{
+    if (auto const name = boost::get<ast::identifier>(&param.value)) {
+        return *name;
+    }
+    return boost::none;
+}
+
+function_table::function_table(ast::declaration_runs const& declarations)
+{
+    ast::for_each_declaration(declarations, [this](ast::ast_node const& node, std::int64_t const line_delta){
+        declare(node, line_delta);
+    });
+}
+
+function_table::function_table(ast::node_list const& declarations, std::int64_t const line_delta)
+{
+    for (auto const& node : declarations) {
+        declare(node, line_delta);
+    }
+}
+
+void function_table::declare(ast::ast_node const& node, std::int64_t const line_delta)
+{
+    auto const& clause = *boost::get<ast::decl_func const*>(node.value);
+    auto const params = parameters(clause);
+    bool const general = std::all_of(std::begin(params), std::end(params), [](ast::ast_node const& p){
+        return parameter_name(*boost::get<ast::decl_param const*>(p.value));
+    });
+
+    auto const inserted = indices.emplace(clause.function_name, declared.size());
+    if (inserted.second) {
+        declared.push_back({clause.function_name, params.size(), {}, {}, boost::none});
+    }
+    auto &f = declared[inserted.first->second];
+
+    auto const line = static_cast<std::size_t>(node.line + line_delta);
+    if (f.arity != params.size()) {
+        throw semantic_error{
+            line, node.col,
+            "clause of " + f.name.to_string() + " takes " + std::to_string(params.size())
+                + " parameters, but its first clause takes " + std::to_string(f.arity)
+        };
+    }
+    if (general) {
+        if (f.general) {
+            throw semantic_error{line, node.col, f.name.to_string() + " has more than one clause which matches every argument"};
+        }
+        f.general = f.clauses.size();
+    }
+    f.clauses.push_back(node);
+    f.line_deltas.push_back(line_delta);
+}
+
+function const* function_table::find(ast::identifier const name) const
+{
+    auto const found = indices.find(name);
+    return found == indices.end() ? nullptr : &declared[found->second];
+}
+
+} // namespace semantic
+} // namespace templa
@@ -0,0 +1,103 @@
+#if !defined TEMPLA_SEMANTIC_HPP_INCLUDED
+#define      TEMPLA_SEMANTIC_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <stdexcept>
+
+#include <boost/optional.hpp>
+
+#include "ast.hpp"
+#include "diagnostics.hpp"
+
+namespace templa {
+namespace semantic {
+
+// A program which parses but has no meaning, e.g. a call of an undeclared
+// function
+class semantic_error : public std::runtime_error {
+public:
+    semantic_error(std::size_t const line, std::size_t const col, std::string const& message)
+        : std::runtime_error(syntax::format_diagnostic(line, col, message)), line(line), col(col), message(message)
+    {}
+
+    std::size_t const line, col;
+    std::string const message;
+};
+
+// Functions every program can call.  Each one takes one argument.
+//
+//   print(x)     x, which is also written to the output when run
+//   to_char(x)   the character whose code is the integer x
+//   String(x)    the string of the character x, or x if it is a string
+enum class builtin {
+    print,
+    to_char,
+    string,
+};
+
+boost::optional<builtin> find_builtin(ast::identifier const name);
+
+// Types which a type match can name, in the order of the alternatives of a
+// value when evaluated: Int, Char, Bool, String and List.  Returns the index
+// of name among them, or none.
+boost::optional<std::size_t> find_type(ast::identifier const name);
+
+// A function and all of its clauses.
+//
+// Note:
+// A function is declared by one or more clauses of the same name and arity.
+// A call uses the most specific clause which matches its arguments: a clause
+// whose parameters are all names (the general clause) is used only if no
+// clause with patterns matches.  At most one clause may be general.
+struct function {
+    ast::identifier name;
+    std::size_t arity;
+    // The decl_func nodes in declaration order
+    std::vector<ast::ast_node> clauses;
+    // Of each clause, the line_delta of its run (see ast::declaration_run)
+    // which places it and the nodes below it at their lines in the source
+    std::vector<std::int64_t> line_deltas;
+    // Index into clauses
+    boost::optional<std::size_t> general;
+};
+
+// The functions declared by a list of decl_func nodes, in the order of their
+// first clauses
+class function_table {
+public:
+    // The functions of a program.  Throws semantic_error if the clauses of a
+    // name disagree on the arity or more than one of them is general.
+    explicit function_table(ast::declaration_runs const& declarations);
+
+    // The functions of a let in a clause whose line_delta is line_delta
+    function_table(ast::node_list const& declarations, std::int64_t const line_delta);
+
+    std::vector<function> const& functions() const
+    {
+        return declared;
+    }
+
+    // The function named name, or null
+    function const* find(ast::identifier const name) const;
+
+private:
+    void declare(ast::ast_node const& node, std::int64_t const line_delta);
+
+    std::vector<function> declared;
+    std::unordered_map<ast::identifier, std::size_t> indices;
+};
+
+// The decl_param nodes of a clause
+ast::node_list parameters(ast::decl_func const& clause);
+
+// The name of a decl_param which is a plain name, otherwise none
+boost::optional<ast::identifier> parameter_name(ast::decl_param const& param);
+
+} // namespace semantic
+} // namespace templa
+
+#endif    // TEMPLA_SEMANTIC_HPP_INCLUDED
@@ -0,0 +1,146 @@
+#include <sstream>
+#include <algorithm>
+#include <exception>
+
+#include <boost/optional.hpp>
+
+#include "server.hpp"
+#include "ast_binary.hpp"
+#include "helper/source_buffer.hpp"
+
+namespace templa {
+
+namespace {
+
+// Reparses of a file after which it is parsed from scratch
+std::size_t const max_reparses = 64;
+
+// The edit which turns before into after, or none if they are the same
+boost::optional<syntax::parser::text_edit> difference(
+    helper::source_buffer const& before,
+    helper::source_buffer const& after
+)
+{
+    auto const shorter = std::min(before.size(), after.size());
+    auto const prefix = static_cast<std::size_t>(
+        std::mismatch(before.begin(), before.begin() + shorter, after.begin()).first - before.begin()
+    );
+    if (prefix == before.size() && prefix == after.size()) {
+        return boost::none;
+    }
+
+    std::size_t suffix = 0;
+    while (suffix < shorter - prefix && before.end()[-1 - suffix] == after.end()[-1 - suffix]) {
+        ++suffix;
+    }
+    return syntax::parser::text_edit{prefix, before.size() - prefix - suffix, after.size() - prefix - suffix};
+}
+
+void answer_error(std::ostream &out, std::string const& message)
+{
+    out << "error 1\n" << message << '\n';
+}
+
+} // namespace
+
+void server::serve(std::istream &in, std::ostream &out)
+{
+    std::string line;
+    while (std::getline(in, line)) {
+        ++counters.requests;
+        auto const space = line.find(' ');
+        auto const command = line.substr(0, space);
+        auto const argument = space == std::string::npos ? std::string{} : line.substr(space + 1);
+
+        if (command == "compile" && !argument.empty()) {
+            compile(argument, out);
+        } else if (command == "forget" && !argument.empty()) {
+            files.erase(argument);
+            out << "ok 0\n";
+        } else if (command == "stats") {
+            std::ostringstream text;
+            text << "requests: " << counters.requests << '\n'
+                 << "full parses: " << counters.full_parses << '\n'
+                 << "reparses: " << counters.reparses << '\n'
+                 << "unchanged: " << counters.unchanged << '\n'
+                 << "files: " << files.size() << '\n';
+            out << "ok " << text.str().size() << '\n' << text.str();
+        } else if (command == "quit") {
+            out << "ok 0\n" << std::flush;
+            return;
+        } else {
+            answer_error(out, "unknown request: " + line);
+        }
+        out.flush();
+    }
+}
+
+void server::compile(std::string const& path, std::ostream &out)
+{
+    auto const source = helper::source_buffer::read_file(path);
+    if (!source) {
+        answer_error(out, "File cannot be opened: " + path);
+        return;
+    }
+
+    syntax::diagnostics diags;
+    std::string const* output;
+    std::ostringstream written;
+    try {
+        auto const found = files.find(path);
+        if (ast::is_ast_binary(*source)) {
+            // Loading is as fast as reusing, and the AST would not be a
+            // source to diff against
+            files.erase(path);
+            ++counters.full_parses;
+            c.write(c.parse(source, &diags), written);
+            auto const text = written.str();
+            out << "ok " << text.size() << '\n' << text;
+            return;
+        }
+
+        if (found == files.end() || found->second.reparses == max_reparses) {
+            auto a = c.parse(source, &diags);
+            ++counters.full_parses;
+            c.write(a, written);
+            auto &kept = files[path];
+            kept = kept_ast{std::move(a), source, 0, written.str()};
+            output = &kept.output;
+        } else {
+            auto &kept = found->second;
+            auto const edit = difference(*kept.source, *source);
+            if (edit) {
+                // Kept only once it is written, so that a file whose output
+                // fails is not answered by the output of its last version
+                auto tree = c.reparse(kept.tree, source, *edit, &diags);
+                c.write(tree, written);
+                kept.tree = std::move(tree);
+                kept.source = source;
+                kept.output = written.str();
+                ++kept.reparses;
+                ++counters.reparses;
+            } else {
+                ++counters.unchanged;
+            }
+            output = &kept.output;
+        }
+    } catch (syntax::parse_error const& e) {
+        // The AST of the last valid text is kept, so that fixing the error
+        // is an incremental change again
+        if (diags.empty()) {
+            diags.report(e.line, e.col, e.message);
+        }
+        out << "error " << diags.entries().size() << '\n';
+        for (auto const& d : diags.entries()) {
+            out << path << ": Syntax error: " << d << '\n';
+        }
+        return;
+    } catch (std::exception const& e) {
+        answer_error(out, path + ": " + e.what());
+        return;
+    }
+
+    out << "ok " << output->size() << '\n' << *output;
+}
+
+} // namespace templa
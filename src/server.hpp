@@ -0,0 +1,74 @@
+#if !defined TEMPLA_SERVER_HPP_INCLUDED
+#define      TEMPLA_SERVER_HPP_INCLUDED
+
+#include <cstddef>
+#include <string>
+#include <memory>
+#include <istream>
+#include <ostream>
+#include <unordered_map>
+
+#include "ast.hpp"
+#include "compiler.hpp"
+#include "helper/source_buffer.hpp"
+
+namespace templa {
+
+// Compiles files on request and keeps its state between requests: the
+// grammar and parse cache of the compiler and the AST of every file compiled
+// before.  A file compiled again is diffed against the text it was last
+// compiled from and only the declarations the change touches are parsed.
+//
+// Requests are lines:
+//
+//   compile {path}   compile the file as it is on disk now
+//   forget {path}    drop the AST kept for the file
+//   stats            counters of the server
+//   quit             stop serving
+//
+// Each request is answered by a header line, "ok {bytes}" followed by the
+// output or "error {lines}" followed by that many lines of diagnostics.
+class server {
+public:
+    struct statistics {
+        std::size_t requests = 0;
+        std::size_t full_parses = 0;
+        std::size_t reparses = 0;
+        std::size_t unchanged = 0;
+    };
+
+    explicit server(compiler &c)
+        : c(c)
+    {}
+
+    // Answers requests read from in until "quit" or the end of in
+    void serve(std::istream &in, std::ostream &out);
+
+    statistics const& stats() const
+    {
+        return counters;
+    }
+
+private:
+    void compile(std::string const& path, std::ostream &out);
+
+    struct kept_ast {
+        ast::ast tree;
+        // The text of the file which tree is the AST of, which the next
+        // compile of the file is diffed against
+        std::shared_ptr<helper::source_buffer const> source;
+        // Reparses since the last full parse.  Each one keeps the previous
+        // AST alive, so the chain is cut by a full parse now and then.
+        std::size_t reparses;
+        // Answered as it is while the file is unchanged
+        std::string output;
+    };
+
+    compiler &c;
+    std::unordered_map<std::string, kept_ast> files;
+    statistics counters;
+};
+
+} // namespace templa
+
+#endif    // TEMPLA_SERVER_HPP_INCLUDED
@@ -1,54 +1,411 @@
 #include <exception>
 #include <iostream>
-#include <iterator>
+#include <sstream>
 #include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
 
-#include <boost/optional.hpp>
+#include <boost/program_options.hpp>
 
 #include "templa.hpp"
+#include "server.hpp"
+#include "ast_binary.hpp"
+#include "parse_cache.hpp"
+#include "semantic.hpp"
+#include "compile_stats.hpp"
+#include "counting_new.hpp"
+#include "helper/source_buffer.hpp"
+#include "helper/thread_pool.hpp"
 
 namespace templa {
 
-template<class String>
 inline
-boost::optional<String> read_file(std::string const& file_name)
+bool parse_stats_format(std::string const& name, stats_format &format)
 {
-    typedef typename String::value_type CharT;
+    if (name == "table") {
+        format = stats_format::table;
+    } else if (name == "json") {
+        format = stats_format::json;
+    } else {
+        return false;
+    }
+    return true;
+}
 
-    std::basic_ifstream<CharT> input(file_name, std::ios::in);
-    if (!input.is_open()) {
-        return boost::none;
+inline
+bool parse_emit_kind(std::string const& name, emit_kind &kind)
+{
+    if (name == "ast") {
+        kind = emit_kind::ast;
+    } else if (name == "ast-json") {
+        kind = emit_kind::ast_json;
+    } else if (name == "ast-bin") {
+        kind = emit_kind::ast_bin;
+    } else if (name == "cpp") {
+        kind = emit_kind::cpp;
+    } else if (name == "bytecode") {
+        kind = emit_kind::bytecode;
+    } else {
+        return false;
     }
-    return String{std::istreambuf_iterator<CharT>{input}, std::istreambuf_iterator<CharT>{}};
+    return true;
 }
 
-} // namespace templa
+inline
+bool parse_run_engine(std::string const& name, run_engine &engine)
+{
+    if (name == "vm") {
+        engine = run_engine::vm;
+    } else if (name == "tree") {
+        engine = run_engine::tree;
+    } else {
+        return false;
+    }
+    return true;
+}
 
-int main(int const argc, char const* const argv[])
+inline
+bool parse_cpp_backend(std::string const& name, cpp_backend &backend)
 {
-    // TODO: use Boost.ProgramOptions
-    if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " {file}\n";
-        return 1;
+    if (name == "mpl") {
+        backend = cpp_backend::mpl;
+    } else if (name == "constexpr") {
+        backend = cpp_backend::constexpr_;
+    } else {
+        return false;
     }
+    return true;
+}
+
+inline
+bool parse_parser_backend(std::string const& name, syntax::parser::backend &backend)
+{
+    if (name == "spirit") {
+        backend = syntax::parser::backend::spirit;
+    } else if (name == "descent") {
+        backend = syntax::parser::backend::recursive_descent;
+    } else {
+        return false;
+    }
+    return true;
+}
 
-    auto const maybe_code = templa::read_file<std::string>(argv[1]);
-    if(!maybe_code) {
-        std::cerr << "File cannot be opened: " << argv[1] << std::endl;
+// Appended to the name of each input for its output in batch mode
+inline
+char const* output_extension(emit_kind const kind)
+{
+    switch (kind) {
+    case emit_kind::ast:      return ".ast";
+    case emit_kind::ast_json: return ".ast.json";
+    case emit_kind::ast_bin:  return ".astb";
+    case emit_kind::cpp:      return ".cpp";
+    case emit_kind::bytecode: return ".bytecode";
+    case emit_kind::run:      return ".out";
+    }
+    return "";
+}
+
+// Appends the names listed in list_name, one per line, to files.  "-" reads
+// the list from stdin.
+inline
+bool read_file_list(std::string const& list_name, std::vector<std::string> &files)
+{
+    std::ifstream list_file;
+    if (list_name != "-") {
+        list_file.open(list_name);
+        if (!list_file.is_open()) {
+            return false;
+        }
+    }
+    std::istream &list = list_name == "-" ? std::cin : list_file;
+
+    std::string line;
+    while (std::getline(list, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (!line.empty()) {
+            files.push_back(line);
+        }
+    }
+    return true;
+}
+
+// Compiles file_name into out, or into the file output_name if out is null.
+// Messages are written into log and the time to open the file into stats if
+// it is not null.  Returns the exit status of the file.
+inline
+int compile_file(
+    compiler &c,
+    std::string const& file_name,
+    std::ostream *out,
+    std::string const& output_name,
+    std::ostream &log,
+    compile_stats *const stats
+)
+{
+    auto const source = [&]{
+        compile_stats::scope const measure{stats, compile_stats::phase::read};
+        return helper::source_buffer::map_file(file_name);
+    }();
+    if(!source) {
+        log << "File cannot be opened: " << file_name << '\n';
         return 2;
     }
-    auto const& code = *maybe_code;
 
-    templa::compiler compiler;
+    std::ofstream output_file;
+    if (out == nullptr) {
+        output_file.open(output_name, std::ios::out | std::ios::binary);
+        if (!output_file.is_open()) {
+            log << "File cannot be opened: " << output_name << '\n';
+            return 2;
+        }
+        out = &output_file;
+    }
+
+    syntax::diagnostics diags;
     try {
-        compiler.compile(code);
-    } catch (templa::syntax::parse_error const& e) {
-        std::cerr << "Syntax error: " << e.what() << std::endl;
+        c.compile(source, *out, &diags);
+    } catch (syntax::parse_error const& e) {
+        if (diags.empty()) {
+            log << file_name << ": Syntax error: " << e.what() << '\n';
+        }
+        for (auto const& d : diags.entries()) {
+            log << file_name << ": Syntax error: " << d << '\n';
+        }
+        return 4;
+    } catch (ast::ast_format_error const& e) {
+        log << file_name << ": Invalid binary AST: " << e.what() << '\n';
+        return 4;
+    } catch (semantic::semantic_error const& e) {
+        log << file_name << ": Semantic error: " << e.what() << '\n';
+        return 4;
+    } catch (eval::evaluation_error const& e) {
+        log << file_name << ": Runtime error: " << e.what() << '\n';
         return 4;
     } catch (std::exception const& e) {
-        std::cerr << "Internal compilation error: " << e.what() << std::endl;
+        log << file_name << ": Internal compilation error: " << e.what() << '\n';
         return 3;
     }
 
     return 0;
 }
+
+} // namespace templa
+
+int main(int const argc, char const* const argv[])
+{
+    namespace po = boost::program_options;
+
+    po::options_description visible_options("Options");
+    visible_options.add_options()
+        ("help,h", "show this message")
+        ("emit", po::value<std::string>()->default_value("ast"), "output: ast, ast-json, ast-bin, cpp or bytecode")
+        ("backend", po::value<std::string>()->default_value("mpl"), "C++ of --emit cpp: mpl (class templates) or constexpr (functions)")
+        ("parser", po::value<std::string>()->default_value("spirit"), "parser of the sources: spirit (Boost.Spirit grammar) or descent (hand-written, faster on large sources)")
+        ("run", "evaluate main and write what the C++ program would print, instead of emitting")
+        ("engine", po::value<std::string>()->default_value("vm"), "evaluator of --run: vm (bytecode) or tree (on the AST)")
+        ("memo", po::value<std::size_t>()->default_value(0), "remember the results of up to N calls of top-level functions in --run and folding, 0 for none")
+        ("max-depth", po::value<std::size_t>()->default_value(100000), "calls which --run nests at most")
+        ("output,o", po::value<std::string>(), "write the output into the file instead of stdout")
+        ("jobs,j", po::value<std::size_t>()->default_value(1), "compile N files in parallel, 0 for all cores")
+        ("from-list", po::value<std::string>(), "also compile the files listed in the file, one per line (- for stdin)")
+        ("no-cache", "always parse instead of loading a cached AST")
+        ("cache-dir", po::value<std::string>(), "directory of the parse cache")
+        ("cache-size", po::value<std::uint64_t>()->default_value(256), "size limit of the parse cache in MB")
+        ("fold-budget", po::value<std::size_t>()->default_value(100000), "steps to evaluate each closed declaration or call with before emitting C++, 0 to not evaluate them")
+        ("parse-threads", po::value<std::size_t>()->default_value(1), "threads to parse a large source with, 0 for all cores")
+        ("serve", "answer compile requests from stdin on stdout, keeping ASTs between them")
+        ("time-phases", "print the time of each compile phase to stderr")
+        ("stats", "print the time of each phase, AST node counts, allocations and peak memory to stderr")
+        ("stats-format", po::value<std::string>()->default_value("table"), "format of --time-phases and --stats: table or json")
+    ;
+    po::options_description all_options;
+    all_options.add(visible_options).add_options()
+        ("file", po::value<std::vector<std::string>>(), "source files or binary ASTs")
+    ;
+    po::positional_options_description positional;
+    positional.add("file", -1);
+
+    po::variables_map vm;
+    try {
+        po::store(po::command_line_parser(argc, argv).options(all_options).positional(positional).run(), vm);
+        po::notify(vm);
+    } catch (po::error const& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> files;
+    if (vm.count("file")) {
+        files = vm["file"].as<std::vector<std::string>>();
+    }
+    if (vm.count("from-list") && !templa::read_file_list(vm["from-list"].as<std::string>(), files)) {
+        std::cerr << "File cannot be opened: " << vm["from-list"].as<std::string>() << std::endl;
+        return 2;
+    }
+
+    if (vm.count("help") || (files.empty() && !vm.count("serve"))) {
+        std::cerr << "Usage: " << argv[0] << " [options] {file...}\n"
+                  << "With several files or --from-list, the output of each file is written\n"
+                  << "next to it, and the exit status is the highest one of the files.\n"
+                  << visible_options;
+        return vm.count("help") ? 0 : 1;
+    }
+
+    templa::emit_kind emit;
+    if (!templa::parse_emit_kind(vm["emit"].as<std::string>(), emit)) {
+        std::cerr << "Unknown --emit: " << vm["emit"].as<std::string>() << std::endl;
+        return 1;
+    }
+
+    if (vm.count("run")) {
+        emit = templa::emit_kind::run;
+    }
+    templa::run_engine engine;
+    if (!templa::parse_run_engine(vm["engine"].as<std::string>(), engine)) {
+        std::cerr << "Unknown --engine: " << vm["engine"].as<std::string>() << std::endl;
+        return 1;
+    }
+    templa::eval::limits run_limits;
+    run_limits.steps = std::numeric_limits<std::size_t>::max();
+    run_limits.depth = vm["max-depth"].as<std::size_t>();
+    run_limits.memo = vm["memo"].as<std::size_t>();
+
+    templa::cpp_backend backend;
+    if (!templa::parse_cpp_backend(vm["backend"].as<std::string>(), backend)) {
+        std::cerr << "Unknown --backend: " << vm["backend"].as<std::string>() << std::endl;
+        return 1;
+    }
+
+    templa::syntax::parser::backend parsing;
+    if (!templa::parse_parser_backend(vm["parser"].as<std::string>(), parsing)) {
+        std::cerr << "Unknown --parser: " << vm["parser"].as<std::string>() << std::endl;
+        return 1;
+    }
+
+    templa::stats_format stats_format;
+    if (!templa::parse_stats_format(vm["stats-format"].as<std::string>(), stats_format)) {
+        std::cerr << "Unknown --stats-format: " << vm["stats-format"].as<std::string>() << std::endl;
+        return 1;
+    }
+    bool const measure = vm.count("time-phases") || vm.count("stats");
+    if (vm.count("stats")) {
+        templa::start_counting_allocations();
+        templa::compile_stats::allocation_counter = templa::thread_allocations;
+    }
+
+    bool const batch = files.size() > 1 || vm.count("from-list");
+    if (batch && vm.count("output")) {
+        std::cerr << "--output cannot be used with several files" << std::endl;
+        return 1;
+    }
+
+    std::ofstream output_file;
+    if (vm.count("output")) {
+        output_file.open(vm["output"].as<std::string>(), std::ios::out | std::ios::binary);
+        if (!output_file.is_open()) {
+            std::cerr << "File cannot be opened: " << vm["output"].as<std::string>() << std::endl;
+            return 2;
+        }
+    }
+    std::ostream *const out = batch ? nullptr : output_file.is_open() ? &output_file : &std::cout;
+
+    std::unique_ptr<templa::parse_cache> cache;
+    if (!vm.count("no-cache")) {
+        cache = std::make_unique<templa::parse_cache>(
+            vm.count("cache-dir") ? vm["cache-dir"].as<std::string>() : templa::parse_cache::default_directory(),
+            vm["cache-size"].as<std::uint64_t>() * 1024 * 1024
+        );
+    }
+
+    boost::optional<templa::eval::limits> folding;
+    if (vm["fold-budget"].as<std::size_t>() != 0) {
+        folding = templa::eval::limits{};
+        folding->steps = vm["fold-budget"].as<std::size_t>();
+        folding->memo = vm["memo"].as<std::size_t>();
+    }
+
+    if (vm.count("serve")) {
+        templa::compiler compiler{emit, parsing};
+        compiler.use_backend(backend);
+        compiler.use_run_limits(run_limits);
+        compiler.use_run_engine(engine);
+        if (folding) {
+            compiler.use_folding(*folding);
+        }
+        if (cache) {
+            compiler.use_cache(*cache);
+        }
+        templa::server server{compiler};
+        server.serve(std::cin, std::cout);
+        return 0;
+    }
+
+    // One compiler per worker, so that each builds its grammar once and
+    // reuses it for all of its files.  Each one also has its own statistics.
+    templa::helper::thread_pool jobs{std::min(vm["jobs"].as<std::size_t>(), files.size())};
+    std::vector<std::unique_ptr<templa::compiler>> compilers;
+    std::vector<templa::compile_stats> stats(jobs.size());
+    for (std::size_t i = 0; i < jobs.size(); ++i) {
+        {
+            templa::compile_stats::scope const setup{measure ? &stats[i] : nullptr, templa::compile_stats::phase::setup};
+            compilers.push_back(std::make_unique<templa::compiler>(emit, parsing));
+        }
+        compilers.back()->use_backend(backend);
+        compilers.back()->use_run_limits(run_limits);
+        compilers.back()->use_run_engine(engine);
+        if (folding) {
+            compilers.back()->use_folding(*folding);
+        }
+        if (cache) {
+            compilers.back()->use_cache(*cache);
+        }
+        if (measure) {
+            compilers.back()->use_stats(stats[i]);
+        }
+    }
+
+    // Only a single file is parsed in parallel.  Files are in batch mode.
+    std::unique_ptr<templa::helper::thread_pool> parse_threads;
+    if (!batch && vm["parse-threads"].as<std::size_t>() != 1) {
+        parse_threads = std::make_unique<templa::helper::thread_pool>(vm["parse-threads"].as<std::size_t>());
+        compilers.front()->use_threads(*parse_threads);
+    }
+
+    std::vector<int> statuses(files.size());
+    std::mutex log_mutex;
+    jobs.parallel_for(files.size(), [&](std::size_t const i, std::size_t const worker){
+        std::ostringstream log;
+        statuses[i] = templa::compile_file(
+            *compilers[worker], files[i], out, files[i] + templa::output_extension(emit), log,
+            measure ? &stats[worker] : nullptr
+        );
+
+        // Messages of a file are written at once, not interleaved with others
+        std::lock_guard<std::mutex> lock{log_mutex};
+        std::cerr << log.str() << std::flush;
+    });
+
+    auto const num_failed = std::count_if(std::begin(statuses), std::end(statuses), [](int const s){ return s != 0; });
+    if (batch && num_failed != 0) {
+        std::cerr << num_failed << " of " << files.size() << " files failed" << std::endl;
+    }
+
+    if (measure) {
+        for (std::size_t i = 1; i < stats.size(); ++i) {
+            stats.front().merge(stats[i]);
+        }
+        if (cache) {
+            stats.front().cache = cache->stats();
+        }
+        templa::print_stats(std::cerr, stats.front(), stats_format, !vm.count("stats"));
+    }
+
+    return *std::max_element(std::begin(statuses), std::end(statuses));
+}
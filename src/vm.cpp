@@ -0,0 +1,483 @@
+#include <limits>
+#include <utility>
+
+#include <boost/variant/get.hpp>
+
+#include "vm.hpp"
+#include "operations.hpp"
+#include "semantic.hpp"
+
+// GCC and Clang jump to the handler of the next instruction from the end of
+// each handler, through a table of label addresses.  The indirect jumps are
+// predicted per handler instead of at a single switch.
+#if defined __GNUC__
+#define TEMPLA_VM_COMPUTED_GOTO 1
+#endif
+
+namespace templa {
+namespace eval {
+
+namespace {
+
+constexpr std::size_t no_link = std::numeric_limits<std::size_t>::max();
+
+} // namespace
+
+vm::vm(bytecode const& program, limits const& l)
+    : program(program)
+    , bounds(l)
+    , memo(l.memo != 0 ? std::make_unique<memo_table>(l.memo) : nullptr)
+{}
+
+value vm::call(boost::string_ref const name, std::vector<value> args)
+{
+    auto const f = program.find(ast::identifier{name});
+    if (!f) {
+        throw semantic::semantic_error{1, 1, name.to_string() + " is not declared"};
+    }
+    if (args.size() != program.functions[*f].arity) {
+        auto const& at = program.functions[*f].at;
+        throw semantic::semantic_error{at.line, at.col, name.to_string() + " takes " + std::to_string(program.functions[*f].arity) + " arguments"};
+    }
+    return call(*f, std::move(args));
+}
+
+value vm::call(std::size_t const function, std::vector<value> args)
+{
+    auto const& f = program.functions[function];
+    stack.clear();
+    calls.clear();
+    for (auto &a : args) {
+        stack.push_back(std::move(a));
+    }
+    stack.resize(f.frame_size);
+
+    // Returns to the halt at 0
+    calls.push_back({0, no_link, 0, static_cast<std::uint32_t>(function), false});
+    ++taken;
+    if (taken > bounds.steps) {
+        throw limit_exceeded{f.at.line, f.at.col, "evaluation takes more than " + std::to_string(bounds.steps) + " steps"};
+    }
+    return execute(static_cast<std::uint32_t>(f.entry));
+}
+
+void vm::fail(std::uint32_t const pc, std::string const& message) const
+{
+    auto const& at = program.locations[pc];
+    throw evaluation_error{at.line, at.col, message};
+}
+
+void vm::step(std::uint32_t const pc, std::size_t const n)
+{
+    taken += n;
+    if (taken > bounds.steps) {
+        auto const& at = program.locations[pc];
+        throw limit_exceeded{at.line, at.col, "evaluation takes more than " + std::to_string(bounds.steps) + " steps"};
+    }
+}
+
+void vm::check_length(std::uint32_t const pc, std::size_t const length) const
+{
+    if (length > bounds.length) {
+        auto const& at = program.locations[pc];
+        throw limit_exceeded{at.line, at.col, "a value is longer than " + std::to_string(bounds.length) + " elements"};
+    }
+}
+
+value vm::execute(std::uint32_t pc)
+{
+    auto const code = program.code.data();
+    auto const& locations = program.locations;
+    auto base = calls.back().base;
+
+    // The two values at the top for binary operators
+    auto const lhs = [&]() -> value& { return stack[stack.size() - 2]; };
+    auto const rhs = [&]() -> value& { return stack.back(); };
+    auto const ints = [&]{ return boost::get<int>(&lhs()) && boost::get<int>(&rhs()); };
+
+#if TEMPLA_VM_COMPUTED_GOTO
+    static void* const handlers[] = {
+        &&op_halt, &&op_push_const, &&op_load, &&op_load_outer, &&op_call, &&op_ret,
+        &&op_jump, &&op_jump_unless, &&op_or_else, &&op_and_then,
+        &&op_add, &&op_sub, &&op_mul, &&op_div, &&op_mod,
+        &&op_eq, &&op_ne, &&op_lt, &&op_gt, &&op_le, &&op_ge, &&op_neg, &&op_not_,
+        &&op_print, &&op_to_char, &&op_to_string, &&op_int_range, &&op_char_range, &&op_make_list,
+        &&op_match_value, &&op_match_list, &&op_match_type, &&op_dispatch, &&op_no_match,
+    };
+    static_assert(sizeof(handlers) / sizeof(handlers[0]) == static_cast<std::size_t>(opcode::no_match) + 1, "a handler is missing");
+#   define TEMPLA_OP(name) op_##name:
+#   define TEMPLA_NEXT() goto *handlers[static_cast<std::size_t>(code[pc].op)]
+    TEMPLA_NEXT();
+#else
+#   define TEMPLA_OP(name) case opcode::name:
+#   define TEMPLA_NEXT() continue
+    for (;;) switch (code[pc].op) {
+#endif
+
+    TEMPLA_OP(halt) {
+        auto result = std::move(stack.back());
+        stack.clear();
+        return result;
+    }
+
+    TEMPLA_OP(push_const) {
+        stack.push_back(program.constants[code[pc].a]);
+        ++pc;
+        TEMPLA_NEXT();
+    }
+
+    TEMPLA_OP(load) {
+        stack.push_back(stack[base + code[pc].a]);
+        ++pc;
+        TEMPLA_NEXT();
+    }
+
+    TEMPLA_OP(load_outer) {
+        auto a = calls.size() - 1;
+        for (std::uint32_t h = 0; h < code[pc].a; ++h) {
+            a = calls[a].link;
+        }
+        stack.push_back(stack[calls[a].base + code[pc].b]);
+        ++pc;
+        TEMPLA_NEXT();
+    }
+
+    TEMPLA_OP(call) {
+        auto const& i = code[pc];
+        auto const& f = program.functions[i.a];
+        step(pc);
+        if (calls.size() >= bounds.depth) {
+            fail(pc, "calls nest more than " + std::to_string(bounds.depth) + " deep");
+        }
+
+        auto link = no_link;
+        if (i.b != bytecode::global) {
+            link = calls.size() - 1;
+            for (std::uint32_t h = 0; h < i.b; ++h) {
+                link = calls[link].link;
+            }
+        }
+
+        // Only top-level functions, whose values depend on their arguments
+        // alone
+        bool const remembered = memo && i.b == bytecode::global;
+        if (remembered) {
+            if (auto const r = memo->find(&f, stack.data() + stack.size() - f.arity, f.arity)) {
+                auto result = *r;
+                stack.resize(stack.size() - f.arity);
+                stack.push_back(std::move(result));
+                ++pc;
+                TEMPLA_NEXT();
+            }
+        }
+
+        base = stack.size() - f.arity;
+        calls.push_back({base, link, pc + 1, i.a, remembered});
+        stack.resize(base + f.frame_size);
+        pc = static_cast<std::uint32_t>(f.entry);
+        TEMPLA_NEXT();
+    }
+
+    TEMPLA_OP(ret) {
+        auto const returning = calls.back();
+        if (returning.remembered) {
+            // The arguments are intact; patterns bind after them
+            auto const& f = program.functions[returning.function];
+            memo->store(&f, stack.data() + returning.base, f.arity, stack.back());
+        }
+        if (stack.size() - 1 != returning.base) {
+            stack[returning.base] = std::move(stack.back());
+        }
+        stack.resize(returning.base + 1);
+        calls.pop_back();
+        if (!calls.empty()) {
+            base = calls.back().base;
+        }
+        pc = returning.return_pc;
+        TEMPLA_NEXT();
+    }
+
+    TEMPLA_OP(jump) {
+        pc = code[pc].a;
+        TEMPLA_NEXT();
+    }
+
+    TEMPLA_OP(jump_unless) {
+        auto const b = boost::get<bool>(&stack.back());
+        bool const taken_branch = b ? *b : truth(locations[pc], stack.back());
+        stack.pop_back();
+        pc = taken_branch ? pc + 1 : code[pc].a;
+        TEMPLA_NEXT();
+    }
+
+    TEMPLA_OP(or_else) {
+        if (operand(locations[pc], "|", stack.back()) != 0) {
+            stack.back() = true;
+            pc = code[pc].a;
+        } else {
+            stack.pop_back();
+            ++pc;
+        }
+        TEMPLA_NEXT();
+    }
+
+    TEMPLA_OP(and_then) {
+        if (operand(locations[pc], "&", stack.back()) == 0) {
+            stack.back() = false;
+            pc = code[pc].a;
+        } else {
+            stack.pop_back();
+            ++pc;
+        }
+        TEMPLA_NEXT();
+    }
+
+    TEMPLA_OP(add) {
+        if (ints()) {
+            lhs() = checked(locations[pc], static_cast<long long>(boost::get<int>(lhs())) + boost::get<int>(rhs()));
+        } else {
+            lhs() = eval::add(locations[pc], lhs(), rhs());
+            check_length(pc, length_of(lhs()));
+        }
+        stack.pop_back();
+        ++pc;
+        TEMPLA_NEXT();
+    }
+
+    TEMPLA_OP(sub) {
+        if (ints()) {
+            lhs() = checked(locations[pc], static_cast<long long>(boost::get<int>(lhs())) - boost::get<int>(rhs()));
+        } else {
+            lhs() = arithmetic(locations[pc], '-', lhs(), rhs());
+        }
+        stack.pop_back();
+        ++pc;
+        TEMPLA_NEXT();
+    }
+
+    TEMPLA_OP(mul) {
+        if (ints()) {
+            lhs() = checked(locations[pc], static_cast<long long>(boost::get<int>(lhs())) * boost::get<int>(rhs()));
+        } else {
+            lhs() = arithmetic(locations[pc], '*', lhs(), rhs());
+        }
+        stack.pop_back();
+        ++pc;
+        TEMPLA_NEXT();
+    }
+
+    TEMPLA_OP(div) {
+        lhs() = arithmetic(locations[pc], '/', lhs(), rhs());
+        stack.pop_back();
+        ++pc;
+        TEMPLA_NEXT();
+    }
+
+    TEMPLA_OP(mod) {
+        lhs() = arithmetic(locations[pc], '%', lhs(), rhs());
+        stack.pop_back();
+        ++pc;
+        TEMPLA_NEXT();
+    }
+
+    TEMPLA_OP(eq) {
+        lhs() = ints() ? boost::get<int>(lhs()) == boost::get<int>(rhs()) : equal(lhs(), rhs());
+        stack.pop_back();
+        ++pc;
+        TEMPLA_NEXT();
+    }
+
+    TEMPLA_OP(ne) {
+        lhs() = ints() ? boost::get<int>(lhs()) != boost::get<int>(rhs()) : !equal(lhs(), rhs());
+        stack.pop_back();
+        ++pc;
+        TEMPLA_NEXT();
+    }
+
+    TEMPLA_OP(lt) {
+        lhs() = compare(locations[pc], "<", lhs(), rhs());
+        stack.pop_back();
+        ++pc;
+        TEMPLA_NEXT();
+    }
+
+    TEMPLA_OP(gt) {
+        lhs() = compare(locations[pc], ">", lhs(), rhs());
+        stack.pop_back();
+        ++pc;
+        TEMPLA_NEXT();
+    }
+
+    TEMPLA_OP(le) {
+        lhs() = compare(locations[pc], "<=", lhs(), rhs());
+        stack.pop_back();
+        ++pc;
+        TEMPLA_NEXT();
+    }
+
+    TEMPLA_OP(ge) {
+        lhs() = compare(locations[pc], ">=", lhs(), rhs());
+        stack.pop_back();
+        ++pc;
+        TEMPLA_NEXT();
+    }
+
+    TEMPLA_OP(neg) {
+        stack.back() = checked(locations[pc], -static_cast<long long>(operand(locations[pc], "-", stack.back())));
+        ++pc;
+        TEMPLA_NEXT();
+    }
+
+    TEMPLA_OP(not_) {
+        stack.back() = operand(locations[pc], "!", stack.back()) == 0;
+        ++pc;
+        TEMPLA_NEXT();
+    }
+
+    TEMPLA_OP(print) {
+        step(pc);
+        ++pc;
+        TEMPLA_NEXT();
+    }
+
+    TEMPLA_OP(to_char) {
+        step(pc);
+        stack.back() = apply_builtin(locations[pc], semantic::builtin::to_char, "to_char", std::move(stack.back()));
+        ++pc;
+        TEMPLA_NEXT();
+    }
+
+    TEMPLA_OP(to_string) {
+        step(pc);
+        stack.back() = apply_builtin(locations[pc], semantic::builtin::string, "String", std::move(stack.back()));
+        ++pc;
+        TEMPLA_NEXT();
+    }
+
+    TEMPLA_OP(int_range) {
+        long long const min = static_cast<int>(code[pc].a);
+        long long const max = static_cast<int>(code[pc].b);
+        std::vector<value> elements;
+        if (min <= max) {
+            auto const size = static_cast<std::size_t>(max - min + 1);
+            check_length(pc, size);
+            step(pc, size);
+            elements.reserve(size);
+            for (auto i = min; i <= max; ++i) {
+                elements.emplace_back(static_cast<int>(i));
+            }
+        }
+        stack.push_back(list{std::move(elements)});
+        ++pc;
+        TEMPLA_NEXT();
+    }
+
+    TEMPLA_OP(char_range) {
+        std::vector<value> elements;
+        for (int ch = static_cast<char>(code[pc].a); ch <= static_cast<char>(code[pc].b); ++ch) {
+            step(pc);
+            elements.emplace_back(static_cast<char>(ch));
+        }
+        stack.push_back(list{std::move(elements)});
+        ++pc;
+        TEMPLA_NEXT();
+    }
+
+    TEMPLA_OP(make_list) {
+        auto const first = stack.end() - code[pc].a;
+        std::vector<value> elements(std::make_move_iterator(first), std::make_move_iterator(stack.end()));
+        stack.erase(first, stack.end());
+        stack.push_back(list{std::move(elements)});
+        ++pc;
+        TEMPLA_NEXT();
+    }
+
+    TEMPLA_OP(match_value) {
+        bool const matched = equal(stack[base + code[pc].a], stack.back());
+        stack.pop_back();
+        pc = matched ? pc + 1 : code[pc].b;
+        TEMPLA_NEXT();
+    }
+
+    TEMPLA_OP(match_list) {
+        auto const& i = code[pc];
+        auto const l = boost::get<list>(&stack[base + i.a]);
+        if (!l || l->size() < i.b) {
+            pc = i.d;
+            TEMPLA_NEXT();
+        }
+        for (std::uint32_t e = 0; e < i.b; ++e) {
+            stack[base + i.c + e] = (*l)[e];
+        }
+        stack[base + i.c + i.b] = l->drop(i.b);
+        ++pc;
+        TEMPLA_NEXT();
+    }
+
+    TEMPLA_OP(match_type) {
+        auto const& i = code[pc];
+        if (stack[base + i.a].which() != static_cast<int>(i.b)) {
+            pc = i.d;
+            TEMPLA_NEXT();
+        }
+        stack[base + i.c] = stack[base + i.a];
+        ++pc;
+        TEMPLA_NEXT();
+    }
+
+    TEMPLA_OP(dispatch) {
+        auto const& table = program.tables[code[pc].b];
+        auto const& arg = stack[base + code[pc].a];
+        pc = table.otherwise;
+        if (arg.which() == table.type) {
+            auto const index = static_cast<long long>(*numeric(arg)) - table.min;
+            if (index >= 0 && index < static_cast<long long>(table.targets.size())) {
+                pc = table.targets[static_cast<std::size_t>(index)];
+            }
+        }
+        TEMPLA_NEXT();
+    }
+
+    TEMPLA_OP(no_match) {
+        auto const& f = program.functions[code[pc].a];
+        std::string types;
+        for (std::size_t a = 0; a < f.arity; ++a) {
+            types += (types.empty() ? "" : ", ") + std::string{type_name(stack[base + a])};
+        }
+        auto const message = "no clause of " + f.name.to_string() + " matches (" + types + ")";
+        auto const return_pc = calls.back().return_pc;
+        if (return_pc == 0) {
+            throw evaluation_error{f.at.line, f.at.col, message};
+        }
+        fail(return_pc - 1, message);
+    }
+
+#if !TEMPLA_VM_COMPUTED_GOTO
+    }
+#endif
+#undef TEMPLA_OP
+#undef TEMPLA_NEXT
+}
+
+void run_vm(std::ostream &out, ast::ast const& a, limits const& l, memo_statistics *const memo_stats)
+{
+    auto const program = compile_bytecode(a);
+    auto const main = program.find(ast::identifier{"main"});
+    if (!main) {
+        throw semantic::semantic_error{1, 1, "main is not declared"};
+    }
+    if (program.functions[*main].arity != 0) {
+        auto const& at = program.functions[*main].at;
+        throw semantic::semantic_error{at.line, at.col, "main cannot take parameters"};
+    }
+
+    vm machine{program, l};
+    auto const result = machine.call(*main, {});
+    if (memo_stats && machine.memoized()) {
+        memo_stats->merge(machine.memoized()->stats());
+    }
+    out << result << '\n';
+}
+
+} // namespace eval
+} // namespace templa
@@ -0,0 +1,85 @@
+#if !defined TEMPLA_VM_HPP_INCLUDED
+#define      TEMPLA_VM_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <ostream>
+#include <string>
+#include <memory>
+
+#include <boost/utility/string_ref.hpp>
+
+#include "ast.hpp"
+#include "bytecode.hpp"
+#include "evaluator.hpp"
+#include "memo.hpp"
+
+namespace templa {
+namespace eval {
+
+// Runs bytecode on a stack of values.  It computes the same values and
+// fails with the same errors as evaluator, but calls do not recurse on the
+// C++ stack, so the depth is only limited by l.depth and memory.
+class vm {
+public:
+    explicit vm(bytecode const& program, limits const& l = {});
+
+    // Calls functions[function] of the program
+    value call(std::size_t const function, std::vector<value> args);
+
+    // Calls the top-level function named name
+    value call(boost::string_ref const name, std::vector<value> args);
+
+    // Steps taken since the construction or reset_steps(), counted as
+    // evaluator counts them
+    std::size_t steps() const
+    {
+        return taken;
+    }
+
+    void reset_steps()
+    {
+        taken = 0;
+    }
+
+    // The results remembered by the limits, or null
+    memo_table const* memoized() const
+    {
+        return memo.get();
+    }
+
+private:
+    struct activation {
+        // Index of slot 0 in stack
+        std::size_t base;
+        // Index in calls of the activation which the function is declared
+        // in, if it is declared in a let
+        std::size_t link;
+        std::uint32_t return_pc;
+        std::uint32_t function;
+        // Whether the result is stored in memo
+        bool remembered;
+    };
+
+    value execute(std::uint32_t pc);
+    [[noreturn]] void fail(std::uint32_t const pc, std::string const& message) const;
+    void step(std::uint32_t const pc, std::size_t const n = 1);
+    void check_length(std::uint32_t const pc, std::size_t const length) const;
+
+    bytecode const& program;
+    limits const bounds;
+    std::size_t taken = 0;
+    std::vector<value> stack;
+    std::vector<activation> calls;
+    std::unique_ptr<memo_table> const memo;
+};
+
+// What eval::run() writes, computed by compiling a to bytecode and running
+// it on vm
+void run_vm(std::ostream &out, ast::ast const& a, limits const& l = {}, memo_statistics *const memo_stats = nullptr);
+
+} // namespace eval
+} // namespace templa
+
+#endif    // TEMPLA_VM_HPP_INCLUDED
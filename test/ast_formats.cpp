@@ -0,0 +1,99 @@
+#include <string>
+#include <sstream>
+
+#include "compiler.hpp"
+#include "parser.hpp"
+#include "ast_binary.hpp"
+#include "ast_json.hpp"
+#include "ast_dumper.hpp"
+#include "helper/source_buffer.hpp"
+#include "generator.hpp"
+#include "test.hpp"
+
+namespace templa {
+namespace test {
+
+namespace {
+
+// Sources whose first name begins with the magic of binary ASTs before it
+// began with a byte which is not ASCII
+void check_magic()
+{
+    std::string const programs[] = {
+        "TMPLASTx = 1\nmain = TMPLASTx\n",
+        "TMPLAST = 1\nmain = TMPLAST\n",
+    };
+    for (auto const& code : programs) {
+        check(!ast::is_ast_binary(*helper::source_buffer::copy_of(code)), "the source is taken for a binary AST:\n" + code);
+        std::string output;
+        try {
+            output = compiler{emit_kind::run}.compile(code);
+        } catch (std::exception const& e) {
+            output = e.what();
+        }
+        check(output == "1\n", "the source is run as " + output + ":\n" + code);
+    }
+
+    std::ostringstream binary;
+    ast::save_ast_binary(binary, compiler{}.parse(helper::source_buffer::copy_of(programs[0])));
+    check(ast::is_ast_binary(*helper::source_buffer::copy_of(binary.str())), "a binary AST is not taken for one");
+}
+
+std::string json_of(ast::ast const& a)
+{
+    std::ostringstream out;
+    ast::dump_ast_json(out, a);
+    return out.str();
+}
+
+ast::ast saved_and_loaded(ast::ast const& a)
+{
+    std::ostringstream out;
+    ast::save_ast_binary(out, a);
+    return ast::load_ast_binary(helper::source_buffer::copy_of(out.str()));
+}
+
+// A loaded binary AST must be the saved one at the same positions, and dump
+// to the same text and JSON
+void check_round_trip(std::string const& name, ast::ast const& saved, ast::ast const& expected)
+{
+    auto const loaded = saved_and_loaded(saved);
+    check(same_ast(expected, loaded), name + ": the loaded binary AST differs");
+    check(ast::dump_ast(loaded) == ast::dump_ast(expected), name + ": the loaded binary AST dumps differently");
+    check(json_of(saved) == json_of(expected), name + ": the JSON differs");
+    check(json_of(loaded) == json_of(expected), name + ": the JSON of the loaded binary AST differs");
+}
+
+void check_round_trips()
+{
+    syntax::parser p;
+    std::string const programs[] = {
+        "fizz = \"fizz\"\nc = 'a'\nb = true\nl = [1, 'a', \"s\"]\nr = [a..z]\n",
+        "f(x:y:xs) = let\n g(n::Int) = -n\nin if x < y then g(x) else case\n | x == 0 then 1\n | otherwise 2\n",
+        bench::generate_program(64 * 1024),
+    };
+    for (auto const& code : programs) {
+        auto const name = code.substr(0, code.find('\n'));
+        auto const tree = p.parse(code);
+        check_round_trip(name, tree, tree);
+
+        // The declarations of a reparsed AST after the edit are at other
+        // lines than the ones they were parsed at
+        auto const edited = "zz(a) = a + 1\n" + code;
+        auto const reparsed = p.reparse(tree, helper::source_buffer::copy_of(edited), {0, 0, 14});
+        check_round_trip(name + ", reparsed", reparsed, p.parse(edited));
+    }
+}
+
+void ast_formats()
+{
+    check_magic();
+    check_round_trips();
+}
+
+registration const _{"ast_formats", ast_formats};
+
+} // namespace
+
+} // namespace test
+} // namespace templa
@@ -0,0 +1,60 @@
+#include <string>
+#include <sstream>
+
+#include "parser.hpp"
+#include "evaluator.hpp"
+#include "vm.hpp"
+#include "generator.hpp"
+#include "test.hpp"
+
+namespace templa {
+namespace test {
+
+namespace {
+
+// The tree walker and the VM must print the same
+void bytecode_vm()
+{
+    struct program {
+        std::string name;
+        std::string code;
+    };
+
+    program const programs[] = {
+        {"fib_22", "fib(0) = 0\nfib(1) = 1\nfib(n) = fib(n - 1) + fib(n - 2)\nmain = fib(22)\n"},
+        {
+            "collatz_3000",
+            "steps(1) = 0\n"
+            "steps(n) = if n % 2 == 0 then 1 + steps(n / 2) else 1 + steps(3 * n + 1)\n"
+            "longest(0, best) = best\n"
+            "longest(n, best) = let s = steps(n)\n"
+            "                   in longest(n - 1, max(s, best))\n"
+            "max(a, b) = if a > b then a else b\n"
+            "main = longest(3000, 0)\n"
+        },
+        {"sum_10000", bench::generate_sum_program(10000)},
+        {"list_sum_10000", bench::generate_list_sum_program(10000)},
+        {"fizzbuzz_100", bench::generate_fizzbuzz_program(100)},
+    };
+
+    syntax::parser p;
+    eval::limits l;
+    l.depth = 100000;
+    l.steps = 100000000;
+    for (auto const& prog : programs) {
+        auto const a = p.parse(prog.code);
+
+        std::ostringstream tree_out, vm_out;
+        eval::run(tree_out, a, l);
+        eval::run_vm(vm_out, a, l);
+        check(tree_out.str() == vm_out.str(),
+              prog.name + ": the VM printed " + vm_out.str() + " instead of " + tree_out.str());
+    }
+}
+
+registration const _{"bytecode_vm", bytecode_vm};
+
+} // namespace
+
+} // namespace test
+} // namespace templa
@@ -0,0 +1,47 @@
+#include <string>
+#include <sstream>
+
+#include "parser.hpp"
+#include "constant_folding.hpp"
+#include "vm.hpp"
+#include "test.hpp"
+
+namespace templa {
+namespace test {
+
+namespace {
+
+// Folding with the limits of --emit cpp must not crash on calls nested as
+// deep as the limit allows, however deep their expressions nest, and the
+// folded program must print what the original one prints
+void constant_folding()
+{
+    syntax::parser p;
+    eval::limits l;
+    l.steps = 100000;
+
+    for (std::size_t const parentheses : {0, 20, 200}) {
+        auto const a = p.parse(
+            "f(0) = 0\n"
+            "f(n) = " + std::string(parentheses, '(') + "1 + f(n - 1)" + std::string(parentheses, ')') + "\n"
+            "main = print(f(900))\n"
+        );
+        auto const name = std::to_string(parentheses) + " parentheses";
+
+        eval::folding_statistics stats;
+        auto const folded = eval::fold_constants(a, l, &stats);
+        check(stats.declarations + stats.calls + stats.failures != 0, name + ": nothing was evaluated");
+
+        std::ostringstream expected, actual;
+        eval::run_vm(expected, a);
+        eval::run_vm(actual, folded);
+        check(actual.str() == expected.str(), name + ": the folded program printed " + actual.str() + " instead of " + expected.str());
+    }
+}
+
+registration const _{"constant_folding", constant_folding};
+
+} // namespace
+
+} // namespace test
+} // namespace templa
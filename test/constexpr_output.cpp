@@ -0,0 +1,61 @@
+#include <string>
+#include <sstream>
+#include <fstream>
+
+#include "parser.hpp"
+#include "compiler.hpp"
+#include "vm.hpp"
+#include "generator.hpp"
+#include "test.hpp"
+
+namespace templa {
+namespace test {
+
+namespace {
+
+// The compiled output of the constexpr backend, with folding as --emit cpp
+// folds by default, must print what --run prints, however long its strings
+void constexpr_output()
+{
+    struct program {
+        std::string name;
+        std::string code;
+    };
+
+    program const programs[] = {
+        {"fizzbuzz_30", bench::generate_fizzbuzz_program(30)},
+        // Folded into a literal of 1834 chars
+        {"fizzbuzz_400", bench::generate_fizzbuzz_program(400)},
+        {"sum_100", bench::generate_sum_program(100)},
+    };
+
+    auto const cxx = cxx_compiler();
+    temporary_directory const directory;
+    syntax::parser p;
+    eval::limits folding;
+    folding.steps = 100000;
+    compiler c{emit_kind::cpp};
+    c.use_backend(cpp_backend::constexpr_);
+    c.use_folding(folding);
+
+    for (auto const& prog : programs) {
+        std::ostringstream expected;
+        eval::run_vm(expected, p.parse(prog.code));
+
+        auto const base = directory.path() + "/" + prog.name;
+        std::ofstream{base + ".cpp"} << c.compile(prog.code);
+        if (!run_command(cxx + " -std=c++14 -o " + base + " " + base + ".cpp >/dev/null 2>&1")) {
+            fail(prog.name + ": " + cxx + " rejects the output");
+            continue;
+        }
+        auto const actual = run_command(base);
+        check(actual == expected.str(), prog.name + ": the C++ output printed " + actual.value_or("nothing") + " instead of " + expected.str());
+    }
+}
+
+registration const _{"constexpr_output", constexpr_output};
+
+} // namespace
+
+} // namespace test
+} // namespace templa
@@ -0,0 +1,74 @@
+#include <string>
+#include <fstream>
+#include <sstream>
+
+#include "parser.hpp"
+#include "mpl_generator.hpp"
+#include "generator.hpp"
+#include "test.hpp"
+
+namespace templa {
+namespace test {
+
+namespace {
+
+// The last line which the program prints that is not empty
+std::string last_line(std::string const& output)
+{
+    std::istringstream in{output};
+    std::string line, last;
+    while (std::getline(in, line)) {
+        if (!line.empty()) {
+            last = line;
+        }
+    }
+    return last;
+}
+
+// Programs which recurse 10000 calls deep in templa.  The MPL output folds
+// them in halves, so it must compile with the default -ftemplate-depth of
+// the C++ compiler and print the same as the recursion would.
+void deep_recursion()
+{
+    struct program {
+        std::string name;
+        std::string code;
+        std::string expected;
+    };
+
+    program const programs[] = {
+        {"sum_10000", bench::generate_sum_program(10000), "50005000"},
+        {"list_sum_10000", bench::generate_list_sum_program(10000), "50005000"},
+        {"fizzbuzz_10000", bench::generate_fizzbuzz_program(10000), "buzz"},
+    };
+
+    auto const compiler = cxx_compiler();
+    temporary_directory const directory;
+    syntax::parser p;
+    for (auto const& prog : programs) {
+        auto const base = directory.path() + "/" + prog.name;
+        {
+            std::ofstream out{base + ".cpp"};
+            codegen::generate_mpl(out, p.parse(prog.code));
+        }
+
+        if (!run_command(compiler + " -std=c++14 -o " + base + " " + base + ".cpp >/dev/null 2>&1")) {
+            fail(prog.name + ": " + compiler + " rejects the output");
+            continue;
+        }
+        auto const output = run_command(base);
+        if (!output) {
+            fail(prog.name + ": the compiled program fails");
+            continue;
+        }
+        check(last_line(*output) == prog.expected,
+              prog.name + ": printed " + last_line(*output) + " instead of " + prog.expected);
+    }
+}
+
+registration const _{"deep_recursion", deep_recursion};
+
+} // namespace
+
+} // namespace test
+} // namespace templa
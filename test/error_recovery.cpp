@@ -0,0 +1,75 @@
+#include <string>
+
+#include <boost/variant/get.hpp>
+
+#include "parser.hpp"
+#include "helper/source_buffer.hpp"
+#include "generator.hpp"
+#include "test.hpp"
+
+namespace templa {
+namespace test {
+
+namespace {
+
+using backend = syntax::parser::backend;
+
+std::size_t num_declarations(ast::ast const& a)
+{
+    return ast::count_declarations(boost::get<ast::program const*>(a.root.value)->function_declarations);
+}
+
+// Breaks every `interval`th top-level declaration of code by inserting a ']'
+// after its '='.  Returns the number of broken declarations.
+std::size_t break_declarations(std::string &code, std::size_t const interval)
+{
+    std::size_t broken = 0;
+    std::size_t n = 0;
+    for (std::size_t line = 0; line < code.size(); line = code.find('\n', line) + 1) {
+        if (code[line] != 'f' || n++ % interval != 0) {
+            continue;
+        }
+        code.insert(code.find('=', line) + 1, " ]");
+        ++broken;
+        if (code.find('\n', line) == std::string::npos) {
+            break;
+        }
+    }
+    return broken;
+}
+
+void check_backend(backend const b, std::string const& name)
+{
+    syntax::parser p{b};
+    auto const code = bench::generate_program(64 * 1024);
+
+    // Without errors the result is the one of parse()
+    auto const valid = helper::source_buffer::copy_of(code);
+    syntax::diagnostics none;
+    auto const expected = p.parse(valid);
+    check(same_ast(expected, p.parse_recovering(valid, none)), name + ": the result differs from parse() on a valid program");
+    check(none.empty(), name + ": an error is reported on a valid program");
+
+    // Every broken declaration is reported once and only it is dropped
+    auto broken_code = code;
+    auto const num_broken = break_declarations(broken_code, 20);
+    syntax::diagnostics diags;
+    auto const partial = p.parse_recovering(helper::source_buffer::copy_of(broken_code), diags);
+    check(diags.entries().size() == num_broken,
+          name + ": " + std::to_string(diags.entries().size()) + " errors are reported for " + std::to_string(num_broken) + " broken declarations");
+    check(num_declarations(expected) - num_declarations(partial) == num_broken,
+          name + ": " + std::to_string(num_declarations(expected) - num_declarations(partial)) + " declarations are dropped for " + std::to_string(num_broken) + " broken ones");
+}
+
+void error_recovery()
+{
+    check_backend(backend::spirit, "spirit");
+    check_backend(backend::recursive_descent, "recursive_descent");
+}
+
+registration const _{"error_recovery", error_recovery};
+
+} // namespace
+
+} // namespace test
+} // namespace templa
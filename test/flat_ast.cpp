@@ -0,0 +1,49 @@
+#include <string>
+
+#include "parser.hpp"
+#include "flat_ast.hpp"
+#include "ast_dumper.hpp"
+#include "helper/source_buffer.hpp"
+#include "generator.hpp"
+#include "test.hpp"
+
+namespace templa {
+namespace test {
+
+namespace {
+
+// The flat representation must dump as the tree does, and compare as the
+// tree does
+void check_program(std::string const& name, ast::ast const& tree, ast::ast const& other_tree)
+{
+    auto const flat = ast::flatten(tree);
+    check(ast::dump_ast(tree) == ast::dump_ast(flat), name + ": the dumps of the tree and the flat representation differ");
+    check((tree == other_tree) == (flat == ast::flatten(other_tree)), name + ": the flat representations compare unlike the trees");
+}
+
+void flat_ast()
+{
+    syntax::parser p;
+    for (std::size_t size = 1024; size <= 64 * 1024; size *= 8) {
+        auto const code = bench::generate_program(size);
+        auto const name = std::to_string(size) + " bytes";
+        auto const tree = p.parse(code);
+        check_program(name, tree, p.parse(code));
+        check_program(name + ", changed", tree, p.parse(code + "zz(a) = a + 1\n"));
+
+        // A reparsed AST shares declarations of the previous one at other
+        // lines
+        auto const edited = "zz(a) = a + 1\n" + code;
+        auto const reparsed = p.reparse(tree, helper::source_buffer::copy_of(edited), {0, 0, 14});
+        check_program(name + ", reparsed", reparsed, p.parse(edited));
+        check(ast::dump_ast(ast::flatten(reparsed)) == ast::dump_ast(p.parse(edited)),
+              name + ": the flat representation of a reparsed AST dumps unlike a full parse");
+    }
+}
+
+registration const _{"flat_ast", flat_ast};
+
+} // namespace
+
+} // namespace test
+} // namespace templa
@@ -0,0 +1,166 @@
+#include <string>
+#include <random>
+#include <sstream>
+
+#include "parser.hpp"
+#include "evaluator.hpp"
+#include "semantic.hpp"
+#include "vm.hpp"
+#include "helper/source_buffer.hpp"
+#include "generator.hpp"
+#include "test.hpp"
+
+namespace templa {
+namespace test {
+
+namespace {
+
+using text_edit = syntax::parser::text_edit;
+
+struct edited {
+    std::string text;
+    text_edit edit;
+};
+
+edited apply(std::string const& text, std::size_t const offset, std::size_t const old_length, std::string const& replacement)
+{
+    return {
+        text.substr(0, offset) + replacement + text.substr(offset + old_length),
+        {offset, old_length, replacement.size()}
+    };
+}
+
+// A random edit of the kinds an editor produces: changing a digit, inserting
+// or deleting a line and replacing a few characters.  Many of them make the
+// program invalid.
+edited random_edit(std::string const& text, std::mt19937 &rng)
+{
+    auto const random_offset = [&]{ return std::uniform_int_distribution<std::size_t>{0, text.size() - 1}(rng); };
+    auto const offset = random_offset();
+
+    switch (rng() % 5) {
+    case 0: {
+        auto const digit = text.find_first_of("0123456789", offset);
+        if (digit == std::string::npos) {
+            return apply(text, 0, 0, "");
+        }
+        return apply(text, digit, 1, std::string(1, '0' + rng() % 10));
+    }
+    case 1: {
+        auto const newline = text.find('\n', offset);
+        return apply(text, newline == std::string::npos ? text.size() : newline, 0, "\nzz(a) = a + 1");
+    }
+    case 2: {
+        auto const newline = text.find('\n', offset);
+        auto const next = newline == std::string::npos ? std::string::npos : text.find('\n', newline + 1);
+        if (next == std::string::npos) {
+            return apply(text, 0, 0, "");
+        }
+        return apply(text, newline, next - newline, "");
+    }
+    case 3:
+        return apply(text, offset, 0, "\n");
+    default: {
+        auto const length = std::min<std::size_t>(rng() % 8, text.size() - offset);
+        return apply(text, offset, length, text.substr(random_offset(), rng() % 8));
+    }
+    }
+}
+
+boost::optional<ast::ast> try_parse(syntax::parser &p, std::string const& code)
+{
+    try {
+        return p.parse(code);
+    } catch (syntax::parse_error const&) {
+        return boost::none;
+    }
+}
+
+// Each reparse must agree with the full parse of the edited text.  Valid
+// edits are kept, so that later edits apply to reparsed ASTs.
+void check_edits(syntax::parser &p, std::string const& backend, std::size_t const num_edits)
+{
+    std::mt19937 rng{42};
+    std::string text = bench::generate_program(16 * 1024);
+    auto previous = p.parse(text);
+
+    for (std::size_t i = 0; i < num_edits; ++i) {
+        auto const e = random_edit(text, rng);
+        auto const expected = try_parse(p, e.text);
+
+        boost::optional<ast::ast> actual;
+        try {
+            actual = p.reparse(previous, helper::source_buffer::copy_of(e.text), e.edit);
+        } catch (syntax::parse_error const&) {}
+
+        check(same_ast(expected, actual),
+              backend + ": the reparse after the edit at offset " + std::to_string(e.edit.offset) + " differs from the full parse");
+
+        if (actual) {
+            text = e.text;
+            previous = *actual;
+        }
+    }
+}
+
+// Where running a fails, as "line:col", by the tree walker and the VM
+std::string error_positions(ast::ast const& a)
+{
+    auto const position_of = [&](auto const& run){
+        std::ostringstream out;
+        try {
+            run(out, a, eval::limits{}, nullptr);
+        } catch (eval::evaluation_error const& e) {
+            return std::to_string(e.line) + ':' + std::to_string(e.col);
+        } catch (semantic::semantic_error const& e) {
+            return std::to_string(e.line) + ':' + std::to_string(e.col);
+        }
+        return std::string{"none"};
+    };
+    return position_of(eval::run) + ' ' + position_of(eval::run_vm);
+}
+
+// The declarations after an edit which adds or removes lines are shared with
+// the previous AST at the lines they were parsed at.  Errors in them must be
+// reported at their lines in the edited text.
+void check_error_positions(syntax::parser &p, std::string const& backend)
+{
+    std::string const programs[] = {
+        "one = 1\ntwo = 2\nbad(x) = x + [1]\nmain = bad(one)\n",
+        "one = 1\ntwo = 2\nbad(x) = nothere(x)\nmain = bad(one)\n",
+        "one = 1\ntwo = 2\nbad(0) = 0\nmain = bad(one)\n",
+    };
+    for (auto const& code : programs) {
+        auto const inserted = apply(code, 0, 0, "zero = 0\nnil = 0\n");
+        auto const removed = apply(inserted.text, 0, inserted.edit.new_length, "");
+        auto const once = p.reparse(p.parse(code), helper::source_buffer::copy_of(inserted.text), inserted.edit);
+        auto const twice = p.reparse(once, helper::source_buffer::copy_of(removed.text), removed.edit);
+
+        auto const expected_once = error_positions(p.parse(inserted.text));
+        auto const actual_once = error_positions(once);
+        check(actual_once == expected_once,
+              backend + ": errors after inserting lines are at " + actual_once + " instead of " + expected_once);
+        auto const expected_twice = error_positions(p.parse(removed.text));
+        auto const actual_twice = error_positions(twice);
+        check(actual_twice == expected_twice,
+              backend + ": errors after removing lines are at " + actual_twice + " instead of " + expected_twice);
+    }
+}
+
+void incremental_reparse()
+{
+    syntax::parser spirit{syntax::parser::backend::spirit};
+    syntax::parser descent{syntax::parser::backend::recursive_descent};
+
+    check_edits(spirit, "spirit", 100);
+    check_edits(descent, "recursive_descent", 500);
+    check_error_positions(spirit, "spirit");
+    check_error_positions(descent, "recursive_descent");
+}
+
+registration const _{"incremental_reparse", incremental_reparse};
+
+} // namespace
+
+} // namespace test
+} // namespace templa
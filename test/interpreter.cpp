@@ -0,0 +1,56 @@
+#include <string>
+#include <sstream>
+
+#include "parser.hpp"
+#include "evaluator.hpp"
+#include "generator.hpp"
+#include "test.hpp"
+
+namespace templa {
+namespace test {
+
+namespace {
+
+// What the C++ program of generate_fizzbuzz_program(n) prints
+std::string fizzbuzz_output(std::size_t const n)
+{
+    std::string output;
+    for (std::size_t i = 1; i <= n; ++i) {
+        output += i % 15 == 0 ? "fizzbuzz" : i % 3 == 0 ? "fizz" : i % 5 == 0 ? "buzz" : std::to_string(i);
+        output += '\n';
+    }
+    return output + '\n';
+}
+
+// --run prints what the C++ program prints
+void interpreter()
+{
+    struct program {
+        std::string name;
+        std::string code;
+        std::string expected;
+    };
+
+    program const programs[] = {
+        {"fizzbuzz_100", bench::generate_fizzbuzz_program(100), fizzbuzz_output(100)},
+        {"fizzbuzz_10000", bench::generate_fizzbuzz_program(10000), fizzbuzz_output(10000)},
+        {"sum_10000", bench::generate_sum_program(10000), "50005000\n"},
+        {"list_sum_10000", bench::generate_list_sum_program(10000), "50005000\n"},
+    };
+
+    syntax::parser p;
+    eval::limits l;
+    l.depth = 100000;
+    for (auto const& prog : programs) {
+        std::ostringstream out;
+        eval::run(out, p.parse(prog.code), l);
+        check(out.str() == prog.expected, prog.name + " printed a wrong output");
+    }
+}
+
+registration const _{"interpreter", interpreter};
+
+} // namespace
+
+} // namespace test
+} // namespace templa
@@ -0,0 +1,134 @@
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include <unistd.h>
+
+#include "flat_ast.hpp"
+#include "test.hpp"
+
+namespace templa {
+namespace test {
+
+namespace {
+
+std::size_t failures = 0;
+
+} // namespace
+
+void fail(std::string const& message)
+{
+    std::cerr << "FAIL: " << message << std::endl;
+    ++failures;
+}
+
+boost::optional<std::string> run_command(std::string const& command)
+{
+    auto const pipe = ::popen(command.c_str(), "r");
+    if (pipe == nullptr) {
+        return boost::none;
+    }
+    std::string output;
+    char buffer[4096];
+    for (std::size_t n; (n = std::fread(buffer, 1, sizeof(buffer), pipe)) > 0;) {
+        output.append(buffer, n);
+    }
+    if (::pclose(pipe) != 0) {
+        return boost::none;
+    }
+    return output;
+}
+
+std::string cxx_compiler()
+{
+    auto const cxx = std::getenv("CXX");
+    if (cxx == nullptr || !run_command(std::string{cxx} + " --version >/dev/null 2>&1")) {
+        throw skipped{"no C++ compiler, set CXX"};
+    }
+    return cxx;
+}
+
+temporary_directory::temporary_directory()
+{
+    char name[] = "/tmp/templa_test_XXXXXX";
+    if (::mkdtemp(name) == nullptr) {
+        throw std::runtime_error{"can't create a directory under /tmp"};
+    }
+    directory = name;
+}
+
+temporary_directory::~temporary_directory()
+{
+    std::system(("rm -rf " + directory).c_str());
+}
+
+bool same_ast(boost::optional<ast::ast> const& expected, boost::optional<ast::ast> const& actual)
+{
+    if (!expected || !actual) {
+        return !expected && !actual;
+    }
+
+    if (*expected != *actual) {
+        return false;
+    }
+
+    auto const e = ast::flatten(*expected);
+    auto const a = ast::flatten(*actual);
+    return e.lines == a.lines && e.cols == a.cols;
+}
+
+std::vector<test_case> &registry()
+{
+    static std::vector<test_case> tests;
+    return tests;
+}
+
+} // namespace test
+} // namespace templa
+
+// Runs the tests named in the arguments, or all of them.  Exits with 1 if a
+// check fails, and with 77 if a test is skipped and none fails, which ctest
+// reports as skipped.
+int main(int const argc, char const* const argv[])
+{
+    using namespace templa::test;
+    auto const& tests = registry();
+
+    std::vector<test_case> selected;
+    if (argc == 1) {
+        selected = tests;
+    }
+    for (int i = 1; i < argc; ++i) {
+        auto const found = std::find_if(std::begin(tests), std::end(tests),
+                                        [&](auto const& t){ return std::strcmp(t.name, argv[i]) == 0; });
+        if (found == std::end(tests)) {
+            std::cerr << "Unknown test: " << argv[i] << "\nAvailable:";
+            for (auto const& t : tests) {
+                std::cerr << ' ' << t.name;
+            }
+            std::cerr << std::endl;
+            return 1;
+        }
+        selected.push_back(*found);
+    }
+
+    bool skipped_any = false;
+    for (auto const& t : selected) {
+        try {
+            t.run();
+        } catch (skipped const& e) {
+            std::cerr << "SKIP: " << t.name << ": " << e.what() << std::endl;
+            skipped_any = true;
+        } catch (std::exception const& e) {
+            fail(std::string{t.name} + " threw: " + e.what());
+        }
+    }
+
+    if (failures != 0) {
+        std::cerr << failures << " checks failed" << std::endl;
+        return 1;
+    }
+    return skipped_any ? 77 : 0;
+}
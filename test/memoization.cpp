@@ -0,0 +1,137 @@
+#include <string>
+#include <sstream>
+
+#include "parser.hpp"
+#include "evaluator.hpp"
+#include "bytecode.hpp"
+#include "vm.hpp"
+#include "memo.hpp"
+#include "constant_folding.hpp"
+#include "test.hpp"
+
+namespace templa {
+namespace test {
+
+namespace {
+
+// Hits and misses are counted per lookup and the least recently used result
+// is evicted first
+void check_table()
+{
+    int const f = 0;
+    int const g = 0;
+    eval::value const one = 1;
+    eval::value const two = 2;
+    eval::value const three = 3;
+    eval::value const char_one = '\x01';
+
+    eval::memo_table table{2};
+    table.store(&f, &one, 1, 10);
+    table.store(&f, &two, 1, 20);
+    auto const found = table.find(&f, &one, 1);
+    check(found && eval::equal(*found, 10), "a stored result is not found");
+    check(!table.find(&g, &one, 1), "a result is found for another function");
+    check(!table.find(&f, &char_one, 1), "a result is found for an argument of another type");
+
+    // f(1) was used after f(2)
+    table.store(&f, &three, 1, 30);
+    check(!table.find(&f, &two, 1), "the least recently used result is not evicted");
+    check(table.find(&f, &one, 1) && table.find(&f, &three, 1), "a recently used result is evicted");
+    check(table.size() == 2, std::to_string(table.size()) + " results are remembered with capacity 2");
+
+    auto const& s = table.stats();
+    check(s.hits == 3 && s.misses == 3 && s.stores == 3 && s.evictions == 1,
+          "hits " + std::to_string(s.hits) + ", misses " + std::to_string(s.misses) + ", stores "
+          + std::to_string(s.stores) + ", evictions " + std::to_string(s.evictions) + " instead of 3, 3, 3 and 1");
+
+    eval::memo_table none{0};
+    none.store(&f, &one, 1, 10);
+    check(!none.find(&f, &one, 1) && none.stats().stores == 0, "a table of capacity 0 remembers a result");
+}
+
+std::string run_output(ast::ast const& a, eval::limits const& l, bool const vm)
+{
+    std::ostringstream out;
+    if (vm) {
+        eval::run_vm(out, a, l);
+    } else {
+        eval::run(out, a, l);
+    }
+    return out.str();
+}
+
+// Memo tables of any capacity change the work, but not the results
+void check_programs()
+{
+    struct program {
+        std::string name;
+        std::string code;
+    };
+
+    program const programs[] = {
+        {"fib_20", "fib(0) = 0\nfib(1) = 1\nfib(n) = fib(n - 1) + fib(n - 2)\nmain = fib(20)\n"},
+        {
+            "binomial_16",
+            "choose(n, 0) = 1\n"
+            "choose(n, k) = if n == k then 1 else choose(n - 1, k - 1) + choose(n - 1, k)\n"
+            "main = choose(16, 8)\n"
+        },
+        {
+            "let_16",
+            "f(n) = let g(x) = x + n\n"
+            "       in g(1)\n"
+            "sum(0) = 0\n"
+            "sum(n) = f(n) + f(n) + sum(n - 1)\n"
+            "main = [sum(16), f(3)]\n"
+        },
+    };
+
+    syntax::parser p;
+    for (auto const& prog : programs) {
+        auto const a = p.parse(prog.code);
+        auto const code = eval::compile_bytecode(a);
+
+        eval::limits plain;
+        plain.steps = 100000000;
+        eval::vm without{code, plain};
+        auto const expected = without.call("main", {});
+        auto const expected_output = run_output(a, plain, false);
+        auto const expected_folded = eval::fold_constants(a, plain);
+
+        for (std::size_t const capacity : {1, 8, 4096}) {
+            auto l = plain;
+            l.memo = capacity;
+            auto const label = prog.name + " with memo " + std::to_string(capacity) + ": ";
+
+            eval::vm machine{code, l};
+            check(eval::equal(machine.call("main", {}), expected), label + "the VM computes another value");
+            check(machine.steps() <= without.steps(), label + "the VM takes more steps than without memo");
+            if (auto const m = machine.memoized()) {
+                auto const& s = m->stats();
+                check(capacity == 1 || s.hits != 0, label + "no call is found in the memo");
+                check(s.stores <= s.misses, label + "more results are stored than looked up in vain");
+                check((s.evictions == 0) == (capacity == 4096), label + "results are evicted only beyond the capacity");
+                check(m->size() <= capacity, label + "more results are remembered than the capacity");
+            } else {
+                fail(label + "the VM has no memo table");
+            }
+
+            check(run_output(a, l, false) == expected_output, label + "run prints another output");
+            check(run_output(a, l, true) == expected_output, label + "run_vm prints another output");
+            check(same_ast(expected_folded, eval::fold_constants(a, l)), label + "folding gives another AST");
+        }
+    }
+}
+
+void memoization()
+{
+    check_table();
+    check_programs();
+}
+
+registration const _{"memoization", memoization};
+
+} // namespace
+
+} // namespace test
+} // namespace templa
@@ -0,0 +1,80 @@
+#include <string>
+#include <sstream>
+#include <fstream>
+
+#include "parser.hpp"
+#include "evaluator.hpp"
+#include "vm.hpp"
+#include "mpl_generator.hpp"
+#include "generator.hpp"
+#include "test.hpp"
+
+namespace templa {
+namespace test {
+
+namespace {
+
+// The compiled MPL output must print what --run prints, and must not print
+// anything when --run fails.  Most of these programs are lowered to folds,
+// some of which would skip the recursion --run reports.
+void mpl_output()
+{
+    struct program {
+        std::string name;
+        std::string code;
+    };
+
+    program const programs[] = {
+        {"sum_left", "s(0) = 0\ns(n) = s(n - 1) + n\nmain = print(s(100))\n"},
+        {"sum_right", "s(n) = n + s(n - 1)\ns(0) = 0\nmain = print(s(100))\n"},
+        {"sum_from_base", "s(3) = 7\ns(n) = s(n - 1) + n\nmain = print(s(3))\n"},
+        {"sum_above_base", "s(n) = s(n - 1) + n\ns(3) = 7\nmain = print(s(10))\n"},
+        {"product", "p(1) = 1\np(n) = n * p(n - 1) * 2\nmain = print(p(10))\n"},
+        {"strings", "r(0) = \"\"\nr(n) = r(n - 1) + \"ab\"\nmain = print(r(5))\n"},
+        {"list_sum", bench::generate_list_sum_program(100)},
+        {"fizzbuzz", bench::generate_fizzbuzz_program(30)},
+        // Below the base the recursion never ends
+        {"below_base", "s(n) = s(n - 1) + n\ns(3) = 7\nmain = print(s(1))\n"},
+        {"if_skips_base", "s(n) = if n == 5 then 100 else s(n - 1) + n\nmain = print(s(2))\n"},
+        {"negative", "s(0) = 0\ns(n) = s(n - 1) + n\nmain = print(s(-3))\n"},
+    };
+
+    auto const compiler = cxx_compiler();
+    temporary_directory const directory;
+    syntax::parser p;
+    for (auto const& prog : programs) {
+        auto const a = p.parse(prog.code);
+
+        boost::optional<std::string> expected;
+        try {
+            std::ostringstream out;
+            eval::run_vm(out, a);
+            expected = out.str();
+        } catch (eval::evaluation_error const&) {}
+
+        auto const base = directory.path() + "/" + prog.name;
+        {
+            std::ofstream out{base + ".cpp"};
+            codegen::generate_mpl(out, a);
+        }
+        boost::optional<std::string> actual;
+        if (run_command(compiler + " -std=c++14 -o " + base + " " + base + ".cpp >/dev/null 2>&1")) {
+            actual = run_command(base);
+        }
+
+        if (!expected) {
+            check(!actual, prog.name + ": --run fails, but the C++ output printed " + actual.value_or(""));
+        } else if (!actual) {
+            fail(prog.name + ": --run printed " + *expected + ", but the C++ output fails");
+        } else {
+            check(*actual == *expected, prog.name + ": the C++ output printed " + *actual + " instead of " + *expected);
+        }
+    }
+}
+
+registration const _{"mpl_output", mpl_output};
+
+} // namespace
+
+} // namespace test
+} // namespace templa
@@ -0,0 +1,76 @@
+#include <string>
+
+#include <boost/optional.hpp>
+
+#include "parser.hpp"
+#include "helper/source_buffer.hpp"
+#include "helper/thread_pool.hpp"
+#include "generator.hpp"
+#include "test.hpp"
+
+namespace templa {
+namespace test {
+
+namespace {
+
+boost::optional<ast::ast> try_parse(syntax::parser &p, std::shared_ptr<helper::source_buffer const> const& source)
+{
+    try {
+        return p.parse(source);
+    } catch (syntax::parse_error const&) {
+        return boost::none;
+    }
+}
+
+boost::optional<ast::ast> try_parse(syntax::parser &p, std::shared_ptr<helper::source_buffer const> const& source, helper::thread_pool &pool)
+{
+    try {
+        return p.parse(source, pool);
+    } catch (syntax::parse_error const&) {
+        return boost::none;
+    }
+}
+
+// The parallel parse must agree with the sequential one on the AST and its
+// positions, also when the source is split into chunks which fail
+void check_backend(syntax::parser &p, std::string const& backend, helper::thread_pool &pool)
+{
+    // Large enough for several chunks, split at a declaration in the middle
+    auto const code = bench::generate_program(600 * 1024);
+    auto const middle = code.find("\nf", code.size() / 2) + 1;
+    std::string const programs[] = {
+        code,
+        code.substr(0, middle) + "a = [1, 2\n" + code.substr(middle),
+        code.substr(0, middle) + "in_between = 1\n\n" + code.substr(middle),
+    };
+
+    for (auto const& program : programs) {
+        auto const source = helper::source_buffer::copy_of(program);
+        auto const parallel = try_parse(p, source, pool);
+        check(same_ast(try_parse(p, source), parallel), backend + ": the parallel parse differs from the sequential one");
+
+        // A reparse finds the declarations of each chunk by their offsets
+        if (parallel) {
+            auto const edited = program.substr(0, middle) + "zz(a) = a + 1\n" + program.substr(middle);
+            auto const reparsed = p.reparse(*parallel, helper::source_buffer::copy_of(edited), {middle, 0, 14});
+            check(same_ast(try_parse(p, helper::source_buffer::copy_of(edited)), reparsed),
+                  backend + ": the reparse of a parallel parse differs from the full parse");
+        }
+    }
+}
+
+void parallel_parse()
+{
+    helper::thread_pool pool{4};
+    syntax::parser spirit{syntax::parser::backend::spirit};
+    syntax::parser descent{syntax::parser::backend::recursive_descent};
+    check_backend(spirit, "spirit", pool);
+    check_backend(descent, "recursive_descent", pool);
+}
+
+registration const _{"parallel_parse", parallel_parse};
+
+} // namespace
+
+} // namespace test
+} // namespace templa
@@ -0,0 +1,73 @@
+#include <string>
+#include <vector>
+
+#include "parser.hpp"
+#include "generator.hpp"
+#include "test.hpp"
+
+namespace templa {
+namespace test {
+
+namespace {
+
+std::vector<std::string> corpus()
+{
+    std::vector<std::string> programs = {
+        "a = 1 + 2\n",
+        "fizz = \"fizz\"\nbuzz = \"buzz\"\nfizzbuzz = fizz + buzz",
+        "to_string(x) = String(to_char(x)) + if x < 10 then \"\" else to_string(x-1)\n",
+        "to_fizzbuzz(n) = case\n"
+        "                 | n % 15 == 0 then fizzbuzz\n"
+        "                 | n %  3 == 0 then fizz\n"
+        "                 | n %  5 == 0 then buzz\n"
+        "                 | otherwise        to_string(n)\n",
+        "hoge = [1, 'a', \"hoge\"]\nhoge2 = [1 .. 10]\nfoo(x:y:xs) = [x, y]\n",
+        "f(x) = let\n g = [-3..+3]\n h(y::Int) = y\nin g || h(x) && !x\n",
+        "c = [a..z]\nd = [1..x]\ne = 2 * -3 - -4 + +5\n",
+        "g(a, b) = (a <= b) >= (a < b) > (a != b)\n",
+        // Names which begin with true or false are not booleans
+        "trueish = 1\nfalsey = trueish\nmain = falsey + 1\n",
+        "true_count = 3\nmain = true_count + 1\n",
+        "f(x) = if true then false else x\n",
+        // Syntax errors must be rejected by both backends
+        "a = \n",
+        "a = [1, 2\n",
+        "f(x = 1\n",
+        "a = 1\n\nb = 2\n",
+    };
+
+    for (std::size_t size = 64; size <= 64 * 1024; size *= 4) {
+        programs.push_back(bench::generate_program(size));
+    }
+
+    return programs;
+}
+
+boost::optional<ast::ast> try_parse(syntax::parser &p, std::string const& code)
+{
+    try {
+        return p.parse(code);
+    } catch (syntax::parse_error const&) {
+        return boost::none;
+    }
+}
+
+// Both backends must accept the same programs and build the same AST at the
+// same positions
+void parse_backends()
+{
+    syntax::parser spirit{syntax::parser::backend::spirit};
+    syntax::parser descent{syntax::parser::backend::recursive_descent};
+
+    for (auto const& code : corpus()) {
+        check(same_ast(try_parse(spirit, code), try_parse(descent, code)),
+              "the backends disagree on:\n" + code.substr(0, 200));
+    }
+}
+
+registration const _{"parse_backends", parse_backends};
+
+} // namespace
+
+} // namespace test
+} // namespace templa
@@ -0,0 +1,106 @@
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "parse_cache.hpp"
+#include "parser.hpp"
+#include "generator.hpp"
+#include "test.hpp"
+
+namespace templa {
+namespace test {
+
+namespace {
+
+// Paths of the entries in directory
+std::vector<std::string> entries_in(std::string const& directory)
+{
+    std::vector<std::string> entries;
+    if (DIR *const dir = ::opendir(directory.c_str())) {
+        while (auto const e = ::readdir(dir)) {
+            std::string const name = e->d_name;
+            if (name.size() > 4 && name.compare(name.size() - 4, 4, ".ast") == 0) {
+                entries.push_back(directory + '/' + name);
+            }
+        }
+        ::closedir(dir);
+    }
+    return entries;
+}
+
+std::uint64_t total_size(std::vector<std::string> const& paths)
+{
+    std::uint64_t total = 0;
+    for (auto const& p : paths) {
+        struct ::stat st;
+        if (::stat(p.c_str(), &st) == 0) {
+            total += st.st_size;
+        }
+    }
+    return total;
+}
+
+// The entry of another source under the name of this one, as a source of
+// the same hash and size would have, must not be loaded
+void check_verification(std::string const& directory)
+{
+    syntax::parser p;
+    auto const source = helper::source_buffer::copy_of("f(x) = x + 1\nmain = f(2)\n");
+    auto const other = helper::source_buffer::copy_of("f(x) = x + 2\nmain = f(3)\n");
+
+    parse_cache cache{directory + "/cache", 1024 * 1024};
+    cache.store(*other, p.parse(other));
+    check(static_cast<bool>(cache.load(other)), "a stored AST is not loaded");
+    parse_cache names{directory + "/names", 1024 * 1024};
+    names.store(*source, p.parse(source));
+
+    auto const entries = entries_in(directory + "/cache");
+    auto const name_of_source = entries_in(directory + "/names");
+    check(entries.size() == 1 && name_of_source.size() == 1, "one source is not stored as one entry");
+    if (entries.size() != 1 || name_of_source.size() != 1) {
+        return;
+    }
+    auto const colliding = directory + "/cache" + name_of_source.front().substr(name_of_source.front().rfind('/'));
+    check(std::rename(entries.front().c_str(), colliding.c_str()) == 0, "the entry cannot be renamed");
+    check(!cache.load(source), "the entry of a different text is loaded");
+}
+
+// Stores beyond the size limit evict the least recently used entries
+void check_eviction(std::string const& directory)
+{
+    syntax::parser p;
+    std::uint64_t const max_bytes = 64 * 1024;
+    parse_cache cache{directory, max_bytes};
+
+    std::shared_ptr<helper::source_buffer const> first;
+    for (std::size_t i = 0; i < 32; ++i) {
+        auto const source = helper::source_buffer::copy_of(bench::generate_program(4 * 1024) + "n = " + std::to_string(i) + "\n");
+        cache.store(*source, p.parse(source));
+        if (i == 0) {
+            first = source;
+        }
+    }
+
+    check(cache.stats().stores == 32, std::to_string(cache.stats().stores) + " of 32 stores");
+    check(cache.stats().evictions != 0, "no entry is evicted beyond the size limit");
+    check(total_size(entries_in(directory)) <= max_bytes, "the directory exceeds the size limit");
+    check(!cache.load(first), "the least recently used entry is not evicted");
+}
+
+void parse_cache_test()
+{
+    temporary_directory const directory;
+    check_verification(directory.path() + "/verification");
+    check_eviction(directory.path() + "/eviction");
+}
+
+registration const _{"parse_cache", parse_cache_test};
+
+} // namespace
+
+} // namespace test
+} // namespace templa
@@ -0,0 +1,97 @@
+#include <string>
+#include <sstream>
+#include <fstream>
+
+#include "compiler.hpp"
+#include "parse_cache.hpp"
+#include "server.hpp"
+#include "test.hpp"
+
+namespace templa {
+namespace test {
+
+namespace {
+
+std::string const original = "f(x) = x + 1\ng = \"s\" + \"t\"\nmain = f(2)\n";
+std::string const edited = "f(x) = x + 1\ng = \"s\" + \"t\"\nh = 3\nmain = f(2)\n";
+
+std::string answer(templa::server &s, std::string const& request)
+{
+    std::istringstream in{request + "\n"};
+    std::ostringstream out;
+    s.serve(in, out);
+    return out.str();
+}
+
+// A file compiled again by a server whose AST of it came from the parse
+// cache is unchanged or reparsed, and answered as a fresh compile is
+void server()
+{
+    temporary_directory const directory;
+    auto const path = directory.path() + "/a.templa";
+    auto const compile = "compile " + path;
+    parse_cache cache{directory.path() + "/cache", 1024 * 1024};
+
+    std::ofstream{path} << edited;
+    compiler fresh;
+    templa::server expected{fresh};
+    auto const edited_answer = answer(expected, compile);
+
+    std::ofstream{path} << original;
+    {
+        compiler c;
+        c.use_cache(cache);
+        templa::server first{c};
+        answer(first, compile);
+    }
+    check(cache.stats().stores == 1, "the first compile is not cached");
+
+    compiler c;
+    c.use_cache(cache);
+    templa::server s{c};
+    auto const loaded = answer(s, compile);
+    check(cache.stats().hits == 1, "the second server does not load the AST from the cache");
+    check(answer(s, compile) == loaded, "an unchanged file is answered differently");
+    check(s.stats().unchanged == 1 && s.stats().reparses == 0, "an unchanged file is reparsed");
+
+    std::ofstream{path} << edited;
+    check(answer(s, compile) == edited_answer, "the reparsed file is answered differently from a fresh compile");
+    check(s.stats().reparses == 1 && s.stats().full_parses == 1,
+          std::to_string(s.stats().reparses) + " reparses of one edit");
+}
+
+// A reparsed file whose output fails is answered by the error again when it
+// is compiled unchanged, not by the output of its last valid version
+void failed_output()
+{
+    temporary_directory const directory;
+    auto const path = directory.path() + "/a.templa";
+    auto const compile = "compile " + path;
+
+    compiler c{emit_kind::run};
+    templa::server s{c};
+    std::ofstream{path} << "main = 1\n";
+    check(answer(s, compile) == "ok 2\n1\n", "the valid file is not run");
+
+    std::ofstream{path} << "main = f(1)\n";
+    auto const failed = answer(s, compile);
+    check(failed.compare(0, 6, "error ") == 0, "a call of an undeclared function is answered by " + failed);
+    auto const again = answer(s, compile);
+    check(again == failed, "the unchanged file is answered by " + again + " instead of " + failed);
+
+    std::ofstream{path} << "main = 2\n";
+    check(answer(s, compile) == "ok 2\n2\n", "the fixed file is not run");
+}
+
+void server_test()
+{
+    server();
+    failed_output();
+}
+
+registration const _{"server", server_test};
+
+} // namespace
+
+} // namespace test
+} // namespace templa
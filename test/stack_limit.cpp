@@ -0,0 +1,56 @@
+#include <string>
+#include <sstream>
+
+#include "parser.hpp"
+#include "evaluator.hpp"
+#include "vm.hpp"
+#include "test.hpp"
+
+namespace templa {
+namespace test {
+
+namespace {
+
+// f(n) nests n calls, each of them `parentheses` parentheses deep
+std::string nested_program(std::size_t const n, std::size_t const parentheses)
+{
+    return
+        "f(0) = 0\n"
+        "f(n) = " + std::string(parentheses, '(') + "40 + f(n - 1)" + std::string(parentheses, ')') + "\n"
+        "main = print(f(" + std::to_string(n) + "))\n";
+}
+
+// The tree walker prints what the VM prints, or fails with limit_exceeded
+// where its stack ends, on the stack of run() and on that of the caller
+void stack_limit()
+{
+    syntax::parser p;
+    eval::limits l;
+    l.depth = 100000;
+    l.steps = 100000000;
+
+    for (std::size_t const parentheses : {0, 40, 400}) {
+        auto const a = p.parse(nested_program(90000, parentheses));
+        auto const name = std::to_string(parentheses) + " parentheses";
+
+        std::ostringstream expected;
+        eval::run_vm(expected, a, l);
+        try {
+            std::ostringstream actual;
+            eval::run(actual, a, l);
+            check(actual.str() == expected.str(), name + ": the tree walker printed " + actual.str() + " instead of " + expected.str());
+        } catch (eval::limit_exceeded const&) {}
+
+        try {
+            eval::evaluator e{a, l};
+            e.call("main", {});
+        } catch (eval::limit_exceeded const&) {}
+    }
+}
+
+registration const _{"stack_limit", stack_limit};
+
+} // namespace
+
+} // namespace test
+} // namespace templa
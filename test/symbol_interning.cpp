@@ -0,0 +1,91 @@
+#include <string>
+#include <vector>
+#include <thread>
+
+#include "parser.hpp"
+#include "identifier.hpp"
+#include "generator.hpp"
+#include "test.hpp"
+
+namespace templa {
+namespace test {
+
+namespace {
+
+// Threads which intern the same names in different orders, each into its
+// own table, must get the same ids, and an id must have the same text in
+// every thread
+void check_threads()
+{
+    std::size_t const num_threads = 8;
+    std::size_t const num_names = 5000;
+    std::vector<std::string> names;
+    for (std::size_t i = 0; i < num_names; ++i) {
+        names.push_back("symbol_interning_" + std::to_string(i));
+    }
+
+    std::vector<std::vector<std::uint32_t>> ids(num_threads, std::vector<std::uint32_t>(num_names));
+    std::vector<std::size_t> wrong_texts(num_threads);
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t]{
+            for (std::size_t k = 0; k < num_names; ++k) {
+                auto const i = t % 2 == 0 ? (k * 7919 + t) % num_names : num_names - 1 - k;
+                ast::identifier const id{names[i]};
+                ids[t][i] = id.id();
+                wrong_texts[t] += id.text() != names[i];
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    for (std::size_t t = 0; t < num_threads; ++t) {
+        check(ids[t] == ids.front(), "thread " + std::to_string(t) + " got other ids for the same names");
+        check(wrong_texts[t] == 0, "thread " + std::to_string(t) + " got " + std::to_string(wrong_texts[t]) + " ids of other names");
+    }
+
+    // The main thread sees the names for the first time, too
+    for (std::size_t i = 0; i < num_names; ++i) {
+        ast::identifier const id{names[i]};
+        if (id.id() != ids.front()[i] || id.text() != names[i]) {
+            fail("the main thread got another id for " + names[i]);
+            break;
+        }
+    }
+}
+
+// ASTs parsed in different threads compare their names by id, so they must
+// be equal
+void check_parses()
+{
+    auto const code = bench::generate_program(64 * 1024);
+    std::vector<ast::ast> asts(4);
+    std::vector<std::thread> threads;
+    for (auto &a : asts) {
+        threads.emplace_back([&]{
+            syntax::parser p{syntax::parser::backend::recursive_descent};
+            a = p.parse(code);
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    for (auto const& a : asts) {
+        check(same_ast(asts.front(), a), "ASTs parsed in different threads differ");
+    }
+}
+
+void symbol_interning()
+{
+    check_threads();
+    check_parses();
+}
+
+registration const _{"symbol_interning", symbol_interning};
+
+} // namespace
+
+} // namespace test
+} // namespace templa
@@ -0,0 +1,78 @@
+#if !defined TEMPLA_TEST_TEST_HPP_INCLUDED
+#define      TEMPLA_TEST_TEST_HPP_INCLUDED
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include <boost/optional.hpp>
+
+#include "ast.hpp"
+
+namespace templa {
+namespace test {
+
+// Reports a failed check of the running test.  The test goes on, so that one
+// run reports every mismatch, and fails at its end.
+void fail(std::string const& message);
+
+inline void check(bool const condition, std::string const& message)
+{
+    if (!condition) {
+        fail(message);
+    }
+}
+
+// Thrown when the test can't run here, e.g. without a C++ compiler
+struct skipped : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+// Runs command with the shell and returns what it writes to the standard
+// output, or none if it exits with non-zero status
+boost::optional<std::string> run_command(std::string const& command);
+
+// The C++ compiler in $CXX which accepts the C++ output.  Throws skipped
+// without one.
+std::string cxx_compiler();
+
+// A directory under /tmp which is removed with everything in it at the end
+// of its scope
+class temporary_directory {
+public:
+    temporary_directory();
+    ~temporary_directory();
+
+    temporary_directory(temporary_directory const&) = delete;
+    temporary_directory &operator=(temporary_directory const&) = delete;
+
+    std::string const& path() const
+    {
+        return directory;
+    }
+
+private:
+    std::string directory;
+};
+
+// Whether both are none or both are equal ASTs at equal positions
+bool same_ast(boost::optional<ast::ast> const& expected, boost::optional<ast::ast> const& actual);
+
+struct test_case {
+    char const* name;
+    void (*run)();
+};
+
+std::vector<test_case> &registry();
+
+struct registration {
+    registration(char const* name, void (*run)())
+    {
+        registry().push_back({name, run});
+    }
+};
+
+} // namespace test
+} // namespace templa
+
+#endif    // TEMPLA_TEST_TEST_HPP_INCLUDED